@@ -0,0 +1,207 @@
+#include "benchmark.h"
+#include "Tracker.h"
+#include "Calibration.h"
+#include "Processor.h"
+#include "EventDetector.h"
+#include "JsonBuilder.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+std::vector<cv::Mat> MakeFrames(cv::Size, int);
+std::string WriteCalibration(cv::Size);
+template<class T> std::vector<T> ParseList(const std::string&);
+
+int main(int argc, char** argv)
+{
+    int iterations = 20, warmup = 3;
+    double tolerance = 0.10;
+    std::string output = "", baseline = "";
+    std::vector<cv::Size> resolutions = { cv::Size(640, 480), cv::Size(1280, 960), cv::Size(1920, 1440) };
+    std::vector<int> thread_counts = { 1, int(std::max(1u, std::thread::hardware_concurrency())) };
+
+    for(int i = 1; i < argc - 1; i += 2)
+    {
+        std::string arg = argv[i], value = argv[i + 1];
+        if(arg == "--iterations")       iterations = std::stoi(value);
+        else if(arg == "--warmup")      warmup = std::stoi(value);
+        else if(arg == "--threads")     thread_counts = ParseList<int>(value);
+        else if(arg == "--resolutions") resolutions = ParseList<cv::Size>(value);
+        else if(arg == "--output")      output = value;
+        else if(arg == "--baseline")    baseline = value;
+        else if(arg == "--tolerance")   tolerance = std::stod(value);
+        else
+        {
+            std::cerr << "Usage: run_benchmarks [--iterations N] [--warmup N] [--threads 1,4,8]\n"
+                         "                      [--resolutions 640x480,1920x1440] [--output FILE]\n"
+                         "                      [--baseline FILE] [--tolerance 0.1]\n";
+            return 2;
+        }
+    }
+
+    Benchmark bench(iterations, warmup);
+    std::cerr << "=== Running Benchmarks ===\n";
+
+    for(auto resolution : resolutions)
+    {
+        auto frames = MakeFrames(resolution, 16);
+        std::string calib_file = WriteCalibration(resolution);
+
+        for(int threads : thread_counts)
+        {
+            Tracker::Settings t_conf;
+            t_conf.bDrawContours = false;
+            t_conf.MinThreshold = 200;
+            Tracker tracker(t_conf);
+            size_t f = 0;
+
+            bench.Run("CreateMask", resolution, threads, [&]() {
+                cv::Mat frame = frames[f++ % frames.size()].clone();
+                tracker.CreateMask(frame);
+            });
+
+            // Contours are found on the mask left behind by the last CreateMask.
+            bench.Run("GetObjectContours", resolution, threads, [&]() {
+                tracker.GetObjectContours(frames[0]);
+            });
+
+            Calibration::Input input;
+            input.image_size = resolution;
+            Calibration calib(input, CalibrationType::STEREO, calib_file);
+            calib.ReadCalibration();
+
+            bench.Run("UndistortImage", resolution, threads, [&]() {
+                cv::Mat frame = frames[f++ % frames.size()].clone();
+                calib.UndistortImage(frame, 0);
+            });
+
+            bench.Run("ConcatenateMatrices", resolution, threads, [&]() {
+                ConcatenateMatrices(frames[f % frames.size()], frames[(f + 1) % frames.size()]);
+                f++;
+            });
+
+            // None of the frames hold a QR code, which is the common case while
+            // the videos are being scanned for a sync point.
+            bench.Run("QRDetection", resolution, threads, [&]() {
+                QREvent qr;
+                int frame_num = int(f);
+                qr.CheckFrame(frames[f++ % frames.size()], frame_num);
+            });
+        }
+    }
+
+    // The remaining cases do not depend on the frame size.
+    for(int threads : thread_counts)
+    {
+        bench.Run("BuildJSON", cv::Size(), threads, []() {
+            JSON events("DetectedEvents");
+            for(int i = 1; i <= 1000; i++)
+            {
+                ActivityEvent event(i, i * 10, i * 10 + 5);
+                events.AddObject(event.GetAsJSON());
+            }
+            events.BuildJSONObjectArray();
+        });
+
+        Calibration::Input input;
+        input.image_size = resolutions.empty() ? cv::Size(1920, 1440) : resolutions.back();
+        Calibration calib(input, CalibrationType::STEREO, WriteCalibration(input.image_size));
+
+        cv::RNG rng(7);
+        for(int i = 0; i < 2; i++)
+            for(int j = 0; j < 10; j++)
+            {
+                std::vector<cv::Point2f> points(500);
+                for(auto& point : points)
+                    point = cv::Point2f(rng.uniform(0.f, float(input.image_size.width)),
+                                        rng.uniform(0.f, float(input.image_size.height)));
+                calib._input.image_points[i].push_back(points);
+            }
+        calib.ReadCalibration();
+
+        bench.Run("TriangulatePoints", cv::Size(), threads, [&]() {
+            calib.TriangulatePoints();
+        });
+    }
+
+    std::string json = bench.GetJSON();
+    if(output != "")
+    {
+        std::ofstream out(output);
+        out << json;
+    }
+    else std::cout << json << std::endl;
+
+    int regressions = 0;
+    if(baseline != "")
+    {
+        regressions = bench.Compare(baseline, tolerance);
+        std::cerr << "=== " << regressions << " regression(s) against \"" << baseline << "\" ===\n";
+    }
+    std::cerr << "=== Finished Benchmarks ===\n";
+
+    return regressions > 0 ? 1 : 0;
+}
+
+/// Renders a sequence of frames with a textured background and a dark
+/// ellipse moving across it, so the tracker has something to find.
+std::vector<cv::Mat> MakeFrames(cv::Size size, int count)
+{
+    cv::RNG rng(12345);
+    cv::Mat background(size, CV_8UC3);
+    rng.fill(background, cv::RNG::UNIFORM, cv::Scalar::all(60), cv::Scalar::all(120));
+    cv::GaussianBlur(background, background, cv::Size(15, 15), 5);
+
+    std::vector<cv::Mat> frames;
+    for(int i = 0; i < count; i++)
+    {
+        cv::Mat frame = background.clone();
+        cv::Point center(size.width * (i + 1) / (count + 1), size.height / 2);
+        cv::ellipse(frame, center, cv::Size(size.width / 12, size.height / 30), 0, 0, 360, cv::Scalar(20, 30, 25), cv::FILLED);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+/// Writes a plausible stereo calibration for a frame size, and returns the
+/// file name to load it with.
+std::string WriteCalibration(cv::Size size)
+{
+    mkdir("calib_config", 0755);
+    std::string name = "bench_calibration_" + std::to_string(size.width) + "x" + std::to_string(size.height) + ".yaml";
+
+    double f = 0.8 * size.width, cx = size.width / 2.0, cy = size.height / 2.0, baseline = 100.0;
+    cv::Mat K = (cv::Mat_<double>(3, 3) << f, 0, cx, 0, f, cy, 0, 0, 1);
+    cv::Mat D = (cv::Mat_<double>(1, 5) << -0.2, 0.05, 0, 0, 0);
+    cv::Mat P1 = (cv::Mat_<double>(3, 4) << f, 0, cx, 0, 0, f, cy, 0, 0, 0, 1, 0);
+    cv::Mat P2 = (cv::Mat_<double>(3, 4) << f, 0, cx, -f * baseline, 0, f, cy, 0, 0, 0, 1, 0);
+    cv::Mat T = (cv::Mat_<double>(3, 1) << -baseline, 0, 0);
+    cv::Mat I = cv::Mat::eye(3, 3, CV_64F);
+
+    cv::FileStorage fs("calib_config/" + name, cv::FileStorage::WRITE);
+    fs << "K1" << K << "D1" << D << "K2" << K << "D2" << D;
+    fs << "E" << I << "F" << I << "R" << I << "T" << T;
+    fs << "P1" << P1 << "R1" << I << "P2" << P2 << "R2" << I;
+    return name;
+}
+
+template<class T> T ParseValue(const std::string& str) { return T(std::stod(str)); }
+template<> cv::Size ParseValue<cv::Size>(const std::string& str)
+{
+    size_t x = str.find('x');
+    return cv::Size(std::stoi(str.substr(0, x)), std::stoi(str.substr(x + 1)));
+}
+
+template<class T> std::vector<T> ParseList(const std::string& str)
+{
+    std::vector<T> values;
+    std::stringstream stream(str);
+    std::string item;
+    while(std::getline(stream, item, ','))
+        if(item != "") values.push_back(ParseValue<T>(item));
+    return values;
+}
@@ -0,0 +1,120 @@
+#include "benchmark.h"
+#include "JsonBuilder.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+std::string CaseKey(const std::string&, cv::Size, int);
+
+Benchmark::Benchmark(int iterations, int warmup)
+    : _iterations{std::max(1, iterations)}, _warmup{std::max(0, warmup)}
+{
+}
+
+void Benchmark::Run(const std::string& name, cv::Size resolution, int threads, std::function<void()> fn)
+{
+    cv::setNumThreads(threads);
+
+    for(int i = 0; i < _warmup; i++)
+        fn();
+
+    std::vector<double> times(_iterations);
+    for(int i = 0; i < _iterations; i++)
+    {
+        auto start = cv::getTickCount();
+        fn();
+        times[i] = 1000.0 * double(cv::getTickCount() - start) / cv::getTickFrequency();
+    }
+    std::sort(times.begin(), times.end());
+
+    Result result;
+    result.name       = name;
+    result.resolution = resolution;
+    result.threads    = threads;
+    result.iterations = _iterations;
+    result.mean_ms    = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+    result.p50_ms     = times[times.size() / 2];
+    result.p95_ms     = times[std::min(times.size() - 1, size_t(times.size() * 0.95))];
+    result.min_ms     = times.front();
+    _results.push_back(result);
+
+    std::cerr << "  > " << CaseKey(name, resolution, threads) << ": " << result.p50_ms << " ms\n";
+}
+
+std::string Benchmark::GetJSON() const
+{
+    JSON benchmarks("Benchmarks");
+
+    std::map<std::string, std::string> environment;
+    environment.insert(std::make_pair("opencv", CV_VERSION));
+    environment.insert(std::make_pair("hardware_threads", std::to_string(std::thread::hardware_concurrency())));
+    benchmarks.AddObject(JSON("Environment", environment));
+
+    for(const auto& result : _results)
+    {
+        std::map<std::string, std::string> values;
+        values.insert(std::make_pair("width", std::to_string(result.resolution.width)));
+        values.insert(std::make_pair("height", std::to_string(result.resolution.height)));
+        values.insert(std::make_pair("threads", std::to_string(result.threads)));
+        values.insert(std::make_pair("iterations", std::to_string(result.iterations)));
+        values.insert(std::make_pair("mean_ms", std::to_string(result.mean_ms)));
+        values.insert(std::make_pair("p50_ms", std::to_string(result.p50_ms)));
+        values.insert(std::make_pair("p95_ms", std::to_string(result.p95_ms)));
+        values.insert(std::make_pair("min_ms", std::to_string(result.min_ms)));
+        benchmarks.AddObject(JSON(result.name, values));
+    }
+
+    benchmarks.BuildJSONObjectArray();
+    return benchmarks.GetJSON();
+}
+
+int Benchmark::Compare(const std::string& baseline_file, double tolerance) const
+{
+    cv::FileStorage fs(baseline_file, cv::FileStorage::READ);
+    if(!fs.isOpened())
+        throw std::runtime_error("Could not open baseline \"" + baseline_file + "\"!");
+
+    // Index the baseline medians by case.
+    std::map<std::string, double> baseline;
+    for(auto entry : fs["Benchmarks"])
+        for(auto bench : entry)
+        {
+            if(bench.name() == "Environment") continue;
+
+            cv::Size resolution((int)bench["width"], (int)bench["height"]);
+            baseline[CaseKey(bench.name(), resolution, (int)bench["threads"])] = (double)bench["p50_ms"];
+        }
+
+    int regressions = 0;
+    for(const auto& result : _results)
+    {
+        std::string key = CaseKey(result.name, result.resolution, result.threads);
+        auto it = baseline.find(key);
+        if(it == baseline.end() || it->second <= 0.0) continue;
+
+        double change = result.p50_ms / it->second - 1.0;
+        if(change > tolerance)
+        {
+            std::cerr << " !> " << key << " regressed by " << int(change * 100) << "% ("
+                      << it->second << " ms -> " << result.p50_ms << " ms)\n";
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+const std::vector<Benchmark::Result>& Benchmark::GetResults() const
+{
+    return _results;
+}
+
+std::string CaseKey(const std::string& name, cv::Size resolution, int threads)
+{
+    std::ostringstream key;
+    key << name << "@" << resolution.width << "x" << resolution.height << "/t" << threads;
+    return key.str();
+}
@@ -0,0 +1,63 @@
+/// \date October 19, 2026
+///
+/// A small timing harness for the findFish hot paths. Each case is run a few
+/// times to warm up, then timed over a fixed number of iterations, and the
+/// results are written as JSON so that runs from different builds can be
+/// compared against each other.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/// Times benchmark cases and reports or compares their results.
+class Benchmark
+{
+public:
+    /// Timing results for a single case.
+    struct Result
+    {
+        std::string name;
+        cv::Size resolution;
+        int threads;
+        int iterations;
+
+        double mean_ms;
+        double p50_ms;
+        double p95_ms;
+        double min_ms;
+    };
+
+public:
+    /// Constructs a harness that times every case the same number of times.
+    /// \param[in] iterations The number of timed calls per case.
+    /// \param[in] warmup The number of untimed calls made first.
+    Benchmark(int iterations, int warmup);
+
+    /// Times a single case and records the result.
+    /// \param[in] name The name of the case.
+    /// \param[in] resolution The frame size the case runs on.
+    /// \param[in] threads The number of OpenCV threads to run with.
+    /// \param[in] fn The code to time.
+    void Run(const std::string& name, cv::Size resolution, int threads, std::function<void()> fn);
+
+    /// Returns every recorded result as a JSON document.
+    std::string GetJSON() const;
+
+    /// Compares the recorded results against a previous run.
+    /// \param[in] baseline_file A JSON file written by a previous run.
+    /// \param[in] tolerance The allowed relative slowdown of the median.
+    /// \returns The number of cases that got slower than the tolerance allows.
+    int Compare(const std::string& baseline_file, double tolerance) const;
+
+    /// Returns every recorded result.
+    const std::vector<Result>& GetResults() const;
+
+private:
+    int _iterations;
+    int _warmup;
+    std::vector<Result> _results;
+};
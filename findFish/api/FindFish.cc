@@ -0,0 +1,260 @@
+#include "FindFish.h"
+
+#include "../resources/includes/Processor.h"
+#include "../resources/includes/Calibration.h"
+#include "../resources/includes/ProgressReporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(int(FF_STAGE_STARTING) == int(PROGRESS_STARTING) && int(FF_STAGE_STOPPED) == int(PROGRESS_STOPPED),
+              "ff_stage has to match ProgressStage");
+
+/// The settings jobs read when they aren't given any.
+static const char* CONFIG_FILE = "config/findfish.yaml";
+
+/// The stereo calibration points are triangulated with when none is given.
+static const char* CALIBRATION_FILE = "stereo_calibration.yaml";
+
+struct ff_job
+{
+    std::vector<std::string> Videos;
+    std::string Name;
+    std::string ConfigFile;
+    ff_progress_fn OnProgress = nullptr;
+    ff_event_fn OnEvent = nullptr;
+    void* User = nullptr;
+
+    std::thread Thread;
+    std::atomic<int> Status{FF_RUNNING};
+    std::string Error;
+
+    // Guards the processor, which is only made once the job's thread starts,
+    // so a cancel can't slip in between.
+    std::mutex Mutex;
+    std::unique_ptr<Processor> Proc;
+    bool bCancelled = false;
+
+    // Only one caller may join the thread.
+    std::mutex JoinMutex;
+};
+
+static void RunJob(ff_job*);
+static void Finish(ff_job*, int, const std::string&);
+static void CopyError(const std::string&, char*, size_t);
+
+int ff_version(void)
+{
+    return FINDFISH_API_VERSION;
+}
+
+ff_job* ff_job_submit(const ff_job_options* options)
+{
+    ff_job* job = nullptr;
+    try
+    {
+        job = new ff_job();
+        if(!options)
+            throw std::runtime_error("No options were given.");
+        if(!options->videos || options->n_videos < 2)
+            throw std::runtime_error("A job needs a video for each camera, and at least two cameras.");
+
+        for(size_t i = 0; i < options->n_videos; i++)
+        {
+            if(!options->videos[i])
+                throw std::runtime_error("Video " + std::to_string(i) + " is NULL.");
+            job->Videos.push_back(options->videos[i]);
+        }
+        job->Name       = options->name ? options->name : "";
+        job->ConfigFile = options->config_file ? options->config_file : CONFIG_FILE;
+        job->OnProgress = options->on_progress;
+        job->OnEvent    = options->on_event;
+        job->User       = options->user;
+
+        job->Thread = std::thread(RunJob, job);
+    }
+    catch(const std::bad_alloc&)
+    {
+        delete job;
+        return nullptr;
+    }
+    catch(const std::exception& e)
+    {
+        if(job->OnProgress)
+            job->OnProgress(job->User, FF_STAGE_FAILED, 0, 0, 0.0);
+        Finish(job, FF_ERROR, e.what());
+    }
+    return job;
+}
+
+int ff_job_status(const ff_job* job)
+{
+    return job ? job->Status.load() : FF_ERROR;
+}
+
+int ff_job_wait(ff_job* job)
+{
+    if(!job)
+        return FF_ERROR;
+
+    std::lock_guard<std::mutex> lock(job->JoinMutex);
+    if(job->Thread.joinable())
+        job->Thread.join();
+    return job->Status;
+}
+
+void ff_job_cancel(ff_job* job)
+{
+    if(!job)
+        return;
+
+    std::lock_guard<std::mutex> lock(job->Mutex);
+    job->bCancelled = true;
+    if(job->Proc)
+        job->Proc->Cancel();
+}
+
+const char* ff_job_error(const ff_job* job)
+{
+    // The error is written before the status, so it is settled once the
+    // job isn't running.
+    if(!job || job->Status == FF_RUNNING)
+        return "";
+    return job->Error.c_str();
+}
+
+void ff_job_free(ff_job* job)
+{
+    if(!job)
+        return;
+
+    ff_job_wait(job);
+    delete job;
+}
+
+int ff_triangulate(const char* calib_file, const float* left, const float* right, size_t n_points,
+                   float* xyz, char* error, size_t error_size)
+{
+    try
+    {
+        if(n_points > 0 && (!left || !right || !xyz))
+            throw std::runtime_error("The points and where they go can't be NULL.");
+
+        std::vector<cv::Point2f> points[2];
+        for(size_t i = 0; i < n_points; i++)
+        {
+            points[0].push_back(cv::Point2f(left[2 * i], left[2 * i + 1]));
+            points[1].push_back(cv::Point2f(right[2 * i], right[2 * i + 1]));
+        }
+
+        Calibration::Input input;
+        Calibration calib(input, CalibrationType::STEREO, calib_file ? calib_file : CALIBRATION_FILE);
+        calib.ReadCalibration();
+
+        auto world = calib.Triangulate(points[0], points[1]);
+        for(size_t i = 0; i < world.size(); i++)
+        {
+            xyz[3 * i]     = world[i].x;
+            xyz[3 * i + 1] = world[i].y;
+            xyz[3 * i + 2] = world[i].z;
+        }
+        CopyError("", error, error_size);
+        return FF_OK;
+    }
+    catch(const std::exception& e)
+    {
+        CopyError(e.what(), error, error_size);
+        return FF_ERROR;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+/// Processes a job, on its own thread.
+static void RunJob(ff_job* job)
+{
+    // Progress only goes to the callback, as nothing is polling for it.
+    auto progress = std::make_shared<ProgressReporter>("");
+    if(job->OnProgress)
+        progress->Listener = [job](ProgressStage stage, int64_t frame, int64_t total_frames, double fps)
+        {
+            job->OnProgress(job->User, stage, frame, total_frames, fps);
+        };
+
+    try
+    {
+        std::string name = job->Name;
+        if(name.empty())
+            name = job->Videos[0].substr(job->Videos[0].find_last_of('/') + 1);
+        progress->SetPair(0, 1, name);
+
+        auto processor = std::make_unique<Processor>(job->Videos);
+        processor->Config = Processor::ReadSettings(job->ConfigFile);
+        processor->Progress = progress;
+        processor->bObeyStopRequests = false;
+        if(!job->Name.empty())
+            processor->SetName(job->Name);
+        if(job->OnEvent)
+            processor->OnEvent = [job](const std::string& event)
+            {
+                job->OnEvent(job->User, event.c_str());
+            };
+
+        Processor* p;
+        {
+            std::lock_guard<std::mutex> lock(job->Mutex);
+            job->Proc = std::move(processor);
+            p = job->Proc.get();
+            if(job->bCancelled)
+                p->Cancel();
+        }
+        p->ProcessVideos();
+
+        bool bCancelled;
+        {
+            std::lock_guard<std::mutex> lock(job->Mutex);
+            bCancelled = job->bCancelled;
+        }
+
+        if(p->Success)
+            Finish(job, FF_OK, "");
+        else if(bCancelled)
+            Finish(job, FF_CANCELLED, "");
+        else if(!p->Error.empty())
+            Finish(job, FF_ERROR, p->Error);
+        else
+            throw std::runtime_error("The videos aren't named alike, so the job needs a name.");
+    }
+    catch(const std::exception& e)
+    {
+        progress->SetStage(PROGRESS_FAILED);
+        Finish(job, FF_ERROR, e.what());
+    }
+}
+
+/// Settles how a job ended.
+static void Finish(ff_job* job, int status, const std::string& error)
+{
+    job->Error  = error;
+    job->Status = status;
+}
+
+/// Copies an error into a caller's buffer, cutting it short if it has to.
+static void CopyError(const std::string& message, char* error, size_t error_size)
+{
+    if(!error || error_size == 0)
+        return;
+
+    size_t n = std::min(message.size(), error_size - 1);
+    std::memcpy(error, message.c_str(), n);
+    error[n] = '\0';
+}
@@ -0,0 +1,143 @@
+/// \date October 19, 2026
+///
+/// The C interface to findFish, for running jobs inside another process (the
+/// GoFish server calls it through cgo) instead of starting FishFinder and
+/// polling the files it writes. Each job runs on its own thread, reports its
+/// progress and events through callbacks as it goes, and can be cancelled on
+/// its own. Jobs still write their results where FishFinder does. Everything
+/// here is plain C, so bump FINDFISH_API_VERSION whenever a declaration
+/// changes.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FINDFISH_API_VERSION 1
+
+#if defined(__GNUC__)
+#define FINDFISH_API __attribute__((visibility("default")))
+#else
+#define FINDFISH_API
+#endif
+
+/// The stage a job is in. The same stages the status files publish.
+typedef enum
+{
+    FF_STAGE_STARTING,
+    FF_STAGE_SYNCING,
+    FF_STAGE_PROCESSING,
+    FF_STAGE_FINALIZING,
+    FF_STAGE_DONE,
+    FF_STAGE_FAILED,
+    FF_STAGE_STOPPED
+} ff_stage;
+
+/// How a call or a job turned out.
+typedef enum
+{
+    FF_OK        = 0,
+    FF_RUNNING   = 1,
+    FF_ERROR     = -1,
+    FF_CANCELLED = -2
+} ff_status;
+
+/// A job running in the background.
+typedef struct ff_job ff_job;
+
+/// Called on the job's thread whenever its progress is published, at most
+/// every quarter of a second while frames are being processed.
+/// \param[in] user The user pointer the job was submitted with.
+/// \param[in] stage An ff_stage.
+/// \param[in] frame How many frames have been processed.
+/// \param[in] total_frames How many frames will be processed.
+/// \param[in] fps How fast frames are being processed.
+typedef void (*ff_progress_fn)(void* user, int stage, int64_t frame, int64_t total_frames, double fps);
+
+/// Called on the job's thread with each event the job found, once they have
+/// all been found.
+/// \param[in] user The user pointer the job was submitted with.
+/// \param[in] event_json The event, as written to the events file. Only valid
+///                       during the call.
+typedef void (*ff_event_fn)(void* user, const char* event_json);
+
+/// What to process, and who to tell about it.
+typedef struct
+{
+    // One synced video per camera, the stereo pair first.
+    const char* const* videos;
+    size_t n_videos;
+
+    // What to name the results. NULL names them after the videos.
+    const char* name;
+
+    // The settings to process with. NULL reads config/findfish.yaml.
+    const char* config_file;
+
+    // Either callback may be NULL.
+    ff_progress_fn on_progress;
+    ff_event_fn on_event;
+    void* user;
+} ff_job_options;
+
+/// Returns the FINDFISH_API_VERSION the library was built with.
+FINDFISH_API int ff_version(void);
+
+/// Starts processing a job on a thread of its own. The options are copied,
+/// so they can go as soon as this returns. Jobs don't share the cores with
+/// other jobs the way FishFinder does, as OpenCV's threads belong to the
+/// whole process.
+/// \param[in] options What to process.
+/// \returns The job, which has to be freed with ff_job_free. Jobs that can't
+///          start finish straight away with FF_ERROR. NULL only if out of
+///          memory.
+FINDFISH_API ff_job* ff_job_submit(const ff_job_options* options);
+
+/// Checks on a job without waiting.
+/// \param[in] job The job.
+/// \returns FF_RUNNING, or how the job ended.
+FINDFISH_API int ff_job_status(const ff_job* job);
+
+/// Waits for a job to finish.
+/// \param[in] job The job.
+/// \returns FF_OK, FF_ERROR or FF_CANCELLED.
+FINDFISH_API int ff_job_wait(ff_job* job);
+
+/// Asks a job to stop after the frame it is on. A job stopped while
+/// processing in one pass leaves a checkpoint, and is resumed by the next
+/// job with the same videos. Safe to call from any thread, and more than once.
+/// \param[in] job The job.
+FINDFISH_API void ff_job_cancel(ff_job* job);
+
+/// Says why a job failed.
+/// \param[in] job The job.
+/// \returns The reason, or an empty string if it didn't fail. Valid until the
+///          job is freed.
+FINDFISH_API const char* ff_job_error(const ff_job* job);
+
+/// Waits for a job to finish, then frees it. Cancel it first to not wait for
+/// the whole job.
+/// \param[in] job The job. May be NULL.
+FINDFISH_API void ff_job_free(ff_job* job);
+
+/// Triangulates points marked on the undistorted left and right frames of a
+/// processed video into the left camera's coordinates.
+/// \param[in] calib_file The stereo calibration in calib_config/. NULL uses
+///                       stereo_calibration.yaml.
+/// \param[in] left The x and y of each point on the left frame.
+/// \param[in] right The x and y of each point on the right frame.
+/// \param[in] n_points How many points there are.
+/// \param[out] xyz The x, y and z of each point, in mm.
+/// \param[out] error Why it failed, if it did. May be NULL.
+/// \param[in] error_size The size of error.
+/// \returns FF_OK or FF_ERROR.
+FINDFISH_API int ff_triangulate(const char* calib_file, const float* left, const float* right, size_t n_points,
+                                float* xyz, char* error, size_t error_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,22 +7,28 @@
 
 #include "resources/includes/Processor.h"
 #include "resources/includes/Calibration.h"
+#include "resources/includes/ProgressReporter.h"
+#include "resources/includes/SyntheticVideo.h"
+#include "resources/includes/ThreadBudget.h"
 
 using namespace std;
 
 // Directory to save JSON config video_files to.
 #define JSON_DIR "static/video-info/"
 #define VIDEO_DIR "static/videos/"
+#define CONFIG_FILE "config/findfish.yaml"
 
 //#define THREADED
 
 void HandleSignal(int);
 std::vector<std::string> GetVideosFromDir(std::string, std::vector<std::string>);
+std::shared_ptr<ThreadBudget> CreateBudget(const Processor::Settings&);
 
 int main(int argc, char** argv)
 {
     signal(SIGABRT, HandleSignal);
     signal(SIGINT, HandleSignal);
+    signal(SIGTERM, HandleSignal);
     
     // FIXME: This is very hacky, and should not stay. 
     // See https://github.com/cisco/goFish/projects/1#card-24603535 for possible solution.
@@ -54,11 +60,83 @@ int main(int argc, char** argv)
         {
             std::cerr << e.what() << '\n';
         }
-        
+        else if (std::string(argv[1]) == "GENERATE")
+        try
+        {
+            // GENERATE <name> [frames] [<width>x<height>] [noise]
+            SyntheticVideo::Settings settings;
+            settings.OutDir = VIDEO_DIR;
+            if (argc > 2) settings.Name = argv[2];
+            if (argc > 3) settings.Frames = std::stoi(argv[3]);
+            if (argc > 4)
+            {
+                std::string res = argv[4];
+                settings.Resolution = cv::Size(std::stoi(res.substr(0, res.find("x"))), std::stoi(res.substr(res.find("x") + 1)));
+            }
+            if (argc > 5) settings.Noise = std::stod(argv[5]);
+
+            SyntheticVideo generator(settings);
+            auto files = generator.Generate();
+            std::cout << "=== Generated \"" << files.first << "\" and \"" << files.second << "\" ===\n";
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+        }
+        else if (std::string(argv[1]) == "STREAM")
+        try
+        {
+            // STREAM <name> <input> <input> [<input> ...]
+            // Each input is a FIFO, or "-" for stdin, with a camera's stream.
+            if (argc < 5)
+                throw std::runtime_error("STREAM needs a name, and an input for each camera.");
+
+            Processor p(std::vector<std::string>(argv + 3, argv + argc));
+            p.Config = Processor::ReadSettings(CONFIG_FILE);
+            p.Progress = std::make_shared<ProgressReporter>(ProgressReporter::DefaultFile());
+            p.Budget = CreateBudget(p.Config);
+            p.SetName(argv[2]);
+            p.ProcessVideos();
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+        }
+        else if (std::string(argv[1]) == "REPLAY")
+        try
+        {
+            // REPLAY <name> [min_threshold ...]
+            if (argc < 3)
+                throw std::runtime_error("REPLAY needs the name of a processed video.");
+
+            std::string cache_file = std::string(JSON_DIR) + "FG_" + argv[2] + ".fgc";
+            std::vector<int> thresholds;
+            for (int i = 3; i < argc; i++)
+                thresholds.push_back(std::stoi(argv[i]));
+            if (thresholds.empty())
+                thresholds.push_back(200);
+
+            // Every threshold gets its own pass, so a sweep is one command.
+            for (int threshold : thresholds)
+                Processor::Replay(cache_file, threshold);
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+        }
+
 
         return 0;
     }
 
+    Processor::Settings settings = Processor::ReadSettings(CONFIG_FILE);
+
+    // Publish progress where the server can find it by our PID.
+    auto progress = std::make_shared<ProgressReporter>(ProgressReporter::DefaultFile());
+
+    // Share the cores with any other jobs on the machine.
+    auto budget = CreateBudget(settings);
+
     bool bHasVideos = false;
     do 
     {
@@ -76,6 +154,9 @@ int main(int argc, char** argv)
 
         for (size_t i = 0; i < json_files.size(); i++) 
         {
+            // Only the detected events mark a video as done.
+            if (json_files[i].find("DE_") == std::string::npos) continue;
+
             std::string jf = json_files[i].substr(json_files[i].find("DE_") + 3, json_files[i].length());
             jf = jf.substr(0, jf.find_last_of("."));
 
@@ -91,34 +172,50 @@ int main(int argc, char** argv)
         if(argv[1] == NULL)
         {
         #ifdef THREADED
+            // Every rig gets a thread, so OpenCV's threads are split between
+            // them instead of each rig using the whole budget.
+            size_t cameras = settings.Rig.Cameras;
+            size_t n_rigs = video_files.size() / cameras;
+            cv::setNumThreads(std::max<int>(1, budget->GetCores() / std::max<size_t>(1, n_rigs)));
+
+            std::vector<std::unique_ptr<Processor>> processors;
             std::vector<std::thread> threads;
-            threads.resize(video_files.size());
-            for (size_t i = 0; i < video_files.size() / 2; i++)
+            for (size_t i = 0; i < n_rigs; i++)
             {
                 std::cout << "!!! Creating Thread: " << i << " !!!\n";
-                auto p = new Processor(video_files[i], video_files[(i + 1) % video_files.size()]);
-                threads[i] = std::thread(&Processor::ProcessVideos, p);
+                processors.push_back(std::make_unique<Processor>(std::vector<std::string>(
+                    video_files.begin() + i * cameras, video_files.begin() + (i + 1) * cameras)));
+                processors.back()->Config = settings;
+                threads.emplace_back(&Processor::ProcessVideos, processors.back().get());
             }
 
             for(auto& thread : threads)
                 if(thread.joinable()) thread.join();
 
-            // TODO: Should check to make sure processing was successful.
-            if(video_files.size() > 1)
-                for(std::string video : video_files)
-                    std::remove(video.c_str());
+            for (size_t i = 0; i < n_rigs; i++)
+                if (processors[i]->Success)
+                    for (size_t j = i * cameras; j < (i + 1) * cameras; j++)
+                        std::remove(video_files[j].c_str());
         #else
-            for (size_t i = 0; i < video_files.size() / 2; i += 2)
+            // Each rig's videos sort next to each other, one per camera.
+            size_t cameras = settings.Rig.Cameras;
+            for (size_t i = 0; i + cameras <= video_files.size(); i += cameras)
                 try
                 {
-                    Processor p(video_files[i], video_files[(i + 1) % video_files.size()]);
+                    std::string name = video_files[i].substr(video_files[i].find_last_of("/") + 1);
+                    progress->SetPair(i / cameras, video_files.size() / cameras, name);
+
+                    std::vector<std::string> rig(video_files.begin() + i, video_files.begin() + i + cameras);
+                    Processor p(rig);
+                    p.Config = settings;
+                    p.Progress = progress;
+                    p.Budget = budget;
                     p.ProcessVideos();
 
                     if(p.Success)
-                    {
-                        std::remove(video_files[i].c_str());
-                        std::remove(video_files[(i + 1) % video_files.size()].c_str());
-                    }
+                        for (const auto& video : rig)
+                            std::remove(video.c_str());
+                    if(Processor::StopRequested()) break;
                 }
                 catch(const std::exception& e)
                 {
@@ -127,7 +224,7 @@ int main(int argc, char** argv)
         #endif
         }
 
-    } while (bHasVideos);
+    } while (bHasVideos && !Processor::StopRequested());
 
     return 0;
 }
@@ -135,8 +232,17 @@ int main(int argc, char** argv)
 void HandleSignal(int signal)
 {
     std::cout << "\r=== Got signal: " << signal << " ===" << endl;
-    std::cout << "  > Terminating..." << endl;
-    exit(0);
+
+    // Nothing can be saved after an abort, and a second interrupt means
+    // whoever sent it doesn't want to wait.
+    if (signal == SIGABRT || Processor::StopRequested())
+    {
+        std::cout << "  > Terminating..." << endl;
+        exit(0);
+    }
+
+    std::cout << "  > Stopping after the current frame (again to terminate)..." << endl;
+    Processor::RequestStop();
 }
 
 std::vector<std::string> GetVideosFromDir(std::string dir, std::vector<std::string> filters)
@@ -153,4 +259,15 @@ std::vector<std::string> GetVideosFromDir(std::string dir, std::vector<std::stri
         closedir(dp);
     }
     return video_files;
-}
\ No newline at end of file
+}
+
+std::shared_ptr<ThreadBudget> CreateBudget(const Processor::Settings& settings)
+{
+    ThreadBudget::Settings budget_settings;
+    budget_settings.MaxJobs     = settings.Job.MaxJobs;
+    budget_settings.bPinThreads = settings.Job.bPinThreads;
+
+    auto budget = std::make_shared<ThreadBudget>(budget_settings);
+    budget->Apply();
+    return budget;
+}
@@ -1,17 +1,30 @@
 #include "includes/Calibration.h"
+#include "includes/ThreadPool.h"
+#include "includes/ContentHash.h"
 
 #include <opencv2/calib3d.hpp>
 #include <opencv2/tracking.hpp>
 #include <opencv2/ximgproc.hpp>
 
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <regex>
 #include <algorithm>
 #include <assert.h>
+#include <future>
+#include <sstream>
 #include <stdexcept>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 std::vector<std::string> Split(std::string&, const char*);
+void RefineCircleCenters(const cv::Mat&, std::vector<cv::Point2f>&);
 
 Calibration::Calibration(Input& in, CalibrationType type, std::string outfile)
 {
@@ -24,10 +37,14 @@ Calibration::Calibration(Input& in, CalibrationType type, std::string outfile)
     this->_input.image_size        = in.image_size;
     this->_input.grid_size         = in.grid_size != cv::Size() ? in.grid_size : cv::Size(19, 11);
     this->_input.grid_dot_size     = in.grid_dot_size >= 1.f ? in.grid_dot_size : 13.f; // mm
+    this->_input.detect_scale      = in.detect_scale > 0.f && in.detect_scale < 1.f ? in.detect_scale : 1.f;
+    this->_input.n_threads         = std::max(0, in.n_threads);
+    this->_input.use_detection_cache = in.use_detection_cache;
 
     this->_type              = type;
     this->_outfile_name      = outfile;
     this->_out_dir           = "calib_config/";
+    this->_cache_file        = "detection_cache.yaml";
 }
 
 void Calibration::ReadImages(std::string dir1, std::string dir2)
@@ -89,27 +106,113 @@ void Calibration::ReadCalibration()
         fs["R1"] >> _result.R1;
         fs["P2"] >> _result.P2;
         fs["R2"] >> _result.R2;
+        fs["Q"]  >> _result.Q;
+
+        // Rigs with more cameras list the rest after the stereo pair.
+        _result.CameraMatrix.resize(2);
+        _result.DistCoeffs.resize(2);
+        for(int i = 3; ; i++)
+        {
+            cv::Mat K, D;
+            fs["K" + std::to_string(i)] >> K;
+            fs["D" + std::to_string(i)] >> D;
+            if(K.empty() || D.empty())
+                break;
+            _result.CameraMatrix.push_back(K);
+            _result.DistCoeffs.push_back(D);
+        }
+        _result.UndistortMaps.assign(_result.CameraMatrix.size(), std::array<cv::Mat, 2>());
+
+        // Frames are resized to the size the cameras were calibrated at.
+        cv::Size image_size;
+        fs["image_size"] >> image_size;
+        if(image_size != cv::Size())
+            _input.image_size = image_size;
+
+        // cv::undistort builds its maps on every call, so build them once.
+        for(size_t i = 0; i < _result.CameraMatrix.size(); i++)
+            if(_input.image_size != cv::Size() && !_result.CameraMatrix[i].empty() && !_result.DistCoeffs[i].empty())
+                cv::initUndistortRectifyMap(_result.CameraMatrix[i], _result.DistCoeffs[i], cv::Mat(),
+                                            _result.CameraMatrix[i], _input.image_size, CV_16SC2,
+                                            _result.UndistortMaps[i][0], _result.UndistortMaps[i][1]);
     }
 }
 
 void Calibration::GetImagePoints()
 {
     std::cout << "=== Finding Image Points ===" << std::endl;
-   
-    for (size_t i = 0; i < (_input.images[0].size() + _input.images[1].size())/2; i++)
-    {
-        std::string imageL = _input.images[0][i], imageR = _input.images[1][i];
-        cv::Mat imgL = cv::imread(imageL, cv::IMREAD_GRAYSCALE), imgR = cv::imread(imageR, cv::IMREAD_GRAYSCALE), frameL, frameR;
 
-        if (_input.image_size == cv::Size())
-            _input.image_size = imgL.size() != cv::Size() ? imgL.size() : imgR.size() != cv::Size() ? imgR.size() : cv::Size(1920, 1440);
+    size_t n_pairs = std::min(_input.images[0].size(), _input.images[1].size());
 
-        if(imgL.size() != cv::Size()) cv::resize(imgL, frameL, _input.image_size);
-        if(imgR.size() != cv::Size()) cv::resize(imgR, frameR, _input.image_size);
+    // Every image is resized to the same size, so settle it before any of the
+    // detections start. The rig's images all come off the same cameras, so
+    // the first one is enough.
+    if (_input.image_size == cv::Size() && n_pairs > 0)
+        _input.image_size = cv::imread(_input.images[0][0], cv::IMREAD_GRAYSCALE).size();
+    if (_input.image_size == cv::Size())
+        _input.image_size = cv::Size(1920, 1440);
+
+    if (_input.use_detection_cache)
+        ReadDetectionCache();
+
+    // Detect each image on its own worker. The futures are kept in pair order,
+    // so the left and right point sets still line up for stereoCalibrate.
+    // Images whose contents and grid parameters match a previous run are
+    // taken straight from the cache.
+    std::vector<std::future<std::tuple<std::string, Detection, bool>>> detections[2];
+    {
+        ThreadPool pool(_input.n_threads);
+        std::cout << "  > Detecting grids in " << n_pairs << " image pairs on " << pool.Size() << " threads...\n";
+
+        for (size_t i = 0; i < n_pairs; i++)
+            for (int j = 0; j < 2; j++)
+                detections[j].push_back(pool.Enqueue([this](const std::string& file) {
+                    std::string key = _input.use_detection_cache ? DetectionKey(file) : "";
+                    auto cached = _detection_cache.find(key);
+                    if (!key.empty() && cached != _detection_cache.end())
+                        return std::make_tuple(key, cached->second, true);
+
+                    Detection detection;
+                    auto start = cv::getTickCount();
+                    detection.found = DetectGrid(file, detection.points);
+                    detection.seconds = double(cv::getTickCount() - start) / cv::getTickFrequency();
+                    return std::make_tuple(key, detection, false);
+                }, _input.images[j][i]));
+    }
+
+    int n_cached = 0, n_detected = 0;
+    double saved_seconds = 0.0;
+    for (size_t i = 0; i < n_pairs; i++)
+    {
+        std::string imageL = _input.images[0][i], imageR = _input.images[1][i];
 
-        std::vector<cv::Point2f> bufferL, bufferR;
-        bool found_left  = cv::findCirclesGrid(frameL, cv::Size(_input.grid_size.width, _input.grid_size.height), bufferL);
-        bool found_right = cv::findCirclesGrid(frameR, cv::Size(_input.grid_size.width, _input.grid_size.height), bufferR);
+        Detection found[2];
+        for (int j = 0; j < 2; j++)
+            try
+            {
+                std::string key;
+                bool cached;
+                std::tie(key, found[j], cached) = detections[j][i].get();
+
+                if (cached)
+                {
+                    n_cached++;
+                    saved_seconds += found[j].seconds;
+                }
+                else n_detected++;
+
+                // Hits are stored again too, as the image may have moved.
+                found[j].file = _input.images[j][i];
+                if (!key.empty()) _detection_cache[key] = found[j];
+            }
+            catch(const std::exception& e)
+            {
+                std::cerr << " !> " << e.what() << '\n';
+            }
+
+        bool found_left = found[0].found, found_right = found[1].found;
+        const auto& bufferL = found[0].points;
+        const auto& bufferR = found[1].points;
 
         if ((_type == CalibrationType::STEREO && (found_left && found_right)) ||
             (_type == CalibrationType::SINGLE && (found_left || found_right)) )
@@ -132,6 +235,136 @@ void Calibration::GetImagePoints()
         _input.object_points.push_back(objs);
 
     _result.n_image_pairs = _result.good_images.size() / 2;
+
+    if (_input.use_detection_cache)
+    {
+        WriteDetectionCache();
+        std::cout << "  > " << n_cached << " of " << (n_cached + n_detected) << " detections came from the cache"
+                  << " (saved ~" << saved_seconds << " seconds)\n";
+    }
+}
+
+bool Calibration::DetectGrid(const std::string& file, std::vector<cv::Point2f>& points) const
+{
+    cv::Mat img = cv::imread(file, cv::IMREAD_GRAYSCALE), frame;
+    if (img.empty())
+        return false;
+
+    cv::resize(img, frame, _input.image_size);
+    if (_input.detect_scale >= 1.f)
+        return cv::findCirclesGrid(frame, _input.grid_size, points);
+
+    // Find the grid on a smaller image, then move the centres back onto the
+    // full resolution image.
+    cv::Mat small;
+    cv::resize(frame, small, cv::Size(), _input.detect_scale, _input.detect_scale, cv::INTER_AREA);
+    if (!cv::findCirclesGrid(small, _input.grid_size, points))
+        return false;
+
+    for (auto& point : points)
+        point *= 1.0 / _input.detect_scale;
+    RefineCircleCenters(frame, points);
+    return true;
+}
+
+std::string Calibration::DetectionKey(const std::string& file) const
+{
+    std::string hash = HashFile(file);
+    if (hash.empty())
+        return "";
+
+    std::ostringstream key;
+    key << hash << "_" << _input.grid_size.width << "x" << _input.grid_size.height
+        << "_" << _input.image_size.width << "x" << _input.image_size.height
+        << "_" << _input.detect_scale;
+    return key.str();
+}
+
+void Calibration::ReadDetectionCache()
+{
+    for (auto& entry : LoadDetections(_out_dir + _cache_file))
+        _detection_cache[entry.first] = entry.second;
+}
+
+void Calibration::WriteDetectionCache() const
+{
+    // Other calibrations may be saving the cache at the same time. Hold a
+    // lock while their entries are merged in, and write to a temporary file
+    // that is renamed over the cache, so nobody reads half of one.
+    std::string file = _out_dir + _cache_file;
+    int lock_fd = open((file + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+    if (lock_fd >= 0)
+        flock(lock_fd, LOCK_EX);
+
+    std::map<std::string, Detection> cache = LoadDetections(file);
+    for (const auto& entry : _detection_cache)
+        cache[entry.first] = entry.second;
+
+    std::string temp_file = file + "." + std::to_string(getpid()) + ".tmp";
+    bool bWritten = false;
+    int n_dropped = 0;
+    {
+        cv::FileStorage fs(temp_file, cv::FileStorage::WRITE);
+        if (fs.isOpened())
+        {
+            // Images that are gone can't be detected again, so their entries
+            // would only ever grow the cache.
+            fs << "detections" << "[";
+            for (const auto& entry : cache)
+            {
+                struct stat info;
+                if (stat(entry.second.file.c_str(), &info) != 0)
+                {
+                    n_dropped++;
+                    continue;
+                }
+
+                fs << "{" << "key" << entry.first
+                          << "file" << entry.second.file
+                          << "found" << int(entry.second.found)
+                          << "seconds" << entry.second.seconds
+                          << "points" << entry.second.points << "}";
+            }
+            fs << "]";
+            bWritten = true;
+        }
+    }
+    if (bWritten && std::rename(temp_file.c_str(), file.c_str()) != 0)
+    {
+        std::remove(temp_file.c_str());
+        bWritten = false;
+    }
+    if (lock_fd >= 0)
+        close(lock_fd);
+
+    if (!bWritten)
+        std::cerr << " !> Could not write the detection cache to \"" << file << "\"\n";
+    else if (n_dropped > 0)
+        std::cout << "  > Dropped " << n_dropped << " cached detections for images that no longer exist\n";
+}
+
+std::map<std::string, Calibration::Detection> Calibration::LoadDetections(const std::string& file)
+{
+    std::map<std::string, Calibration::Detection> cache;
+    cv::FileStorage fs(file, cv::FileStorage::READ);
+    if (!fs.isOpened())
+        return cache;
+
+    for (auto node : fs["detections"])
+    {
+        std::string key;
+        int found = 0;
+        Detection detection;
+        node["key"] >> key;
+        node["found"] >> found;
+        node["seconds"] >> detection.seconds;
+        node["points"] >> detection.points;
+        node["file"] >> detection.file;
+
+        detection.found = found != 0;
+        if (!key.empty()) cache[key] = detection;
+    }
+    return cache;
 }
 
 void Calibration::SingleCalibrate()
@@ -251,6 +484,7 @@ void Calibration::StereoCalibrate()
     fs << "R1" << _result.R1;
     fs << "P2" << _result.P2;
     fs << "R2" << _result.R2;
+    fs << "Q" << _result.Q;
     fs << "grid_size" << _input.grid_size;
     fs << "grid_dot_size" << _input.grid_dot_size;
     fs << "image_size" << _input.image_size;
@@ -296,19 +530,94 @@ void Calibration::GetUndistortedImage() const
 
 void Calibration::UndistortImage(cv::Mat& img, int index) const
 {
-    if(_result.CameraMatrix[index].empty() || _result.DistCoeffs[index].empty())
+    if(index < 0 || index >= GetCameraCount() || _result.CameraMatrix[index].empty() || _result.DistCoeffs[index].empty())
         throw std::runtime_error("Camera Matrix [" + std::to_string(index) +"] is empty!");
         
-    if(index < 2 && !img.empty())
+    if(!img.empty())
     {
         cv::Mat uimg;
-        cv::Mat frame;
-        cv::resize(img, frame, _input.image_size);
-        cv::undistort(frame, uimg, _result.CameraMatrix[index], _result.DistCoeffs[index]);
+        cv::Mat frame = img;
+        if(img.size() != _input.image_size)
+            cv::resize(img, frame, _input.image_size);
+
+        if(!_result.UndistortMaps[index][0].empty())
+            cv::remap(frame, uimg, _result.UndistortMaps[index][0], _result.UndistortMaps[index][1], cv::INTER_LINEAR);
+        else
+            cv::undistort(frame, uimg, _result.CameraMatrix[index], _result.DistCoeffs[index]);
         img = uimg;
     }
 }
 
+void Calibration::UndistortPoints(std::vector<cv::Point2f>& points, int index) const
+{
+    if(index < 0 || index >= GetCameraCount() || _result.CameraMatrix[index].empty() || _result.DistCoeffs[index].empty())
+        throw std::runtime_error("Camera Matrix [" + std::to_string(index) +"] is empty!");
+
+    if(!points.empty())
+        cv::undistortPoints(std::vector<cv::Point2f>(points), points, _result.CameraMatrix[index],
+                            _result.DistCoeffs[index], cv::Mat(), _result.CameraMatrix[index]);
+}
+
+void Calibration::UndistortBoxes(std::vector<cv::Rect>& boxes, int index) const
+{
+    // The edges of a box bow as they are undistorted, so the middle of each
+    // side goes in with the corners.
+    std::vector<cv::Point2f> points;
+    for(const auto& box : boxes)
+    {
+        float right = float(box.x + box.width - 1), bottom = float(box.y + box.height - 1);
+        float middle_x = (box.x + right) / 2.f, middle_y = (box.y + bottom) / 2.f;
+        points.insert(points.end(), { cv::Point2f(box.x, box.y), cv::Point2f(middle_x, box.y), cv::Point2f(right, box.y),
+                                      cv::Point2f(right, middle_y), cv::Point2f(right, bottom), cv::Point2f(middle_x, bottom),
+                                      cv::Point2f(box.x, bottom), cv::Point2f(box.x, middle_y) });
+    }
+    UndistortPoints(points, index);
+
+    for(size_t i = 0; i < boxes.size(); i++)
+    {
+        std::vector<cv::Point> outline;
+        for(size_t j = 8 * i; j < 8 * i + 8; j++)
+            outline.push_back(cv::Point(cvRound(points[j].x), cvRound(points[j].y)));
+        boxes[i] = cv::boundingRect(outline);
+    }
+}
+
+bool Calibration::GetDistortion(cv::Mat D[2]) const
+{
+    for(int i = 0; i < 2; i++)
+        D[i] = _result.DistCoeffs[i];
+    return !D[0].empty() && !D[1].empty();
+}
+
+cv::Size Calibration::GetImageSize() const
+{
+    return _input.image_size;
+}
+
+int Calibration::GetCameraCount() const
+{
+    return (int)_result.CameraMatrix.size();
+}
+
+bool Calibration::GetRectification(cv::Mat K[2], cv::Mat R[2], cv::Mat P[2], cv::Mat& Q) const
+{
+    if(_result.Q.empty() || _result.R1.empty() || _result.R2.empty() || _result.P1.empty() || _result.P2.empty())
+        return false;
+
+    for(int i = 0; i < 2; i++)
+        K[i] = _result.CameraMatrix[i];
+    R[0] = _result.R1; R[1] = _result.R2;
+    P[0] = _result.P1; P[1] = _result.P2;
+    Q = _result.Q;
+    return true;
+}
+
+bool Calibration::GetFundamental(cv::Mat& F) const
+{
+    F = _result.F;
+    return !F.empty();
+}
+
 void Calibration::UndistortPoints()
 {
     if(_result.CameraMatrix[0].empty() || _result.CameraMatrix[1].empty())
@@ -370,6 +679,46 @@ void Calibration::TriangulatePoints()
     std::cout << "=== Finished Triangulation ===" << std::endl;
 }
 
+std::vector<cv::Point3f> Calibration::Triangulate(const std::vector<cv::Point2f>& left, const std::vector<cv::Point2f>& right) const
+{
+    if(left.size() != right.size())
+        throw std::runtime_error("Both sides do not have the same number of points!");
+    if(_result.CameraMatrix[0].empty() || _result.CameraMatrix[1].empty() || _result.R.empty() || _result.T.empty())
+        throw std::runtime_error("The stereo calibration has no extrinsics, so points can't be triangulated!");
+
+    std::vector<cv::Point3f> points;
+    if(left.empty())
+        return points;
+
+    // Undistorted frames keep each camera's own matrix, so the left camera
+    // projects from the origin and the right one from R and T.
+    cv::Mat K[2], R, T, Rt[2], P[2];
+    for(int i = 0; i < 2; i++)
+        _result.CameraMatrix[i].convertTo(K[i], CV_64F);
+    _result.R.convertTo(R, CV_64F);
+    _result.T.convertTo(T, CV_64F);
+    cv::hconcat(cv::Mat::eye(3, 3, CV_64F), cv::Mat::zeros(3, 1, CV_64F), Rt[0]);
+    cv::hconcat(R, T.reshape(1, 3), Rt[1]);
+    for(int i = 0; i < 2; i++)
+        P[i] = K[i] * Rt[i];
+
+    cv::Mat homogeneous;
+    cv::triangulatePoints(P[0], P[1], left, right, homogeneous);
+    homogeneous.convertTo(homogeneous, CV_64F);
+
+    // Points on parallel rays meet at infinity, and come back as NaN.
+    for(int i = 0; i < homogeneous.cols; i++)
+    {
+        double w = homogeneous.at<double>(3, i);
+        if(std::abs(w) < 1e-12)
+            w = std::numeric_limits<double>::quiet_NaN();
+        points.push_back(cv::Point3f(homogeneous.at<double>(0, i) / w,
+                                     homogeneous.at<double>(1, i) / w,
+                                     homogeneous.at<double>(2, i) / w));
+    }
+    return points;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Helper Functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -392,4 +741,30 @@ std::vector<std::string> Split(std::string& str, const char* delimiter)
         _result.push_back(regex_replace(temp.substr(0, i), r, ""));
 
     return _result;
+}
+
+void RefineCircleCenters(const cv::Mat& img, std::vector<cv::Point2f>& centers)
+{
+    if (centers.size() < 2)
+        return;
+
+    // Keep the search window within half the distance to the next dot, so it
+    // only ever covers one of them.
+    int radius = std::max(2, int(cv::norm(centers[1] - centers[0]) * 0.45));
+    cv::Rect bounds(0, 0, img.cols, img.rows);
+
+    for (auto& center : centers)
+    {
+        cv::Rect window = cv::Rect(int(center.x) - radius, int(center.y) - radius, 2 * radius + 1, 2 * radius + 1) & bounds;
+        if (window.area() == 0)
+            continue;
+
+        // The dots are dark on a light background, so invert before taking the
+        // centroid of the thresholded window.
+        cv::Mat blob;
+        cv::threshold(img(window), blob, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+        cv::Moments m = cv::moments(blob, true);
+        if (m.m00 > 0)
+            center = cv::Point2f(float(window.x + m.m10 / m.m00), float(window.y + m.m01 / m.m00));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "includes/ContentHash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t HashString(const std::string& str, uint64_t hash)
+{
+    return HashBytes(str.data(), str.size(), hash);
+}
+
+std::string HashFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open())
+        return "";
+
+    uint64_t hash = 14695981039346656037ULL;
+    std::vector<char> buffer(1 << 16);
+    while(file)
+    {
+        file.read(buffer.data(), buffer.size());
+        hash = HashBytes(buffer.data(), size_t(file.gcount()), hash);
+    }
+    return HashToHex(hash);
+}
+
+std::string HashFileChunks(const std::string& path, size_t chunk_size, int chunks)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+        return "";
+
+    // The size goes in first, so files that only differ in length never
+    // share a hash.
+    uint64_t size = uint64_t(file.tellg());
+    uint64_t hash = HashBytes(&size, sizeof(size));
+    chunk_size = std::max<size_t>(1, chunk_size);
+    chunks = std::max(2, chunks);
+    if(size <= uint64_t(chunk_size) * chunks)
+    {
+        chunk_size = size_t(size);
+        chunks = 1;
+    }
+
+    std::vector<char> buffer(chunk_size);
+    for(int i = 0; i < chunks; i++)
+    {
+        uint64_t offset = (chunks > 1) ? (size - chunk_size) * i / (chunks - 1) : 0;
+        file.clear();
+        file.seekg(std::streamoff(offset));
+        file.read(buffer.data(), buffer.size());
+        if(file.gcount() != std::streamsize(buffer.size()))
+            return "";
+        hash = HashBytes(buffer.data(), buffer.size(), hash);
+    }
+    return HashToHex(hash);
+}
+
+std::string HashToHex(uint64_t hash)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for(int i = 15; i >= 0; i--, hash >>= 4)
+        hex[i] = digits[hash & 0xf];
+    return hex;
+}
@@ -0,0 +1,114 @@
+#include "includes/DepthEstimator.h"
+#include "includes/Calibration.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+DepthEstimator::DepthEstimator(const Calibration& calib, DepthEstimator::Settings settings)
+    : Config{settings}, _image_size{calib._input.image_size}
+{
+    if(!calib.GetRectification(_K, _R, _P, _Q))
+        throw std::runtime_error("The stereo calibration has no rectification, so depth can't be measured!");
+
+    // Undistorted frames only need rectifying, raw ones need both.
+    if(Config.bRawFrames && !calib.GetDistortion(_D))
+        throw std::runtime_error("The stereo calibration has no distortion coefficients, so raw frames can't be measured!");
+
+    for(int i = 0; i < 2; i++)
+        cv::initUndistortRectifyMap(_K[i], _D[i], _R[i], _P[i], _image_size, CV_32FC1, _maps[i][0], _maps[i][1]);
+}
+
+std::vector<ObjectDepth> DepthEstimator::Estimate(const cv::Mat& left, const cv::Mat& right,
+                                                  const std::vector<cv::Rect>& boxes, const cv::Mat& mask) const
+{
+    std::vector<ObjectDepth> objects;
+    if(left.empty() || right.empty())
+        return objects;
+
+    cv::Rect image(cv::Point(0, 0), _image_size);
+    double focal = _P[0].at<double>(0, 0);
+
+    auto sgbm = cv::StereoSGBM::create(0, Config.NumDisparities, Config.BlockSize,
+                                       8 * Config.BlockSize * Config.BlockSize,
+                                       32 * Config.BlockSize * Config.BlockSize);
+
+    for(const auto& box : boxes)
+    {
+        if(box.area() < Config.MinArea)
+            continue;
+
+        // Find where the box lands in the rectified image.
+        std::vector<cv::Point2f> corners = {
+            cv::Point2f(box.x, box.y), cv::Point2f(box.x + box.width, box.y),
+            cv::Point2f(box.x, box.y + box.height), cv::Point2f(box.x + box.width, box.y + box.height)
+        };
+        std::vector<cv::Point2f> rectified;
+        cv::undistortPoints(corners, rectified, _K[0], _D[0], _R[0], _P[0]);
+
+        cv::Rect object_box = cv::boundingRect(rectified);
+        cv::Rect roi = cv::Rect(object_box.x - Config.Margin, object_box.y - Config.Margin,
+                                object_box.width + 2 * Config.Margin, object_box.height + 2 * Config.Margin) & image;
+        if(roi.empty())
+            continue;
+
+        // A left pixel's match lies up to NumDisparities to its left, so the
+        // strip that gets matched has to start that much earlier.
+        int strip_x = std::max(0, roi.x - Config.NumDisparities);
+        cv::Rect strip(strip_x, roi.y, roi.x + roi.width - strip_x, roi.height);
+
+        // Rectify only the strip, by remapping with just its part of the maps.
+        cv::Mat rect[2], gray[2];
+        const cv::Mat* frames[2] = { &left, &right };
+        for(int i = 0; i < 2; i++)
+        {
+            cv::remap(*frames[i], rect[i], _maps[i][0](strip), _maps[i][1](strip), cv::INTER_LINEAR);
+            if(rect[i].channels() == 3) cv::cvtColor(rect[i], gray[i], cv::COLOR_BGR2GRAY);
+            else gray[i] = rect[i];
+        }
+
+        cv::Mat fg;
+        if(!mask.empty())
+            cv::remap(mask, fg, _maps[0][0](strip), _maps[0][1](strip), cv::INTER_NEAREST);
+
+        cv::Mat disparity;
+        sgbm->compute(gray[0], gray[1], disparity);
+
+        // Collect the valid disparities of the object's pixels, in full image
+        // coordinates, since that is what Q expects.
+        std::vector<cv::Point3f> pixels;
+        for(int y = roi.y; y < roi.y + roi.height; y++)
+            for(int x = roi.x; x < roi.x + roi.width; x++)
+            {
+                int sx = x - strip.x, sy = y - strip.y;
+                if(!fg.empty() && fg.at<unsigned char>(sy, sx) == 0)
+                    continue;
+
+                short d = disparity.at<short>(sy, sx);
+                if(d > 0)
+                    pixels.push_back(cv::Point3f(x, y, d / float(cv::StereoMatcher::DISP_SCALE)));
+            }
+        if(int(pixels.size()) < Config.MinValidPixels)
+            continue;
+
+        std::vector<cv::Point3f> points;
+        cv::perspectiveTransform(pixels, points, _Q);
+
+        std::vector<float> depths;
+        for(const auto& point : points)
+            if(point.z > 0)
+                depths.push_back(point.z);
+        if(int(depths.size()) < Config.MinValidPixels)
+            continue;
+
+        std::nth_element(depths.begin(), depths.begin() + depths.size() / 2, depths.end());
+
+        ObjectDepth object;
+        object.Box         = object_box;
+        object.Range       = depths[depths.size() / 2];
+        object.Width       = object_box.width * object.Range / focal;
+        object.Height      = object_box.height * object.Range / focal;
+        object.ValidPixels = int(depths.size());
+        objects.push_back(object);
+    }
+    return objects;
+}
@@ -0,0 +1,316 @@
+#include "includes/DetectionLog.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+void PutVarint(std::string&, uint64_t);
+void PutSigned(std::string&, int64_t);
+bool GetVarint(const uint8_t*&, const uint8_t*, uint64_t&);
+bool GetVarint(std::istream&, uint64_t&);
+bool GetSigned(const uint8_t*&, const uint8_t*, int64_t&);
+
+/// The number of values stored per detection, each in its own column.
+static const int DETECTION_COLUMNS = 7;
+
+DetectionLog::DetectionLog(std::string file, DetectionLog::Settings settings)
+    : Config{settings}, _file{file}, _size{0}
+{
+    Config.BlockRows = std::max(1, Config.BlockRows);
+    Open();
+}
+
+DetectionLog::~DetectionLog()
+{
+    try
+    {
+        Flush();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << " !> " << e.what() << '\n';
+    }
+}
+
+void DetectionLog::Add(int frame, int camera, const std::vector<std::vector<cv::Point>>& contours)
+{
+    if(contours.empty())
+        return;
+
+    // Measure outside the lock, so the other camera and chunks aren't held up.
+    DetectionRow row = { frame, camera, {} };
+    for(const auto& contour : contours)
+    {
+        cv::Moments moments = cv::moments(contour);
+        cv::Rect box = cv::boundingRect(contour);
+        cv::Point centroid = (moments.m00 > 0) ? cv::Point(cvRound(moments.m10 / moments.m00), cvRound(moments.m01 / moments.m00))
+                                               : (box.tl() + box.br()) / 2;
+        row.Detections.push_back({ box, cvRound(moments.m00), centroid });
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rows.push_back(row);
+    if((int)_rows.size() >= Config.BlockRows)
+        WriteBlock();
+}
+
+void DetectionLog::Flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    WriteBlock();
+}
+
+uint64_t DetectionLog::Size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+}
+
+void DetectionLog::Truncate(uint64_t size)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rows.clear();
+    _out.close();
+
+    // Anything short of the header starts the log over.
+    if(size < 2 * sizeof(uint32_t))
+        size = 0;
+    if(size < _size && truncate(_file.c_str(), size) != 0)
+        throw std::runtime_error("Could not truncate \"" + _file + "\"!");
+    Open();
+}
+
+void DetectionLog::WriteBlock()
+{
+    if(_rows.empty())
+        return;
+
+    // Each column is stored as differences from the value before it, which
+    // restart with every block so blocks can be decoded on their own.
+    std::string payload;
+    int64_t last_frame = 0;
+    size_t n_detections = 0;
+    for(const auto& row : _rows)
+    {
+        PutSigned(payload, row.Frame - last_frame);
+        last_frame = row.Frame;
+    }
+    for(const auto& row : _rows)
+        PutVarint(payload, row.Camera);
+    for(const auto& row : _rows)
+    {
+        PutVarint(payload, row.Detections.size());
+        n_detections += row.Detections.size();
+    }
+    for(int column = 0; column < DETECTION_COLUMNS; column++)
+    {
+        int64_t last = 0;
+        for(const auto& row : _rows)
+            for(const auto& detection : row.Detections)
+            {
+                const int values[DETECTION_COLUMNS] = {
+                    detection.Box.x, detection.Box.y, detection.Box.width, detection.Box.height,
+                    detection.Area, detection.Centroid.x, detection.Centroid.y
+                };
+                PutSigned(payload, values[column] - last);
+                last = values[column];
+            }
+    }
+
+    std::string block;
+    block.append(reinterpret_cast<const char*>(&DETECTION_BLOCK_MAGIC), sizeof(uint32_t));
+    PutVarint(block, _rows.size());
+    PutVarint(block, n_detections);
+    PutVarint(block, payload.size());
+    block += payload;
+
+    _out.write(block.data(), block.size());
+    _out.flush();
+    if(!_out)
+        throw std::runtime_error("Could not write to \"" + _file + "\"!");
+    _size += block.size();
+    _rows.clear();
+}
+
+void DetectionLog::Open()
+{
+    uint32_t header[2] = { DETECTION_LOG_MAGIC, DETECTION_LOG_VERSION };
+    {
+        std::ifstream in(_file, std::ios::binary | std::ios::ate);
+        _size = in.is_open() ? (uint64_t)in.tellg() : 0;
+        if(_size > 0)
+        {
+            uint32_t existing[2] = { 0, 0 };
+            in.seekg(0);
+            in.read(reinterpret_cast<char*>(existing), sizeof(existing));
+            if(!in || existing[0] != header[0] || existing[1] != header[1])
+                throw std::runtime_error("\"" + _file + "\" is not a detection log, or is from another version!");
+        }
+    }
+
+    _out.open(_file, std::ios::binary | std::ios::app);
+    if(!_out.is_open())
+        throw std::runtime_error("Could not open \"" + _file + "\"!");
+    if(_size == 0)
+    {
+        _out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        _out.flush();
+        _size = sizeof(header);
+    }
+}
+
+DetectionLogReader::DetectionLogReader(std::string file)
+    : _in{file, std::ios::binary}, _next{0}
+{
+    uint32_t header[2] = { 0, 0 };
+    _in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if(!_in)
+        throw std::runtime_error("Could not read \"" + file + "\"!");
+    if(header[0] != DETECTION_LOG_MAGIC || header[1] != DETECTION_LOG_VERSION)
+        throw std::runtime_error("\"" + file + "\" is not a detection log, or is from another version!");
+}
+
+bool DetectionLogReader::Next(DetectionRow& row)
+{
+    while(_next >= _block.size())
+        if(!ReadBlock())
+            return false;
+
+    row = std::move(_block[_next++]);
+    return true;
+}
+
+bool DetectionLogReader::ReadBlock()
+{
+    _block.clear();
+    _next = 0;
+
+    uint32_t magic = 0;
+    uint64_t n_rows, n_detections, n_bytes;
+    _in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if(!_in || magic != DETECTION_BLOCK_MAGIC ||
+       !GetVarint(_in, n_rows) || !GetVarint(_in, n_detections) || !GetVarint(_in, n_bytes))
+        return false;
+
+    // Every row takes at least three bytes and every detection seven, which
+    // also stops a corrupt count from allocating the world.
+    if(3 * n_rows + DETECTION_COLUMNS * n_detections > n_bytes)
+        return false;
+
+    std::string payload(n_bytes, '\0');
+    _in.read(&payload[0], n_bytes);
+    if(!_in)
+        return false;
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(payload.data());
+    const uint8_t* end = p + payload.size();
+
+    _block.resize(n_rows);
+    int64_t frame = 0;
+    for(auto& row : _block)
+    {
+        int64_t delta;
+        if(!GetSigned(p, end, delta))
+            return false;
+        frame += delta;
+        row.Frame = (int)frame;
+    }
+
+    uint64_t value;
+    for(auto& row : _block)
+    {
+        if(!GetVarint(p, end, value))
+            return false;
+        row.Camera = (int)value;
+    }
+
+    size_t total = 0;
+    for(auto& row : _block)
+    {
+        if(!GetVarint(p, end, value) || (total += value) > n_detections)
+            return false;
+        row.Detections.resize(value);
+    }
+    if(total != n_detections)
+        return false;
+
+    for(int column = 0; column < DETECTION_COLUMNS; column++)
+    {
+        int64_t last = 0;
+        for(auto& row : _block)
+            for(auto& detection : row.Detections)
+            {
+                int64_t delta;
+                if(!GetSigned(p, end, delta))
+                    return false;
+                last += delta;
+
+                int* fields[DETECTION_COLUMNS] = {
+                    &detection.Box.x, &detection.Box.y, &detection.Box.width, &detection.Box.height,
+                    &detection.Area, &detection.Centroid.x, &detection.Centroid.y
+                };
+                *fields[column] = (int)last;
+            }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+/// Appends an unsigned value, seven bits a byte, lowest first.
+void PutVarint(std::string& out, uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+/// Appends a signed value zigzag encoded, so small negative values stay small.
+void PutSigned(std::string& out, int64_t value)
+{
+    PutVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for(int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = *p++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool GetVarint(std::istream& in, uint64_t& value)
+{
+    value = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = in.get();
+        if(byte == EOF)
+            return false;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool GetSigned(const uint8_t*& p, const uint8_t* end, int64_t& value)
+{
+    uint64_t zigzag;
+    if(!GetVarint(p, end, zigzag))
+        return false;
+    value = int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+    return true;
+}
@@ -0,0 +1,241 @@
+#include "includes/DnnClassifier.h"
+#include "includes/ThreadPool.h"
+#include "includes/PipelineStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+DnnClassifier::DnnClassifier(DnnClassifier::Settings settings)
+    : Config{settings}
+{
+    Config.Threads = std::max(1, Config.Threads);
+    Config.BatchSize = std::max(1, Config.BatchSize);
+    Config.SampleInterval = std::max(1, Config.SampleInterval);
+
+    // A network can't run two batches at once, so each thread gets its own.
+    for(int i = 0; i < Config.Threads; i++)
+    {
+        cv::dnn::Net net = cv::dnn::readNetFromONNX(Config.Model);
+        if(net.empty())
+            throw std::runtime_error("Could not load the network \"" + Config.Model + "\"!");
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        _nets.push_back(net);
+        _free_nets.push_back(i);
+    }
+    _pool = std::make_unique<ThreadPool>(Config.Threads);
+
+    std::ifstream labels(Config.Labels);
+    for(std::string line; std::getline(labels, line);)
+        _labels.push_back(line);
+}
+
+DnnClassifier::~DnnClassifier()
+{
+    try
+    {
+        Flush();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << " !> " << e.what() << '\n';
+    }
+}
+
+void DnnClassifier::Add(int frame, const cv::Mat& img, const std::vector<cv::Rect>& boxes)
+{
+    if(frame % Config.SampleInterval != 0 || img.empty())
+        return;
+
+    // Crop and scale outside the lock, so other chunks aren't held up.
+    cv::Rect image(0, 0, img.cols, img.rows);
+    std::vector<Crop> crops;
+    for(const auto& box : boxes)
+    {
+        cv::Rect roi = cv::Rect(box.x - Config.Margin, box.y - Config.Margin,
+                                box.width + 2 * Config.Margin, box.height + 2 * Config.Margin) & image;
+        if(roi.empty())
+            continue;
+
+        Crop crop{ frame, box, cv::Mat() };
+        cv::resize(img(roi), crop.Image, Config.InputSize, 0, 0, cv::INTER_AREA);
+        crops.push_back(crop);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue.insert(_queue.end(), crops.begin(), crops.end());
+    if(Stats) Stats->RecordQueueDepth("dnn_crops", _queue.size());
+    while(int(_queue.size()) >= Config.BatchSize)
+        StartBatch();
+    if(Stats) Stats->RecordQueueDepth("dnn_batches", _batches.size());
+
+    // Collect finished batches, so any errors show up early.
+    for(auto it = _batches.begin(); it != _batches.end();)
+        if(it->wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            it->get();
+            it = _batches.erase(it);
+        }
+        else ++it;
+}
+
+void DnnClassifier::Flush()
+{
+    std::vector<std::future<void>> batches;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        while(!_queue.empty())
+            StartBatch();
+        batches = std::move(_batches);
+        _batches.clear();
+    }
+    for(auto& batch : batches)
+        batch.get();
+}
+
+bool DnnClassifier::Classify(int first, int last, std::string& label, double& confidence) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<const DnnResult*> results;
+    for(auto it = _results.lower_bound(first); it != _results.end() && it->first <= last; ++it)
+        for(const auto& result : it->second)
+            results.push_back(&result);
+    return Summarize(results, label, confidence);
+}
+
+bool DnnClassifier::Classify(const std::vector<int>& frames, const std::vector<cv::Rect>& boxes,
+                             std::string& label, double& confidence) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<const DnnResult*> results;
+    for(size_t i = 0; i < frames.size() && i < boxes.size(); i++)
+    {
+        auto it = _results.find(frames[i]);
+        if(it == _results.end())
+            continue;
+        for(const auto& result : it->second)
+            if(result.Box == boxes[i])
+                results.push_back(&result);
+    }
+    return Summarize(results, label, confidence);
+}
+
+void DnnClassifier::Save(cv::FileStorage& fs, std::string name) const
+{
+    // Each crop is written as its frame and box, then its scores.
+    std::lock_guard<std::mutex> lock(_mutex);
+    fs << name << "[";
+    for(const auto& frame : _results)
+        for(const auto& result : frame.second)
+        {
+            std::vector<float> values = { float(frame.first), float(result.Box.x), float(result.Box.y),
+                                          float(result.Box.width), float(result.Box.height) };
+            values.insert(values.end(), result.Scores.begin(), result.Scores.end());
+            fs << values;
+        }
+    fs << "]";
+}
+
+void DnnClassifier::Load(const cv::FileNode& node)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _results.clear();
+    for(auto entry : node)
+    {
+        std::vector<float> values;
+        entry >> values;
+        if(values.size() < 6)
+            continue;
+
+        DnnResult result;
+        result.Box = cv::Rect(int(values[1]), int(values[2]), int(values[3]), int(values[4]));
+        result.Scores.assign(values.begin() + 5, values.end());
+        _results[int(values[0])].push_back(result);
+    }
+}
+
+void DnnClassifier::StartBatch()
+{
+    size_t n = std::min(_queue.size(), size_t(Config.BatchSize));
+    std::vector<Crop> batch(_queue.begin(), _queue.begin() + n);
+    _queue.erase(_queue.begin(), _queue.begin() + n);
+    _batches.push_back(_pool->Enqueue(&DnnClassifier::RunBatch, this, std::move(batch)));
+}
+
+void DnnClassifier::RunBatch(std::vector<Crop> batch)
+{
+    // There are as many networks as threads, so one is always free.
+    int net;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        net = _free_nets.back();
+        _free_nets.pop_back();
+    }
+
+    std::vector<cv::Mat> images;
+    for(const auto& crop : batch)
+        images.push_back(crop.Image);
+
+    // Timed here rather than where crops are added, as that only queues them.
+    cv::Mat scores;
+    try
+    {
+        PipelineStats::Timer timer(Stats.get(), STAGE_DNN);
+        cv::Mat blob = cv::dnn::blobFromImages(images, Config.Scale, Config.InputSize, cv::Scalar(), Config.bSwapRB, false);
+        _nets[net].setInput(blob);
+        scores = _nets[net].forward().reshape(1, int(batch.size()));
+    }
+    catch(...)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _free_nets.push_back(net);
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free_nets.push_back(net);
+    for(int i = 0; i < scores.rows; i++)
+    {
+        DnnResult result;
+        result.Box = batch[i].Box;
+        const float* row = scores.ptr<float>(i);
+        result.Scores.assign(row, row + scores.cols);
+
+        // Turn logits into probabilities, if the model doesn't already.
+        float sum = 0.f, highest = *std::max_element(result.Scores.begin(), result.Scores.end());
+        bool bProbabilities = true;
+        for(float score : result.Scores)
+        {
+            bProbabilities &= score >= 0.f && score <= 1.f;
+            sum += score;
+        }
+        if(!bProbabilities || std::abs(sum - 1.f) > 1e-3f)
+        {
+            sum = 0.f;
+            for(float& score : result.Scores)
+                sum += (score = std::exp(score - highest));
+            for(float& score : result.Scores)
+                score /= sum;
+        }
+        _results[batch[i].Frame].push_back(result);
+    }
+}
+
+bool DnnClassifier::Summarize(const std::vector<const DnnResult*>& results, std::string& label, double& confidence) const
+{
+    if(results.empty() || results[0]->Scores.empty())
+        return false;
+
+    std::vector<double> mean(results[0]->Scores.size(), 0.0);
+    for(const auto* result : results)
+        for(size_t i = 0; i < mean.size() && i < result->Scores.size(); i++)
+            mean[i] += result->Scores[i] / results.size();
+
+    size_t best = std::max_element(mean.begin(), mean.end()) - mean.begin();
+    label = best < _labels.size() ? _labels[best] : std::to_string(best);
+    confidence = mean[best];
+    return true;
+}
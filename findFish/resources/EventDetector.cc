@@ -134,6 +134,20 @@ bool ActivityEvent::IsActive() const
     return (_start_frame != -1 && _end_frame == -1);
 }
 
+void ActivityEvent::AddInfo(std::string key, std::string value)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _json_object->AddKeyValue(key, value);
+    _json_object->BuildJSONObject();
+}
+
+void ActivityEvent::AddInfo(const JSON& info)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _json_object->AddObject(info);
+    _json_object->BuildJSONObject();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////
 // Helper Functions
 std::vector<std::string> SplitString(std::string& str, const char* delimiter)
@@ -0,0 +1,164 @@
+#include "includes/EventIndex.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void EventIndex::Add(int id, int first, int last, int cameras, int thumbnail_row, const std::vector<ObjectTrack>& tracks)
+{
+    EventIndexRecord record = {};
+    record.ID           = id;
+    record.Start        = first;
+    record.End          = last;
+    record.MaxEnd       = last;
+    record.Cameras      = cameras;
+    record.Objects      = (int32_t)tracks.size();
+    record.ThumbnailRow = thumbnail_row;
+    record.TrackOffset  = _tracks.size() * sizeof(int32_t);
+
+    for(const auto& track : tracks)
+    {
+        _tracks.push_back(track.ID);
+        _tracks.push_back((int32_t)track.Frames.size());
+        for(size_t i = 0; i < track.Frames.size(); i++)
+        {
+            const cv::Rect& box = track.Boxes[i];
+            _tracks.insert(_tracks.end(), { track.Frames[i], box.x, box.y, box.width, box.height });
+        }
+    }
+    record.TrackSize = _tracks.size() * sizeof(int32_t) - record.TrackOffset;
+    _records.push_back(record);
+}
+
+bool EventIndex::Write(std::string file) const
+{
+    std::vector<EventIndexRecord> records = _records;
+    std::sort(records.begin(), records.end(), [](const EventIndexRecord& a, const EventIndexRecord& b)
+    {
+        return a.Start != b.Start ? a.Start < b.Start : a.End < b.End;
+    });
+    for(size_t i = 1; i < records.size(); i++)
+        records[i].MaxEnd = std::max(records[i].End, records[i - 1].MaxEnd);
+
+    EventIndexHeader header = {};
+    header.Magic       = EVENT_INDEX_MAGIC;
+    header.Version     = EVENT_INDEX_VERSION;
+    header.Count       = (uint32_t)records.size();
+    header.RecordSize  = sizeof(EventIndexRecord);
+    header.TrackOffset = sizeof(EventIndexHeader) + records.size() * sizeof(EventIndexRecord);
+    header.TrackSize   = _tracks.size() * sizeof(int32_t);
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(EventIndexRecord));
+    out.write(reinterpret_cast<const char*>(_tracks.data()), _tracks.size() * sizeof(int32_t));
+    return (bool)out;
+}
+
+size_t EventIndex::Size() const
+{
+    return _records.size();
+}
+
+EventIndexReader::EventIndexReader(std::string file)
+    : _fd{-1}, _size{0}, _data{nullptr}, _header{nullptr}, _records{nullptr}
+{
+    _fd = open(file.c_str(), O_RDONLY);
+    if(_fd < 0)
+        throw std::runtime_error("Could not open \"" + file + "\": " + strerror(errno));
+
+    struct stat info;
+    if(fstat(_fd, &info) != 0 || (size_t)info.st_size < sizeof(EventIndexHeader))
+    {
+        close(_fd);
+        throw std::runtime_error("\"" + file + "\" is not an event index!");
+    }
+    _size = info.st_size;
+
+    void* mem = mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+    if(mem == MAP_FAILED)
+    {
+        close(_fd);
+        throw std::runtime_error("Could not map \"" + file + "\": " + strerror(errno));
+    }
+    _data    = static_cast<const uint8_t*>(mem);
+    _header  = reinterpret_cast<const EventIndexHeader*>(_data);
+    _records = reinterpret_cast<const EventIndexRecord*>(_data + sizeof(EventIndexHeader));
+
+    // Check everything the header points at is inside the file, so a
+    // truncated index fails here rather than on a query.
+    uint64_t records_end = sizeof(EventIndexHeader) + (uint64_t)_header->Count * sizeof(EventIndexRecord);
+    if(_header->Magic != EVENT_INDEX_MAGIC || _header->Version != EVENT_INDEX_VERSION ||
+       _header->RecordSize != sizeof(EventIndexRecord) || records_end > _size ||
+       _header->TrackOffset < records_end || _header->TrackOffset + _header->TrackSize > _size)
+    {
+        munmap(const_cast<uint8_t*>(_data), _size);
+        close(_fd);
+        throw std::runtime_error("\"" + file + "\" is not an event index, or is from another version!");
+    }
+}
+
+EventIndexReader::~EventIndexReader()
+{
+    munmap(const_cast<uint8_t*>(_data), _size);
+    close(_fd);
+}
+
+size_t EventIndexReader::Size() const
+{
+    return _header->Count;
+}
+
+const EventIndexRecord& EventIndexReader::Get(size_t i) const
+{
+    return _records[i];
+}
+
+std::vector<const EventIndexRecord*> EventIndexReader::Query(int first, int last) const
+{
+    const EventIndexRecord* begin = _records;
+    const EventIndexRecord* end = _records + _header->Count;
+
+    // Records from the first whose MaxEnd reaches the range, up to the last
+    // that starts before it ends, are the only ones that can overlap it.
+    const EventIndexRecord* lo = std::lower_bound(begin, end, first,
+        [](const EventIndexRecord& record, int frame) { return record.MaxEnd < frame; });
+    const EventIndexRecord* hi = std::upper_bound(lo, end, last,
+        [](int frame, const EventIndexRecord& record) { return frame < record.Start; });
+
+    std::vector<const EventIndexRecord*> found;
+    for(const EventIndexRecord* record = lo; record < hi; record++)
+        if(record->End >= first)
+            found.push_back(record);
+    return found;
+}
+
+std::vector<ObjectTrack> EventIndexReader::GetTracks(const EventIndexRecord& record) const
+{
+    std::vector<ObjectTrack> tracks;
+    if(record.TrackOffset + record.TrackSize > _header->TrackSize)
+        return tracks;
+
+    const int32_t* values = reinterpret_cast<const int32_t*>(_data + _header->TrackOffset + record.TrackOffset);
+    size_t n = record.TrackSize / sizeof(int32_t);
+    for(size_t i = 0; i + 2 <= n;)
+    {
+        ObjectTrack track;
+        track.ID = values[i++];
+        size_t boxes = values[i++];
+        for(size_t j = 0; j < boxes && i + 5 <= n; j++, i += 5)
+        {
+            track.Frames.push_back(values[i]);
+            track.Boxes.emplace_back(values[i + 1], values[i + 2], values[i + 3], values[i + 4]);
+        }
+        tracks.push_back(track);
+    }
+    return tracks;
+}
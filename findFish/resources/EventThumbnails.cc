@@ -0,0 +1,156 @@
+#include "includes/EventThumbnails.h"
+
+#include <algorithm>
+
+EventThumbnails::EventThumbnails(EventThumbnails::Settings settings)
+    : Config{settings}
+{
+}
+
+void EventThumbnails::Observe(int frame, const cv::Mat& image, double activity)
+{
+    if(activity <= 0.0 || image.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_size == cv::Size())
+        _size = cv::Size(Config.Width, std::max(1, cvRound(double(Config.Width) * image.rows / image.cols)));
+
+    // Carry on the stretch that ended on the previous frame, if there is one.
+    auto open = _open.find(frame - 1);
+    if(open == _open.end())
+    {
+        Thumbnail thumbnail = Shrink(frame, image, activity);
+        _runs[frame] = { frame, frame, { thumbnail, thumbnail, thumbnail } };
+        _open[frame] = frame;
+        return;
+    }
+
+    Run& run = _runs[open->second];
+    _open.erase(open);
+    _open[frame] = run.First;
+
+    run.Last = frame;
+    run.Picks[COLUMN_END] = Shrink(frame, image, activity);
+    if(activity > run.Picks[COLUMN_PEAK].Activity)
+        run.Picks[COLUMN_PEAK] = run.Picks[COLUMN_END];
+}
+
+int EventThumbnails::AddRow(int first, int last, Thumbnail picks[N_COLUMNS])
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Events are merged from both cameras, so can span several stretches.
+    bool bFound = false;
+    for(auto it = _runs.begin(); it != _runs.end() && it->first <= last; ++it)
+    {
+        const Run& run = it->second;
+        if(run.Last < first)
+            continue;
+
+        if(!bFound || run.First < picks[COLUMN_START].Frame)
+            picks[COLUMN_START] = run.Picks[COLUMN_START];
+        if(!bFound || run.Picks[COLUMN_PEAK].Activity > picks[COLUMN_PEAK].Activity)
+            picks[COLUMN_PEAK] = run.Picks[COLUMN_PEAK];
+        if(!bFound || run.Last > picks[COLUMN_END].Frame)
+            picks[COLUMN_END] = run.Picks[COLUMN_END];
+        bFound = true;
+    }
+    if(!bFound)
+        return -1;
+
+    std::vector<cv::Mat> row;
+    for(int i = 0; i < N_COLUMNS; i++)
+        row.push_back(picks[i].Image);
+    _rows.push_back(row);
+    return int(_rows.size()) - 1;
+}
+
+bool EventThumbnails::WriteSheet(std::string file) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_rows.empty())
+        return false;
+
+    cv::Mat sheet(_size.height * int(_rows.size()), _size.width * N_COLUMNS, _rows[0][0].type(), cv::Scalar::all(0));
+    for(size_t i = 0; i < _rows.size(); i++)
+        for(int j = 0; j < N_COLUMNS; j++)
+            _rows[i][j].copyTo(sheet(cv::Rect(j * _size.width, int(i) * _size.height, _size.width, _size.height)));
+
+    return cv::imwrite(file, sheet, { cv::IMWRITE_JPEG_QUALITY, Config.Quality });
+}
+
+cv::Size EventThumbnails::GetThumbnailSize() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+}
+
+void EventThumbnails::Save(cv::FileStorage& fs, std::string name) const
+{
+    // The thumbnails are kept as JPEGs, like the sheet they end up in, so a
+    // long job's checkpoint doesn't hold every picked frame as text.
+    std::lock_guard<std::mutex> lock(_mutex);
+    fs << name << "{";
+    fs << "size" << _size;
+    fs << "runs" << "[";
+    for(const auto& entry : _runs)
+    {
+        const Run& run = entry.second;
+        fs << "{" << "first" << run.First << "last" << run.Last << "picks" << "[";
+        for(int i = 0; i < N_COLUMNS; i++)
+        {
+            std::vector<unsigned char> jpeg;
+            cv::imencode(".jpg", run.Picks[i].Image, jpeg, { cv::IMWRITE_JPEG_QUALITY, Config.Quality });
+            fs << "{" << "frame" << run.Picks[i].Frame << "activity" << run.Picks[i].Activity
+               << "image" << cv::Mat(jpeg) << "}";
+        }
+        fs << "]" << "}";
+    }
+    fs << "]" << "}";
+}
+
+void EventThumbnails::Load(const cv::FileNode& node)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _runs.clear();
+    _open.clear();
+    if(node.empty())
+        return;
+
+    node["size"] >> _size;
+    for(auto entry : node["runs"])
+    {
+        Run run;
+        run.First = (int)entry["first"];
+        run.Last  = (int)entry["last"];
+
+        int i = 0;
+        for(auto pick : entry["picks"])
+        {
+            if(i >= N_COLUMNS)
+                break;
+            cv::Mat jpeg;
+            pick["image"] >> jpeg;
+            run.Picks[i].Frame    = (int)pick["frame"];
+            run.Picks[i].Activity = (double)pick["activity"];
+            run.Picks[i].Image    = jpeg.empty() ? cv::Mat() : cv::imdecode(jpeg, cv::IMREAD_UNCHANGED);
+            i++;
+        }
+        if(i < N_COLUMNS || run.Picks[COLUMN_START].Image.empty())
+            continue;
+
+        // Stretches that ran up to the checkpoint carry on from it.
+        _runs[run.First] = run;
+        _open[run.Last] = run.First;
+    }
+}
+
+Thumbnail EventThumbnails::Shrink(int frame, const cv::Mat& image, double activity)
+{
+    Thumbnail thumbnail;
+    thumbnail.Frame = frame;
+    thumbnail.Activity = activity;
+    cv::resize(image, thumbnail.Image, _size, 0, 0, cv::INTER_AREA);
+    return thumbnail;
+}
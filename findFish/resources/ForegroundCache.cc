@@ -0,0 +1,205 @@
+#include "includes/ForegroundCache.h"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+/// The start of the cache file.
+struct ForegroundCacheHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    double Scale;
+    int32_t Levels;
+    int32_t Flags;
+};
+
+/// Set in the header's flags when the foregrounds are of the raw frames.
+static const int32_t FOREGROUND_RAW_FRAMES = 1;
+
+/// The start of each record, followed by Bytes of PNG.
+struct ForegroundRecord
+{
+    int32_t Frame;
+    int32_t Camera;
+    uint32_t Bytes;
+};
+
+ForegroundCache::ForegroundCache(std::string file, ForegroundCache::Settings settings)
+    : Config{settings}, _file{file}, _size{0}
+{
+    Config.Scale = std::min(1.0, std::max(0.01, Config.Scale));
+    Config.Levels = std::min(256, std::max(2, Config.Levels));
+    Open();
+}
+
+void ForegroundCache::Add(int frame, int camera, const cv::Mat& foreground)
+{
+    if(foreground.empty())
+        return;
+
+    // Scaling down by area averages the foreground, so a quantized pixel
+    // still says how much of its patch was moving.
+    cv::Mat small, quantized;
+    cv::resize(foreground, small, cv::Size(), Config.Scale, Config.Scale, cv::INTER_AREA);
+    small.convertTo(quantized, CV_8U, (Config.Levels - 1) / 255.0);
+
+    std::vector<unsigned char> png;
+    cv::imencode(".png", quantized, png, { cv::IMWRITE_PNG_COMPRESSION, Config.Compression });
+    ForegroundRecord record = { frame, camera, (uint32_t)png.size() };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    _out.write(reinterpret_cast<const char*>(png.data()), png.size());
+    if(!_out)
+        throw std::runtime_error("Could not write to \"" + _file + "\"!");
+    _size += sizeof(record) + png.size();
+}
+
+void ForegroundCache::Flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _out.flush();
+}
+
+uint64_t ForegroundCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+}
+
+void ForegroundCache::Truncate(uint64_t size)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _out.close();
+
+    // Anything short of the header starts the cache over.
+    if(size < sizeof(ForegroundCacheHeader))
+        size = 0;
+    if(size < _size && truncate(_file.c_str(), size) != 0)
+        throw std::runtime_error("Could not truncate \"" + _file + "\"!");
+    Open();
+}
+
+void ForegroundCache::Open()
+{
+    {
+        std::ifstream in(_file, std::ios::binary | std::ios::ate);
+        _size = in.is_open() ? (uint64_t)in.tellg() : 0;
+        if(_size > 0)
+        {
+            ForegroundCacheHeader existing = {};
+            in.seekg(0);
+            in.read(reinterpret_cast<char*>(&existing), sizeof(existing));
+            if(!in || existing.Magic != FOREGROUND_CACHE_MAGIC || existing.Version != FOREGROUND_CACHE_VERSION)
+                throw std::runtime_error("\"" + _file + "\" is not a foreground cache, or is from another version!");
+
+            // Every record in a cache has to be at the same scale, and of the
+            // same frames. Raw and undistorted masks can't be mixed, so a
+            // cache of the other kind is started over.
+            if(((existing.Flags & FOREGROUND_RAW_FRAMES) != 0) != Config.bRawFrames)
+            {
+                in.close();
+                if(truncate(_file.c_str(), 0) != 0)
+                    throw std::runtime_error("Could not truncate \"" + _file + "\"!");
+                _size = 0;
+            }
+            else
+            {
+                Config.Scale  = existing.Scale;
+                Config.Levels = existing.Levels;
+            }
+        }
+    }
+
+    _out.open(_file, std::ios::binary | std::ios::app);
+    if(!_out.is_open())
+        throw std::runtime_error("Could not open \"" + _file + "\"!");
+    if(_size == 0)
+    {
+        ForegroundCacheHeader header = { FOREGROUND_CACHE_MAGIC, FOREGROUND_CACHE_VERSION, Config.Scale, Config.Levels,
+                                         Config.bRawFrames ? FOREGROUND_RAW_FRAMES : 0 };
+        _out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        _out.flush();
+        _size = sizeof(header);
+    }
+}
+
+ForegroundCacheReader::ForegroundCacheReader(std::string file)
+    : _in{file, std::ios::binary}
+{
+    ForegroundCacheHeader header = {};
+    _in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!_in)
+        throw std::runtime_error("Could not read \"" + file + "\"!");
+    if(header.Magic != FOREGROUND_CACHE_MAGIC || header.Version != FOREGROUND_CACHE_VERSION)
+        throw std::runtime_error("\"" + file + "\" is not a foreground cache, or is from another version!");
+    _scale  = header.Scale;
+    _levels = std::max(2, header.Levels);
+    _bRaw   = (header.Flags & FOREGROUND_RAW_FRAMES) != 0;
+
+    // Find every record up front, skipping over the images, so they can be
+    // read back in frame order even when chunks wrote them out of order. A
+    // record cut short at the end is left out.
+    _in.seekg(0, std::ios::end);
+    std::streamoff end = _in.tellg();
+    std::streamoff offset = sizeof(header);
+    ForegroundRecord record;
+    while(offset + (std::streamoff)sizeof(record) <= end)
+    {
+        _in.seekg(offset);
+        _in.read(reinterpret_cast<char*>(&record), sizeof(record));
+        if(!_in || offset + (std::streamoff)sizeof(record) + record.Bytes > end)
+            break;
+        _records[std::make_pair(record.Frame, record.Camera)] = offset;
+        offset += sizeof(record) + record.Bytes;
+    }
+    _in.clear();
+    _next = _records.begin();
+}
+
+bool ForegroundCacheReader::Next(int& frame, int& camera, cv::Mat& foreground)
+{
+    while(_next != _records.end())
+    {
+        auto current = _next++;
+
+        ForegroundRecord record;
+        _in.seekg(current->second);
+        _in.read(reinterpret_cast<char*>(&record), sizeof(record));
+        std::vector<unsigned char> png(record.Bytes);
+        _in.read(reinterpret_cast<char*>(png.data()), png.size());
+
+        cv::Mat quantized = _in ? cv::imdecode(png, cv::IMREAD_GRAYSCALE) : cv::Mat();
+        if(quantized.empty())
+        {
+            _in.clear();
+            continue;
+        }
+
+        frame  = record.Frame;
+        camera = record.Camera;
+        quantized.convertTo(foreground, CV_8U, 255.0 / (_levels - 1));
+        return true;
+    }
+    return false;
+}
+
+double ForegroundCacheReader::GetScale() const
+{
+    return _scale;
+}
+
+bool ForegroundCacheReader::IsRaw() const
+{
+    return _bRaw;
+}
+
+size_t ForegroundCacheReader::Size() const
+{
+    return _records.size();
+}
@@ -2,6 +2,8 @@
 #include <cstdarg>
 #include <cstdlib>
 
+std::string FormatValue(const std::string&);
+
 JSON::JSON(std::string ObjectName)
 : _json_string{ "{}" }, _name{ ObjectName } 
 {
@@ -12,6 +14,7 @@ JSON::JSON(const JSON& j)
     this->_name = j._name;
     this->_json_string = j._json_string;
     this->_key_val_pairs = j._key_val_pairs;
+    this->_key_arrays = j._key_arrays;
 }
 
 JSON::~JSON()
@@ -47,6 +50,11 @@ void JSON::AddKeyValue(std::string Key, std::string Value)
     _key_val_pairs.insert(std::make_pair(Key, Value));
 }
 
+void JSON::AddKeyArray(std::string Key, std::vector<std::string> Values)
+{
+    _key_arrays[Key] = Values;
+}
+
 void JSON::AddObject(JSON& Object)
 {
     if(Object.GetJSON() != "{}")
@@ -66,17 +74,24 @@ void JSON::BuildJSONObject()
     for(auto e : _key_val_pairs)
     {
         ++it;
-        _json_string += "\"" + e.first + "\":";
-        
-        char* err;
-        std::strtod(e.second.c_str(), &err);
-        _json_string += *err == '\0' ? e.second : "\"" + e.second + "\"";
-
+        _json_string += "\"" + e.first + "\":" + FormatValue(e.second);
         if(it != _key_val_pairs.end()) _json_string += ",";
     }
 
+    if(!_key_val_pairs.empty() && !_key_arrays.empty()) _json_string += ",";
+    auto at = _key_arrays.begin();
+    for(auto e : _key_arrays)
+    {
+        ++at;
+        _json_string += "\"" + e.first + "\":[";
+        for(size_t i = 0; i < e.second.size(); i++)
+            _json_string += (i > 0 ? "," : "") + FormatValue(e.second[i]);
+        _json_string += "]";
+        if(at != _key_arrays.end()) _json_string += ",";
+    }
+
     auto jt = _subobjects.begin();
-    if(!_key_val_pairs.empty() && it != _key_val_pairs.end()) _json_string += ",";
+    if((!_key_val_pairs.empty() || !_key_arrays.empty()) && !_subobjects.empty()) _json_string += ",";
     for(auto e : _subobjects)
     {
         ++jt;
@@ -94,17 +109,12 @@ void JSON::BuildJSONObjectArray()
     for(auto e : _key_val_pairs)
     {
         ++it;
-        _json_string += "{\"" + e.first + "\":";
-        
-        char* err;
-        std::strtod(e.second.c_str(), &err);
-        _json_string += *err == '\0' ? e.second : "\"" + e.second + "\"";
-        _json_string += "}";
+        _json_string += "{\"" + e.first + "\":" + FormatValue(e.second) + "}";
         if(it != _key_val_pairs.end()) _json_string += ",";
     }
 
     auto jt = _subobjects.begin();
-    if(!_key_val_pairs.empty() && it != _key_val_pairs.end()) _json_string += ",";
+    if(!_key_val_pairs.empty() && !_subobjects.empty()) _json_string += ",";
     for(auto e : _subobjects)
     {
         ++jt;
@@ -135,3 +145,11 @@ std::vector<std::string> JSON::GetSubobjectNames()
     
     return tempNames;
 }
+
+std::string FormatValue(const std::string& value)
+{
+    // Numbers are written as they are, anything else as a string.
+    char* err;
+    std::strtod(value.c_str(), &err);
+    return *err == '\0' ? value : "\"" + value + "\"";
+}
@@ -0,0 +1,194 @@
+#include "includes/LengthEstimator.h"
+#include "includes/Calibration.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+void FindContourEnds(const std::vector<cv::Point>&, cv::Point2f&, cv::Point2f&);
+double DistanceToLine(const cv::Vec3f&, const cv::Point2f&);
+
+LengthEstimator::LengthEstimator(const Calibration& calib, LengthEstimator::Settings settings)
+    : Config{settings}
+{
+    cv::Mat Q;
+    if(!calib.GetFundamental(_F) || !calib.GetRectification(_K, _R, _P, Q))
+        throw std::runtime_error("The stereo calibration is missing F or its rectification, so lengths can't be measured!");
+}
+
+std::vector<ContourMatch> LengthEstimator::Match(const Contours& left, const Contours& right) const
+{
+    std::vector<ContourMatch> matches;
+
+    // Find the ends of every contour big enough to be an object.
+    std::vector<std::pair<cv::Point2f, cv::Point2f>> right_ends;
+    for(const auto& contour : right)
+    {
+        cv::Point2f head, tail;
+        if(cv::contourArea(contour) >= Config.MinArea)
+            FindContourEnds(contour, head, tail);
+        else
+            head = tail = cv::Point2f(-1.f, -1.f);
+        right_ends.push_back(std::make_pair(head, tail));
+    }
+
+    for(const auto& contour : left)
+    {
+        if(cv::contourArea(contour) < Config.MinArea)
+            continue;
+
+        ContourMatch match;
+        FindContourEnds(contour, match.Head[0], match.Tail[0]);
+
+        std::vector<cv::Point2f> ends = { match.Head[0], match.Tail[0] };
+        std::vector<cv::Vec3f> lines;
+        cv::computeCorrespondEpilines(ends, 1, _F, lines);
+
+        // The partner is the contour whose ends sit closest to the lines, in
+        // whichever order fits better.
+        match.Error = std::numeric_limits<double>::max();
+        for(const auto& candidate : right_ends)
+        {
+            if(candidate.first.x < 0.f)
+                continue;
+
+            double forward  = (DistanceToLine(lines[0], candidate.first) + DistanceToLine(lines[1], candidate.second)) / 2.0;
+            double backward = (DistanceToLine(lines[0], candidate.second) + DistanceToLine(lines[1], candidate.first)) / 2.0;
+            if(std::min(forward, backward) < match.Error)
+            {
+                match.Error   = std::min(forward, backward);
+                match.Head[1] = forward <= backward ? candidate.first : candidate.second;
+                match.Tail[1] = forward <= backward ? candidate.second : candidate.first;
+            }
+        }
+
+        if(match.Error <= Config.MaxEpipolarError)
+            matches.push_back(match);
+    }
+    return matches;
+}
+
+std::vector<double> LengthEstimator::Measure(const std::vector<ContourMatch>& matches) const
+{
+    std::vector<double> lengths;
+    if(matches.empty())
+        return lengths;
+
+    // Rectify every end, then triangulate them all in one go.
+    std::vector<cv::Point2f> points[2];
+    for(const auto& match : matches)
+        for(int i = 0; i < 2; i++)
+        {
+            points[i].push_back(match.Head[i]);
+            points[i].push_back(match.Tail[i]);
+        }
+
+    std::vector<cv::Point2f> rectified[2];
+    for(int i = 0; i < 2; i++)
+        cv::undistortPoints(points[i], rectified[i], _K[i], cv::Mat(), _R[i], _P[i]);
+
+    cv::Mat homogeneous;
+    cv::triangulatePoints(_P[0], _P[1], rectified[0], rectified[1], homogeneous);
+
+    std::vector<cv::Point3f> world;
+    cv::convertPointsFromHomogeneous(homogeneous.t(), world);
+
+    for(size_t i = 0; i + 1 < world.size(); i += 2)
+        if(world[i].z > 0 && world[i + 1].z > 0)
+            lengths.push_back(cv::norm(world[i] - world[i + 1]));
+    return lengths;
+}
+
+void LengthEstimator::Add(int frame, const std::vector<ContourMatch>& matches)
+{
+    if(matches.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& kept = _matches[frame];
+    kept.insert(kept.end(), matches.begin(), matches.end());
+}
+
+std::vector<double> LengthEstimator::GetLengths(int first, int last) const
+{
+    std::vector<ContourMatch> matches;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(auto it = _matches.lower_bound(first); it != _matches.end() && it->first <= last; ++it)
+            matches.insert(matches.end(), it->second.begin(), it->second.end());
+    }
+    return Measure(matches);
+}
+
+void LengthEstimator::Save(cv::FileStorage& fs, std::string name) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    fs << name << "[";
+    for(const auto& frame : _matches)
+        for(const auto& match : frame.second)
+            fs << std::vector<double>{ double(frame.first),
+                                       match.Head[0].x, match.Head[0].y, match.Tail[0].x, match.Tail[0].y,
+                                       match.Head[1].x, match.Head[1].y, match.Tail[1].x, match.Tail[1].y,
+                                       match.Error };
+    fs << "]";
+}
+
+void LengthEstimator::Load(const cv::FileNode& node)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _matches.clear();
+    for(auto entry : node)
+    {
+        std::vector<double> values;
+        entry >> values;
+        if(values.size() != 10)
+            continue;
+
+        ContourMatch match;
+        for(int i = 0; i < 2; i++)
+        {
+            match.Head[i] = cv::Point2f(values[1 + 4 * i], values[2 + 4 * i]);
+            match.Tail[i] = cv::Point2f(values[3 + 4 * i], values[4 + 4 * i]);
+        }
+        match.Error = values[9];
+        _matches[int(values[0])].push_back(match);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+void FindContourEnds(const std::vector<cv::Point>& contour, cv::Point2f& head, cv::Point2f& tail)
+{
+    // The ends are the furthest points either way along the contour's
+    // principal axis.
+    cv::Point2f mean(0.f, 0.f);
+    for(const auto& point : contour)
+        mean += cv::Point2f(point.x, point.y);
+    mean = mean / double(contour.size());
+
+    double xx = 0.0, yy = 0.0, xy = 0.0;
+    for(const auto& point : contour)
+    {
+        double dx = point.x - mean.x, dy = point.y - mean.y;
+        xx += dx * dx; yy += dy * dy; xy += dx * dy;
+    }
+    double angle = 0.5 * std::atan2(2.0 * xy, xx - yy);
+    cv::Point2f axis(std::cos(angle), std::sin(angle));
+
+    double lowest = std::numeric_limits<double>::max(), highest = -lowest;
+    for(const auto& point : contour)
+    {
+        cv::Point2f p(point.x, point.y);
+        double along = (p - mean).dot(axis);
+        if(along < lowest)  { lowest = along;  tail = p; }
+        if(along > highest) { highest = along; head = p; }
+    }
+}
+
+double DistanceToLine(const cv::Vec3f& line, const cv::Point2f& point)
+{
+    // computeCorrespondEpilines normalizes lines so that a² + b² = 1.
+    return std::abs(line[0] * point.x + line[1] * point.y + line[2]);
+}
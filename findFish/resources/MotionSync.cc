@@ -0,0 +1,135 @@
+#include "includes/MotionSync.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool Standardise(const std::vector<float>&, int, cv::Mat&);
+
+/// How far either side of the best lag still counts as the same peak, as
+/// motion rarely starts and stops within a single frame.
+static const int PEAK_WIDTH = 5;
+
+MotionSync::MotionSync(MotionSync::Settings settings)
+    : Config{settings}
+{
+    Config.MaxLag = std::max(0, Config.MaxLag);
+}
+
+void MotionSync::Add(int camera, const cv::Mat& frame)
+{
+    if(camera < 0)
+        return;
+    if((int)_signals.size() <= camera)
+    {
+        _signals.resize(camera + 1);
+        _previous.resize(camera + 1);
+    }
+
+    if(frame.empty())
+    {
+        _signals[camera].push_back(0.0f);
+        return;
+    }
+
+    // Shrinking by area averages away the noise, so only real motion is left.
+    cv::Mat small, grey;
+    cv::resize(frame, small, Config.Size, 0, 0, cv::INTER_AREA);
+    if(small.channels() > 1)
+        cv::cvtColor(small, grey, cv::COLOR_BGR2GRAY);
+    else
+        grey = small;
+
+    float energy = 0.0f;
+    if(!_previous[camera].empty())
+    {
+        cv::Mat difference;
+        cv::absdiff(grey, _previous[camera], difference);
+        energy = (float)cv::mean(difference)[0];
+    }
+    _signals[camera].push_back(energy);
+    _previous[camera] = grey;
+}
+
+const std::vector<float>& MotionSync::GetSignal(int camera) const
+{
+    static const std::vector<float> empty;
+    return (camera >= 0 && camera < (int)_signals.size()) ? _signals[camera] : empty;
+}
+
+MotionSync::Result MotionSync::Estimate(int camera) const
+{
+    return CrossCorrelate(GetSignal(0), GetSignal(camera), Config.MaxLag);
+}
+
+MotionSync::Result MotionSync::CrossCorrelate(const std::vector<float>& first, const std::vector<float>& second, int max_lag)
+{
+    Result result;
+    int n_first = first.size(), n_second = second.size();
+
+    // Both signals are zero padded to at least their combined length, so the
+    // circular correlation the FFT gives never wraps onto itself.
+    int n = cv::getOptimalDFTSize(n_first + n_second);
+    cv::Mat a, b;
+    if(!Standardise(first, n, a) || !Standardise(second, n, b))
+        return result;
+
+    cv::Mat spectrum_a, spectrum_b, product, correlation;
+    cv::dft(a, spectrum_a, cv::DFT_COMPLEX_OUTPUT);
+    cv::dft(b, spectrum_b, cv::DFT_COMPLEX_OUTPUT);
+    cv::mulSpectrums(spectrum_b, spectrum_a, product, 0, true);
+    cv::idft(product, correlation, cv::DFT_REAL_OUTPUT | cv::DFT_SCALE);
+
+    // Each lag is averaged over the frames the signals share there, and lags
+    // that leave less than half of the shorter signal overlapping are skipped.
+    max_lag = std::min(max_lag, std::max(n_first, n_second));
+    int min_overlap = std::max(2, std::min(n_first, n_second) / 2);
+    std::vector<std::pair<int, float>> lags;
+    for(int lag = -max_lag; lag <= max_lag; lag++)
+    {
+        int overlap = std::min(n_first, n_second - lag) - std::max(0, -lag);
+        if(overlap < min_overlap)
+            continue;
+        lags.push_back(std::make_pair(lag, correlation.at<float>(0, (lag + n) % n) / overlap));
+    }
+    if(lags.empty())
+        return result;
+
+    auto best = std::max_element(lags.begin(), lags.end(),
+        [](const std::pair<int, float>& x, const std::pair<int, float>& y) { return x.second < y.second; });
+
+    float runner_up = 0.0f;
+    for(const auto& lag : lags)
+        if(std::abs(lag.first - best->first) > PEAK_WIDTH)
+            runner_up = std::max(runner_up, lag.second);
+
+    result.Offset = best->first;
+    result.Confidence = std::min(1.0, std::max(0.0, double(best->second - runner_up)));
+    return result;
+}
+
+bool MotionSync::IsConfident(const MotionSync::Result& result) const
+{
+    return result.Confidence >= Config.MinConfidence;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+/// Copies a signal into a zero padded row with zero mean and unit variance.
+/// Returns false if the signal is too short or never changes.
+bool Standardise(const std::vector<float>& signal, int length, cv::Mat& out)
+{
+    if(signal.size() < 2)
+        return false;
+
+    cv::Mat values = cv::Mat(signal).reshape(1, 1);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(values, mean, stddev);
+    if(stddev[0] < 1e-6)
+        return false;
+
+    out = cv::Mat::zeros(1, length, CV_32F);
+    values.convertTo(out(cv::Rect(0, 0, values.cols, 1)), CV_32F, 1.0 / stddev[0], -mean[0] / stddev[0]);
+    return true;
+}
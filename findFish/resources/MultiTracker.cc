@@ -0,0 +1,304 @@
+#include "includes/MultiTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+cv::Point2f Centre(const cv::Rect&);
+int64_t CellKey(int, int);
+
+MultiTracker::MultiTracker(MultiTracker::Settings settings)
+    : Config{settings}
+{
+}
+
+std::vector<int> MultiTracker::Update(int frame, const std::vector<cv::Rect>& boxes)
+{
+    std::vector<int> ids(boxes.size(), 0);
+
+    // Bucket the boxes by the cell their centre falls in.
+    std::unordered_map<int64_t, std::vector<int>> grid;
+    for(size_t i = 0; i < boxes.size(); i++)
+        if(boxes[i].area() >= Config.MinArea)
+        {
+            cv::Point2f centre = Centre(boxes[i]);
+            grid[CellKey(int(std::floor(centre.x / Config.CellSize)), int(std::floor(centre.y / Config.CellSize)))].push_back(int(i));
+        }
+
+    // Score every track against the boxes in the cells around where it is
+    // expected to be.
+    struct Candidate { double Cost; int Track, Box; };
+    std::vector<Candidate> candidates;
+    std::vector<cv::Rect> predicted(_active.size());
+    for(size_t t = 0; t < _active.size(); t++)
+    {
+        const Active& active = _active[t];
+        int gap = frame - active.Track.Frames.back();
+        cv::Point2f shift = active.Velocity * float(gap);
+        predicted[t] = active.Track.Boxes.back() + cv::Point(cvRound(shift.x), cvRound(shift.y));
+
+        cv::Point2f centre = Centre(predicted[t]);
+        double reach = Config.MaxDistance + std::max(predicted[t].width, predicted[t].height);
+        int x0 = int(std::floor((centre.x - reach) / Config.CellSize)), x1 = int(std::floor((centre.x + reach) / Config.CellSize));
+        int y0 = int(std::floor((centre.y - reach) / Config.CellSize)), y1 = int(std::floor((centre.y + reach) / Config.CellSize));
+        for(int y = y0; y <= y1; y++)
+            for(int x = x0; x <= x1; x++)
+            {
+                auto cell = grid.find(CellKey(x, y));
+                if(cell == grid.end())
+                    continue;
+
+                double cost;
+                for(int b : cell->second)
+                    if(Score(predicted[t], boxes[b], cost))
+                        candidates.push_back({ cost, int(t), b });
+            }
+    }
+
+    // Take the best matches first, using each track and box once.
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.Cost < b.Cost; });
+    std::vector<bool> bTrackUsed(_active.size(), false), bBoxUsed(boxes.size(), false);
+    for(const auto& candidate : candidates)
+    {
+        if(bTrackUsed[candidate.Track] || bBoxUsed[candidate.Box])
+            continue;
+        bTrackUsed[candidate.Track] = bBoxUsed[candidate.Box] = true;
+
+        Active& active = _active[candidate.Track];
+        const cv::Rect& box = boxes[candidate.Box];
+        int gap = frame - active.Track.Frames.back();
+        cv::Point2f step = (Centre(box) - Centre(active.Track.Boxes.back())) * (1.f / gap);
+        active.Velocity = active.Track.Frames.size() > 1 ? 0.5f * (active.Velocity + step) : step;
+
+        active.Track.Frames.push_back(frame);
+        active.Track.Boxes.push_back(box);
+        if(active.Track.ID == 0 && int(active.Track.Frames.size()) >= Config.MinHits)
+            active.Track.ID = _next_id++;
+        ids[candidate.Box] = active.Track.ID;
+    }
+
+    // End the tracks that have gone unseen for too long.
+    std::vector<Active> still_active;
+    for(size_t t = 0; t < _active.size(); t++)
+    {
+        if(!bTrackUsed[t] && frame - _active[t].Track.Frames.back() > Config.MaxMissed)
+            Finish(_active[t]);
+        else
+            still_active.push_back(std::move(_active[t]));
+    }
+    _active = std::move(still_active);
+
+    // Anything left over is a new object.
+    for(size_t b = 0; b < boxes.size(); b++)
+        if(!bBoxUsed[b] && boxes[b].area() >= Config.MinArea)
+        {
+            Active active;
+            active.Track.Frames.push_back(frame);
+            active.Track.Boxes.push_back(boxes[b]);
+            active.Velocity = cv::Point2f(0.f, 0.f);
+            if(Config.MinHits <= 1)
+                active.Track.ID = _next_id++;
+            ids[b] = active.Track.ID;
+            _active.push_back(active);
+        }
+    return ids;
+}
+
+void MultiTracker::SetLabel(int id, std::string label)
+{
+    for(auto& active : _active)
+        if(active.Track.ID == id)
+            active.Track.Label = label;
+}
+
+std::vector<ObjectTrack> MultiTracker::GetTracks(int first, int last) const
+{
+    std::vector<ObjectTrack> tracks;
+    auto add = [&](const ObjectTrack& track)
+    {
+        if(track.ID == 0 || track.Frames.front() > last || track.Frames.back() < first)
+            return;
+
+        ObjectTrack part;
+        part.ID = track.ID;
+        part.Label = track.Label;
+        for(size_t i = 0; i < track.Frames.size(); i++)
+            if(track.Frames[i] >= first && track.Frames[i] <= last)
+            {
+                part.Frames.push_back(track.Frames[i]);
+                part.Boxes.push_back(track.Boxes[i]);
+            }
+        tracks.push_back(part);
+    };
+
+    for(const auto& track : _finished)
+        add(track);
+    for(const auto& active : _active)
+        add(active.Track);
+
+    std::sort(tracks.begin(), tracks.end(),
+        [](const ObjectTrack& a, const ObjectTrack& b) { return a.ID < b.ID; });
+    return tracks;
+}
+
+void MultiTracker::Append(const MultiTracker& next, int boundary)
+{
+    // Neither tracker will see any more frames.
+    for(auto& active : _active)
+        Finish(active);
+    _active.clear();
+
+    std::vector<ObjectTrack> incoming = next._finished;
+    for(const auto& active : next._active)
+        if(active.Track.ID != 0)
+            incoming.push_back(active.Track);
+    std::sort(incoming.begin(), incoming.end(),
+        [](const ObjectTrack& a, const ObjectTrack& b) { return a.ID < b.ID; });
+
+    // Tracks that were still going when this tracker stopped can carry on
+    // into ones that start where the next one began.
+    std::vector<bool> bJoined(_finished.size(), false);
+    for(auto& track : incoming)
+    {
+        double best_cost = 0.0;
+        int best = -1;
+        if(track.Frames.front() == boundary)
+            for(size_t i = 0; i < _finished.size(); i++)
+            {
+                double cost;
+                const ObjectTrack& previous = _finished[i];
+                if(bJoined[i] || previous.Frames.back() >= boundary || boundary - previous.Frames.back() > Config.MaxMissed)
+                    continue;
+                if(Score(previous.Boxes.back(), track.Boxes.front(), cost) && (best < 0 || cost < best_cost))
+                {
+                    best = int(i);
+                    best_cost = cost;
+                }
+            }
+
+        if(best >= 0)
+        {
+            bJoined[best] = true;
+            ObjectTrack& previous = _finished[best];
+            previous.Frames.insert(previous.Frames.end(), track.Frames.begin(), track.Frames.end());
+            previous.Boxes.insert(previous.Boxes.end(), track.Boxes.begin(), track.Boxes.end());
+            if(previous.Label.empty())
+                previous.Label = track.Label;
+        }
+        else
+        {
+            track.ID = _next_id++;
+            _finished.push_back(track);
+        }
+    }
+}
+
+void MultiTracker::Save(cv::FileStorage& fs, std::string name) const
+{
+    // Each track is written as its ID and velocity, then frame and box
+    // after frame and box.
+    fs << name << "{";
+    fs << "next_id" << _next_id;
+    for(int list = 0; list < 2; list++)
+    {
+        fs << (list == 0 ? "finished" : "active") << "[";
+        size_t count = list == 0 ? _finished.size() : _active.size();
+        for(size_t i = 0; i < count; i++)
+        {
+            const ObjectTrack& track = list == 0 ? _finished[i] : _active[i].Track;
+            cv::Point2f velocity = list == 0 ? cv::Point2f(0.f, 0.f) : _active[i].Velocity;
+
+            std::vector<double> values = { double(track.ID), velocity.x, velocity.y };
+            for(size_t j = 0; j < track.Frames.size(); j++)
+            {
+                const cv::Rect& box = track.Boxes[j];
+                values.insert(values.end(), { double(track.Frames[j]), double(box.x), double(box.y), double(box.width), double(box.height) });
+            }
+            fs << values;
+        }
+        fs << "]";
+    }
+
+    fs << "labels" << "[";
+    for(const auto& track : _finished)
+        if(!track.Label.empty())
+            fs << "{" << "id" << track.ID << "label" << track.Label << "}";
+    for(const auto& active : _active)
+        if(!active.Track.Label.empty())
+            fs << "{" << "id" << active.Track.ID << "label" << active.Track.Label << "}";
+    fs << "]";
+    fs << "}";
+}
+
+void MultiTracker::Load(const cv::FileNode& node)
+{
+    _finished.clear();
+    _active.clear();
+    if(node.empty())
+        return;
+
+    _next_id = (int)node["next_id"];
+    for(int list = 0; list < 2; list++)
+        for(auto entry : node[list == 0 ? "finished" : "active"])
+        {
+            std::vector<double> values;
+            entry >> values;
+            if(values.size() < 8 || (values.size() - 3) % 5 != 0)
+                continue;
+
+            Active active;
+            active.Track.ID = int(values[0]);
+            active.Velocity = cv::Point2f(values[1], values[2]);
+            for(size_t j = 3; j < values.size(); j += 5)
+            {
+                active.Track.Frames.push_back(int(values[j]));
+                active.Track.Boxes.push_back(cv::Rect(int(values[j + 1]), int(values[j + 2]), int(values[j + 3]), int(values[j + 4])));
+            }
+
+            if(list == 0) _finished.push_back(active.Track);
+            else          _active.push_back(active);
+        }
+
+    for(auto entry : node["labels"])
+    {
+        int id = (int)entry["id"];
+        std::string label = (std::string)entry["label"];
+        for(auto& track : _finished)
+            if(track.ID == id) track.Label = label;
+        SetLabel(id, label);
+    }
+}
+
+void MultiTracker::Finish(Active& active)
+{
+    if(active.Track.ID != 0)
+        _finished.push_back(std::move(active.Track));
+}
+
+bool MultiTracker::Score(const cv::Rect& predicted, const cv::Rect& box, double& cost) const
+{
+    double overlap = (predicted & box).area();
+    double iou = overlap > 0 ? overlap / (predicted.area() + box.area() - overlap) : 0.0;
+    double distance = cv::norm(Centre(predicted) - Centre(box));
+    if(iou < Config.MinIoU && distance > Config.MaxDistance)
+        return false;
+
+    cost = (1.0 - iou) + std::min(1.0, distance / Config.MaxDistance);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+cv::Point2f Centre(const cv::Rect& box)
+{
+    return cv::Point2f(box.x + box.width / 2.f, box.y + box.height / 2.f);
+}
+
+int64_t CellKey(int x, int y)
+{
+    return (int64_t(x) << 32) ^ int64_t(uint32_t(y));
+}
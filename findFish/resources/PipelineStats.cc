@@ -0,0 +1,257 @@
+#include "includes/PipelineStats.h"
+#include "includes/JsonBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+
+#include <sys/resource.h>
+
+void AtomicMax(std::atomic<uint64_t>&, uint64_t);
+std::string FormatMs(double);
+double ProcessCpuSeconds();
+
+///////////////////////////////////////////////////////////////////////////////
+// Latency Histogram
+LatencyHistogram::LatencyHistogram()
+    : _count{0}, _total_ns{0}, _max_ns{0}
+{
+    for(auto& bucket : _buckets)
+        bucket = 0;
+}
+
+void LatencyHistogram::Record(double seconds)
+{
+    uint64_t ns = uint64_t(std::max(0.0, seconds) * 1e9);
+
+    // Bucket 0 holds everything under a microsecond. Above that, there are
+    // four buckets per doubling of the latency.
+    double us = ns / 1000.0;
+    int index = us < 1.0 ? 0 : 1 + int(std::log2(us) * 4.0);
+    index = std::min(index, N_BUCKETS - 1);
+
+    _buckets[index]++;
+    _count++;
+    _total_ns += ns;
+    AtomicMax(_max_ns, ns);
+}
+
+uint64_t LatencyHistogram::Count() const
+{
+    return _count;
+}
+
+double LatencyHistogram::Total() const
+{
+    return _total_ns / 1e9;
+}
+
+double LatencyHistogram::Max() const
+{
+    return _max_ns / 1e9;
+}
+
+double LatencyHistogram::Percentile(double p) const
+{
+    uint64_t count = _count;
+    if(count == 0)
+        return 0.0;
+
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(count * std::min(100.0, std::max(0.0, p)) / 100.0)));
+    uint64_t seen = 0;
+    for(int i = 0; i < N_BUCKETS; i++)
+    {
+        seen += _buckets[i];
+        if(seen >= rank)
+        {
+            if(i == 0)
+                return std::min(1e-6, Max());
+
+            // Take the middle of the bucket (on a log scale), but never more
+            // than the largest sample actually seen.
+            double us = std::pow(2.0, (i - 0.5) / 4.0);
+            return std::min(us / 1e6, Max());
+        }
+    }
+    return Max();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pipeline Stats
+PipelineStats::Timer::Timer(PipelineStats* stats, PipelineStage stage)
+    : _stats{stats}, _stage{stage}
+{
+    if(_stats) _start = std::chrono::steady_clock::now();
+}
+
+PipelineStats::Timer::~Timer()
+{
+    if(_stats)
+        _stats->Record(_stage, std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count());
+}
+
+PipelineStats::PipelineStats()
+    : _frames_processed{0}, _frames_dropped{0}, _thread_budget{0},
+      _start{std::chrono::steady_clock::now()}, _cpu_start{ProcessCpuSeconds()}
+{
+}
+
+const char* PipelineStats::StageName(PipelineStage stage)
+{
+    static const char* names[N_STAGES] = {
+        "decode", "sync", "undistort", "background_subtraction",
+        "morphology", "contours", "concatenate", "encode",
+        "depth", "length", "objects", "classify", "dnn"
+    };
+    return stage < N_STAGES ? names[stage] : "unknown";
+}
+
+void PipelineStats::Record(PipelineStage stage, double seconds)
+{
+    if(stage < N_STAGES)
+        _stages[stage].Record(seconds);
+}
+
+void PipelineStats::CountFrame()
+{
+    _frames_processed++;
+}
+
+void PipelineStats::CountDroppedFrame()
+{
+    _frames_dropped++;
+}
+
+void PipelineStats::RecordQueueDepth(const std::string& queue, size_t depth)
+{
+    std::lock_guard<std::mutex> lock(_queue_mutex);
+    size_t& peak = _peak_queue_depths[queue];
+    peak = std::max(peak, depth);
+}
+
+const LatencyHistogram& PipelineStats::GetStage(PipelineStage stage) const
+{
+    return _stages[stage];
+}
+
+uint64_t PipelineStats::FramesProcessed() const
+{
+    return _frames_processed;
+}
+
+uint64_t PipelineStats::FramesDropped() const
+{
+    return _frames_dropped;
+}
+
+double PipelineStats::WallSeconds() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+double PipelineStats::CpuSeconds() const
+{
+    return ProcessCpuSeconds() - _cpu_start;
+}
+
+void PipelineStats::SetThreadBudget(int cores)
+{
+    _thread_budget = cores;
+}
+
+JSON PipelineStats::GetAsJSON() const
+{
+    double wall = WallSeconds();
+    double cores = wall > 0 ? CpuSeconds() / wall : 0.0;
+
+    JSON stages("stages");
+    for(int i = 0; i < N_STAGES; i++)
+    {
+        const LatencyHistogram& stage = _stages[i];
+        if(stage.Count() == 0) continue;
+
+        std::map<std::string, std::string> values;
+        values.insert(std::make_pair("count", std::to_string(stage.Count())));
+        values.insert(std::make_pair("total_ms", FormatMs(stage.Total())));
+        values.insert(std::make_pair("mean_ms", FormatMs(stage.Total() / stage.Count())));
+        values.insert(std::make_pair("p50_ms", FormatMs(stage.Percentile(50))));
+        values.insert(std::make_pair("p95_ms", FormatMs(stage.Percentile(95))));
+        values.insert(std::make_pair("p99_ms", FormatMs(stage.Percentile(99))));
+        values.insert(std::make_pair("max_ms", FormatMs(stage.Max())));
+        stages.AddObject(JSON(StageName(PipelineStage(i)), values));
+    }
+    stages.BuildJSONObject();
+
+    JSON queues("peak_queue_depths");
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        for(const auto& queue : _peak_queue_depths)
+            queues.AddKeyValue(queue.first, std::to_string(queue.second));
+    }
+    queues.BuildJSONObject();
+
+    JSON report("PerformanceReport");
+    report.AddKeyValue("frames_processed", std::to_string(FramesProcessed()));
+    report.AddKeyValue("frames_dropped", std::to_string(FramesDropped()));
+    report.AddKeyValue("wall_seconds", std::to_string(wall));
+    report.AddKeyValue("fps", std::to_string(wall > 0 ? FramesProcessed() / wall : 0.0));
+    report.AddKeyValue("cpu_seconds", std::to_string(CpuSeconds()));
+    report.AddKeyValue("effective_cores", std::to_string(cores));
+    if(_thread_budget > 0)
+    {
+        report.AddKeyValue("thread_budget", std::to_string(_thread_budget));
+        report.AddKeyValue("utilisation", std::to_string(cores / _thread_budget));
+    }
+    report.AddObject(stages);
+    report.AddObject(queues);
+    report.BuildJSONObject();
+    return report;
+}
+
+void PipelineStats::Print(std::ostream& out) const
+{
+    double wall = WallSeconds();
+    out << "  > Frames: " << FramesProcessed() << " processed, " << FramesDropped() << " dropped ("
+        << (wall > 0 ? FramesProcessed() / wall : 0.0) << " fps)\n";
+    out << "  > CPU: " << (wall > 0 ? CpuSeconds() / wall : 0.0) << " cores busy";
+    if(_thread_budget > 0)
+        out << " of " << _thread_budget << " budgeted";
+    out << '\n';
+
+    for(int i = 0; i < N_STAGES; i++)
+    {
+        const LatencyHistogram& stage = _stages[i];
+        if(stage.Count() == 0) continue;
+
+        out << "  > " << std::left << std::setw(24) << StageName(PipelineStage(i)) << std::right
+            << " p50 " << FormatMs(stage.Percentile(50)) << " ms"
+            << ", p95 " << FormatMs(stage.Percentile(95)) << " ms"
+            << ", p99 " << FormatMs(stage.Percentile(99)) << " ms"
+            << ", total " << FormatMs(stage.Total()) << " ms\n";
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+void AtomicMax(std::atomic<uint64_t>& target, uint64_t value)
+{
+    uint64_t current = target;
+    while(value > current && !target.compare_exchange_weak(current, value)) {}
+}
+
+std::string FormatMs(double seconds)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", seconds * 1000.0);
+    return buffer;
+}
+
+/// The user and system time of every thread in the process, in seconds.
+double ProcessCpuSeconds()
+{
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
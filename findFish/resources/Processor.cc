@@ -2,16 +2,75 @@
 #include "includes/JsonBuilder.h"
 #include "includes/EventDetector.h"
 #include "includes/Calibration.h"
+#include "includes/DepthEstimator.h"
+#include "includes/LengthEstimator.h"
+#include "includes/EventThumbnails.h"
+#include "includes/MultiTracker.h"
+#include "includes/DnnClassifier.h"
+#include "includes/EventIndex.h"
+#include "includes/DetectionLog.h"
+#include "includes/ForegroundCache.h"
+#include "includes/MotionSync.h"
+#include "includes/StreamPacer.h"
 #include "includes/Tracker.h"
+#include "includes/PipelineStats.h"
+#include "includes/ProgressReporter.h"
+#include "includes/ThreadPool.h"
+#include "includes/ThreadBudget.h"
+#include "includes/ResultCache.h"
 
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <iterator>
+#include <limits>
 #include <time.h>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <sstream>
 #include <stdexcept>
 
-cv::Mat ConcatenateMatrices(cv::Mat&, cv::Mat&);
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
 void ReadVectorOfVector(cv::FileStorage&, std::string, std::vector<std::vector<cv::Point2f>>&);
+std::string FormatNumber(double, int decimals = 1);
+std::vector<std::vector<cv::Point>> UndistortContours(const Calibration&, const std::vector<std::vector<cv::Point>>&, int);
+std::vector<std::pair<int, int>> MergeRanges(std::vector<std::pair<int, int>>);
+std::vector<cv::Rect> MosaicLayout(const std::vector<cv::Size>&, int);
+cv::Size MosaicSize(const std::vector<std::unique_ptr<Video>>&, int);
+int FramesLeft(const std::vector<std::unique_ptr<Video>>&);
+bool AnyEnded(const std::vector<std::unique_ptr<Video>>&);
+std::vector<std::string> ResultFiles(const std::string&);
+std::string DescribeSettings(const Processor::Settings&, const Tracker::Settings&);
+std::string BackgroundFile(const std::string&, size_t, bool);
+std::vector<std::string> ReadEvents(const std::string&);
+std::string ConcatEntry(const std::string&);
+bool RunProgram(const std::vector<std::string>&);
+
+/// How many frames go by between checks on how many jobs share the cores.
+static const int REBALANCE_INTERVAL = 300;
+
+/// The most cameras a foreground cache is replayed for, which is also as
+/// many as fit in the event index's camera mask.
+static const int MAX_REPLAY_CAMERAS = 32;
+
+/// The stereo calibration every job is undistorted and measured with.
+static const char* CALIBRATION_FILE = "stereo_calibration.yaml";
+
+/// Part of every result cache key. Bump it whenever what a job writes
+/// changes, so results cached before aren't handed out.
+static const int RESULT_CACHE_VERSION = 1;
+
+std::atomic<bool> Processor::_bStopRequested{false};
 
 Processor::Processor()
     : Success{false}
@@ -19,25 +78,39 @@ Processor::Processor()
     Calibration::Input input;
     input.image_size = cv::Size(1920, 1440);
 
-    _calib = std::make_shared<Calibration>(input, CalibrationType::STEREO, "stereo_calibration.yaml");
+    _calib = std::make_shared<Calibration>(input, CalibrationType::STEREO, CALIBRATION_FILE);
     _calib->ReadCalibration();
 }
 
 Processor::Processor(std::string left_file, std::string right_file)
+    : Processor(std::vector<std::string>{ left_file, right_file })
+{
+}
+
+Processor::Processor(std::vector<std::string> files)
     : Success{false}
 {
-    if(left_file != "" && right_file != "")
+    bool bHasFiles = files.size() >= 2 && std::none_of(files.begin(), files.end(), [](const std::string& file) { return file.empty(); });
+    if(bHasFiles)
     {
-        if(left_file != right_file)
-        {
-            _videos[0] = std::make_unique<Video>(left_file);
-            _videos[1] = std::make_unique<Video>(right_file);
-        }
+        std::vector<std::string> sorted = files;
+        std::sort(sorted.begin(), sorted.end());
+        if(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end())
+            for(const auto& file : files)
+                _videos.push_back(std::make_unique<Video>(file));
+
+        // Each camera gets its own tracker, so each background model only
+        // ever sees frames from one view.
+        _stats = std::make_shared<PipelineStats>();
 
         Tracker::Settings t_conf;
         t_conf.bDrawContours = false;
         t_conf.MinThreshold = 200;
-        _tracker = std::make_unique<Tracker>(t_conf);
+        for(size_t i = 0; i < files.size(); i++)
+        {
+            _trackers.push_back(std::make_unique<Tracker>(t_conf));
+            _trackers.back()->Stats = _stats;
+        }
 
         _detected_events = std::make_shared<JSON>("DetectedEvents");
     }
@@ -45,7 +118,7 @@ Processor::Processor(std::string left_file, std::string right_file)
     Calibration::Input input;
     input.image_size = cv::Size(1920, 1440);
 
-    _calib = std::make_shared<Calibration>(input, CalibrationType::STEREO, "stereo_calibration.yaml");
+    _calib = std::make_shared<Calibration>(input, CalibrationType::STEREO, CALIBRATION_FILE);
     _calib->ReadCalibration();
 }
 
@@ -53,64 +126,264 @@ Processor::~Processor()
 {
 }
 
+void Processor::SetName(std::string name)
+{
+    for(auto& video : _videos)
+        video->FileName = name;
+}
+
 void Processor::ProcessVideos()
 {
+    Error = "";
     try
     {
-        if(!_videos[0] || !_videos[1])
+        if(_videos.size() < 2)
             throw std::runtime_error("One or more videos is null");
 
         auto time_start = cv::getTickCount();
         std::string file_name = "";
-        if (_videos[0]->FileName == _videos[1]->FileName &&
-        (_videos[0]->FileName != "" || _videos[1]->FileName != ""))
+        bool bSameName = std::all_of(_videos.begin(), _videos.end(),
+            [this](const std::unique_ptr<Video>& video) { return video->FileName == _videos[0]->FileName; });
+        if (bSameName && _videos[0]->FileName != "")
         {
             // Create a save location for the new combined video.
             file_name = "./static/proc_videos/" + _videos[0]->FileName + ".mp4";
             std::cout << "=== Creating \"" << file_name << "\" ===" << std::endl;
 
-            // Setup QR Code detection events for the left and right _videos.
-            if (!SyncVideos())
-                throw std::runtime_error("Videos did not sync. Either they are "
-                                        "missing QR code(s), or none were detected.");
+            // Streams can't be gone back over, so they are never resumed or
+            // cached.
+            bool bLive = std::any_of(_videos.begin(), _videos.end(),
+                [](const std::unique_ptr<Video>& video) { return video->bLive; });
+
+            // A job that has been done before is answered by linking its
+            // results back into place.
+            ResultCache::Settings cache_settings;
+            cache_settings.MaxEntries = Config.Results.Entries;
+            ResultCache cache(cache_settings);
+            std::string result_key = (Config.Results.bEnabled && !bLive) ? ResultKey() : "";
+            if(!result_key.empty())
+            {
+                auto restored = cache.Restore(result_key, _videos[0]->FileName);
+                if(!restored.empty())
+                {
+                    std::remove(("static/video-info/CK_" + _videos[0]->FileName + ".yaml").c_str());
+                    std::remove(("static/video-info/CK_" + _videos[0]->FileName + ".mp4").c_str());
+                    std::cout << "=== Linked " << restored.size() << " results of an identical job, "
+                              << "skipping processing ===\n";
+                    if(OnEvent)
+                        for(const auto& event : ReadEvents("static/video-info/DE_" + _videos[0]->FileName + ".json"))
+                            OnEvent(event);
+                    Success = true;
+                    if(Progress) Progress->SetStage(PROGRESS_DONE);
+                    return;
+                }
+            }
+
+            // Results from an earlier run may be linked into the cache, and
+            // are about to be written over.
+            ResultCache::Detach(ResultFiles(_videos[0]->FileName));
+
+            // Points can only be undistorted on frames at the calibrated size,
+            // since otherwise every frame needs resizing anyway.
+            _bPointSpace = Config.Rig.bUndistortPoints;
+            for(size_t i = 0; i < _videos.size() && _bPointSpace; i++)
+                if(cv::Size(_videos[i]->Width, _videos[i]->Height) != _calib->GetImageSize())
+                {
+                    std::cout << "  > Video " << i << " isn't at the calibrated size, undistorting whole frames\n";
+                    _bPointSpace = false;
+                }
+
+            // Depth needs Q, which older calibrations didn't save.
+            if(Config.Events.bEstimateDepth && !_depth)
+                try
+                {
+                    DepthEstimator::Settings depth_settings;
+                    depth_settings.bRawFrames = _bPointSpace;
+                    _depth = std::make_shared<DepthEstimator>(*_calib, depth_settings);
+                }
+                catch(const std::exception& e)
+                {
+                    std::cerr << " !> " << e.what() << '\n';
+                }
+
+            // Lengths need F and the rectification.
+            if(Config.Events.bMeasureLength && !_length)
+                try
+                {
+                    _length = std::make_shared<LengthEstimator>(*_calib, LengthEstimator::Settings());
+                }
+                catch(const std::exception& e)
+                {
+                    std::cerr << " !> " << e.what() << '\n';
+                }
+
+            if(Config.Events.bThumbnails && !_thumbnails)
+                _thumbnails = std::make_shared<EventThumbnails>(EventThumbnails::Settings());
+            if(Config.Events.bTrackObjects && !_objects)
+                _objects = std::make_shared<MultiTracker>(MultiTracker::Settings());
+
+            if(Config.Dnn.bEnabled && !_dnn)
+                try
+                {
+                    DnnClassifier::Settings dnn_settings;
+                    dnn_settings.Model     = Config.Dnn.Model;
+                    dnn_settings.Labels    = Config.Dnn.Labels;
+                    dnn_settings.InputSize = cv::Size(Config.Dnn.InputSize, Config.Dnn.InputSize);
+                    dnn_settings.BatchSize = Config.Dnn.BatchSize;
+                    dnn_settings.Threads   = Config.Dnn.Threads;
+                    _dnn = std::make_shared<DnnClassifier>(dnn_settings);
+                    _dnn->Stats = _stats;
+                }
+                catch(const std::exception& e)
+                {
+                    std::cerr << " !> " << e.what() << '\n';
+                }
+
+            if(Config.Record.bDetectionLog && !_detections)
+                try
+                {
+                    _detections = std::make_shared<DetectionLog>("static/video-info/DL_" + _videos[0]->FileName + ".dlog",
+                                                                 DetectionLog::Settings());
+                }
+                catch(const std::exception& e)
+                {
+                    std::cerr << " !> " << e.what() << '\n';
+                }
+
+            if(Config.Record.bForegroundCache && !_foreground)
+                try
+                {
+                    ForegroundCache::Settings cache_settings;
+                    cache_settings.Scale = Config.Record.ForegroundScale;
+                    cache_settings.bRawFrames = _bPointSpace;
+                    _foreground = std::make_shared<ForegroundCache>("static/video-info/FG_" + _videos[0]->FileName + ".fgc",
+                                                                    cache_settings);
+                }
+                catch(const std::exception& e)
+                {
+                    std::cerr << " !> " << e.what() << '\n';
+                }
 
-            // Create a writer for the new combined video.
-            cv::VideoWriter writer(
-                file_name,
-                _videos[0]->FOURCC,
-                _videos[0]->FPS,
-                cv::Size(_videos[0]->Width + _videos[1]->Width,
-                        std::max(_videos[0]->Height, _videos[1]->Height)),
-                true);
+            // Pick up where a stopped run left off, if there is a checkpoint.
+            Checkpoint checkpoint;
+            bool bResuming = !bLive && ReadCheckpoint(checkpoint);
+
+            // A fresh run logs and caches every frame again.
+            if(_detections && !bResuming)
+                _detections->Truncate(0);
+            if(_foreground && !bResuming)
+                _foreground->Truncate(0);
+            std::string partial_file = "static/video-info/CK_" + _videos[0]->FileName + ".mp4";
+            if(bResuming)
+                std::rename(file_name.c_str(), partial_file.c_str());
+            else
+            {
+                // Setup QR Code detection events for every camera's video.
+                if(Progress) Progress->SetStage(PROGRESS_SYNCING);
+                bool bSynced;
+                {
+                    PipelineStats::Timer timer(_stats.get(), STAGE_SYNC);
+                    bSynced = SyncVideos();
+                }
+                if(Stopping())
+                {
+                    std::cout << "=== Stopped before the videos synced ===\n";
+                    if(Progress) Progress->SetStage(PROGRESS_STOPPED);
+                    return;
+                }
+                if (!bSynced)
+                    throw std::runtime_error("Videos did not sync. Either they are "
+                                            "missing QR code(s), or none were detected.");
+            }
 
             int frame_num = 0;
-            while (!_videos[0]->Ended() && !_videos[1]->Ended())
+            int cores = Budget ? Budget->GetCores() : (int)std::thread::hardware_concurrency();
+            int n_chunks = (Config.Job.Chunks > 0) ? Config.Job.Chunks : cores;
+            _stats->SetThreadBudget(Budget ? cores : 0);
+
+            // Chunks seed their own trackers.
+            if(bLive || bResuming || n_chunks <= 1)
+                SeedBackgrounds(_trackers);
+            if(bLive)
+            {
+                // A stopped stream is a finished recording, so its events
+                // get written like any other.
+                if(Progress) Progress->SetStage(PROGRESS_PROCESSING);
+                frame_num = ProcessStream(file_name);
+            }
+            else if(!bResuming && n_chunks > 1)
+            {
+                // Split the pair up, and process the pieces side by side.
+                if(Progress) Progress->SetStage(PROGRESS_PROCESSING);
+                frame_num = ProcessChunks(file_name, n_chunks);
+                if(Stopping())
+                {
+                    std::cout << "=== Stopped, chunked runs start over ===\n";
+                    if(Progress) Progress->SetStage(PROGRESS_STOPPED);
+                    return;
+                }
+            }
+            else
             {
-                std::shared_ptr<cv::Mat> frames[2];
-                for(int i = 0; i < 2; i++)
-                    _videos[i]->Read();
-                
-                if(_videos[0]->Get() && _videos[1]->Get())
+                // Create a writer for the new combined video.
+                cv::VideoWriter writer(
+                    file_name,
+                    _videos[0]->FOURCC,
+                    _videos[0]->FPS,
+                    MosaicSize(_videos, Config.Rig.MosaicColumns),
+                    true);
+
+                if(bResuming)
                 {
-                    for(int i = 0; i < 2; i++)
+                    Resume(writer, checkpoint, partial_file);
+                    frame_num = checkpoint.Frame;
+                }
+
+                // Processing stops at the end of whichever video runs out first.
+                int total_frames = frame_num + FramesLeft(_videos);
+                if(Progress) Progress->SetStage(PROGRESS_PROCESSING);
+
+                while (!AnyEnded(_videos) && !Stopping())
+                {
+                    auto frames = ReadFrames(_videos);
+                    if(!frames.empty())
                     {
-                        // Undistort the frames using camera calibration data.
-                        frames[i] = _videos[i]->Get();
-                        UndistortImage(*frames[i], 0);
+                        // Write the mosaic of undistorted frames.
+                        cv::Mat res = ProcessFrame(frames, _trackers, _objects.get(), frame_num);
+                        {
+                            PipelineStats::Timer timer(_stats.get(), STAGE_ENCODE);
+                            writer << res;
+                        }
+                        _stats->CountFrame();
+                        frame_num++;
+                        if(Progress) Progress->Update(frame_num, total_frames);
+                        if(Budget && frame_num % REBALANCE_INTERVAL == 0 && Budget->Rebalance())
+                            _stats->SetThreadBudget(Budget->GetCores());
 
-                        // Run the tracker on the undistorted frames.
-                        _tracker->CreateMask(*frames[i]);
-                        _tracker->CheckForActivity(frame_num);
+                        if(Config.Job.CheckpointInterval > 0 && frame_num % Config.Job.CheckpointInterval == 0)
+                            WriteCheckpoint(frame_num);
                     }
+                    else _stats->CountDroppedFrame();
+                }
+
+                cv::destroyAllWindows();
 
-                    // Write the concatenated undistorted frames.
-                    cv::Mat res = ConcatenateMatrices(*frames[0], *frames[1]);
-                    writer << res;
-                    frame_num++;
+                // Finish the output cleanly and save everything found so far, so
+                // the next run carries on from here.
+                if(Stopping())
+                {
+                    writer.release();
+                    WriteCheckpoint(frame_num);
+                    std::cout << "=== Stopped at frame " << frame_num << ", checkpoint saved ===\n";
+                    if(Progress) Progress->SetStage(PROGRESS_STOPPED);
+                    return;
                 }
             }
 
-            cv::destroyAllWindows();
+            if(Progress) Progress->SetStage(PROGRESS_FINALIZING);
+
+            // Chunked runs save theirs from the last chunk.
+            SaveBackgrounds(_trackers);
             
             std::cout << "=== Finished Concatenating ===\n";
             std::cout << "=== Time taken: " << (double)(cv::getTickCount() - time_start)/cv::getTickFrequency() << " seconds ===\n";
@@ -126,13 +399,34 @@ void Processor::ProcessVideos()
             configFile << _detected_events->GetJSON();
             configFile.close();
 
+            // Write where the time went next to the events.
+            _stats->Print(std::cout);
+            std::ofstream perfFile("static/video-info/PERF_" + _videos[0]->FileName + ".json");
+            perfFile << _stats->GetAsJSON().GetJSON();
+            perfFile.close();
+
+            std::remove(("static/video-info/CK_" + _videos[0]->FileName + ".yaml").c_str());
+
+            if(!result_key.empty())
+            {
+                if(_detections)
+                    _detections->Flush();
+                if(_foreground)
+                    _foreground->Flush();
+                if(!cache.Store(result_key, _videos[0]->FileName, ResultFiles(_videos[0]->FileName)))
+                    std::cerr << " !> Could not cache the results of \"" << file_name << "\"\n";
+            }
+
             std::cout << "=== Finished Processing for \"" << file_name << "\" ===\n";
             Success = true;
+            if(Progress) Progress->SetStage(PROGRESS_DONE);
         }
     }
     catch(const std::exception& e)
     {
         std::cerr << " !> " << e.what() << '\n';
+        Error = e.what();
+        if(Progress) Progress->SetStage(PROGRESS_FAILED);
     }
 }
 
@@ -161,48 +455,1031 @@ void Processor::TriangulatePoints(std::string points_file, std::string calib_fil
     }
 }
 
+cv::Mat Processor::ProcessFrame(std::vector<std::shared_ptr<cv::Mat>>& frames, std::vector<std::unique_ptr<Tracker>>& trackers,
+                                MultiTracker* objects, int frame_num) const
+{
+    // Every camera has its own tracker, so they can all be analysed at once.
+    cv::parallel_for_(cv::Range(0, (int)frames.size()), [&](const cv::Range& range)
+    {
+        for(int i = range.start; i < range.end; i++)
+        {
+            // Undistort the frames using camera calibration data, unless only
+            // the points measured get undistorted.
+            if(!_bPointSpace)
+            {
+                PipelineStats::Timer timer(_stats.get(), STAGE_UNDISTORT);
+                UndistortImage(*frames[i], i);
+            }
+
+            // Run the tracker on the frames.
+            // CheckForActivity takes the frame by reference, so each camera
+            // gets its own copy.
+            int frame = frame_num;
+            trackers[i]->CreateMask(*frames[i]);
+            trackers[i]->CheckForActivity(frame);
+            if(_foreground)
+                _foreground->Add(frame_num, i, trackers[i]->GetForeground());
+            // The log is always in the undistorted frame, like the objects
+            // and lengths.
+            if(_detections)
+            {
+                if(_bPointSpace)
+                    _detections->Add(frame_num, i, UndistortContours(*_calib, trackers[i]->GetContours(), i));
+                else
+                    _detections->Add(frame_num, i, trackers[i]->GetContours());
+            }
+        }
+    });
+
+    // Measure what the left camera found. Objects are only found while there
+    // is activity, so this only runs during events.
+    auto boxes = trackers[0]->GetBoundingBoxes();
+
+    // Objects are kept in the undistorted frame, like everything else that
+    // gets written out, even while the trackers still see the raw one.
+    auto object_boxes = boxes;
+    if(_bPointSpace)
+        _calib->UndistortBoxes(object_boxes, 0);
+    if(objects)
+    {
+        std::vector<int> ids;
+        {
+            PipelineStats::Timer timer(_stats.get(), STAGE_OBJECTS);
+            ids = objects->Update(frame_num, object_boxes);
+        }
+
+        // Name what was found. Labels are cached per object, so this mostly
+        // runs when new objects show up.
+        if(trackers[0]->HasCascades() && !boxes.empty())
+        {
+            auto labels = trackers[0]->Classify(*frames[0], boxes, ids, frame_num);
+            for(size_t i = 0; i < boxes.size(); i++)
+                if(ids[i] != 0 && !labels[i].empty())
+                    objects->SetLabel(ids[i], labels[i]);
+        }
+    }
+
+    if(_depth && !boxes.empty())
+    {
+        PipelineStats::Timer timer(_stats.get(), STAGE_DEPTH);
+        auto objects = _depth->Estimate(*frames[0], *frames[1], boxes, trackers[0]->GetMask());
+
+        // Keep the object that was measured best.
+        auto best = std::max_element(objects.begin(), objects.end(),
+            [](const ObjectDepth& a, const ObjectDepth& b) { return a.ValidPixels < b.ValidPixels; });
+        if(best != objects.end())
+        {
+            std::lock_guard<std::mutex> lock(_depth_mutex);
+            _depth_samples[frame_num] = { best->Range, best->Width, best->Height };
+        }
+    }
+
+    // Pair up the objects both cameras found, to measure their lengths.
+    if(_length && !trackers[0]->GetContours().empty() && !trackers[1]->GetContours().empty())
+    {
+        PipelineStats::Timer timer(_stats.get(), STAGE_LENGTH);
+        if(_bPointSpace)
+            _length->Add(frame_num, _length->Match(UndistortContours(*_calib, trackers[0]->GetContours(), 0),
+                                                   UndistortContours(*_calib, trackers[1]->GetContours(), 1)));
+        else
+            _length->Add(frame_num, _length->Match(trackers[0]->GetContours(), trackers[1]->GetContours()));
+    }
+
+    // Everything has been measured, so the frames are only needed for the
+    // output video now.
+    if(_bPointSpace)
+        cv::parallel_for_(cv::Range(0, (int)frames.size()), [&](const cv::Range& range)
+        {
+            for(int i = range.start; i < range.end; i++)
+            {
+                PipelineStats::Timer timer(_stats.get(), STAGE_UNDISTORT);
+                UndistortImage(*frames[i], i);
+            }
+        });
+
+    // Only classify while an event is open, so the cost follows activity
+    // rather than the length of the video. The crops are taken once the
+    // frames are undistorted, so they are keyed by the same boxes as the
+    // objects.
+    if(_dnn && trackers[0]->IsActive() && !object_boxes.empty())
+        _dnn->Add(frame_num, *frames[0], object_boxes);
+
+    cv::Mat res;
+    {
+        PipelineStats::Timer timer(_stats.get(), STAGE_CONCATENATE);
+        res = Mosaic(frames);
+    }
+
+    // Keep a thumbnail while there is activity, scored by how much of the
+    // frame the objects cover.
+    if(_thumbnails)
+    {
+        double activity = 0.0;
+        for(const auto& tracker : trackers)
+            for(const auto& contour : tracker->GetContours())
+                activity += cv::contourArea(contour);
+        _thumbnails->Observe(frame_num, res, activity);
+    }
+    return res;
+}
+
+int Processor::ProcessChunks(std::string file_name, int n_chunks)
+{
+    // Chunks are measured from the synced start of each video.
+    std::vector<int> start;
+    for(const auto& video : _videos)
+        start.push_back(video->Frame);
+    int total_frames = std::max(0, FramesLeft(_videos));
+    int chunk_size = std::max(1, (total_frames + n_chunks - 1) / n_chunks);
+
+    std::vector<Chunk> chunks;
+    for(int first = 0; first < total_frames || chunks.empty(); first += chunk_size)
+    {
+        Chunk chunk;
+        chunk.First   = first;
+        chunk.Last    = std::min(first + chunk_size, total_frames);
+        chunk.Segment = "static/video-info/SEG_" + _videos[0]->FileName + "_" + std::to_string(chunks.size()) + ".mp4";
+        for(const auto& tracker : _trackers)
+        {
+            chunk.Trackers.push_back(std::make_unique<Tracker>(tracker->Config));
+            chunk.Trackers.back()->Stats = _stats;
+        }
+        if(_objects)
+            chunk.Objects = std::make_unique<MultiTracker>(_objects->Config);
+
+        // Later chunks warm up on the frames before them instead.
+        if(chunks.empty())
+            SeedBackgrounds(chunk.Trackers);
+        chunks.push_back(std::move(chunk));
+    }
+    std::cout << "  > Processing " << chunks.size() << " chunks of up to " << chunk_size << " frames\n";
+
+    std::atomic<int> done{0};
+    {
+        ThreadPool pool(std::min<size_t>(n_chunks, chunks.size()));
+        std::vector<std::future<void>> results;
+        for(auto& chunk : chunks)
+            results.push_back(pool.Enqueue(&Processor::ProcessChunk, this, std::ref(chunk), std::cref(start), std::ref(done)));
+        _stats->RecordQueueDepth("chunks", pool.Pending());
+
+        for(auto& result : results)
+        {
+            while(result.wait_for(std::chrono::milliseconds(250)) != std::future_status::ready)
+            {
+                if(Progress) Progress->Update(done, total_frames);
+                _stats->RecordQueueDepth("chunks", pool.Pending());
+            }
+            result.get();
+        }
+    }
+
+    std::vector<std::string> segments;
+    int frame_num = 0;
+    for(auto& chunk : chunks)
+    {
+        segments.push_back(chunk.Segment);
+        frame_num += chunk.Frames;
+
+        // Hand the events over to the main trackers. Events that ran over a
+        // boundary touch the next chunk's, so they get merged back together.
+        for(size_t i = 0; i < _trackers.size(); i++)
+        {
+            auto& events = chunk.Trackers[i]->ActivityRange;
+            _trackers[i]->ActivityRange.insert(_trackers[i]->ActivityRange.end(), events.begin(), events.end());
+            events.clear();
+        }
+
+        // Likewise for the objects, which get renumbered as they are added.
+        if(_objects && chunk.Objects)
+            _objects->Append(*chunk.Objects, chunk.First);
+    }
+
+    if(!Stopping())
+    {
+        SaveBackgrounds(chunks.back().Trackers);
+        cv::Size size = MosaicSize(_videos, Config.Rig.MosaicColumns);
+        ConcatenateSegments(segments, file_name, _videos[0]->FOURCC, _videos[0]->FPS, size.width, size.height);
+    }
+
+    for(auto& segment : segments)
+        std::remove(segment.c_str());
+    return frame_num;
+}
+
+void Processor::ProcessChunk(Chunk& chunk, const std::vector<int>& start, std::atomic<int>& done) const
+{
+    // Every chunk reads the videos on its own, starting far enough back to
+    // warm up its trackers.
+    int frame_num = std::max(0, chunk.First - Config.Job.WarmupFrames);
+    std::vector<std::unique_ptr<Video>> videos;
+    for(size_t i = 0; i < _videos.size(); i++)
+    {
+        videos.push_back(std::make_unique<Video>(_videos[i]->GetPath()));
+        videos.back()->Seek(start[i] + frame_num);
+    }
+
+    cv::VideoWriter writer(
+        chunk.Segment,
+        _videos[0]->FOURCC,
+        _videos[0]->FPS,
+        MosaicSize(_videos, Config.Rig.MosaicColumns),
+        true);
+
+    while(frame_num < chunk.Last && !AnyEnded(videos) && !Stopping())
+    {
+        auto frames = ReadFrames(videos);
+        if(frames.empty())
+        {
+            _stats->CountDroppedFrame();
+            continue;
+        }
+
+        if(frame_num < chunk.First)
+        {
+            // The background has to be learned on the same frames the
+            // trackers will see.
+            for(size_t i = 0; i < frames.size(); i++)
+            {
+                if(!_bPointSpace)
+                    UndistortImage(*frames[i], i);
+                chunk.Trackers[i]->LearnBackground(*frames[i]);
+            }
+        }
+        else
+        {
+            cv::Mat res = ProcessFrame(frames, chunk.Trackers, chunk.Objects.get(), frame_num);
+            {
+                PipelineStats::Timer timer(_stats.get(), STAGE_ENCODE);
+                writer << res;
+            }
+            _stats->CountFrame();
+            chunk.Frames++;
+            done++;
+        }
+        frame_num++;
+    }
+
+    // End anything still going at the boundary, so it can be merged with
+    // whatever the next chunk found at its first frame.
+    for(const auto& tracker : chunk.Trackers)
+        for(auto event : tracker->ActivityRange)
+            if(event->IsActive())
+                event->EndEvent(frame_num);
+}
+
+int Processor::ProcessStream(std::string file_name)
+{
+    StreamPacer::Settings pacer_settings;
+    pacer_settings.BudgetMs   = Config.Stream.BudgetMs;
+    pacer_settings.DropPolicy = StreamPacer::ParsePolicy(Config.Stream.Policy);
+    pacer_settings.MaxStride  = Config.Stream.MaxStride;
+    StreamPacer pacer(_videos[0]->FPS, pacer_settings);
+    std::cout << "=== Streaming with a " << pacer.Config.BudgetMs << " ms budget, "
+              << StreamPacer::PolicyName(pacer.Config.DropPolicy) << " when behind ===\n";
+
+    cv::VideoWriter writer(
+        file_name,
+        _videos[0]->FOURCC,
+        _videos[0]->FPS,
+        MosaicSize(_videos, Config.Rig.MosaicColumns),
+        true);
+
+    std::ofstream live("static/video-info/LIVE_" + _videos[0]->FileName + ".jsonl");
+    std::vector<size_t> emitted(_trackers.size(), 0);
+
+    int frame_num = 0;
+    int64_t first_tick = 0;
+    cv::Mat res;
+    while(!AnyEnded(_videos) && !Stopping())
+    {
+        auto frames = ReadFrames(_videos);
+        if(frames.empty())
+        {
+            _stats->CountDroppedFrame();
+            continue;
+        }
+
+        // The stream's frames turn up at its frame rate from the first one on,
+        // so that's where lag is measured from.
+        if(frame_num == 0)
+            first_tick = cv::getTickCount();
+        double elapsed = (double)(cv::getTickCount() - first_tick) / cv::getTickFrequency();
+
+        // Frames left out repeat the last analysed one, so the output keeps
+        // time without undistorting anything.
+        if(pacer.ShouldAnalyse(frame_num, elapsed))
+        {
+            res = ProcessFrame(frames, _trackers, _objects.get(), frame_num);
+            _stats->CountFrame();
+        }
+        else _stats->CountDroppedFrame();
+
+        if(!res.empty())
+        {
+            PipelineStats::Timer timer(_stats.get(), STAGE_ENCODE);
+            writer << res;
+        }
+        frame_num++;
+        if(Progress) Progress->Update(frame_num, frame_num);
+        if(Budget && frame_num % REBALANCE_INTERVAL == 0 && Budget->Rebalance())
+            _stats->SetThreadBudget(Budget->GetCores());
+
+        // Publish each camera's events as they end, while the rig is still
+        // recording.
+        for(size_t i = 0; i < _trackers.size(); i++)
+        {
+            const auto& events = _trackers[i]->ActivityRange;
+            for(; emitted[i] < events.size() && !events[emitted[i]]->IsActive(); emitted[i]++)
+            {
+                auto range = events[emitted[i]]->GetRange();
+                JSON event("event", {
+                    { "camera", std::to_string(i) },
+                    { "start",  std::to_string(range.first) },
+                    { "end",    std::to_string(range.second) }
+                });
+                event.BuildJSONObject();
+                live << event.GetJSON() << std::endl;
+            }
+        }
+    }
+
+    // Record what was left out, as ranges of frames.
+    std::vector<std::string> columns[2];
+    for(const auto& range : pacer.GetDropped())
+    {
+        columns[0].push_back(std::to_string(range.first));
+        columns[1].push_back(std::to_string(range.second));
+    }
+    JSON dropped("dropped");
+    dropped.AddKeyValue("policy", StreamPacer::PolicyName(pacer.Config.DropPolicy));
+    dropped.AddKeyValue("budget_ms", FormatNumber(pacer.Config.BudgetMs));
+    dropped.AddKeyValue("max_lag_ms", FormatNumber(pacer.MaxLag() * 1000.0));
+    dropped.AddKeyValue("frames", std::to_string(frame_num));
+    dropped.AddKeyValue("dropped", std::to_string(pacer.DroppedCount()));
+    dropped.AddKeyArray("first", columns[0]);
+    dropped.AddKeyArray("last", columns[1]);
+    dropped.BuildJSONObject();
+
+    std::ofstream drop_file("static/video-info/DROP_" + _videos[0]->FileName + ".json");
+    drop_file << dropped.GetJSON();
+    std::cout << "  > Analysed " << frame_num - pacer.DroppedCount() << " of " << frame_num
+              << " frames, at most " << FormatNumber(pacer.MaxLag() * 1000.0) << " ms behind\n";
+    return frame_num;
+}
+
+Processor::Settings Processor::ReadSettings(std::string file)
+{
+    Settings settings;
+    cv::FileStorage fs(file, cv::FileStorage::READ);
+    if(fs.isOpened())
+    {
+        if(!fs["checkpoint_interval"].empty())  settings.Job.CheckpointInterval  = (int)fs["checkpoint_interval"];
+        if(!fs["warmup_frames"].empty())        settings.Job.WarmupFrames        = (int)fs["warmup_frames"];
+        if(!fs["chunks"].empty())               settings.Job.Chunks              = (int)fs["chunks"];
+        if(!fs["max_jobs"].empty())             settings.Job.MaxJobs             = std::max(0, (int)fs["max_jobs"]);
+        if(!fs["pin_threads"].empty())          settings.Job.bPinThreads         = (int)fs["pin_threads"] != 0;
+
+        if(!fs["sync_frames"].empty())          settings.Sync.Frames             = std::max(0, (int)fs["sync_frames"]);
+        if(!fs["motion_sync"].empty())          settings.Sync.bMotion            = (int)fs["motion_sync"] != 0;
+        if(!fs["motion_max_lag"].empty())       settings.Sync.MotionMaxLag       = (int)fs["motion_max_lag"];
+        if(!fs["motion_confidence"].empty())    settings.Sync.MotionConfidence   = (double)fs["motion_confidence"];
+
+        if(!fs["cameras"].empty())              settings.Rig.Cameras             = std::max(2, (int)fs["cameras"]);
+        if(!fs["mosaic_columns"].empty())       settings.Rig.MosaicColumns       = std::max(0, (int)fs["mosaic_columns"]);
+        if(!fs["undistort_points"].empty())     settings.Rig.bUndistortPoints    = (int)fs["undistort_points"] != 0;
+
+        if(!fs["depth"].empty())                settings.Events.bEstimateDepth   = (int)fs["depth"] != 0;
+        if(!fs["length"].empty())               settings.Events.bMeasureLength   = (int)fs["length"] != 0;
+        if(!fs["thumbnails"].empty())           settings.Events.bThumbnails      = (int)fs["thumbnails"] != 0;
+        if(!fs["objects"].empty())              settings.Events.bTrackObjects    = (int)fs["objects"] != 0;
+
+        if(!fs["dnn"].empty())                  settings.Dnn.bEnabled            = (int)fs["dnn"] != 0;
+        if(!fs["dnn_model"].empty())            settings.Dnn.Model               = (std::string)fs["dnn_model"];
+        if(!fs["dnn_labels"].empty())           settings.Dnn.Labels              = (std::string)fs["dnn_labels"];
+        if(!fs["dnn_batch_size"].empty())       settings.Dnn.BatchSize           = (int)fs["dnn_batch_size"];
+        if(!fs["dnn_input_size"].empty())       settings.Dnn.InputSize           = (int)fs["dnn_input_size"];
+        if(!fs["dnn_threads"].empty())          settings.Dnn.Threads             = (int)fs["dnn_threads"];
+
+        if(!fs["detection_log"].empty())        settings.Record.bDetectionLog    = (int)fs["detection_log"] != 0;
+        if(!fs["foreground_cache"].empty())     settings.Record.bForegroundCache = (int)fs["foreground_cache"] != 0;
+        if(!fs["foreground_scale"].empty())     settings.Record.ForegroundScale  = (double)fs["foreground_scale"];
+
+        if(!fs["stream_budget_ms"].empty())     settings.Stream.BudgetMs         = (double)fs["stream_budget_ms"];
+        if(!fs["stream_policy"].empty())        settings.Stream.Policy           = (std::string)fs["stream_policy"];
+        if(!fs["stream_max_stride"].empty())    settings.Stream.MaxStride        = (int)fs["stream_max_stride"];
+
+        if(!fs["result_cache"].empty())         settings.Results.bEnabled        = (int)fs["result_cache"] != 0;
+        if(!fs["result_cache_entries"].empty()) settings.Results.Entries         = std::max(0, (int)fs["result_cache_entries"]);
+
+        if(!fs["site"].empty())                 settings.Background.Site         = (std::string)fs["site"];
+        if(!fs["background_scale"].empty())     settings.Background.Scale        = (double)fs["background_scale"];
+    }
+    return settings;
+}
+
+std::vector<std::pair<int, int>> Processor::Replay(std::string cache_file, int min_threshold)
+{
+    ForegroundCacheReader cache(cache_file);
+
+    // Masks of the raw frames are undistorted first, so the replay sees the
+    // same frame a job that undistorted whole frames would have.
+    std::unique_ptr<Calibration> calib;
+    if(cache.IsRaw())
+    {
+        Calibration::Input input;
+        calib = std::make_unique<Calibration>(input, CalibrationType::STEREO, CALIBRATION_FILE);
+        calib->ReadCalibration();
+
+        cv::Mat D[2];
+        if(!calib->GetDistortion(D) || calib->GetImageSize() == cv::Size())
+            throw std::runtime_error("\"" + cache_file + "\" is of raw frames, and needs the calibration to undistort them!");
+    }
+
+    // The same trackers ProcessVideos uses, apart from the threshold.
+    Tracker::Settings t_conf;
+    t_conf.bDrawContours = false;
+    t_conf.MinThreshold = min_threshold;
+    std::vector<std::unique_ptr<Tracker>> trackers;
+
+    auto time_start = cv::getTickCount();
+    int frame = 0, camera = 0, last_frame = 0;
+    cv::Mat foreground;
+    while(cache.Next(frame, camera, foreground) && !StopRequested())
+    {
+        // Trackers are made as cameras turn up, so any rig can be replayed.
+        if(camera < 0 || camera >= MAX_REPLAY_CAMERAS)
+            continue;
+        while((int)trackers.size() <= camera)
+            trackers.push_back(std::make_unique<Tracker>(t_conf));
+        if(calib)
+        {
+            // UndistortImage works at the calibrated size, so come back down
+            // to the cache's scale afterwards.
+            cv::Size size = foreground.size();
+            calib->UndistortImage(foreground, camera);
+            cv::resize(foreground, foreground, size, 0, 0, cv::INTER_AREA);
+        }
+        trackers[camera]->ReplayMask(foreground, cache.GetScale());
+        trackers[camera]->CheckForActivity(frame);
+        last_frame = std::max(last_frame, frame + 1);
+    }
+    double seconds = (double)(cv::getTickCount() - time_start) / cv::getTickFrequency();
+
+    std::vector<std::pair<int, int>> ranges;
+    for(auto& tracker : trackers)
+        for(auto event : tracker->ActivityRange)
+        {
+            if(event->IsActive())
+                event->EndEvent(last_frame);
+            ranges.push_back(event->GetRange());
+        }
+    std::vector<std::pair<int, int>> merged = MergeRanges(ranges);
+
+    std::cout << "=== Replayed " << cache.Size() << " foregrounds at threshold " << min_threshold
+              << " in " << seconds << " seconds (" << (seconds > 0 ? cache.Size() / seconds : 0) << " per second) ===\n";
+    std::cout << "  > " << merged.size() << " events\n";
+    for(const auto& range : merged)
+        std::cout << "  > " << range.first << " - " << range.second << '\n';
+    return merged;
+}
+
+void Processor::RequestStop()
+{
+    _bStopRequested = true;
+}
+
+bool Processor::StopRequested()
+{
+    return _bStopRequested;
+}
+
+void Processor::Cancel()
+{
+    _bCancelled = true;
+}
+
+bool Processor::Stopping() const
+{
+    return _bCancelled || (bObeyStopRequests && _bStopRequested);
+}
+
+void Processor::WriteCheckpoint(int frame_num) const
+{
+    // Write next to the old checkpoint first, so a crash part way through
+    // writing still leaves the old one intact.
+    std::string file = "static/video-info/CK_" + _videos[0]->FileName + ".yaml";
+    {
+        cv::FileStorage fs(file + ".tmp", cv::FileStorage::WRITE | cv::FileStorage::FORMAT_YAML);
+        if(!fs.isOpened())
+        {
+            std::cerr << " !> Could not write checkpoint \"" << file << "\"\n";
+            return;
+        }
+
+        fs << "frame" << frame_num;
+        std::vector<int> positions;
+        for(const auto& video : _videos)
+            positions.push_back(video->Frame);
+        fs << "positions" << positions;
+        for(size_t i = 0; i < _trackers.size(); i++)
+            _trackers[i]->Save(fs, "tracker_" + std::to_string(i));
+        if(_length)
+            _length->Save(fs, "lengths");
+        if(_objects)
+            _objects->Save(fs, "objects");
+        if(_thumbnails)
+            _thumbnails->Save(fs, "thumbnails");
+        if(_dnn)
+        {
+            _dnn->Flush();
+            _dnn->Save(fs, "dnn");
+        }
+        if(_detections)
+        {
+            _detections->Flush();
+            fs << "detection_log" << double(_detections->Size());
+        }
+        if(_foreground)
+        {
+            _foreground->Flush();
+            fs << "foreground_cache" << double(_foreground->Size());
+        }
+
+        std::lock_guard<std::mutex> lock(_depth_mutex);
+        fs << "depth" << "[";
+        for(const auto& sample : _depth_samples)
+            fs << std::vector<double>{ double(sample.first), sample.second.Range, sample.second.Width, sample.second.Height };
+        fs << "]";
+    }
+    std::rename((file + ".tmp").c_str(), file.c_str());
+}
+
+bool Processor::ReadCheckpoint(Checkpoint& checkpoint)
+{
+    cv::FileStorage fs("static/video-info/CK_" + _videos[0]->FileName + ".yaml", cv::FileStorage::READ);
+    if(!fs.isOpened() || fs["frame"].empty())
+        return false;
+
+    // A checkpoint from a rig with a different number of cameras can't be
+    // resumed from.
+    checkpoint.Frame = (int)fs["frame"];
+    fs["positions"] >> checkpoint.Positions;
+    if(checkpoint.Positions.size() != _trackers.size())
+        return false;
+
+    for(size_t i = 0; i < _trackers.size(); i++)
+        _trackers[i]->Load(fs["tracker_" + std::to_string(i)]);
+
+    for(auto node : fs["depth"])
+    {
+        std::vector<double> sample;
+        node >> sample;
+        if(sample.size() == 4)
+            _depth_samples[int(sample[0])] = { sample[1], sample[2], sample[3] };
+    }
+    if(_length)
+        _length->Load(fs["lengths"]);
+    if(_objects)
+        _objects->Load(fs["objects"]);
+    if(_thumbnails)
+        _thumbnails->Load(fs["thumbnails"]);
+    if(_dnn)
+        _dnn->Load(fs["dnn"]);
+
+    // Forget whatever was logged after the checkpoint, as it gets logged again.
+    if(_detections && !fs["detection_log"].empty())
+        _detections->Truncate(uint64_t((double)fs["detection_log"]));
+    if(_foreground && !fs["foreground_cache"].empty())
+        _foreground->Truncate(uint64_t((double)fs["foreground_cache"]));
+    return true;
+}
+
+void Processor::Resume(cv::VideoWriter& writer, const Checkpoint& checkpoint, std::string partial_file)
+{
+    std::cout << "=== Resuming from frame " << checkpoint.Frame << " ===\n";
+
+    // Copy over what the stopped run wrote. If it didn't stop cleanly, its
+    // output may be short or unreadable.
+    int copied = 0;
+    {
+        cv::VideoCapture partial(partial_file);
+        cv::Mat frame;
+        while(copied < checkpoint.Frame && partial.isOpened() && partial.read(frame))
+        {
+            writer << frame;
+            copied++;
+        }
+    }
+    std::remove(partial_file.c_str());
+    std::cout << "  > Copied " << copied << " frames from the stopped run\n";
+
+    // Replay from whichever comes first: the frames that were lost, or the
+    // frames needed to warm up the background models.
+    int warmup_start = checkpoint.Frame - Config.Job.WarmupFrames;
+    int frame_num = std::max(0, std::min(copied, warmup_start));
+    for(size_t i = 0; i < _videos.size(); i++)
+        _videos[i]->Seek(checkpoint.Positions[i] - (checkpoint.Frame - frame_num));
+
+    while(frame_num < checkpoint.Frame && !AnyEnded(_videos))
+    {
+        auto frames = ReadFrames(_videos);
+        if(frames.empty())
+            continue;
+
+        for(size_t i = 0; i < frames.size(); i++)
+        {
+            if(!_bPointSpace)
+                UndistortImage(*frames[i], i);
+            if(frame_num >= warmup_start)
+                _trackers[i]->LearnBackground(*frames[i]);
+            if(_bPointSpace && frame_num >= copied)
+                UndistortImage(*frames[i], i);
+        }
+
+        if(frame_num >= copied)
+            writer << Mosaic(frames);
+        frame_num++;
+    }
+
+    // Dropped frames can leave the videos off by a little, so line them back
+    // up with the checkpoint.
+    for(size_t i = 0; i < _videos.size(); i++)
+        if(_videos[i]->Frame != checkpoint.Positions[i])
+            _videos[i]->Seek(checkpoint.Positions[i]);
+}
+
+std::vector<std::shared_ptr<cv::Mat>> Processor::ReadFrames(std::vector<std::unique_ptr<Video>>& videos) const
+{
+    // Each video has its own decoder, so they can all be read at once.
+    cv::parallel_for_(cv::Range(0, (int)videos.size()), [&](const cv::Range& range)
+    {
+        for(int i = range.start; i < range.end; i++)
+        {
+            PipelineStats::Timer timer(_stats.get(), STAGE_DECODE);
+            videos[i]->Read();
+        }
+    });
+
+    std::vector<std::shared_ptr<cv::Mat>> frames;
+    for(auto& video : videos)
+    {
+        if(!video->Get())
+            return {};
+        frames.push_back(video->Get());
+    }
+    return frames;
+}
+
+cv::Mat Processor::Mosaic(const std::vector<std::shared_ptr<cv::Mat>>& frames) const
+{
+    std::vector<cv::Mat> mats;
+    for(const auto& frame : frames)
+        mats.push_back(*frame);
+    return MosaicMatrices(mats, Config.Rig.MosaicColumns);
+}
+
+std::string Processor::ResultKey() const
+{
+    std::vector<std::string> videos;
+    for(const auto& video : _videos)
+        videos.push_back(video->GetPath());
+
+    // Calibration reads its files from calib_config/.
+    std::vector<std::string> files = { "calib_config/" + std::string(CALIBRATION_FILE) };
+    if(Config.Dnn.bEnabled)
+    {
+        files.push_back(Config.Dnn.Model);
+        files.push_back(Config.Dnn.Labels);
+    }
+
+    // The site's backgrounds are saved again by every job, and only change
+    // the first few frames, so the site goes in the key rather than them.
+    Tracker::Settings tracker_settings = _trackers.empty() ? Tracker::Settings() : _trackers[0]->Config;
+    ResultCache::Settings cache_settings;
+    return ResultCache(cache_settings).Key(videos, files, DescribeSettings(Config, tracker_settings));
+}
+
+void Processor::SeedBackgrounds(std::vector<std::unique_ptr<Tracker>>& trackers) const
+{
+    if(Config.Background.Site.empty())
+        return;
+
+    int seeded = 0;
+    for(size_t i = 0; i < trackers.size(); i++)
+    {
+        cv::Mat background = cv::imread(BackgroundFile(Config.Background.Site, i, _bPointSpace), cv::IMREAD_COLOR);
+        if(background.empty())
+            continue;
+        trackers[i]->SeedBackground(background);
+        seeded++;
+    }
+    if(seeded > 0)
+        std::cout << "  > Starting " << seeded << " background models from site \"" << Config.Background.Site << "\"\n";
+}
+
+void Processor::SaveBackgrounds(const std::vector<std::unique_ptr<Tracker>>& trackers) const
+{
+    if(Config.Background.Site.empty())
+        return;
+
+    std::string dir = "static/backgrounds/" + Config.Background.Site + "/";
+    mkdir("static/backgrounds/", 0775);
+    mkdir(dir.c_str(), 0775);
+    for(size_t i = 0; i < trackers.size(); i++)
+    {
+        cv::Mat background = trackers[i]->GetBackground();
+        if(background.empty())
+            continue;
+        if(Config.Background.Scale > 0.0 && Config.Background.Scale < 1.0)
+            cv::resize(background, background, cv::Size(), Config.Background.Scale, Config.Background.Scale, cv::INTER_AREA);
+
+        // Written aside and renamed, so a job starting now never reads half
+        // a file.
+        std::string file = BackgroundFile(Config.Background.Site, i, _bPointSpace);
+        std::string partial = file.substr(0, file.size() - 4) + ".part.png";
+        if(!cv::imwrite(partial, background) || std::rename(partial.c_str(), file.c_str()) != 0)
+        {
+            std::cerr << " !> Could not save the background of camera " << i << " to \"" << file << "\"\n";
+            std::remove(partial.c_str());
+        }
+    }
+}
+
 void Processor::UndistortImage(cv::Mat& frame, int index) const
 {
-    _calib->UndistortImage(frame, index);
+    // Cameras without calibration data are used as they are.
+    if(index < _calib->GetCameraCount())
+        _calib->UndistortImage(frame, index);
 }
 
+
 void Processor::AssembleEvents(int& last_frame) const
 {
-    for(auto event : _tracker->ActivityRange)
+    // Each camera has its own activity ranges, so merge the ones that overlap
+    // into a single event for the rig.
+    std::vector<std::pair<int, int>> ranges;
+    std::vector<std::vector<std::pair<int, int>>> camera_ranges(_trackers.size());
+    for(size_t i = 0; i < _trackers.size(); i++)
+        for(auto event : _trackers[i]->ActivityRange)
+        {
+            if(event->IsActive())
+                event->EndEvent(last_frame);
+            ranges.push_back(event->GetRange());
+            camera_ranges[i].push_back(event->GetRange());
+        }
+    std::vector<std::pair<int, int>> merged = MergeRanges(ranges);
+
+    EventIndex index;
+    int id = 1;
+    for(auto range : merged)
     {
-        if(event->IsActive())
-            event->EndEvent(last_frame);
-        _detected_events->AddObject(event->GetAsJSON());
+        ActivityEvent event(id, range.first, range.second);
+
+        // Medians are used so a few bad matches don't skew the measurements.
+        std::vector<double> samples[3];
+        {
+            std::lock_guard<std::mutex> lock(_depth_mutex);
+            for(auto it = _depth_samples.lower_bound(range.first); it != _depth_samples.end() && it->first <= range.second; ++it)
+            {
+                samples[0].push_back(it->second.Range);
+                samples[1].push_back(it->second.Width);
+                samples[2].push_back(it->second.Height);
+            }
+        }
+        if(!samples[0].empty())
+        {
+            const char* keys[3] = { "range", "width", "height" };
+            for(int i = 0; i < 3; i++)
+            {
+                std::nth_element(samples[i].begin(), samples[i].begin() + samples[i].size() / 2, samples[i].end());
+                event.AddInfo(keys[i], FormatNumber(samples[i][samples[i].size() / 2]));
+            }
+            event.AddInfo("depth_samples", std::to_string(samples[0].size()));
+        }
+
+        // Lengths are given as a distribution, as a fish bends while it swims
+        // and is shortest when seen end on.
+        std::vector<double> lengths = _length ? _length->GetLengths(range.first, range.second) : std::vector<double>();
+        if(!lengths.empty())
+        {
+            std::sort(lengths.begin(), lengths.end());
+            auto percentile = [&lengths](double p) { return FormatNumber(lengths[size_t(p * (lengths.size() - 1) + 0.5)]); };
+            event.AddInfo(JSON("length", {
+                { "p10",     percentile(0.10) },
+                { "p25",     percentile(0.25) },
+                { "median",  percentile(0.50) },
+                { "p75",     percentile(0.75) },
+                { "p90",     percentile(0.90) },
+                { "samples", std::to_string(lengths.size()) }
+            }));
+        }
+
+        // Count the objects followed through the event, and how many were in
+        // view at once, then give each one's path.
+        std::vector<ObjectTrack> tracks = _objects ? _objects->GetTracks(range.first, range.second) : std::vector<ObjectTrack>();
+        if(!tracks.empty())
+        {
+            std::map<int, int> in_view;
+            std::map<std::string, int> species;
+            JSON paths("tracks");
+            for(const auto& track : tracks)
+            {
+                std::vector<std::string> columns[5];
+                for(size_t i = 0; i < track.Frames.size(); i++)
+                {
+                    const cv::Rect& box = track.Boxes[i];
+                    in_view[track.Frames[i]]++;
+                    columns[0].push_back(std::to_string(track.Frames[i]));
+                    columns[1].push_back(std::to_string(box.x));
+                    columns[2].push_back(std::to_string(box.y));
+                    columns[3].push_back(std::to_string(box.width));
+                    columns[4].push_back(std::to_string(box.height));
+                }
+
+                JSON path("object_" + std::to_string(track.ID));
+                if(!track.Label.empty())
+                {
+                    path.AddKeyValue("label", track.Label);
+                    species[track.Label]++;
+                }
+
+                std::string dnn_label;
+                double confidence;
+                if(_dnn && _dnn->Classify(track.Frames, track.Boxes, dnn_label, confidence))
+                {
+                    path.AddKeyValue("dnn_label", dnn_label);
+                    path.AddKeyValue("dnn_confidence", FormatNumber(confidence, 3));
+                }
+                const char* keys[5] = { "frames", "x", "y", "width", "height" };
+                for(int i = 0; i < 5; i++)
+                    path.AddKeyArray(keys[i], columns[i]);
+                path.BuildJSONObject();
+                paths.AddObject(path);
+            }
+            paths.BuildJSONObject();
+
+            int most = 0;
+            for(const auto& frame : in_view)
+                most = std::max(most, frame.second);
+            event.AddInfo("objects", std::to_string(tracks.size()));
+            event.AddInfo("max_objects", std::to_string(most));
+            event.AddInfo(paths);
+
+            if(!species.empty())
+            {
+                JSON counts("labels");
+                for(const auto& label : species)
+                    counts.AddKeyValue(label.first, std::to_string(label.second));
+                counts.BuildJSONObject();
+                event.AddInfo(counts);
+            }
+        }
+
+        // What the network made of everything seen during the event.
+        std::string dnn_label;
+        double confidence;
+        if(_dnn && _dnn->Classify(range.first, range.second, dnn_label, confidence))
+        {
+            event.AddInfo("dnn_label", dnn_label);
+            event.AddInfo("dnn_confidence", FormatNumber(confidence, 3));
+        }
+
+        // Point the event at its row of the sprite sheet.
+        Thumbnail picks[EventThumbnails::N_COLUMNS];
+        int row = _thumbnails ? _thumbnails->AddRow(range.first, range.second, picks) : -1;
+        if(row >= 0)
+        {
+            cv::Size size = _thumbnails->GetThumbnailSize();
+            event.AddInfo(JSON("thumbnails", {
+                { "sheet",  "TH_" + _videos[0]->FileName + ".jpg" },
+                { "row",    std::to_string(row) },
+                { "width",  std::to_string(size.width) },
+                { "height", std::to_string(size.height) },
+                { "start",  std::to_string(picks[EventThumbnails::COLUMN_START].Frame) },
+                { "peak",   std::to_string(picks[EventThumbnails::COLUMN_PEAK].Frame) },
+                { "end",    std::to_string(picks[EventThumbnails::COLUMN_END].Frame) }
+            }));
+        }
+        _detected_events->AddObject(event.GetAsJSON());
+        if(OnEvent)
+            OnEvent(event.GetAsJSON().GetJSON());
+
+        int cameras = 0;
+        for(size_t i = 0; i < camera_ranges.size() && i < 32; i++)
+            for(const auto& camera_range : camera_ranges[i])
+                if(camera_range.first <= range.second && camera_range.second >= range.first)
+                    cameras |= int(1u << i);
+        index.Add(id++, range.first, range.second, cameras, row, tracks);
     }
+
+    if(_thumbnails)
+        _thumbnails->WriteSheet("static/video-info/TH_" + _videos[0]->FileName + ".jpg");
+
+    // Index the events too, so time windows can be looked up without the JSON.
+    if(!index.Write("static/video-info/EI_" + _videos[0]->FileName + ".idx"))
+        std::cerr << " !> Could not write the event index!\n";
 }
 
 bool Processor::SyncVideos() const
 {
-    for(int i = 0 ; i < 2; i++)
+    MotionSync::Settings motion_settings;
+    motion_settings.MaxLag        = Config.Sync.MotionMaxLag;
+    motion_settings.MinConfidence = Config.Sync.MotionConfidence;
+    MotionSync motion(motion_settings);
+
+    // Reads the next frame of a video, keeping its motion for later.
+    auto read = [&](size_t i)
+    {
+        _videos[i]->Read();
+        auto frame = _videos[i]->Get();
+        if(Config.Sync.bMotion)
+            motion.Add(i, frame ? *frame : cv::Mat());
+        return frame;
+    };
+    auto searched = [this](size_t i) { return Config.Sync.Frames > 0 && _videos[i]->Frame >= Config.Sync.Frames; };
+
+    std::vector<int> qr_frames(_videos.size(), -1);
+    for(size_t i = 0; i < _videos.size(); i++)
     {
         QREvent detect_QR;
-        while(true)
+        while(!Stopping() && !_videos[i]->Ended() && !searched(i) && !detect_QR.DetectedQR())
         {
-            if(!detect_QR.DetectedQR())
-            {
-                _videos[i]->Read();
-                if(_videos[i]->Get())
-                    detect_QR.CheckFrame(*_videos[i]->Get(), _videos[i]->Frame);
-            }
-            else break;
+            auto frame = read(i);
+            if(frame)
+                detect_QR.CheckFrame(*frame, _videos[i]->Frame);
         }
-        if(!detect_QR.DetectedQR()) return false;
+        if(detect_QR.DetectedQR())
+            qr_frames[i] = _videos[i]->Frame;
+    }
+    if(Stopping())
+        return false;
+
+    if(std::find(qr_frames.begin(), qr_frames.end(), -1) == qr_frames.end())
+    {
+        // The card wins, but a confident disagreement is worth knowing about.
+        for(size_t i = 1; i < _videos.size() && Config.Sync.bMotion; i++)
+        {
+            MotionSync::Result result = motion.Estimate(i);
+            int qr_offset = qr_frames[i] - qr_frames[0];
+            if(motion.IsConfident(result) && std::abs(result.Offset - qr_offset) > 1)
+                std::cout << "  > Motion puts video " << i << " " << result.Offset << " frames from the first, but the QR card "
+                          << qr_offset << " (confidence " << FormatNumber(result.Confidence, 2) << "), keeping the QR card\n";
+        }
+        std::cout << " > Synced videos\n";
+        return true;
+    }
+    if(!Config.Sync.bMotion)
+        return false;
+
+    // Without the card in every video, give each the same frames to compare.
+    std::cout << "  > No QR card in every video, syncing by motion\n";
+    for(size_t i = 0; i < _videos.size(); i++)
+        while(!Stopping() && !_videos[i]->Ended() && !searched(i))
+            read(i);
+    if(Stopping())
+        return false;
+
+    std::vector<int> offsets(_videos.size(), 0);
+    for(size_t i = 1; i < _videos.size(); i++)
+    {
+        MotionSync::Result result = motion.Estimate(i);
+        std::cout << "  > Video " << i << " is " << result.Offset << " frames from the first (confidence "
+                  << FormatNumber(result.Confidence, 2) << ")\n";
+        if(!motion.IsConfident(result))
+            return false;
+        offsets[i] = result.Offset;
     }
-    std::cout << " > Synced videos\n";
+
+    // Start every video at the first frame they all share. Streams can't go
+    // back, so they skip ahead to the same point after the frames searched.
+    int lead = -std::min(0, *std::min_element(offsets.begin(), offsets.end()));
+    int searched_frames = 0;
+    for(const auto& video : _videos)
+        searched_frames = std::max(searched_frames, video->Frame);
+    for(size_t i = 0; i < _videos.size(); i++)
+    {
+        int target = offsets[i] + lead;
+        if(_videos[i]->bLive)
+            for(target += searched_frames; _videos[i]->Frame < target && !_videos[i]->Ended();)
+                _videos[i]->Read();
+        else
+            _videos[i]->Seek(target);
+    }
+    std::cout << " > Synced videos by motion\n";
     return true;
 }
 
 
 Video::Video(std::string file)
-    : FileName{""}, Frame{0}, TotalFrames{0}, _filepath{file}
+    : FileName{""}, bLive{false}, Frame{0}, TotalFrames{0}, _filepath{file}, _bEnded{false}
 {
     try
     {
+        if(_filepath == "-")
+            _filepath = "/dev/stdin";
+        struct stat info;
+        bLive = stat(_filepath.c_str(), &info) == 0 && (S_ISFIFO(info.st_mode) || S_ISCHR(info.st_mode));
+
         FileName = _filepath.substr(_filepath.find_last_of("/") + 1, _filepath.length());
         FileName = FileName.substr(0,FileName.find_last_of("_"));
         
@@ -215,6 +1492,10 @@ Video::Video(std::string file)
         Height      = _vid_cap->get(cv::CAP_PROP_FRAME_HEIGHT);
         FPS         = _vid_cap->get(cv::CAP_PROP_FPS);
         FOURCC      = _vid_cap->get(cv::CAP_PROP_FOURCC);
+
+        // A stream's length isn't known until it ends.
+        if(bLive)
+            TotalFrames = std::numeric_limits<int>::max();
     } 
     catch(std::exception& e)
     {
@@ -237,6 +1518,14 @@ void Video::Read()
             cv::Mat frame;
             if (_vid_cap->isOpened()) 
                 _vid_cap->read(frame);
+
+            // An empty read from a stream means the writer has gone away.
+            if(frame.empty() && bLive)
+            {
+                _bEnded = true;
+                _frame = nullptr;
+                return;
+            }
             
             if(frame.empty())
             {
@@ -251,6 +1540,40 @@ void Video::Read()
     }
 }
 
+void Video::Seek(int frame)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_vid_cap)
+    {
+        _vid_cap->set(cv::CAP_PROP_POS_FRAMES, frame);
+        _frame = nullptr;
+        Frame = frame;
+
+        // Some backends only seek as far as a keyframe, which would leave a
+        // chunk off by a few frames. Check where the decoder landed, and
+        // decode forward to the frame from there, or from the start if it
+        // went past.
+        int landed = (int)_vid_cap->get(cv::CAP_PROP_POS_FRAMES);
+        if(landed == frame || bLive)
+            return;
+
+        std::cout << "  > \"" << FileName << "\" landed on frame " << landed << " seeking to " << frame
+                  << ", decoding up to it\n";
+        if(landed > frame || landed < 0)
+        {
+            _vid_cap->open(_filepath);
+            landed = 0;
+        }
+        while(landed < frame && _vid_cap->grab())
+            landed++;
+    }
+}
+
+std::string Video::GetPath() const
+{
+    return _filepath;
+}
+
 std::shared_ptr<cv::Mat> Video::Get() const
 {
     std::lock_guard<std::mutex> lock(_mutex);
@@ -263,7 +1586,7 @@ std::shared_ptr<cv::Mat> Video::Get() const
 
 bool Video::Ended() const
 {
-    return Frame >= TotalFrames;
+    return _bEnded || Frame >= TotalFrames;
 }
 
 
@@ -284,6 +1607,212 @@ cv::Mat ConcatenateMatrices(cv::Mat& left_mat, cv::Mat& right_mat)
     return std::move(res);
 }
 
+cv::Mat MosaicMatrices(const std::vector<cv::Mat>& mats, int columns)
+{
+    std::vector<cv::Size> sizes;
+    for(const auto& mat : mats)
+        sizes.push_back(mat.size());
+    std::vector<cv::Rect> rects = MosaicLayout(sizes, columns);
+
+    cv::Rect bounds;
+    for(const auto& rect : rects)
+        bounds |= rect;
+
+    cv::Mat3b res(bounds.height, bounds.width, cv::Vec3b(0, 0, 0));
+    for(size_t i = 0; i < mats.size(); i++)
+        mats[i].copyTo(res(rects[i]));
+
+    return std::move(res);
+}
+
+/// Lays frames out left to right in rows of the given number of columns,
+/// each row as tall as its tallest frame. 0 columns puts them all in one row.
+std::vector<cv::Rect> MosaicLayout(const std::vector<cv::Size>& sizes, int columns)
+{
+    if(columns <= 0)
+        columns = std::max<int>(1, sizes.size());
+
+    std::vector<cv::Rect> rects;
+    int x = 0, y = 0, row_height = 0;
+    for(size_t i = 0; i < sizes.size(); i++)
+    {
+        if(i > 0 && i % columns == 0)
+        {
+            x = 0;
+            y += row_height;
+            row_height = 0;
+        }
+        rects.push_back(cv::Rect(cv::Point(x, y), sizes[i]));
+        x += sizes[i].width;
+        row_height = std::max(row_height, sizes[i].height);
+    }
+    return rects;
+}
+
+/// The size of the mosaic made from the frames of these videos.
+cv::Size MosaicSize(const std::vector<std::unique_ptr<Video>>& videos, int columns)
+{
+    std::vector<cv::Size> sizes;
+    for(const auto& video : videos)
+        sizes.push_back(cv::Size(video->Width, video->Height));
+
+    cv::Rect bounds;
+    for(const auto& rect : MosaicLayout(sizes, columns))
+        bounds |= rect;
+    return bounds.size();
+}
+
+/// The frames left in the shortest of the videos.
+int FramesLeft(const std::vector<std::unique_ptr<Video>>& videos)
+{
+    int left = std::numeric_limits<int>::max();
+    for(const auto& video : videos)
+        left = std::min(left, video->TotalFrames - video->Frame);
+    return videos.empty() ? 0 : left;
+}
+
+bool AnyEnded(const std::vector<std::unique_ptr<Video>>& videos)
+{
+    return std::any_of(videos.begin(), videos.end(), [](const std::unique_ptr<Video>& video) { return video->Ended(); });
+}
+
+void ConcatenateSegments(const std::vector<std::string>& segments, std::string file_name, int fourcc, double fps, int width, int height)
+{
+    // Stream copy the segments with ffmpeg's concat demuxer, so nothing gets
+    // encoded twice.
+    std::string list_file = segments.front() + ".txt";
+    {
+        std::ofstream list(list_file);
+        for(auto& segment : segments)
+        {
+            char* path = realpath(segment.c_str(), nullptr);
+            list << ConcatEntry(path ? path : segment) << "\n";
+            free(path);
+        }
+    }
+
+    // The names come from uploads, so they go straight to ffmpeg rather than
+    // through a shell.
+    bool bCopied = RunProgram({ "ffmpeg", "-nostdin", "-y", "-loglevel", "error", "-f", "concat", "-safe", "0",
+                                "-i", list_file, "-c", "copy", file_name });
+    std::remove(list_file.c_str());
+
+    if(bCopied)
+    {
+        std::cout << "  > Joined " << segments.size() << " segments without re-encoding\n";
+        return;
+    }
+
+    std::cout << "  > Could not join segments with ffmpeg, re-encoding them instead\n";
+    cv::VideoWriter writer(file_name, fourcc, fps, cv::Size(width, height), true);
+    for(auto& segment : segments)
+    {
+        cv::VideoCapture capture(segment);
+        cv::Mat frame;
+        while(capture.read(frame))
+            writer << frame;
+    }
+}
+
+/// Lists everything a job writes, under the name it writes them as.
+std::vector<std::string> ResultFiles(const std::string& name)
+{
+    return {
+        "./static/proc_videos/" + name + ".mp4",
+        "static/video-info/DE_" + name + ".json",
+        "static/video-info/PERF_" + name + ".json",
+        "static/video-info/TH_" + name + ".jpg",
+        "static/video-info/EI_" + name + ".idx",
+        "static/video-info/DL_" + name + ".dlog",
+        "static/video-info/FG_" + name + ".fgc"
+    };
+}
+
+/// Writes out the settings that change what a job finds or writes. Ones that
+/// only change how fast it gets there, like threads or checkpoints, are left
+/// out, so they don't stop results being reused.
+std::string DescribeSettings(const Processor::Settings& config, const Tracker::Settings& tracker)
+{
+    std::ostringstream out;
+    out << "version="            << RESULT_CACHE_VERSION
+        << ";warmup_frames="     << config.Job.WarmupFrames
+        << ";chunks="            << config.Job.Chunks
+        << ";sync_frames="       << config.Sync.Frames
+        << ";motion_sync="       << config.Sync.bMotion
+        << ";motion_max_lag="    << config.Sync.MotionMaxLag
+        << ";motion_confidence=" << config.Sync.MotionConfidence
+        << ";mosaic_columns="    << config.Rig.MosaicColumns
+        << ";depth="             << config.Events.bEstimateDepth
+        << ";length="            << config.Events.bMeasureLength
+        << ";undistort_points="  << config.Rig.bUndistortPoints
+        << ";thumbnails="        << config.Events.bThumbnails
+        << ";objects="           << config.Events.bTrackObjects
+        << ";dnn="               << config.Dnn.bEnabled
+        << ";dnn_input_size="    << config.Dnn.InputSize
+        << ";detection_log="     << config.Record.bDetectionLog
+        << ";foreground_cache="  << config.Record.bForegroundCache
+        << ";foreground_scale="  << config.Record.ForegroundScale
+        << ";site="              << config.Background.Site
+        << ";max_threshold="     << tracker.MaxThreshold
+        << ";min_threshold="     << tracker.MinThreshold
+        << ";blur_size="         << tracker.BlurSize
+        << ";morph_sigma="       << tracker.MorphSigma
+        << ";cascades="          << tracker.CascadeDirectory
+        << ";classify_margin="   << tracker.ClassifyMargin
+        << ";classify_interval=" << tracker.ClassifyInterval;
+    return out.str();
+}
+
+/// Names the file a site's camera keeps its background in. Trackers that
+/// see raw frames learn a different background to ones that see undistorted
+/// frames, so each kind has its own.
+std::string BackgroundFile(const std::string& site, size_t camera, bool raw)
+{
+    return "static/backgrounds/" + site + "/camera_" + std::to_string(camera) + (raw ? "_raw" : "") + ".png";
+}
+
+/// Reads the events back out of an events file, as the JSON each one was
+/// written with.
+std::vector<std::string> ReadEvents(const std::string& file)
+{
+    std::ifstream in(file);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // The events are the objects in the file's array, so they are found by
+    // their depth, skipping over any braces inside strings.
+    std::vector<std::string> events;
+    size_t start = 0;
+    int depth = 0;
+    bool bString = false;
+    for(size_t i = text.find('['); i < text.size(); i++)
+    {
+        char c = text[i];
+        if(bString)
+        {
+            if(c == '\\')
+                i++;
+            else if(c == '"')
+                bString = false;
+        }
+        else if(c == '"')
+            bString = true;
+        else if(c == '{' && depth++ == 0)
+            start = i;
+        else if(c == '}' && --depth == 0)
+            events.push_back(text.substr(start, i - start + 1));
+        else if(c == ']' && depth == 0)
+            break;
+    }
+    return events;
+}
+
+std::string FormatNumber(double value, int decimals)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    return buffer;
+}
+
 void ReadVectorOfVector(cv::FileStorage& fs, std::string name, std::vector<std::vector<cv::Point2f>>& data)
 {
     data.clear();
@@ -297,4 +1826,78 @@ void ReadVectorOfVector(cv::FileStorage& fs, std::string name, std::vector<std::
         node >> temp_vec;
         data.push_back(temp_vec);
     }
-}
\ No newline at end of file
+}
+
+std::vector<std::vector<cv::Point>> UndistortContours(const Calibration& calib, const std::vector<std::vector<cv::Point>>& contours, int index)
+{
+    // Undistort every point in one call, then split them up again.
+    std::vector<cv::Point2f> points;
+    for(const auto& contour : contours)
+        points.insert(points.end(), contour.begin(), contour.end());
+    calib.UndistortPoints(points, index);
+
+    std::vector<std::vector<cv::Point>> undistorted(contours.size());
+    size_t next = 0;
+    for(size_t i = 0; i < contours.size(); i++)
+        for(size_t j = 0; j < contours[i].size(); j++, next++)
+            undistorted[i].push_back(cv::Point(cvRound(points[next].x), cvRound(points[next].y)));
+    return undistorted;
+}
+
+/// Merges ranges of frames that overlap or touch.
+std::vector<std::pair<int, int>> MergeRanges(std::vector<std::pair<int, int>> ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+
+    std::vector<std::pair<int, int>> merged;
+    for(auto range : ranges)
+    {
+        if(range.second <= range.first)
+            continue;
+
+        if(!merged.empty() && range.first <= merged.back().second)
+            merged.back().second = std::max(merged.back().second, range.second);
+        else
+            merged.push_back(range);
+    }
+    return merged;
+}
+
+/// Writes a line of ffmpeg's concat list for a file. Quotes can't be escaped
+/// inside a quoted name, so each one closes the quotes, is escaped, and opens
+/// them again.
+std::string ConcatEntry(const std::string& file)
+{
+    std::string entry = "file '";
+    for(char c : file)
+        entry += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    return entry + "'";
+}
+
+/// Runs a program, found on the PATH, with its output thrown away.
+/// \returns True if it ran and exited with 0.
+bool RunProgram(const std::vector<std::string>& args)
+{
+    std::vector<char*> argv;
+    for(const auto& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if(error != 0)
+        return false;
+
+    int status;
+    while(waitpid(pid, &status, 0) < 0)
+        if(errno != EINTR)
+            return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -0,0 +1,136 @@
+#include "includes/ProgressReporter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ProgressReporter::ProgressReporter(std::string file, double interval)
+    : _file{file}, _fd{-1}, _record{nullptr}, _interval{interval},
+      _stage{PROGRESS_STARTING}, _pair{0}, _total_pairs{0}, _name{""},
+      _frame{0}, _total_frames{0}, _fps{0.0},
+      _last_publish{Clock::now()}, _last_frame{0}
+{
+    if(_file.empty())
+        return;
+
+    try
+    {
+        auto slash = _file.find_last_of("/");
+        if(slash != std::string::npos)
+            mkdir(_file.substr(0, slash).c_str(), 0755);
+
+        _fd = open(_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(_fd < 0)
+            throw std::runtime_error("Could not open \"" + _file + "\": " + strerror(errno));
+
+        if(ftruncate(_fd, sizeof(ProgressRecord)) != 0)
+            throw std::runtime_error("Could not size \"" + _file + "\": " + strerror(errno));
+
+        void* mem = mmap(nullptr, sizeof(ProgressRecord), PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if(mem == MAP_FAILED)
+            throw std::runtime_error("Could not map \"" + _file + "\": " + strerror(errno));
+
+        _record = new (mem) ProgressRecord();
+        _record->Magic   = PROGRESS_MAGIC;
+        _record->Version = PROGRESS_VERSION;
+        _record->PID     = getpid();
+        Publish();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << " !> " << e.what() << '\n';
+        if(_fd >= 0) close(_fd);
+        _fd = -1;
+    }
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    // Whoever is listening may already be gone.
+    Listener = nullptr;
+    if(_record)
+    {
+        Publish();
+        munmap(_record, sizeof(ProgressRecord));
+    }
+    if(_fd >= 0) close(_fd);
+}
+
+std::string ProgressReporter::DefaultFile()
+{
+    return "static/progress/" + std::to_string(getpid()) + ".status";
+}
+
+void ProgressReporter::SetPair(int pair, int total_pairs, std::string name)
+{
+    _pair         = pair;
+    _total_pairs  = total_pairs;
+    _name         = name;
+    _frame        = 0;
+    _total_frames = 0;
+    _fps          = 0.0;
+    _last_frame   = 0;
+    _last_publish = Clock::now();
+    SetStage(PROGRESS_STARTING);
+}
+
+void ProgressReporter::SetStage(ProgressStage stage)
+{
+    _stage = stage;
+    Publish();
+}
+
+void ProgressReporter::Update(int64_t frame, int64_t total_frames)
+{
+    _frame        = frame;
+    _total_frames = total_frames;
+
+    auto now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - _last_publish).count();
+    if(elapsed < _interval)
+        return;
+
+    _fps          = (_frame - _last_frame) / elapsed;
+    _last_frame   = _frame;
+    _last_publish = now;
+    Publish();
+}
+
+bool ProgressReporter::IsOpen() const
+{
+    return _record != nullptr;
+}
+
+void ProgressReporter::Publish()
+{
+    if(Listener)
+        Listener(_stage, _frame, _total_frames, _fps);
+    if(!_record) return;
+
+    // Odd while writing, so readers know to retry.
+    uint64_t seq = _record->Sequence.load(std::memory_order_relaxed);
+    _record->Sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _record->Stage       = _stage;
+    _record->Pair        = _pair;
+    _record->TotalPairs  = _total_pairs;
+    _record->Frame       = _frame;
+    _record->TotalFrames = _total_frames;
+    _record->FPS         = _fps;
+    _record->ETA         = (_fps > 0.0) ? std::max<int64_t>(_total_frames - _frame, 0) / _fps : -1.0;
+    _record->UpdatedAt   = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::memset(_record->Name, 0, sizeof(_record->Name));
+    std::strncpy(_record->Name, _name.c_str(), sizeof(_record->Name) - 1);
+
+    _record->Sequence.store(seq + 2, std::memory_order_release);
+}
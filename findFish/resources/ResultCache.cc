@@ -0,0 +1,275 @@
+#include "includes/ResultCache.h"
+#include "includes/ContentHash.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+std::string EntryDir(const std::string&, const std::string&);
+std::string BaseName(const std::string&);
+std::string Rename(const std::string&, const std::string&, const std::string&);
+bool LinkOrCopy(const std::string&, const std::string&);
+bool CopyFile(const std::string&, const std::string&);
+void RemoveDir(const std::string&);
+
+/// The file in each entry that lists its results, and whose job made them.
+static const char* ENTRY_FILE = "entry.yaml";
+
+ResultCache::ResultCache(ResultCache::Settings settings)
+    : Config{settings}
+{
+}
+
+std::string ResultCache::Key(const std::vector<std::string>& videos, const std::vector<std::string>& files, const std::string& settings) const
+{
+    // Every hash is the same width, so nothing can run into the next part.
+    uint64_t hash = HashString("videos");
+    for(const auto& video : videos)
+    {
+        std::string video_hash = HashFileChunks(video, Config.ChunkSize, Config.Chunks);
+        if(video_hash.empty())
+            return "";
+        hash = HashString(video_hash, hash);
+    }
+
+    hash = HashString("files", hash);
+    for(const auto& file : files)
+        hash = HashString(HashFile(file) + ";", hash);
+
+    hash = HashString("settings", hash);
+    return HashToHex(HashString(settings, hash));
+}
+
+bool ResultCache::Has(const std::string& key) const
+{
+    struct stat info;
+    return !key.empty() && stat((EntryDir(Config.Dir, key) + ENTRY_FILE).c_str(), &info) == 0;
+}
+
+std::vector<std::string> ResultCache::Restore(const std::string& key, const std::string& name) const
+{
+    if(!Has(key) || name.empty())
+        return {};
+
+    std::string dir = EntryDir(Config.Dir, key);
+    std::string cached_name;
+    std::vector<std::string> files;
+    {
+        cv::FileStorage fs(dir + ENTRY_FILE, cv::FileStorage::READ);
+        if(!fs.isOpened())
+            return {};
+        cached_name = (std::string)fs["name"];
+        fs["files"] >> files;
+    }
+    if(cached_name.empty() || files.empty())
+        return {};
+
+    std::vector<std::string> restored;
+    for(const auto& file : files)
+    {
+        std::string source = dir + BaseName(file);
+        std::string target = Rename(file, cached_name, name);
+        std::remove(target.c_str());
+
+        bool bRestored;
+        bool bJson = target.size() > 5 && target.compare(target.size() - 5, 5, ".json") == 0;
+        if(bJson && cached_name != name)
+        {
+            // JSON refers to the other results by file name (e.g. the events
+            // name their thumbnail sheet), so it gets its own renamed copy.
+            std::ifstream in(source, std::ios::binary);
+            std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            for(const auto& other : files)
+            {
+                std::string from = "\"" + BaseName(other) + "\"";
+                std::string to   = "\"" + BaseName(Rename(other, cached_name, name)) + "\"";
+                for(size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size()))
+                    text.replace(pos, from.size(), to);
+            }
+
+            std::ofstream out(target, std::ios::binary);
+            out << text;
+            bRestored = in.is_open() && out.good();
+        }
+        else bRestored = LinkOrCopy(source, target);
+
+        if(!bRestored)
+        {
+            for(const auto& done : restored)
+                std::remove(done.c_str());
+            return {};
+        }
+        restored.push_back(target);
+    }
+
+    // Using an entry makes it the last to be evicted.
+    utime((dir + ENTRY_FILE).c_str(), nullptr);
+    return restored;
+}
+
+bool ResultCache::Store(const std::string& key, const std::string& name, const std::vector<std::string>& files) const
+{
+    if(key.empty() || name.empty())
+        return false;
+    if(Has(key))
+        return true;
+
+    // The entry is put together under another name and renamed into place,
+    // so a half stored entry is never found.
+    mkdir(Config.Dir.c_str(), 0775);
+    std::string dir = EntryDir(Config.Dir, key);
+    std::string partial = dir.substr(0, dir.size() - 1) + ".part" + std::to_string(getpid()) + "/";
+    RemoveDir(partial);
+    if(mkdir(partial.c_str(), 0775) != 0)
+        return false;
+
+    // Only results named after the job can be renamed for another one.
+    std::vector<std::string> stored;
+    for(const auto& file : files)
+    {
+        struct stat info;
+        if(stat(file.c_str(), &info) != 0 || !S_ISREG(info.st_mode) || BaseName(file).find(name) == std::string::npos)
+            continue;
+        if(!LinkOrCopy(file, partial + BaseName(file)))
+        {
+            RemoveDir(partial);
+            return false;
+        }
+        stored.push_back(file);
+    }
+
+    bool bWritten = false;
+    if(!stored.empty())
+    {
+        cv::FileStorage fs(partial + ENTRY_FILE, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_YAML);
+        if(fs.isOpened())
+        {
+            fs << "name" << name;
+            fs << "files" << stored;
+            bWritten = true;
+        }
+    }
+
+    // Renaming fails if another job stored the same key first, which is
+    // just as good.
+    if(!bWritten || std::rename(partial.substr(0, partial.size() - 1).c_str(), dir.substr(0, dir.size() - 1).c_str()) != 0)
+    {
+        RemoveDir(partial);
+        return bWritten && Has(key);
+    }
+
+    Evict(key);
+    return true;
+}
+
+void ResultCache::Detach(const std::vector<std::string>& files)
+{
+    for(const auto& file : files)
+    {
+        struct stat info;
+        if(stat(file.c_str(), &info) != 0 || !S_ISREG(info.st_mode) || info.st_nlink < 2)
+            continue;
+
+        std::string copy = file + ".detach";
+        if(CopyFile(file, copy))
+            std::rename(copy.c_str(), file.c_str());
+        else
+            std::remove(copy.c_str());
+    }
+}
+
+void ResultCache::Evict(const std::string& keep) const
+{
+    if(Config.MaxEntries <= 0)
+        return;
+
+    std::vector<std::pair<time_t, std::string>> entries;
+    if(DIR* dp = opendir(Config.Dir.c_str()))
+    {
+        while(struct dirent* d = readdir(dp))
+        {
+            // Partial entries have a '.' in their name, and are left to the
+            // jobs storing them.
+            std::string key = d->d_name;
+            struct stat info;
+            if(key.find('.') == std::string::npos && key != keep && stat((EntryDir(Config.Dir, key) + ENTRY_FILE).c_str(), &info) == 0)
+                entries.push_back(std::make_pair(info.st_mtime, key));
+        }
+        closedir(dp);
+    }
+    if((int)entries.size() < Config.MaxEntries)
+        return;
+
+    std::sort(entries.begin(), entries.end());
+    for(size_t i = 0; i + Config.MaxEntries <= entries.size(); i++)
+        RemoveDir(EntryDir(Config.Dir, entries[i].second));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+/// Returns the directory of a key's entry, ending in a '/'.
+std::string EntryDir(const std::string& dir, const std::string& key)
+{
+    std::string separator = (!dir.empty() && dir.back() != '/') ? "/" : "";
+    return dir + separator + key + "/";
+}
+
+/// Returns the file name at the end of a path.
+std::string BaseName(const std::string& path)
+{
+    return path.substr(path.find_last_of('/') + 1);
+}
+
+/// Swaps the last occurrence of one name for another in a path's file name.
+std::string Rename(const std::string& path, const std::string& from, const std::string& to)
+{
+    size_t base = path.find_last_of('/') + 1;
+    size_t pos = path.rfind(from);
+    if(from.empty() || pos == std::string::npos || pos < base)
+        return path;
+    return path.substr(0, pos) + to + path.substr(pos + from.size());
+}
+
+/// Hard links a file, or copies it if it can't be linked (e.g. across file
+/// systems).
+bool LinkOrCopy(const std::string& source, const std::string& target)
+{
+    return link(source.c_str(), target.c_str()) == 0 || CopyFile(source, target);
+}
+
+/// Copies a file's contents into a new file.
+bool CopyFile(const std::string& source, const std::string& target)
+{
+    std::ifstream in(source, std::ios::binary);
+    std::ofstream out(target, std::ios::binary);
+    if(!in.is_open() || !out.is_open())
+        return false;
+
+    // Streaming an empty file counts as a failure.
+    if(in.peek() != std::ifstream::traits_type::eof())
+        out << in.rdbuf();
+    return out.good();
+}
+
+/// Removes a directory and the files in it.
+void RemoveDir(const std::string& dir)
+{
+    if(DIR* dp = opendir(dir.c_str()))
+    {
+        while(struct dirent* d = readdir(dp))
+            if(d->d_name[0] != '.')
+                std::remove((dir + d->d_name).c_str());
+        closedir(dp);
+    }
+    rmdir(dir.c_str());
+}
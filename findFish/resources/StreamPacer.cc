@@ -0,0 +1,72 @@
+#include "includes/StreamPacer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+StreamPacer::StreamPacer(double fps, StreamPacer::Settings settings)
+    : Config{settings}, _fps{fps > 0 ? fps : 30.0}, _last_analysed{-1}, _dropped_count{0}, _max_lag{0.0}
+{
+    Config.BudgetMs  = std::max(1.0, Config.BudgetMs);
+    Config.MaxStride = std::max(1, Config.MaxStride);
+}
+
+bool StreamPacer::ShouldAnalyse(int frame, double elapsed)
+{
+    double lag = elapsed - frame / _fps;
+    double budget = Config.BudgetMs / 1000.0;
+    _max_lag = std::max(_max_lag, lag);
+
+    bool bAnalyse = true;
+    if(lag > budget)
+    {
+        if(Config.DropPolicy == Policy::SUBSAMPLE)
+        {
+            // Every budget it is behind by spaces the analysed frames out by
+            // one more.
+            int stride = std::min(Config.MaxStride + 1, 1 + int(lag / budget));
+            bAnalyse = _last_analysed < 0 || frame - _last_analysed >= stride;
+        }
+        else bAnalyse = false;
+    }
+
+    if(bAnalyse)
+        _last_analysed = frame;
+    else
+    {
+        if(!_dropped.empty() && _dropped.back().second == frame - 1)
+            _dropped.back().second = frame;
+        else
+            _dropped.push_back(std::make_pair(frame, frame));
+        _dropped_count++;
+    }
+    return bAnalyse;
+}
+
+const std::vector<std::pair<int, int>>& StreamPacer::GetDropped() const
+{
+    return _dropped;
+}
+
+int StreamPacer::DroppedCount() const
+{
+    return _dropped_count;
+}
+
+double StreamPacer::MaxLag() const
+{
+    return _max_lag;
+}
+
+StreamPacer::Policy StreamPacer::ParsePolicy(std::string name)
+{
+    if(name == "drop")
+        return Policy::DROP;
+    if(name == "subsample")
+        return Policy::SUBSAMPLE;
+    throw std::runtime_error("Unknown stream policy \"" + name + "\"!");
+}
+
+std::string StreamPacer::PolicyName(StreamPacer::Policy policy)
+{
+    return (policy == Policy::SUBSAMPLE) ? "subsample" : "drop";
+}
@@ -0,0 +1,168 @@
+#include "includes/SyntheticVideo.h"
+
+#include <opencv2/objdetect.hpp>
+
+#include <stdexcept>
+
+// QRCodeEncoder was added in OpenCV 4.5.4.
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 4)))
+#define HAS_QR_ENCODER
+#endif
+
+SyntheticVideo::SyntheticVideo(Settings settings)
+    : Config{settings}
+{
+    if(Config.Fishes.empty())
+        for(int start = 50; start + 35 < Config.Frames; start += 100)
+        {
+            float lane = 0.3f + 0.2f * ((start / 100) % 3);
+            Config.Fishes.push_back({ start, start + 35,
+                                      cv::Point2f(0.2f, lane), cv::Point2f(0.8f, lane + 0.05f),
+                                      cv::Size2f(0.12f, 0.05f) });
+        }
+}
+
+std::pair<std::string, std::string> SyntheticVideo::Generate() const
+{
+    cv::Size size = Config.Resolution;
+    cv::Mat card = RenderSyncCard();
+
+    // Both cameras look at the same textured wall, with the right camera
+    // shifted by the disparity.
+    cv::Mat texture(size.height, size.width + Config.Disparity, CV_8UC3);
+    cv::RNG texture_rng(Config.Seed);
+    texture_rng.fill(texture, cv::RNG::UNIFORM, cv::Scalar::all(70), cv::Scalar::all(150));
+    cv::GaussianBlur(texture, texture, cv::Size(9, 9), 3);
+
+    std::string files[2];
+    const char* tags[2] = { "_A.mp4", "_B.mp4" };
+    for(int camera = 0; camera < 2; camera++)
+    {
+        files[camera] = Config.OutDir + Config.Name + tags[camera];
+        cv::Mat background = texture(cv::Rect(camera == 0 ? 0 : Config.Disparity, 0, size.width, size.height)).clone();
+
+        cv::VideoWriter writer(files[camera], cv::VideoWriter::fourcc('m', 'p', '4', 'v'), Config.FPS, size, true);
+        if(!writer.isOpened())
+            throw std::runtime_error("Could not open \"" + files[camera] + "\" for writing!");
+
+        cv::RNG noise_rng(Config.Seed * 7919 + camera);
+        int total = Config.SyncFrame[camera] + 1 + Config.Frames;
+        for(int frame = 0; frame < total; frame++)
+            writer << RenderFrame(camera, frame, background, card, noise_rng);
+    }
+
+    return std::make_pair(files[0], files[1]);
+}
+
+std::vector<std::pair<int, int>> SyntheticVideo::GetEvents() const
+{
+    // The tracker starts an event on the first frame a fish is visible, and
+    // ends it on the first frame it is gone.
+    std::vector<std::pair<int, int>> events;
+    for(const auto& fish : Config.Fishes)
+        events.push_back(std::make_pair(fish.Start, fish.End + 1));
+    return events;
+}
+
+void SyntheticVideo::WriteCalibration(const std::string& file) const
+{
+    cv::Size size = Config.Resolution;
+    double f = 0.8 * size.width, baseline = 100.0;
+
+    cv::Mat K = (cv::Mat_<double>(3, 3) << f, 0, size.width / 2.0, 0, f, size.height / 2.0, 0, 0, 1);
+    cv::Mat D = cv::Mat::zeros(1, 5, CV_64F);
+    cv::Mat I = cv::Mat::eye(3, 3, CV_64F);
+    cv::Mat T = (cv::Mat_<double>(3, 1) << -baseline, 0, 0);
+
+    cv::Mat P1 = cv::Mat::zeros(3, 4, CV_64F), P2;
+    K.copyTo(P1(cv::Rect(0, 0, 3, 3)));
+    P2 = P1.clone();
+    P2.at<double>(0, 3) = -f * baseline;
+
+    cv::FileStorage fs(file, cv::FileStorage::WRITE);
+    if(!fs.isOpened())
+        throw std::runtime_error("Could not open \"" + file + "\" for writing!");
+
+    fs << "K1" << K << "D1" << D << "K2" << K << "D2" << D;
+    // The cameras are parallel, so E is just the skew matrix of T.
+    cv::Mat E = (cv::Mat_<double>(3, 3) << 0, 0, 0, 0, 0, baseline, 0, -baseline, 0);
+    cv::Mat F = cv::Mat(K.inv().t()) * E * cv::Mat(K.inv());
+
+    fs << "E" << E << "F" << F << "R" << I << "T" << T;
+    fs << "P1" << P1 << "R1" << I << "P2" << P2 << "R2" << I;
+
+    cv::Mat Q = (cv::Mat_<double>(4, 4) << 1, 0, 0, -size.width / 2.0,
+                                           0, 1, 0, -size.height / 2.0,
+                                           0, 0, 0, f,
+                                           0, 0, 1.0 / baseline, 0);
+    fs << "Q" << Q;
+    fs << "image_size" << size;
+}
+
+cv::Mat SyntheticVideo::RenderFrame(int camera, int frame, const cv::Mat& background, const cv::Mat& card, cv::RNG& rng) const
+{
+    cv::Size size = Config.Resolution;
+    cv::Mat img = background.clone();
+
+    int scene_frame = frame - Config.SyncFrame[camera] - 1;
+    if(scene_frame == -1)
+    {
+        // The sync card is held up in front of the camera for a single frame.
+        card.copyTo(img(cv::Rect((size.width - card.cols) / 2, (size.height - card.rows) / 2, card.cols, card.rows)));
+    }
+    else if(scene_frame >= 0)
+    {
+        for(const auto& fish : Config.Fishes)
+        {
+            if(scene_frame < fish.Start || scene_frame > fish.End)
+                continue;
+
+            float t = fish.End > fish.Start ? float(scene_frame - fish.Start) / (fish.End - fish.Start) : 0.f;
+            cv::Point2f pos = fish.From + (fish.To - fish.From) * t;
+            cv::Point center(int(pos.x * size.width) - (camera == 1 ? Config.Disparity : 0), int(pos.y * size.height));
+            cv::Size axes(std::max(2, int(fish.Size.width * size.width / 2)), std::max(1, int(fish.Size.height * size.height / 2)));
+            int dir = fish.To.x >= fish.From.x ? 1 : -1;
+
+            cv::Scalar colour(40, 60, 50);
+            cv::ellipse(img, center, axes, 0, 0, 360, colour, cv::FILLED, cv::LINE_AA);
+
+            std::vector<cv::Point> tail = {
+                cv::Point(center.x - dir * axes.width, center.y),
+                cv::Point(center.x - dir * axes.width * 3 / 2, center.y - axes.height),
+                cv::Point(center.x - dir * axes.width * 3 / 2, center.y + axes.height)
+            };
+            cv::fillConvexPoly(img, tail, colour, cv::LINE_AA);
+        }
+    }
+
+    if(Config.Noise > 0)
+    {
+        cv::Mat noise(size, CV_8UC3);
+        rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(128), cv::Scalar::all(Config.Noise));
+        cv::addWeighted(img, 1.0, noise, 1.0, -128, img);
+    }
+    return img;
+}
+
+cv::Mat SyntheticVideo::RenderSyncCard() const
+{
+#ifdef HAS_QR_ENCODER
+    cv::Mat code;
+    cv::QRCodeEncoder::create()->encode(Config.GeoURI, code);
+    if(code.empty())
+        throw std::runtime_error("Could not encode \"" + Config.GeoURI + "\" as a QR code!");
+
+    // Scale the code up to most of the frame, keeping the modules square, and
+    // leave a white border around it.
+    int side = std::min(Config.Resolution.width, Config.Resolution.height) * 8 / 10;
+    int module = std::max(1, side / (code.cols + 8));
+
+    cv::Mat scaled, card;
+    cv::resize(code, scaled, cv::Size(code.cols * module, code.rows * module), 0, 0, cv::INTER_NEAREST);
+    cv::copyMakeBorder(scaled, card, 4 * module, 4 * module, 4 * module, 4 * module, cv::BORDER_CONSTANT, cv::Scalar::all(255));
+    cv::cvtColor(card, card, cv::COLOR_GRAY2BGR);
+    return card;
+#else
+    throw std::runtime_error("Rendering the QR sync card needs OpenCV 4.5.4 or newer!");
+#endif
+}
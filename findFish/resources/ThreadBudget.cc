@@ -0,0 +1,296 @@
+#include "includes/ThreadBudget.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::string SlotFile(const std::string&, int);
+std::string JobFile(const std::string&, int);
+std::string ReadLine(const std::string&);
+
+ThreadBudget::ThreadBudget(ThreadBudget::Settings settings)
+    : Config{settings}, _domains{CacheDomains()}, _total{0}, _slot{-1}, _fd{-1}, _job{-1}, _job_fd{-1}, _cores{1}
+{
+    for(const auto& domain : _domains)
+        _total += domain.size();
+    if(Config.MaxJobs <= 0)
+        Config.MaxJobs = std::max<int>(1, _domains.size());
+
+    mkdir(Config.SlotDir.c_str(), 0775);
+    if(!TakeSlot())
+    {
+        // Without a slot, lock the first free job file, so the other jobs
+        // still count this one when they share the cores out. The files are
+        // reused, so there are only ever as many as ran at once.
+        for(int job = 0; _job < 0; job++)
+        {
+            int fd = open(JobFile(Config.SlotDir, job).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+            if(fd < 0)
+                break;
+            if(flock(fd, LOCK_EX | LOCK_NB) == 0)
+            {
+                _job = job;
+                _job_fd = fd;
+            }
+            else close(fd);
+        }
+    }
+    Share();
+}
+
+ThreadBudget::~ThreadBudget()
+{
+    if(_fd >= 0)
+        close(_fd);
+    if(_job_fd >= 0)
+        close(_job_fd);
+}
+
+void ThreadBudget::Apply()
+{
+    cv::setNumThreads(_cores);
+
+    // Every thread the process has started gets moved, and the ones it
+    // starts later inherit the mask from whichever thread starts them.
+    if(!_cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int cpu : _cpus)
+            CPU_SET(cpu, &set);
+
+        if(DIR* dp = opendir("/proc/self/task"))
+        {
+            while(struct dirent* d = readdir(dp))
+                if(d->d_name[0] != '.')
+                    sched_setaffinity(std::atoi(d->d_name), sizeof(set), &set);
+            closedir(dp);
+        }
+        else sched_setaffinity(0, sizeof(set), &set);
+    }
+
+    std::cout << "=== Using " << _cores << " of " << _total << " cores";
+    if(_slot >= 0)
+        std::cout << " in slot " << _slot << " of " << Config.MaxJobs;
+    if(!_cpus.empty())
+        std::cout << ", pinned to CPUs " << _cpus.front() << "-" << _cpus.back();
+    std::cout << " ===\n";
+}
+
+bool ThreadBudget::Rebalance()
+{
+    // A job that started with every slot taken moves into the first one
+    // that comes free, and gives up its job file.
+    bool bTook = _slot < 0 && TakeSlot();
+    if(bTook && _job_fd >= 0)
+    {
+        close(_job_fd);
+        _job = -1;
+        _job_fd = -1;
+    }
+
+    int cores = _cores;
+    std::vector<int> cpus = _cpus;
+    Share();
+    if(!bTook && _cores == cores && _cpus == cpus)
+        return false;
+
+    if(_cpus != cpus)
+        Apply();
+    else
+    {
+        cv::setNumThreads(_cores);
+        std::cout << "  > Sharing the cores with " << ActiveJobs() << " jobs, now using " << _cores << '\n';
+    }
+    return true;
+}
+
+int ThreadBudget::GetSlot() const
+{
+    return _slot;
+}
+
+int ThreadBudget::GetCores() const
+{
+    return _cores;
+}
+
+const std::vector<int>& ThreadBudget::GetCpus() const
+{
+    return _cpus;
+}
+
+int ThreadBudget::ActiveJobs() const
+{
+    // A slot another job holds can't be locked, even for sharing.
+    int jobs = 1;
+    for(int slot = 0; slot < Config.MaxJobs; slot++)
+    {
+        if(slot == _slot)
+            continue;
+        int fd = open(SlotFile(Config.SlotDir, slot).c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            continue;
+        if(flock(fd, LOCK_SH | LOCK_NB) != 0)
+            jobs++;
+        close(fd);
+    }
+
+    // Likewise for the jobs that didn't get a slot.
+    if(DIR* dp = opendir(Config.SlotDir.c_str()))
+    {
+        while(struct dirent* d = readdir(dp))
+        {
+            std::string name = d->d_name;
+            if(name.compare(0, 4, "job_") != 0 || name.size() < 9 || name.compare(name.size() - 5, 5, ".lock") != 0)
+                continue;
+
+            int job = std::atoi(name.c_str() + 4);
+            if(job == _job)
+                continue;
+            int fd = open(JobFile(Config.SlotDir, job).c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0)
+                continue;
+            if(flock(fd, LOCK_SH | LOCK_NB) != 0)
+                jobs++;
+            close(fd);
+        }
+        closedir(dp);
+    }
+    return jobs;
+}
+
+std::vector<std::vector<int>> ThreadBudget::CacheDomains()
+{
+    // Only the CPUs the process may run on count, which respects a container's
+    // cpuset.
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if(CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+    if(cpus.empty())
+        for(int cpu = 0; cpu < (int)std::max(1u, std::thread::hardware_concurrency()); cpu++)
+            cpus.push_back(cpu);
+
+    std::map<std::string, std::vector<int>> groups;
+    for(int cpu : cpus)
+    {
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+
+        // The highest cache index is the last level, shared the most widely.
+        std::string key;
+        for(int index = 9; index >= 0 && key.empty(); index--)
+            key = ReadLine(base + "/cache/index" + std::to_string(index) + "/shared_cpu_list");
+
+        if(key.empty())
+            if(DIR* dp = opendir(base.c_str()))
+            {
+                while(struct dirent* d = readdir(dp))
+                    if(std::string(d->d_name).find("node") == 0)
+                        key = d->d_name;
+                closedir(dp);
+            }
+        groups[key].push_back(cpu);
+    }
+
+    std::vector<std::vector<int>> domains;
+    for(auto& group : groups)
+        domains.push_back(group.second);
+    std::sort(domains.begin(), domains.end());
+    return domains;
+}
+
+std::vector<int> ThreadBudget::Partition(const std::vector<std::vector<int>>& domains, int parts, int part)
+{
+    std::vector<int> cpus;
+    for(const auto& domain : domains)
+        cpus.insert(cpus.end(), domain.begin(), domain.end());
+    if(cpus.empty())
+        return { 0 };
+
+    parts = std::min<int>(std::max(1, parts), cpus.size());
+    part = std::max(0, part) % parts;
+    size_t first = cpus.size() * part / parts;
+    size_t last  = cpus.size() * (part + 1) / parts;
+    return std::vector<int>(cpus.begin() + first, cpus.begin() + last);
+}
+
+bool ThreadBudget::TakeSlot()
+{
+    // Take the first slot no other job holds. The lock goes with the file
+    // descriptor, so a job that dies frees its slot.
+    for(int slot = 0; slot < Config.MaxJobs && _slot < 0; slot++)
+    {
+        int fd = open(SlotFile(Config.SlotDir, slot).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+        if(fd < 0)
+            continue;
+        if(flock(fd, LOCK_EX | LOCK_NB) == 0)
+        {
+            _slot = slot;
+            _fd = fd;
+        }
+        else close(fd);
+    }
+    return _slot >= 0;
+}
+
+void ThreadBudget::Share()
+{
+    // Pinned jobs each have their own cores. A single slot would pin one job
+    // to every core and leave the rest to run on top of it, so there is
+    // nothing to pin with one.
+    int jobs = ActiveJobs();
+    if(Config.bPinThreads && Config.MaxJobs > 1 && _slot >= 0)
+    {
+        _cpus = Partition(_domains, Config.MaxJobs, _slot);
+
+        // Jobs without a slot run on every core, so with more jobs than
+        // slots the pinned ones give up threads to make room for them.
+        _cores = jobs > Config.MaxJobs ? std::max<int>(1, _cpus.size() * Config.MaxJobs / jobs) : (int)_cpus.size();
+    }
+    else
+    {
+        _cpus.clear();
+        _cores = std::max(1, _total / jobs);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+std::string SlotFile(const std::string& dir, int slot)
+{
+    std::string separator = (!dir.empty() && dir.back() != '/') ? "/" : "";
+    return dir + separator + "slot_" + std::to_string(slot) + ".lock";
+}
+
+/// Names the file a job without a slot locks.
+std::string JobFile(const std::string& dir, int job)
+{
+    std::string separator = (!dir.empty() && dir.back() != '/') ? "/" : "";
+    return dir + separator + "job_" + std::to_string(job) + ".lock";
+}
+
+/// Reads the first line of a file, or nothing if it can't be read.
+std::string ReadLine(const std::string& file)
+{
+    std::ifstream in(file);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
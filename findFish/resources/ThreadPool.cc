@@ -0,0 +1,55 @@
+#include "includes/ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t n_threads)
+    : _bStopping{false}
+{
+    if(n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(size_t i = 0; i < n_threads; i++)
+        _workers.emplace_back(&ThreadPool::Worker, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _bStopping = true;
+    }
+    _condition.notify_all();
+
+    for(auto& worker : _workers)
+        if(worker.joinable()) worker.join();
+}
+
+size_t ThreadPool::Size() const
+{
+    return _workers.size();
+}
+
+size_t ThreadPool::Pending() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _tasks.size();
+}
+
+void ThreadPool::Worker()
+{
+    while(true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]{ return _bStopping || !_tasks.empty(); });
+
+            if(_bStopping && _tasks.empty())
+                return;
+
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
@@ -1,10 +1,15 @@
 #include "includes/Tracker.h"
 #include "includes/EventDetector.h"
+#include "includes/PipelineStats.h"
 
 #include <opencv2/imgcodecs.hpp>
 
+#include <algorithm>
+#include <iostream>
 #include <vector>
 
+#include <sys/stat.h>
+
 Tracker::Tracker(Tracker::Settings s)
 {
     Config = s;
@@ -28,35 +33,53 @@ void Tracker::CreateMask(cv::Mat& frame)
     if(!frame.empty())
     {
         // Background subtraction method.
-        bkgd_sub_ptr->apply(frame, _mask);
-
-        int sigmaX = 10, sigmaY = 10, ksize = 9;
-        
-        cv::Mat kernel = getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2 * sigmaX + 1, 2 * sigmaY + 1), cv::Point(sigmaX, sigmaY));
-
-        cv::GaussianBlur(_mask, _mask, cv::Size(ksize, ksize), sigmaX, sigmaY);
-        cv::morphologyEx(_mask, _mask, cv::MORPH_CLOSE, cv::getGaussianKernel(ksize, sigmaX));
-        
-        cv::dilate(_mask, _mask, kernel, cv::Point(sigmaX, sigmaY));
-        cv::erode(_mask, _mask, kernel, cv::Point(sigmaX, sigmaY));
-
-        cv::threshold(_mask, _mask, Config.MinThreshold, Config.MaxThreshold, cv::THRESH_BINARY);
-    
-        /*
-        // Haar Cascade method.
-        for(auto cascade : cascades)
         {
-            std::vector<cv::Rect> objects;
-            cascade.second->detectMultiScale(frame, objects);
+            PipelineStats::Timer timer(Stats.get(), STAGE_BACKGROUND);
+            ApplySeed(frame);
+            bkgd_sub_ptr->apply(frame, _foreground);
         }
-        */
 
+        Segment(_foreground, 1.0);
         GetObjectContours(frame);
     }
 }
 
+void Tracker::ReplayMask(const cv::Mat& foreground, double scale)
+{
+    if(foreground.empty() || scale <= 0.0)
+        return;
+
+    Segment(foreground, scale);
+    cv::Mat no_frame;
+    GetObjectContours(no_frame);
+
+    // Put the contours back where they'd be on the frame.
+    if(scale != 1.0)
+        for(auto& contour : contours)
+            for(auto& point : contour)
+                point = cv::Point(cvRound(point.x / scale), cvRound(point.y / scale));
+}
+
+void Tracker::Segment(const cv::Mat& foreground, double scale)
+{
+    PipelineStats::Timer timer(Stats.get(), STAGE_MORPHOLOGY);
+    int sigmaX = std::max(1, cvRound(Config.MorphSigma * scale)), sigmaY = sigmaX;
+    int ksize = std::max(1, cvRound(Config.BlurSize * scale)) | 1;
+
+    cv::Mat kernel = getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2 * sigmaX + 1, 2 * sigmaY + 1), cv::Point(sigmaX, sigmaY));
+
+    cv::GaussianBlur(foreground, _mask, cv::Size(ksize, ksize), sigmaX, sigmaY);
+    cv::morphologyEx(_mask, _mask, cv::MORPH_CLOSE, cv::getGaussianKernel(ksize, sigmaX));
+
+    cv::dilate(_mask, _mask, kernel, cv::Point(sigmaX, sigmaY));
+    cv::erode(_mask, _mask, kernel, cv::Point(sigmaX, sigmaY));
+
+    cv::threshold(_mask, _mask, Config.MinThreshold, Config.MaxThreshold, cv::THRESH_BINARY);
+}
+
 void Tracker::GetObjectContours(cv::Mat& frame)
 {
+    PipelineStats::Timer timer(Stats.get(), STAGE_CONTOURS);
     contours.clear();
     int thresh = 8500;
 
@@ -67,7 +90,7 @@ void Tracker::GetObjectContours(cv::Mat& frame)
     cv::Canny(_mask, canny_output, thresh, thresh * 2, 5);
     cv::findContours(canny_output, contours, hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, cv::Point(0, 0));
 
-    if(Config.bDrawContours)
+    if(Config.bDrawContours && !frame.empty())
     {
         cv::RNG rng(12345);
         cv::Mat drawing = cv::Mat::zeros(canny_output.size(), CV_8UC3);
@@ -118,13 +141,232 @@ void Tracker::CheckForActivity(int& CurrentFrame)
             }
 }
 
+std::vector<cv::Rect> Tracker::GetBoundingBoxes() const
+{
+    std::vector<cv::Rect> boxes;
+    for(const auto& contour : contours)
+        boxes.push_back(cv::boundingRect(contour));
+    return boxes;
+}
+
+const std::vector<std::vector<cv::Point>>& Tracker::GetContours() const
+{
+    return contours;
+}
+
+bool Tracker::IsActive() const
+{
+    return bIsActive;
+}
+
+const cv::Mat& Tracker::GetMask() const
+{
+    return _mask;
+}
+
+const cv::Mat& Tracker::GetForeground() const
+{
+    return _foreground;
+}
+
+void Tracker::LearnBackground(cv::Mat& frame)
+{
+    if(!frame.empty())
+    {
+        PipelineStats::Timer timer(Stats.get(), STAGE_BACKGROUND);
+        ApplySeed(frame);
+        bkgd_sub_ptr->apply(frame, _foreground);
+    }
+}
+
+cv::Mat Tracker::GetBackground() const
+{
+    // The model crashes if asked before it has seen a frame.
+    cv::Mat background;
+    if(!_foreground.empty())
+        bkgd_sub_ptr->getBackgroundImage(background);
+    return background;
+}
+
+void Tracker::SeedBackground(const cv::Mat& background)
+{
+    _seed = background.clone();
+}
+
+void Tracker::ApplySeed(const cv::Mat& frame)
+{
+    if(_seed.empty())
+        return;
+    cv::Mat seed;
+    std::swap(seed, _seed);
+    if(seed.type() != frame.type())
+        return;
+    if(seed.size() != frame.size())
+        cv::resize(seed, seed, frame.size(), 0, 0, cv::INTER_LINEAR);
+
+    // A rig that was moved, or a scene lit differently, would start with
+    // more false foreground than a cold model, so those start cold.
+    double difference = cv::norm(seed, frame, cv::NORM_L1) / (double(frame.total()) * frame.channels());
+    if(difference > Config.SeedMaxDifference)
+        return;
+
+    // A few passes fill the model with samples, so the first frames are
+    // compared against the scene instead of an empty model.
+    cv::Mat foreground;
+    for(int i = 0; i < Config.SeedFrames; i++)
+        bkgd_sub_ptr->apply(seed, foreground);
+}
+
+void Tracker::Save(cv::FileStorage& fs, std::string name) const
+{
+    fs << name << "{";
+    fs << "active" << (int)bIsActive;
+    fs << "events" << "[";
+    for(auto event : ActivityRange)
+        if(event)
+        {
+            auto range = event->GetRange();
+            fs << std::vector<int>{ range.first, range.second };
+        }
+    fs << "]";
+    fs << "}";
+}
+
+void Tracker::Load(const cv::FileNode& node)
+{
+    for(auto event : ActivityRange)
+        delete event;
+    ActivityRange.clear();
+
+    bIsActive = (int)node["active"] != 0;
+    for(auto event_node : node["events"])
+    {
+        std::vector<int> range;
+        event_node >> range;
+        if(range.size() == 2)
+            ActivityRange.push_back(new ActivityEvent(int(ActivityRange.size()) + 1, range[0], range[1]));
+    }
+}
+
 void Tracker::GetCascades()
 {
-    // Get all YAML file names from directory.
+    // Get all cascade file names from the directory.
     std::vector<std::string> names;
+    struct stat info;
+    if(stat(Config.CascadeDirectory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+        return;
+    cv::glob(Config.CascadeDirectory, names, false);
+
     for(auto name : names)
     {
-        // Check if <name>.yaml exists.
-        if(false/* Add file exist check here */) cascades.insert(std::make_pair(0, new cv::CascadeClassifier(name + ".yaml")));
+        size_t dot = name.find_last_of('.'), slash = name.find_last_of("/\\");
+        std::string extension = dot == std::string::npos ? "" : name.substr(dot);
+        if(extension != ".xml" && extension != ".yaml" && extension != ".yml")
+            continue;
+
+        // The label is the file name, without its extension.
+        size_t start = slash == std::string::npos ? 0 : slash + 1;
+        std::string label = name.substr(start, dot - start);
+
+        auto cascade = cv::makePtr<cv::CascadeClassifier>();
+        if(cascade->load(name) && !cascade->empty())
+            cascades.insert(std::make_pair(label, cascade));
+        else
+            std::cerr << " !> Could not load cascade \"" << name << "\"\n";
+    }
+}
+
+bool Tracker::HasCascades() const
+{
+    return !cascades.empty();
+}
+
+std::vector<std::string> Tracker::Classify(const cv::Mat& frame, const std::vector<cv::Rect>& boxes,
+                                           const std::vector<int>& ids, int frame_num)
+{
+    std::vector<std::string> found(boxes.size());
+    if(cascades.empty() || frame.empty())
+        return found;
+
+    // Objects already labelled keep their label, and ones that weren't
+    // recognised wait a while before being tried again. Boxes without an ID
+    // can't be cached, so they are left for once they have one.
+    std::vector<size_t> pending;
+    for(size_t i = 0; i < boxes.size(); i++)
+    {
+        if(i >= ids.size() || ids[i] == 0)
+            continue;
+
+        auto cached = labels.find(ids[i]);
+        if(cached == labels.end())
+            pending.push_back(i);
+        else if(!cached->second.Label.empty())
+            found[i] = cached->second.Label;
+        else if(frame_num - cached->second.Frame >= Config.ClassifyInterval)
+            pending.push_back(i);
+    }
+    if(pending.empty())
+        return found;
+
+    // Cut out each object, with some room around it, in grey.
+    cv::Rect image(0, 0, frame.cols, frame.rows);
+    std::vector<cv::Mat> rois;
+    for(size_t i : pending)
+    {
+        const cv::Rect& box = boxes[i];
+        cv::Rect roi = cv::Rect(box.x - Config.ClassifyMargin, box.y - Config.ClassifyMargin,
+                                box.width + 2 * Config.ClassifyMargin, box.height + 2 * Config.ClassifyMargin) & image;
+        cv::Mat gray;
+        if(!roi.empty())
+        {
+            if(frame.channels() == 3) cv::cvtColor(frame(roi), gray, cv::COLOR_BGR2GRAY);
+            else gray = frame(roi).clone();
+            cv::equalizeHist(gray, gray);
+        }
+        rois.push_back(gray);
+    }
+
+    // A cascade can't be shared between threads, so each one gets a thread
+    // and goes through every object.
+    std::vector<cv::Ptr<cv::CascadeClassifier>> classifiers;
+    std::vector<std::string> names;
+    for(auto& cascade : cascades)
+    {
+        names.push_back(cascade.first);
+        classifiers.push_back(cascade.second);
+    }
+
+    std::vector<std::vector<int>> hits(classifiers.size(), std::vector<int>(rois.size(), 0));
+    {
+        PipelineStats::Timer timer(Stats.get(), STAGE_CLASSIFY);
+        cv::parallel_for_(cv::Range(0, int(classifiers.size())), [&](const cv::Range& range)
+        {
+            for(int c = range.start; c < range.end; c++)
+                for(size_t r = 0; r < rois.size(); r++)
+                {
+                    if(rois[r].empty())
+                        continue;
+
+                    std::vector<cv::Rect> detections;
+                    classifiers[c]->detectMultiScale(rois[r], detections);
+                    hits[c][r] = int(detections.size());
+                }
+        });
+    }
+
+    // The cascade with the most detections names the object.
+    for(size_t r = 0; r < pending.size(); r++)
+    {
+        int best = 0;
+        for(size_t c = 0; c < classifiers.size(); c++)
+            if(hits[c][r] > best)
+            {
+                best = hits[c][r];
+                found[pending[r]] = names[c];
+            }
+
+        size_t i = pending[r];
+        labels[ids[i]] = { found[i], frame_num };
     }
+    return found;
 }
\ No newline at end of file
@@ -11,7 +11,9 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <array>
 #include <vector>
+#include <map>
 #include <mutex>
 
 enum CalibrationType { SINGLE, STEREO };
@@ -32,14 +34,26 @@ public:
 
         std::vector<std::vector<cv::Point3f>> object_points;
         std::vector<std::vector<cv::Point2f>> image_points[2];
+
+        /// Scale to detect grids at. Below 1, grids are found on a downscaled
+        /// image and the centres are refined at full resolution.
+        float detect_scale = 1.f;
+
+        /// Number of threads used for grid detection (0 uses every core).
+        int n_threads = 0;
+
+        /// Whether to reuse grid detections from previous runs.
+        bool use_detection_cache = true;
     };
 
 private:
     /// The resultant matrices and undistorted points of the calibration.
     struct Result
     {
-        cv::Mat CameraMatrix[2];
-        cv::Mat DistCoeffs[2];
+        // The stereo pair first, then any other cameras in the rig (K3/D3
+        // onwards), which are only ever undistorted.
+        std::vector<cv::Mat> CameraMatrix = std::vector<cv::Mat>(2);
+        std::vector<cv::Mat> DistCoeffs = std::vector<cv::Mat>(2);
         std::vector<cv::Mat> rvecs[2], tvecs[2];
         
         int n_image_pairs;
@@ -50,6 +64,21 @@ private:
 
         cv::Mat R, T;
         cv::Mat R1, R2, Q, P1, P2, E, F;
+
+        // Maps for undistorting whole frames, built once per calibration.
+        std::vector<std::array<cv::Mat, 2>> UndistortMaps = std::vector<std::array<cv::Mat, 2>>(2);
+    };
+
+    /// A grid detection for a single image, as kept in the detection cache.
+    struct Detection
+    {
+        bool found = false;
+        std::vector<cv::Point2f> points;
+        double seconds = 0.0;
+
+        // The image it was last seen in, so entries for images that have
+        // since been deleted can be dropped.
+        std::string file;
     };
 
 public:
@@ -76,9 +105,56 @@ public:
     /// \param[in] index Which camera results to use.
     void UndistortImage(cv::Mat&, int) const;
 
+    /// Moves points found in a distorted frame to where they are in the
+    /// undistorted one. The frame has to be at the calibrated size.
+    /// \param[in, out] points The points to undistort.
+    /// \param[in] index Which camera results to use.
+    void UndistortPoints(std::vector<cv::Point2f>& points, int index) const;
+
+    /// Moves boxes found in a distorted frame to the bounds of where they are
+    /// in the undistorted one.
+    /// \param[in, out] boxes The boxes to undistort.
+    /// \param[in] index Which camera results to use.
+    void UndistortBoxes(std::vector<cv::Rect>& boxes, int index) const;
+
+    /// Gets the distortion coefficients of both cameras.
+    /// \param[out] D The distortion coefficients.
+    /// \returns False if either camera has none saved.
+    bool GetDistortion(cv::Mat D[2]) const;
+
+    /// Gets the size frames are undistorted at.
+    cv::Size GetImageSize() const;
+
+    /// Gets how many cameras can be undistorted: the stereo pair, and any
+    /// other cameras in the rig that were given intrinsics.
+    int GetCameraCount() const;
+
     /// Triangulates undistorted image points into real world 3D coordinates.
     void TriangulatePoints();
 
+    /// Triangulates points marked on undistorted frames, as the processed
+    /// videos show them, into the left camera's coordinates. Only needs the
+    /// camera matrices, R and T, so older calibrations work too.
+    /// \param[in] left The points on the left frame.
+    /// \param[in] right The same points on the right frame, in the same order.
+    /// \returns The points, in the units of the calibration grid (mm).
+    std::vector<cv::Point3f> Triangulate(const std::vector<cv::Point2f>& left, const std::vector<cv::Point2f>& right) const;
+
+    /// Gets what is needed to rectify undistorted images, and to reproject
+    /// rectified disparities into 3D.
+    /// \param[out] K The camera matrices.
+    /// \param[out] R The rectification rotations.
+    /// \param[out] P The projection matrices in the rectified system.
+    /// \param[out] Q The disparity-to-depth mapping matrix.
+    /// \returns False if the calibration has no rectification saved.
+    bool GetRectification(cv::Mat K[2], cv::Mat R[2], cv::Mat P[2], cv::Mat& Q) const;
+
+    /// Gets the fundamental matrix, which maps points in the left undistorted
+    /// image to their epipolar lines in the right one.
+    /// \param[out] F The fundamental matrix.
+    /// \returns False if the calibration has no fundamental matrix saved.
+    bool GetFundamental(cv::Mat& F) const;
+
 private:
     /// Runs individual calibration for each camera.
     void SingleCalibrate();
@@ -89,6 +165,30 @@ private:
     /// Finds key image points, such as a calibration grid.
     void GetImagePoints();
 
+    /// Reads an image and looks for the calibration grid in it.
+    /// \param[in] file The image file to read.
+    /// \param[out] points The grid centres, if the grid was found.
+    /// \returns True if the whole grid was found, false otherwise.
+    bool DetectGrid(const std::string& file, std::vector<cv::Point2f>& points) const;
+
+    /// Builds the detection cache key for an image from its contents and the
+    /// grid parameters.
+    /// \param[in] file The image file.
+    /// \returns The key, or an empty string if the file could not be read.
+    std::string DetectionKey(const std::string& file) const;
+
+    /// Reads grid detections saved by previous runs.
+    void ReadDetectionCache();
+
+    /// Saves the grid detections whose images still exist for the next run,
+    /// along with any other runs saved since this one read the cache.
+    void WriteDetectionCache() const;
+
+    /// Reads the grid detections saved in a detection cache.
+    /// \param[in] file The cache file.
+    /// \returns The detections by key, or none if there is no cache.
+    static std::map<std::string, Detection> LoadDetections(const std::string& file);
+
     /// Undistorts image points using stereo calibration results.
     void UndistortPoints();
 
@@ -97,11 +197,13 @@ public:
 
 private:
     Result _result;
+    std::map<std::string, Detection> _detection_cache;
 
     std::recursive_mutex _mutex;
     
     std::string _outfile_name;
     std::string _out_dir;
+    std::string _cache_file;
     CalibrationType _type;
     int _flags = 0;
 };
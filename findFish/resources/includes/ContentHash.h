@@ -0,0 +1,47 @@
+/// \date October 19, 2026
+///
+/// Content hashing helpers, used to recognise inputs that have already been
+/// seen (e.g. calibration images) without having to compare them byte by
+/// byte. The hash is 64-bit FNV-1a, which is fast and plenty for telling files
+/// apart, but is not meant to be cryptographically secure.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Hashes a block of memory, continuing from a previous hash value.
+/// \param[in] data The bytes to hash.
+/// \param[in] size The number of bytes to hash.
+/// \param[in] hash The hash to continue from.
+/// \returns The updated hash.
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+/// Hashes a string, continuing from a previous hash value.
+/// \param[in] str The string to hash.
+/// \param[in] hash The hash to continue from.
+/// \returns The updated hash.
+uint64_t HashString(const std::string& str, uint64_t hash = 14695981039346656037ULL);
+
+/// Hashes the whole contents of a file.
+/// \param[in] path The file to hash.
+/// \returns The hash as a hex string, or an empty string if the file could
+///          not be read.
+std::string HashFile(const std::string& path);
+
+/// Hashes a file's size and evenly spaced chunks of its contents, so large
+/// videos can be told apart without reading them all. Files no bigger than
+/// the chunks put together are hashed whole.
+/// \param[in] path The file to hash.
+/// \param[in] chunk_size The size of each chunk, in bytes.
+/// \param[in] chunks How many chunks to hash. The first and last are always
+///                   at the start and end of the file.
+/// \returns The hash as a hex string, or an empty string if the file could
+///          not be read.
+std::string HashFileChunks(const std::string& path, size_t chunk_size = 1 << 20, int chunks = 16);
+
+/// Formats a hash as a fixed width hex string.
+/// \param[in] hash The hash to format.
+/// \returns 16 lowercase hex characters.
+std::string HashToHex(uint64_t hash);
@@ -0,0 +1,85 @@
+/// \date October 19, 2026
+///
+/// Dense stereo depth for the objects the trackers find. Rather than matching
+/// whole frames, only the rectified strip around each detected object is
+/// rectified and matched with SGBM, and only the foreground pixels inside the
+/// object are reprojected through Q. That keeps the cost proportional to the
+/// size of what moved, which is what makes it cheap enough to run on every
+/// frame of every event.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+class Calibration;
+
+/// The measured position and size of a single object.
+struct ObjectDepth
+{
+    /// The object's box in the rectified left image.
+    cv::Rect Box;
+
+    /// The median distance to the object, in calibration units.
+    double Range = 0.0;
+
+    /// The width and height of the object, in calibration units.
+    double Width = 0.0;
+    double Height = 0.0;
+
+    /// The number of pixels with a valid disparity the measurement came from.
+    int ValidPixels = 0;
+};
+
+/// Measures the range and size of objects with stereo block matching.
+class DepthEstimator
+{
+public:
+    /// Nested wrapper class for settings pertaining to stereo matching.
+    struct Settings
+    {
+        // Disparity search range, in pixels. Must be divisible by 16.
+        int NumDisparities = 64;
+        int BlockSize = 5;
+
+        // Pixels of context added around each object before matching.
+        int Margin = 8;
+
+        // Objects with smaller boxes are ignored.
+        int MinArea = 64;
+
+        // Objects with fewer valid disparities than this are not measured.
+        int MinValidPixels = 16;
+
+        // Whether frames, boxes and masks are straight from the cameras
+        // (at the calibrated size) rather than undistorted. The distortion
+        // is then removed along with the rectification, and only around the
+        // objects.
+        bool bRawFrames = false;
+    };
+
+public:
+    /// Sets up the rectification maps from a stereo calibration.
+    /// \param[in] calib The calibration to rectify and reproject with.
+    /// \param[in] settings The settings for stereo matching.
+    DepthEstimator(const Calibration& calib, Settings settings);
+
+    /// Measures every object in a pair of frames.
+    /// \param[in] left The left frame, undistorted unless bRawFrames is set.
+    /// \param[in] right The right frame, undistorted unless bRawFrames is set.
+    /// \param[in] boxes The objects' boxes in the left frame.
+    /// \param[in] mask The left foreground mask. If empty, every pixel in a
+    ///                 box is used.
+    /// \returns The measurements of the objects that could be measured.
+    std::vector<ObjectDepth> Estimate(const cv::Mat& left, const cv::Mat& right,
+                                      const std::vector<cv::Rect>& boxes, const cv::Mat& mask) const;
+
+public:
+    /// Settings for the DepthEstimator.
+    Settings Config;
+
+private:
+    cv::Mat _K[2], _D[2], _R[2], _P[2], _Q;
+    cv::Mat _maps[2][2];
+    cv::Size _image_size;
+};
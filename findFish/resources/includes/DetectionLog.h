@@ -0,0 +1,126 @@
+/// \date October 19, 2026
+///
+/// Keeps everything the trackers find, frame by frame, so objects can be
+/// counted again later without decoding any video. Each row is the frame, the
+/// camera and the objects found in it, with their box, area and centroid, in
+/// the undistorted frame whichever way the job undistorted.
+/// Rows are buffered into blocks, and each block is stored a column at a
+/// time: every value is written as the difference from the one before it in
+/// its column, as a zigzag varint. Neighbouring rows mostly describe the same
+/// objects, so the differences are small and most values fit in one byte.
+/// Blocks are only ever appended, and the reader decodes one at a time, so a
+/// log of any length can be streamed through in constant memory.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// One object a tracker found.
+struct Detection
+{
+    cv::Rect Box;
+
+    /// The area inside the object's contour, in pixels.
+    int Area;
+
+    /// The centre of mass of the object's contour.
+    cv::Point Centroid;
+};
+
+/// The objects a camera found in one frame.
+struct DetectionRow
+{
+    int Frame;
+    int Camera;
+    std::vector<Detection> Detections;
+};
+
+static const uint32_t DETECTION_LOG_MAGIC   = 0x4c444647; // "GFDL"
+static const uint32_t DETECTION_BLOCK_MAGIC = 0x42444647; // "GFDB"
+static const uint32_t DETECTION_LOG_VERSION = 1;
+
+/// Appends detections to a log file.
+class DetectionLog
+{
+public:
+    /// Nested wrapper class for settings pertaining to the log.
+    struct Settings
+    {
+        // Rows are buffered and written out this many at a time.
+        int BlockRows = 512;
+    };
+
+public:
+    /// Opens a log to append to, creating it if needed. Throws if the file
+    /// can't be opened, or is something other than a detection log.
+    /// \param[in] file The log file.
+    /// \param[in] settings The settings for the log.
+    DetectionLog(std::string file, Settings settings);
+
+    /// Writes out whatever is still buffered.
+    ~DetectionLog();
+
+    /// Logs the objects a camera found in a frame. Frames without any are
+    /// left out. Can be called from several threads.
+    /// \param[in] frame The frame number.
+    /// \param[in] camera The camera that found them.
+    /// \param[in] contours The contours of the objects.
+    void Add(int frame, int camera, const std::vector<std::vector<cv::Point>>& contours);
+
+    /// Writes out the buffered rows as a block.
+    void Flush();
+
+    /// Returns the size of the log file, not counting buffered rows.
+    uint64_t Size() const;
+
+    /// Cuts the log back to a size returned by Size, and drops any buffered
+    /// rows, so a resumed run doesn't log frames twice.
+    /// \param[in] size The size to cut the log to. 0 empties it.
+    void Truncate(uint64_t size);
+
+public:
+    /// Settings for the DetectionLog.
+    Settings Config;
+
+private:
+    /// Encodes and writes the buffered rows. Must hold _mutex.
+    void WriteBlock();
+
+    /// Opens the file for appending, starting it if it's empty.
+    void Open();
+
+private:
+    std::string _file;
+    std::ofstream _out;
+    uint64_t _size;
+    std::vector<DetectionRow> _rows;
+    mutable std::mutex _mutex;
+};
+
+/// Streams the rows of a detection log, a block at a time.
+class DetectionLogReader
+{
+public:
+    /// Opens a log. Throws if it can't be read or isn't a detection log.
+    /// \param[in] file The log file.
+    DetectionLogReader(std::string file);
+
+    /// Reads the next row, in the order they were logged.
+    /// \param[out] row The row.
+    /// \returns False at the end of the log, or at a block that was cut short.
+    bool Next(DetectionRow& row);
+
+private:
+    /// Decodes the next block into _block.
+    bool ReadBlock();
+
+private:
+    std::ifstream _in;
+    std::vector<DetectionRow> _block;
+    size_t _next;
+};
@@ -0,0 +1,145 @@
+/// \date October 19, 2026
+///
+/// Classifies moving objects with a neural network, run on the CPU through
+/// cv::dnn. Running a network over whole frames is far too slow, so only crops
+/// around the objects that were found are classified. The crops are queued up
+/// into batches, and each batch runs on one of a few worker threads while
+/// processing carries on, each worker with its own copy of the network. The
+/// scores are kept by frame and box, so they can be matched to whichever
+/// track or event the box ends up in.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/dnn.hpp>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class PipelineStats;
+class ThreadPool;
+
+/// The scores a network gave to one object's crop, one per class.
+struct DnnResult
+{
+    cv::Rect Box;
+    std::vector<float> Scores;
+};
+
+/// Classifies object crops in batches with an ONNX model.
+class DnnClassifier
+{
+public:
+    /// Nested wrapper class for settings pertaining to the network.
+    struct Settings
+    {
+        // The ONNX model, and a text file naming its classes one per line.
+        // Classes without a name are called by their index.
+        std::string Model = "config/species.onnx";
+        std::string Labels = "config/species.txt";
+
+        // The size crops are scaled to, as the model expects.
+        cv::Size InputSize = cv::Size(224, 224);
+
+        // How many crops go through the network at once.
+        int BatchSize = 16;
+
+        // How many batches can run at once, each on its own thread.
+        int Threads = 2;
+
+        // Only every this many frames are objects cropped.
+        int SampleInterval = 5;
+
+        // Pixels of context added around each box.
+        int Margin = 8;
+
+        // How pixels are scaled, and whether to swap to RGB, before the
+        // network sees them.
+        double Scale = 1.0 / 255.0;
+        bool bSwapRB = true;
+    };
+
+public:
+    /// Loads the network and its class names.
+    /// \param[in] settings The settings for the network.
+    DnnClassifier(Settings settings);
+
+    /// Waits for any batches still running.
+    ~DnnClassifier();
+
+    /// Queues crops of the objects in a frame, and starts a batch once there
+    /// are enough of them.
+    /// \param[in] frame The frame number.
+    /// \param[in] img The frame the boxes were found in.
+    /// \param[in] boxes The boxes of the objects.
+    void Add(int frame, const cv::Mat& img, const std::vector<cv::Rect>& boxes);
+
+    /// Runs whatever is queued, and waits for every batch to finish.
+    void Flush();
+
+    /// Averages the scores of every crop taken in a range of frames.
+    /// \param[in] first The first frame.
+    /// \param[in] last The last frame, inclusive.
+    /// \param[out] label The class with the highest average score.
+    /// \param[out] confidence Its average score.
+    /// \returns False if no crops were classified in the range.
+    bool Classify(int first, int last, std::string& label, double& confidence) const;
+
+    /// Averages the scores of the crops of one object.
+    /// \param[in] frames The frames the object was seen in.
+    /// \param[in] boxes The object's box in each of those frames.
+    /// \param[out] label The class with the highest average score.
+    /// \param[out] confidence Its average score.
+    /// \returns False if none of the object's crops were classified.
+    bool Classify(const std::vector<int>& frames, const std::vector<cv::Rect>& boxes,
+                  std::string& label, double& confidence) const;
+
+    /// Writes the scores to a file. Call Flush first to include everything.
+    /// \param[in, out] fs The file to write to.
+    /// \param[in] name The name of the node to write them under.
+    void Save(cv::FileStorage& fs, std::string name) const;
+
+    /// Replaces the scores with ones written by Save.
+    /// \param[in] node The node they were written under.
+    void Load(const cv::FileNode& node);
+
+public:
+    /// Settings for the DnnClassifier.
+    Settings Config;
+
+    /// Optional timings of each batch through the network, and peak depths of
+    /// the crop and batch queues. Left null, nothing is recorded.
+    std::shared_ptr<PipelineStats> Stats;
+
+private:
+    /// An object's crop, waiting for a batch.
+    struct Crop
+    {
+        int Frame;
+        cv::Rect Box;
+        cv::Mat Image;
+    };
+
+    /// Runs a batch through a free copy of the network.
+    void RunBatch(std::vector<Crop> batch);
+
+    /// Starts a batch of the queued crops. Must hold _mutex.
+    void StartBatch();
+
+    /// Averages a set of scores into a label.
+    bool Summarize(const std::vector<const DnnResult*>& results, std::string& label, double& confidence) const;
+
+private:
+    std::vector<std::string> _labels;
+    std::vector<cv::dnn::Net> _nets;
+    std::vector<int> _free_nets;
+    std::unique_ptr<ThreadPool> _pool;
+    std::vector<std::future<void>> _batches;
+
+    std::vector<Crop> _queue;
+    std::map<int, std::vector<DnnResult>> _results;
+    mutable std::mutex _mutex;
+};
@@ -121,6 +121,15 @@ class ActivityEvent : public EventBuilder
   /// \return The running state of the event.
   bool IsActive() const;
 
+  /// Adds extra information to an event that has ended, such as measurements.
+  /// \param[in] key The name of the information.
+  /// \param[in] value The value of the information.
+  void AddInfo(std::string key, std::string value);
+
+  /// Adds an object of extra information to an event that has ended.
+  /// \param[in] info The information, as a built JSON object.
+  void AddInfo(const JSON& info);
+
  private:
    int id_;
 };
\ No newline at end of file
@@ -0,0 +1,129 @@
+/// \date October 19, 2026
+///
+/// A compact binary index of the events found in a video, written next to
+/// DE_<name>.json. It holds a fixed-width record per event, sorted by the
+/// first frame, followed by a section with the boxes of the objects tracked
+/// during each event. The reader memory maps the file, so answering which
+/// events overlap a range of frames is a binary search over the records,
+/// with nothing to parse, however many events the video has.
+
+#pragma once
+
+#include "MultiTracker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// The start of the index file. Every field is little-endian and naturally
+/// aligned, so bump EVENT_INDEX_VERSION whenever the layout changes.
+struct EventIndexHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Count;
+    uint32_t RecordSize;
+
+    /// Where the track section starts in the file, and its size, in bytes.
+    uint64_t TrackOffset;
+    uint64_t TrackSize;
+};
+
+/// One event. Frames are inclusive.
+struct EventIndexRecord
+{
+    int32_t ID;
+    int32_t Start;
+    int32_t End;
+
+    /// The latest End of this and every earlier record, so the first record
+    /// that can overlap a range is found by binary search too.
+    int32_t MaxEnd;
+
+    /// A bit for each camera that saw activity during the event.
+    int32_t Cameras;
+
+    /// The number of objects tracked during the event.
+    int32_t Objects;
+
+    /// The event's row of TH_<name>.jpg, or -1 if it has none.
+    int32_t ThumbnailRow;
+    int32_t Reserved;
+
+    /// Where the event's tracks are, in bytes from the start of the track
+    /// section. Each track is its ID, its number of boxes, then a frame, x,
+    /// y, width and height per box, all as int32.
+    uint64_t TrackOffset;
+    uint64_t TrackSize;
+};
+
+static const uint32_t EVENT_INDEX_MAGIC   = 0x49454647; // "GFEI"
+static const uint32_t EVENT_INDEX_VERSION = 1;
+static_assert(sizeof(EventIndexHeader) == 32, "The event index layout must not change without a new version");
+static_assert(sizeof(EventIndexRecord) == 48, "The event index layout must not change without a new version");
+
+/// Collects events and writes them out as an index.
+class EventIndex
+{
+public:
+    /// Adds an event to the index. Events can be added in any order.
+    /// \param[in] id The ID of the event in DE_<name>.json.
+    /// \param[in] first The first frame of the event.
+    /// \param[in] last The last frame of the event.
+    /// \param[in] cameras A bit for each camera that saw activity during it.
+    /// \param[in] thumbnail_row The event's row of the sprite sheet, or -1.
+    /// \param[in] tracks The objects tracked during the event.
+    void Add(int id, int first, int last, int cameras, int thumbnail_row, const std::vector<ObjectTrack>& tracks);
+
+    /// Writes the index.
+    /// \param[in] file The file to write.
+    /// \returns False if the file could not be written.
+    bool Write(std::string file) const;
+
+    /// Returns the number of events added.
+    size_t Size() const;
+
+private:
+    std::vector<EventIndexRecord> _records;
+    std::vector<int32_t> _tracks;
+};
+
+/// Answers range queries from an index file, without reading it into memory.
+class EventIndexReader
+{
+public:
+    /// Maps an index file. Throws if it can't be opened or isn't an index.
+    /// \param[in] file The file written by EventIndex::Write.
+    EventIndexReader(std::string file);
+
+    /// Unmaps the file.
+    ~EventIndexReader();
+
+    EventIndexReader(const EventIndexReader&) = delete;
+    EventIndexReader& operator=(const EventIndexReader&) = delete;
+
+    /// Returns the number of events in the index.
+    size_t Size() const;
+
+    /// Returns an event, in order of their first frames.
+    /// \param[in] i The index of the event.
+    const EventIndexRecord& Get(size_t i) const;
+
+    /// Finds the events that overlap a range of frames.
+    /// \param[in] first The first frame of the range.
+    /// \param[in] last The last frame of the range, inclusive.
+    /// \returns The overlapping events, in order of their first frames.
+    std::vector<const EventIndexRecord*> Query(int first, int last) const;
+
+    /// Reads back the tracks of an event. Their labels aren't indexed.
+    /// \param[in] record An event from this index.
+    std::vector<ObjectTrack> GetTracks(const EventIndexRecord& record) const;
+
+private:
+    int _fd;
+    size_t _size;
+    const uint8_t* _data;
+    const EventIndexHeader* _header;
+    const EventIndexRecord* _records;
+};
@@ -0,0 +1,106 @@
+/// \date October 19, 2026
+///
+/// Keeps small copies of the frames that show what happened during activity,
+/// while they are still in memory from the processing pass. Each stretch of
+/// consecutive active frames keeps its first frame, its most active frame and
+/// its last frame. Once events are known, each event picks its start, peak
+/// and end from the stretches inside it, and they are tiled into a single
+/// sprite sheet per video, one row per event.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// A shrunken frame, and how active it was.
+struct Thumbnail
+{
+    int Frame = -1;
+    double Activity = 0.0;
+    cv::Mat Image;
+};
+
+/// Collects thumbnails during processing and writes them out as a sprite sheet.
+class EventThumbnails
+{
+public:
+    /// Nested wrapper class for settings pertaining to thumbnails.
+    struct Settings
+    {
+        // Width of each thumbnail, in pixels. The height keeps the frame's
+        // aspect ratio.
+        int Width = 240;
+
+        // JPEG quality of the sprite sheet, from 0 to 100.
+        int Quality = 80;
+    };
+
+    /// The columns of each row in the sprite sheet.
+    enum Column { COLUMN_START, COLUMN_PEAK, COLUMN_END, N_COLUMNS };
+
+public:
+    /// Constructor.
+    /// \param[in] settings The settings for the thumbnails.
+    EventThumbnails(Settings settings);
+
+    /// Offers a processed frame. Frames without activity are ignored, so this
+    /// is cheap outside of events. Safe to call from several threads, in any
+    /// frame order.
+    /// \param[in] frame The frame number.
+    /// \param[in] image The frame as written to the output video.
+    /// \param[in] activity How much activity was in the frame, e.g. the area
+    ///                     of the objects found.
+    void Observe(int frame, const cv::Mat& image, double activity);
+
+    /// Picks the start, peak and end thumbnails of an event, and adds them as
+    /// the next row of the sprite sheet.
+    /// \param[in] first The first frame of the event.
+    /// \param[in] last The last frame of the event.
+    /// \param[out] picks The thumbnails picked, one per column.
+    /// \returns The row they were added as, or -1 if nothing was kept for the
+    ///          event.
+    int AddRow(int first, int last, Thumbnail picks[N_COLUMNS]);
+
+    /// Tiles every row added into one JPEG.
+    /// \param[in] file The file to write to.
+    /// \returns False if there were no rows, or the file couldn't be written.
+    bool WriteSheet(std::string file) const;
+
+    /// Returns the size of each thumbnail in the sprite sheet.
+    cv::Size GetThumbnailSize() const;
+
+    /// Writes the stretches kept so far to a file, with their thumbnails.
+    /// \param[in, out] fs The file to write to.
+    /// \param[in] name The name of the node to write them under.
+    void Save(cv::FileStorage& fs, std::string name) const;
+
+    /// Replaces the stretches with ones written by Save.
+    /// \param[in] node The node they were written under.
+    void Load(const cv::FileNode& node);
+
+public:
+    /// Settings for the EventThumbnails.
+    Settings Config;
+
+private:
+    /// A stretch of consecutive frames with activity.
+    struct Run
+    {
+        int First, Last;
+        Thumbnail Picks[N_COLUMNS];
+    };
+
+    /// Shrinks a frame to thumbnail size.
+    Thumbnail Shrink(int frame, const cv::Mat& image, double activity);
+
+private:
+    std::map<int, Run> _runs;
+    std::map<int, int> _open;
+    std::vector<std::vector<cv::Mat>> _rows;
+    cv::Size _size;
+
+    mutable std::mutex _mutex;
+};
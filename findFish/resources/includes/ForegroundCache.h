@@ -0,0 +1,123 @@
+/// \date October 19, 2026
+///
+/// Saves what the background subtractor sees in every frame, so the rest of
+/// the tracker (morphology, thresholding, contours and activity) can be run
+/// again with other settings without decoding or subtracting anything. Each
+/// frame's foreground is scaled down, quantized to a few levels and stored
+/// as a PNG, which compresses the mostly empty masks down to almost nothing.
+/// Records are only ever appended, and the reader hands them back in frame
+/// order. The header says whether the masks are of the raw frames, as they
+/// are when a job undistorts points instead of frames, so a replay can move
+/// them into the undistorted frame first.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+static const uint32_t FOREGROUND_CACHE_MAGIC   = 0x47464647; // "GFFG"
+static const uint32_t FOREGROUND_CACHE_VERSION = 1;
+
+/// Appends the foreground of each frame to a cache file.
+class ForegroundCache
+{
+public:
+    /// Nested wrapper class for settings pertaining to the cache.
+    struct Settings
+    {
+        // How much the foreground is scaled down by.
+        double Scale = 0.25;
+
+        // How many grey levels are kept.
+        int Levels = 16;
+
+        // PNG compression, from 0 (fastest) to 9 (smallest).
+        int Compression = 1;
+
+        // Whether the foregrounds are of the raw frames, before they were
+        // undistorted.
+        bool bRawFrames = false;
+    };
+
+public:
+    /// Opens a cache to append to, creating it if needed. Throws if the file
+    /// can't be opened, or is something other than a foreground cache.
+    /// \param[in] file The cache file.
+    /// \param[in] settings The settings for the cache. An existing cache
+    ///                     keeps its own scale and levels, but is started
+    ///                     over if it was of the other kind of frames.
+    ForegroundCache(std::string file, Settings settings);
+
+    /// Adds the foreground of a frame. Can be called from several threads.
+    /// \param[in] frame The frame number.
+    /// \param[in] camera The camera it came from.
+    /// \param[in] foreground The background subtractor's output.
+    void Add(int frame, int camera, const cv::Mat& foreground);
+
+    /// Writes out anything the file is still buffering.
+    void Flush();
+
+    /// Returns the size of the cache file, once flushed.
+    uint64_t Size() const;
+
+    /// Cuts the cache back to a size returned by Size, so a resumed run
+    /// doesn't cache frames twice.
+    /// \param[in] size The size to cut the cache to. 0 empties it.
+    void Truncate(uint64_t size);
+
+public:
+    /// Settings for the ForegroundCache.
+    Settings Config;
+
+private:
+    /// Opens the file for appending, starting it if it's empty.
+    void Open();
+
+private:
+    std::string _file;
+    std::ofstream _out;
+    uint64_t _size;
+    mutable std::mutex _mutex;
+};
+
+/// Reads a foreground cache back, a frame at a time.
+class ForegroundCacheReader
+{
+public:
+    /// Opens a cache and finds every record in it. Throws if it can't be read
+    /// or isn't a foreground cache.
+    /// \param[in] file The cache file.
+    ForegroundCacheReader(std::string file);
+
+    /// Reads the next foreground, in order of frame then camera. A frame
+    /// cached twice gives the last copy.
+    /// \param[out] frame The frame number.
+    /// \param[out] camera The camera it came from.
+    /// \param[out] foreground The foreground, at the cache's scale.
+    /// \returns False once every record has been read.
+    bool Next(int& frame, int& camera, cv::Mat& foreground);
+
+    /// Returns how much the foregrounds were scaled down by.
+    double GetScale() const;
+
+    /// Returns whether the foregrounds are of the raw, distorted frames.
+    bool IsRaw() const;
+
+    /// Returns the number of foregrounds in the cache.
+    size_t Size() const;
+
+private:
+    std::ifstream _in;
+    double _scale;
+    int _levels;
+    bool _bRaw;
+
+    /// Where each frame and camera's record is in the file.
+    std::map<std::pair<int, int>, std::streamoff> _records;
+    std::map<std::pair<int, int>, std::streamoff>::const_iterator _next;
+};
@@ -44,6 +44,11 @@ class JSON
    /// \parampin] Value The value associated with the key.
    void AddKeyValue(std::string Key, std::string Value);
 
+   /// Creates a new key with an array of values, and appends it to the object.
+   /// \param[in] Key The value of the key.
+   /// \param[in] Values The values in the array, in order.
+   void AddKeyArray(std::string Key, std::vector<std::string> Values);
+
    /// Adds a premade JSON Object to this JSON.
    /// \param[in, out] obj The JSON object to be appended.
    void AddObject(JSON& obj);
@@ -75,6 +80,7 @@ class JSON
     std::string _json_string;
     std::string _name;
     std::map<std::string, std::string> _key_val_pairs;
+    std::map<std::string, std::vector<std::string>> _key_arrays;
     std::vector<JSON> _subobjects;
 };
 
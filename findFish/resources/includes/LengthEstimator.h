@@ -0,0 +1,92 @@
+/// \date October 19, 2026
+///
+/// Measures fish lengths from the contours the trackers find in each camera.
+/// Each object in the left view is paired with the object in the right view
+/// whose ends best fall on the epipolar lines of its own ends. The paired
+/// ends are collected frame by frame, and triangulated in one batch when the
+/// lengths of an event are asked for.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <mutex>
+#include <vector>
+
+class Calibration;
+
+/// The two ends of an object as seen by both cameras. Which end is the head
+/// isn't known, and doesn't matter for its length.
+struct ContourMatch
+{
+    cv::Point2f Head[2];
+    cv::Point2f Tail[2];
+
+    /// The mean distance of the right ends from their epipolar lines, in px.
+    double Error = 0.0;
+};
+
+/// Pairs contours across a stereo rig, and triangulates their lengths.
+class LengthEstimator
+{
+public:
+    /// Nested wrapper class for settings pertaining to contour matching.
+    struct Settings
+    {
+        // Matches whose ends are further than this from their epipolar lines
+        // are rejected, in pixels.
+        double MaxEpipolarError = 4.0;
+
+        // Contours with a smaller area are ignored.
+        double MinArea = 64.0;
+    };
+
+    using Contours = std::vector<std::vector<cv::Point>>;
+
+public:
+    /// Reads the epipolar geometry and rectification from a calibration.
+    /// \param[in] calib The calibration to match and triangulate with.
+    /// \param[in] settings The settings for contour matching.
+    LengthEstimator(const Calibration& calib, Settings settings);
+
+    /// Pairs up the contours of two undistorted views.
+    /// \param[in] left The contours found in the left view.
+    /// \param[in] right The contours found in the right view.
+    /// \returns The ends of every left contour that found a partner.
+    std::vector<ContourMatch> Match(const Contours& left, const Contours& right) const;
+
+    /// Triangulates the ends of the matches, all at once.
+    /// \param[in] matches The matches to measure.
+    /// \returns The length of every match in front of both cameras, in
+    ///          calibration units.
+    std::vector<double> Measure(const std::vector<ContourMatch>& matches) const;
+
+    /// Keeps the matches found in a frame, to be measured later.
+    /// \param[in] frame The frame the matches were found in.
+    /// \param[in] matches The matches.
+    void Add(int frame, const std::vector<ContourMatch>& matches);
+
+    /// Measures every match kept for a range of frames.
+    /// \param[in] first The first frame.
+    /// \param[in] last The last frame, inclusive.
+    /// \returns The lengths, in calibration units.
+    std::vector<double> GetLengths(int first, int last) const;
+
+    /// Writes the kept matches to a file.
+    /// \param[in, out] fs The file to write to.
+    /// \param[in] name The name of the node to write them under.
+    void Save(cv::FileStorage& fs, std::string name) const;
+
+    /// Replaces the kept matches with ones written by Save.
+    /// \param[in] node The node they were written under.
+    void Load(const cv::FileNode& node);
+
+public:
+    /// Settings for the LengthEstimator.
+    Settings Config;
+
+private:
+    cv::Mat _F, _K[2], _R[2], _P[2];
+    std::map<int, std::vector<ContourMatch>> _matches;
+    mutable std::mutex _mutex;
+};
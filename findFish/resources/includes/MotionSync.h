@@ -0,0 +1,81 @@
+/// \date October 19, 2026
+///
+/// Lines videos up by how much moves in them, for when the QR card can't be
+/// found. Every frame is shrunk and compared to the one before it, giving one
+/// number per frame for how much changed. Anything that shakes or swings the
+/// rig shows up in every camera at once, so the offset between two videos is
+/// where those signals correlate best, found with an FFT over a bounded
+/// window of lags.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/// Builds a motion signal per camera, and finds the offsets between them.
+class MotionSync
+{
+public:
+    /// Nested wrapper class for settings pertaining to the sync.
+    struct Settings
+    {
+        // The size frames are shrunk to before they are compared.
+        cv::Size Size = cv::Size(64, 48);
+
+        // The largest offset searched, in frames either way.
+        int MaxLag = 300;
+
+        // How far the best match has to stand out from the best match
+        // elsewhere for an offset to be trusted, from 0 to 1.
+        double MinConfidence = 0.2;
+    };
+
+    /// The offset found between two cameras.
+    struct Result
+    {
+        // Frame f of the first camera is frame f + Offset of the other.
+        int Offset = 0;
+
+        // How much the correlation at the offset stands out from the best
+        // anywhere else, from 0 (not at all) to 1.
+        double Confidence = 0.0;
+    };
+
+public:
+    /// Constructs an empty sync.
+    /// \param[in] settings The settings for the sync.
+    MotionSync(Settings settings);
+
+    /// Adds the next frame of a camera to its signal. Not thread safe.
+    /// \param[in] camera The camera the frame is from.
+    /// \param[in] frame The frame. An empty frame counts as no motion.
+    void Add(int camera, const cv::Mat& frame);
+
+    /// Returns a camera's motion signal, one value per frame added.
+    /// \param[in] camera The camera.
+    const std::vector<float>& GetSignal(int camera) const;
+
+    /// Finds the offset of a camera from the first camera.
+    /// \param[in] camera The camera to line up with camera 0.
+    /// \returns The offset, and how confident it is.
+    Result Estimate(int camera) const;
+
+    /// Finds the lag where two signals correlate best.
+    /// \param[in] first The first signal.
+    /// \param[in] second The second signal.
+    /// \param[in] max_lag The largest lag searched, either way.
+    /// \returns Where second best matches first, and how confident that is.
+    static Result CrossCorrelate(const std::vector<float>& first, const std::vector<float>& second, int max_lag);
+
+    /// Returns true if the result is confident enough to use.
+    /// \param[in] result A result from Estimate.
+    bool IsConfident(const Result& result) const;
+
+public:
+    /// Settings for the MotionSync.
+    Settings Config;
+
+private:
+    std::vector<std::vector<float>> _signals;
+    std::vector<cv::Mat> _previous;
+};
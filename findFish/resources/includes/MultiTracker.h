@@ -0,0 +1,119 @@
+/// \date October 19, 2026
+///
+/// Follows individual objects from frame to frame, so they can be told apart
+/// and counted. The boxes found in each frame are matched to the existing
+/// tracks by how much they overlap each track's predicted box, and by the
+/// distance between their centres. The boxes are bucketed into a spatial hash
+/// grid first, so each track only looks at the boxes near where it is
+/// expected, which keeps matching close to linear in crowded scenes.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+/// The boxes of one object, frame by frame.
+struct ObjectTrack
+{
+    /// Numbered from 1 in the order objects are confirmed. 0 until then.
+    int ID = 0;
+
+    /// What the object was classified as, if anything.
+    std::string Label;
+
+    std::vector<int> Frames;
+    std::vector<cv::Rect> Boxes;
+};
+
+/// Associates boxes across frames into tracks with persistent IDs.
+class MultiTracker
+{
+public:
+    /// Nested wrapper class for settings pertaining to association.
+    struct Settings
+    {
+        // Boxes overlapping a track's predicted box by this much match it.
+        double MinIoU = 0.1;
+
+        // Boxes whose centres are this close to a track's predicted centre
+        // match it even without overlap, in pixels.
+        double MaxDistance = 60.0;
+
+        // Frames a track can go unmatched before it ends.
+        int MaxMissed = 10;
+
+        // Frames a track has to be seen in before it counts as an object.
+        int MinHits = 3;
+
+        // Boxes with a smaller area are ignored.
+        int MinArea = 64;
+
+        // Side of each spatial hash grid cell, in pixels.
+        int CellSize = 64;
+    };
+
+public:
+    /// Constructor.
+    /// \param[in] settings The settings for association.
+    MultiTracker(Settings settings);
+
+    /// Matches the boxes found in a frame to the tracks. Frames have to be
+    /// given in order.
+    /// \param[in] frame The frame number.
+    /// \param[in] boxes The boxes of the objects found in the frame.
+    /// \returns The ID of the track each box joined, or 0 for boxes that
+    ///          aren't confirmed objects yet.
+    std::vector<int> Update(int frame, const std::vector<cv::Rect>& boxes);
+
+    /// Labels a track that is still being followed.
+    /// \param[in] id The track's ID.
+    /// \param[in] label What the object was classified as.
+    void SetLabel(int id, std::string label);
+
+    /// Gets the confirmed tracks seen in a range of frames.
+    /// \param[in] first The first frame.
+    /// \param[in] last The last frame, inclusive.
+    /// \returns The tracks, cut down to the frames in the range.
+    std::vector<ObjectTrack> GetTracks(int first, int last) const;
+
+    /// Adds the tracks of the frames following this tracker's, and joins up
+    /// tracks that cross the boundary between them. IDs from the other
+    /// tracker are renumbered after this one's.
+    /// \param[in] next The tracker that carried on from this one.
+    /// \param[in] boundary The first frame the next tracker was given.
+    void Append(const MultiTracker& next, int boundary);
+
+    /// Writes the tracks to a file.
+    /// \param[in, out] fs The file to write to.
+    /// \param[in] name The name of the node to write them under.
+    void Save(cv::FileStorage& fs, std::string name) const;
+
+    /// Replaces the tracks with ones written by Save.
+    /// \param[in] node The node they were written under.
+    void Load(const cv::FileNode& node);
+
+public:
+    /// Settings for the MultiTracker.
+    Settings Config;
+
+private:
+    /// A track that can still be matched.
+    struct Active
+    {
+        ObjectTrack Track;
+        cv::Point2f Velocity;
+    };
+
+    /// Ends a track, keeping it only if it was confirmed.
+    void Finish(Active& active);
+
+    /// Whether a box is close enough to where a track is expected, and how
+    /// costly the match is if so. Lower is better.
+    bool Score(const cv::Rect& predicted, const cv::Rect& box, double& cost) const;
+
+private:
+    std::vector<Active> _active;
+    std::vector<ObjectTrack> _finished;
+    int _next_id = 1;
+};
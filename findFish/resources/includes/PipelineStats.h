@@ -0,0 +1,153 @@
+/// \date October 19, 2026
+///
+/// Per-stage instrumentation for the video processing pipeline. Every stage
+/// keeps a latency histogram (quarter-octave buckets, so percentiles are good
+/// to within ~20%), along with frame counters and peak queue depths. Recording
+/// only touches atomics, so stages can be timed from any thread, and the
+/// results are written out as a per-job report once processing finishes.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+class JSON;
+
+/// The stages of the processing pipeline that get timed.
+enum PipelineStage
+{
+    STAGE_DECODE,
+    STAGE_SYNC,
+    STAGE_UNDISTORT,
+    STAGE_BACKGROUND,
+    STAGE_MORPHOLOGY,
+    STAGE_CONTOURS,
+    STAGE_CONCATENATE,
+    STAGE_ENCODE,
+    STAGE_DEPTH,
+    STAGE_LENGTH,
+    STAGE_OBJECTS,
+    STAGE_CLASSIFY,
+    STAGE_DNN,
+    N_STAGES
+};
+
+/// A lock-free histogram of latencies.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    /// Adds a sample to the histogram.
+    /// \param[in] seconds The latency to record.
+    void Record(double seconds);
+
+    /// Returns the number of samples recorded.
+    uint64_t Count() const;
+
+    /// Returns the sum of all samples, in seconds.
+    double Total() const;
+
+    /// Returns the largest sample, in seconds.
+    double Max() const;
+
+    /// Estimates a percentile from the histogram buckets.
+    /// \param[in] p The percentile to get, between 0 and 100.
+    /// \returns The estimated latency, in seconds.
+    double Percentile(double p) const;
+
+private:
+    static const int N_BUCKETS = 128;
+
+    std::atomic<uint64_t> _buckets[N_BUCKETS];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _total_ns;
+    std::atomic<uint64_t> _max_ns;
+};
+
+/// Collects stage latencies and frame counts for a single processing job.
+class PipelineStats
+{
+public:
+    /// Times a stage from construction to destruction. A null stats pointer
+    /// turns the timer into a no-op.
+    class Timer
+    {
+    public:
+        Timer(PipelineStats* stats, PipelineStage stage);
+        ~Timer();
+
+    private:
+        PipelineStats* _stats;
+        PipelineStage _stage;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+public:
+    /// Starts the wall clock for the job.
+    PipelineStats();
+
+    /// Returns the printable name of a stage.
+    static const char* StageName(PipelineStage stage);
+
+    /// Records the latency of a single pass through a stage.
+    /// \param[in] stage The stage that was timed.
+    /// \param[in] seconds How long it took.
+    void Record(PipelineStage stage, double seconds);
+
+    /// Counts a frame that made it all the way through the pipeline.
+    void CountFrame();
+
+    /// Counts a frame that was skipped or could not be processed.
+    void CountDroppedFrame();
+
+    /// Records the current depth of a queue, keeping the peak.
+    /// \param[in] queue The name of the queue.
+    /// \param[in] depth The number of items currently in it.
+    void RecordQueueDepth(const std::string& queue, size_t depth);
+
+    /// Returns the latency histogram of a stage.
+    const LatencyHistogram& GetStage(PipelineStage stage) const;
+
+    /// Returns the number of frames processed so far.
+    uint64_t FramesProcessed() const;
+
+    /// Returns the number of frames dropped so far.
+    uint64_t FramesDropped() const;
+
+    /// Returns the time since the stats were created, in seconds.
+    double WallSeconds() const;
+
+    /// Returns the CPU time the process has used since the stats were
+    /// created, in seconds, across every thread.
+    double CpuSeconds() const;
+
+    /// Sets how many cores the job was budgeted, so the report can say how
+    /// much of them it used. 0 leaves it out.
+    /// \param[in] cores The number of cores.
+    void SetThreadBudget(int cores);
+
+    /// Returns the report as a JSON object.
+    JSON GetAsJSON() const;
+
+    /// Prints a short per-stage summary.
+    /// \param[in, out] out The stream to print to.
+    void Print(std::ostream& out) const;
+
+private:
+    LatencyHistogram _stages[N_STAGES];
+    std::atomic<uint64_t> _frames_processed;
+    std::atomic<uint64_t> _frames_dropped;
+    std::atomic<int> _thread_budget;
+
+    mutable std::mutex _queue_mutex;
+    std::map<std::string, size_t> _peak_queue_depths;
+
+    std::chrono::steady_clock::time_point _start;
+    double _cpu_start;
+};
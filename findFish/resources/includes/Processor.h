@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <map>
 #include <string>
 #include <vector>
 #include <memory>
@@ -15,27 +18,197 @@
 namespace cv {
   class Mat;
   class VideoCapture;
+  class VideoWriter;
 }
 class Tracker;
 class JSON;
+class PipelineStats;
+class ProgressReporter;
+class ThreadBudget;
 class Video;
 class Calibration;
+class DepthEstimator;
+class LengthEstimator;
+class EventThumbnails;
+class MultiTracker;
+class DnnClassifier;
+class DetectionLog;
+class ForegroundCache;
 
-/// \brief Goes through two videos to find events and concatenate them together.
+/// \brief Goes through a rig's videos to find events and stitch them together.
 ///
-/// Goes through stereo videos and finds events, and then writes a
-/// concatenated video, as well as a file containing all detected
-/// events from the video.
+/// Syncs the videos from every camera in a rig, finds the events in them,
+/// and writes a mosaic video of the synced, undistorted frames, as well as a
+/// file containing all of the events found. The first two cameras are the
+/// stereo pair that objects are measured with.
 class Processor
 {
+public:
+  /// Nested wrapper class for settings pertaining to long running jobs. Each
+  /// part of a job has its settings in a struct of its own.
+  struct Settings
+  {
+    /// How a job is split up and checkpointed, and shares the machine.
+    struct JobSettings
+    {
+      // How many frames between checkpoints. 0 only checkpoints when stopped.
+      int CheckpointInterval = 900;
+
+      // How many frames to replay into the trackers before a resumed frame,
+      // or before the first frame of a chunk.
+      int WarmupFrames = 50;
+
+      // How many chunks to split a pair into, processed in parallel. 1 goes
+      // through the pair in one pass, and 0 uses a chunk per hardware thread.
+      int Chunks = 1;
+
+      // How many jobs the machine's cores are split between, 0 for one per
+      // cache domain, and whether each job is kept on its own cores.
+      int MaxJobs = 0;
+      bool bPinThreads = false;
+    };
+
+    /// How the videos are lined up.
+    struct SyncSettings
+    {
+      // How many frames of each video to search for the QR card. 0 searches
+      // the whole video.
+      int Frames = 3000;
+
+      // Whether to line the videos up by their motion when the QR card isn't
+      // found in all of them, and to check the card against it when it is.
+      // Offsets are searched up to MotionMaxLag frames either way, and used
+      // if their confidence is at least MotionConfidence.
+      bool bMotion = true;
+      int MotionMaxLag = 300;
+      double MotionConfidence = 0.2;
+    };
+
+    /// The cameras in the rig, and how their frames are undistorted and laid
+    /// out.
+    struct RigSettings
+    {
+      // How many synced videos make up the rig. The first two are the stereo
+      // pair that depth and length are measured on.
+      int Cameras = 2;
+
+      // How many cameras wide the output mosaic is. 0 puts them all in a row.
+      int MosaicColumns = 0;
+
+      // Whether to track objects on the frames as decoded, and undistort only
+      // the points that get measured. Frames are then undistorted just for
+      // the output video. Needs videos at the calibrated resolution.
+      bool bUndistortPoints = false;
+    };
+
+    /// What is measured and kept about each event.
+    struct EventSettings
+    {
+      // Whether to measure the range and size of objects during events. Needs
+      // a stereo calibration that includes Q.
+      bool bEstimateDepth = true;
+
+      // Whether to measure the length of objects both cameras see, from their
+      // contours. Needs a stereo calibration that includes F.
+      bool bMeasureLength = true;
+
+      // Whether to keep thumbnails of the start, peak and end of each event,
+      // written as one sprite sheet per video.
+      bool bThumbnails = true;
+
+      // Whether to follow each object the left camera finds, to count them
+      // and write their tracks into the events.
+      bool bTrackObjects = true;
+    };
+
+    /// The neural network that classifies objects while events are open.
+    struct DnnSettings
+    {
+      // Whether to classify objects, and the network to use. Batches of
+      // BatchSize crops, scaled to InputSize square, run on up to Threads
+      // threads.
+      bool bEnabled = false;
+      std::string Model = "config/species.onnx";
+      std::string Labels = "config/species.txt";
+      int BatchSize = 16;
+      int InputSize = 224;
+      int Threads = 2;
+    };
+
+    /// What is recorded frame by frame, to be gone through again later.
+    struct RecordSettings
+    {
+      // Whether to log every object the trackers find, frame by frame, to
+      // DL_<name>.dlog, so they can be counted again without the video.
+      bool bDetectionLog = false;
+
+      // Whether to cache what the background subtractor sees in every frame
+      // to FG_<name>.fgc, scaled down by ForegroundScale, so thresholds can
+      // be tuned with REPLAY instead of processing the videos again.
+      bool bForegroundCache = false;
+      double ForegroundScale = 0.25;
+    };
+
+    /// How a live stream keeps up.
+    struct StreamSettings
+    {
+      // How far behind a live stream's frames can be analysed, in ms, and
+      // what to do with the frames past that: "drop" them until caught up,
+      // or "subsample" them, leaving out at most MaxStride in a row.
+      double BudgetMs = 200.0;
+      std::string Policy = "drop";
+      int MaxStride = 8;
+    };
+
+    /// Reusing the results of jobs that have been done before.
+    struct ResultCacheSettings
+    {
+      // Whether to keep finished results by what went into them, and answer
+      // a job that has been done before by linking its results back into
+      // place. The least recently used are dropped past Entries jobs.
+      bool bEnabled = true;
+      int Entries = 50;
+    };
+
+    /// Starting from the backgrounds the rig saw last time.
+    struct BackgroundSettings
+    {
+      // The site the rig is deployed at. Each camera's background model is
+      // saved at the end of a job, at Scale of the frame size, and the
+      // site's next job starts from it instead of learning the scene from
+      // scratch. Off unless a site is named, as a background from another
+      // rig would only get in the way.
+      std::string Site = "";
+      double Scale = 0.5;
+    };
+
+    JobSettings Job;
+    SyncSettings Sync;
+    RigSettings Rig;
+    EventSettings Events;
+    DnnSettings Dnn;
+    RecordSettings Record;
+    StreamSettings Stream;
+    ResultCacheSettings Results;
+    BackgroundSettings Background;
+  };
+
 public:
   Processor();
   Processor(std::string, std::string);
+
+  /// Sets up a rig with any number of cameras.
+  /// \param[in] files One synced video per camera, the stereo pair first.
+  Processor(std::vector<std::string> files);
   ~Processor();
 
-  /// Takes two videos and goes through each of them, finding activity events
-  /// and a sync point, before concatenating them together and writing them as
-  /// one video.
+  /// Names everything written after the given name instead of the videos,
+  /// for streams whose paths don't say what they are.
+  /// \param[in] name The name to use.
+  void SetName(std::string name);
+
+  /// Goes through every camera's video, finding a sync point and then the
+  /// activity events, and writes the synced frames out as one mosaic video.
   void ProcessVideos();
 
   /// Reads stereo points from a file and triangulates a real world coordinate
@@ -44,35 +217,238 @@ public:
   /// \param[in] calib_file The file which contains the stereo calibration data.
   void TriangulatePoints(std::string points_file, std::string calib_file);
 
+  /// Reads processor settings from a file. Anything the file leaves out, or
+  /// everything if there is no file, keeps its default.
+  /// \param[in] file The settings file to read.
+  /// \returns The settings read.
+  static Settings ReadSettings(std::string file);
+
+  /// Runs trackers over a foreground cache instead of the videos, from the
+  /// morphology on, so their settings can be tuned in seconds. A cache of
+  /// raw frames is undistorted with calib_config/stereo_calibration.yaml,
+  /// and throws without it.
+  /// \param[in] cache_file A cache written with foreground_cache on.
+  /// \param[in] min_threshold The threshold to segment the foreground with.
+  /// \returns The activity ranges found, merged across the cameras.
+  static std::vector<std::pair<int, int>> Replay(std::string cache_file, int min_threshold);
+
+  /// Asks every running processor that obeys stop requests to stop after the
+  /// frame it is on. Safe to call from a signal handler.
+  static void RequestStop();
+
+  /// Checks whether a stop was requested.
+  /// \returns True if processors should stop.
+  static bool StopRequested();
+
+  /// Asks this processor alone to stop after the frame it is on, by setting
+  /// its own stop flag. Safe to call from any thread.
+  void Cancel();
+
 private:
+  /// A piece of a pair that is processed on its own.
+  struct Chunk
+  {
+    int First = 0;
+    int Last = 0;
+    int Frames = 0;
+    std::string Segment;
+    std::vector<std::unique_ptr<Tracker>> Trackers;
+    std::unique_ptr<MultiTracker> Objects;
+  };
+
+  /// Undistorts a frame from each camera, runs each camera's tracker over
+  /// them, and lays them out in a mosaic. Cameras are analysed in parallel.
+  /// \param[in, out] frames A frame from each camera.
+  /// \param[in, out] trackers The tracker for each camera.
+  /// \param[in, out] objects Where to follow the left camera's objects. May
+  ///                         be null.
+  /// \param[in] frame_num The frame number of the pair.
+  /// \returns The mosaic of undistorted frames.
+  cv::Mat ProcessFrame(std::vector<std::shared_ptr<cv::Mat>>& frames, std::vector<std::unique_ptr<Tracker>>& trackers,
+                       MultiTracker* objects, int frame_num) const;
+
+  /// Splits the rest of the synced videos into chunks, processes them on
+  /// separate threads, then joins the output segments and the events.
+  /// \param[in] file_name Where to write the combined video.
+  /// \param[in] n_chunks How many chunks to split the videos into.
+  /// \returns The number of frames processed.
+  int ProcessChunks(std::string file_name, int n_chunks);
+
+  /// Processes the frames of one chunk into its own segment. The trackers are
+  /// warmed up on the frames just before the chunk first. Video::Seek checks
+  /// where each decoder lands, so the chunk starts on exactly its frame.
+  /// \param[in, out] chunk The chunk to process.
+  /// \param[in] start The synced start frame of each video.
+  /// \param[in, out] done Counts the frames processed by every chunk.
+  void ProcessChunk(Chunk& chunk, const std::vector<int>& start, std::atomic<int>& done) const;
+
+  /// Processes live streams as their frames arrive, until they end or a stop
+  /// is requested. Frames the pipeline can't get to within the latency budget
+  /// aren't analysed, and are recorded in DROP_<name>.json. Each event is
+  /// appended to LIVE_<name>.jsonl as soon as it ends.
+  /// \param[in] file_name Where to write the combined video.
+  /// \returns The number of frames read.
+  int ProcessStream(std::string file_name);
+
+  /// The range and size of the main object in a frame.
+  struct DepthSample
+  {
+    double Range = 0.0;
+    double Width = 0.0;
+    double Height = 0.0;
+  };
+
+  /// Where a job left off, so it can be resumed.
+  struct Checkpoint
+  {
+    int Frame = 0;
+    std::vector<int> Positions;
+  };
+
+  /// Saves the frame position, every video's position, and the events and
+  /// thumbnails found so far, so the job can be resumed from here.
+  /// \param[in] frame_num The number of frames written to the output.
+  void WriteCheckpoint(int frame_num) const;
+
+  /// Reads the checkpoint left by a stopped run, restoring the trackers.
+  /// \param[out] checkpoint Where the stopped run left off.
+  /// \returns True if there was a checkpoint to resume from.
+  bool ReadCheckpoint(Checkpoint& checkpoint);
+
+  /// Brings a new output back up to a checkpoint. Frames the stopped run
+  /// wrote are copied from its partial output, anything it lost is rendered
+  /// again, and the frames just before the checkpoint are replayed into the
+  /// trackers so their background models are warm.
+  /// \param[in, out] writer The new output.
+  /// \param[in] checkpoint Where the stopped run left off.
+  /// \param[in] partial_file The output of the stopped run.
+  void Resume(cv::VideoWriter& writer, const Checkpoint& checkpoint, std::string partial_file);
+
+  /// Works out what the job's results depend on: its videos, the files it
+  /// reads, and the settings that change what it finds.
+  /// \returns The key of the job's results in the cache, or an empty string
+  ///          if the videos couldn't be read.
+  std::string ResultKey() const;
+
+  /// Starts each tracker's background model from the background its camera
+  /// saved at the end of the site's last job, if there is one.
+  /// \param[in, out] trackers The trackers, one per camera.
+  void SeedBackgrounds(std::vector<std::unique_ptr<Tracker>>& trackers) const;
+
+  /// Saves the background each tracker has learnt for the site's next job.
+  /// Trackers that haven't seen a frame are skipped.
+  /// \param[in] trackers The trackers, one per camera.
+  void SaveBackgrounds(const std::vector<std::unique_ptr<Tracker>>& trackers) const;
+
   /// Undistorts the given frame using calibration data for camera at index.
+  /// Cameras the calibration doesn't cover are left as they are.
   /// \param[in, out] frame The frame to undistort.
   /// \param[in] index The camera index to get calibration from.
   void UndistortImage(cv::Mat&, int) const;
 
-  /// Adds all activity events from the tracker into an array.
+  /// Reads the next frame from every video, in parallel.
+  /// \param[in] videos The videos to read from.
+  /// \returns A frame from each video, or an empty vector if any was dropped.
+  std::vector<std::shared_ptr<cv::Mat>> ReadFrames(std::vector<std::unique_ptr<Video>>& videos) const;
+
+  /// Lays a frame from each camera out in the output mosaic.
+  /// \param[in] frames A frame from each camera.
+  /// \returns The mosaic.
+  cv::Mat Mosaic(const std::vector<std::shared_ptr<cv::Mat>>& frames) const;
+
+  /// Checks whether this processor should stop, either because it was
+  /// cancelled or because every processor was asked to and it obeys.
+  bool Stopping() const;
+
+  /// Merges the activity events from every camera's tracker, and adds them
+  /// into an array, along with the median range and size measured during
+  /// each one.
   /// \param[in, out] last_frame The last frame before quitting.
   void AssembleEvents(int&) const;
 
-  /// Goes through each video and looks for a sync point.
-  /// \returns True is both videos found a sync point point. False otherwise.
+  /// Goes through each video and looks for a sync point. The QR card is
+  /// looked for first, and if any video doesn't show it, the videos are lined
+  /// up by their motion over the frames searched instead.
+  /// \returns True if every video found a sync point. False otherwise.
   bool SyncVideos() const;
 
 public:
   bool Success;
 
+  /// Settings for the Processor.
+  Settings Config;
+
+  /// Where to publish live progress. Nothing is published if null.
+  std::shared_ptr<ProgressReporter> Progress;
+
+  /// The process's share of the cores, rebalanced as other jobs come and go.
+  /// Every core is used if null.
+  std::shared_ptr<ThreadBudget> Budget;
+
+  /// Called with the JSON of each event in the events file, once it has been
+  /// written or restored from the result cache. Nothing is called if empty.
+  std::function<void(const std::string&)> OnEvent;
+
+  /// Why the last run failed, or empty if it didn't.
+  std::string Error;
+
+  /// Whether RequestStop stops this processor, as well as Cancel. Jobs run
+  /// through the C API share their process with others, so they turn it off
+  /// and only stop when they are cancelled.
+  bool bObeyStopRequests = true;
+
 private:
-  std::unique_ptr<Video>        _videos[2];
-  std::unique_ptr<Tracker>      _tracker;
+  std::vector<std::unique_ptr<Video>>   _videos;
+  std::vector<std::unique_ptr<Tracker>> _trackers;
   std::shared_ptr<JSON>         _detected_events;
   std::shared_ptr<Calibration>  _calib;
+  std::shared_ptr<PipelineStats> _stats;
+  std::shared_ptr<DepthEstimator> _depth;
+  std::shared_ptr<LengthEstimator> _length;
+  std::shared_ptr<EventThumbnails> _thumbnails;
+  std::shared_ptr<MultiTracker> _objects;
+  std::shared_ptr<DnnClassifier> _dnn;
+  std::shared_ptr<DetectionLog> _detections;
+  std::shared_ptr<ForegroundCache> _foreground;
+  bool _bPointSpace = false;
+
+  mutable std::map<int, DepthSample> _depth_samples;
+  mutable std::mutex _depth_mutex;
+
+  std::atomic<bool> _bCancelled{false};
+
+  static std::atomic<bool> _bStopRequested;
 
 };
 
+/// Joins video segments into one video. The segments are stream copied with
+/// ffmpeg when it is available, and re-encoded otherwise.
+/// \param[in] segments The segments, in order.
+/// \param[in] file_name Where to write the joined video.
+/// \param[in] fourcc The codec to re-encode with.
+/// \param[in] fps The frame rate to re-encode with.
+/// \param[in] width The width of the segments.
+/// \param[in] height The height of the segments.
+void ConcatenateSegments(const std::vector<std::string>& segments, std::string file_name, int fourcc, double fps, int width, int height);
+
+/// Places two frames side by side in a single frame.
+/// \param[in] left_mat The frame to put on the left.
+/// \param[in] right_mat The frame to put on the right.
+/// \returns The concatenated frame, as tall as the taller of the two.
+cv::Mat ConcatenateMatrices(cv::Mat& left_mat, cv::Mat& right_mat);
+
+/// Lays frames out in a grid, left to right then top to bottom.
+/// \param[in] mats The frames, in camera order.
+/// \param[in] columns How many frames go in each row. 0 puts them all in one.
+/// \returns The mosaic. Each row is as tall as its tallest frame, and the
+///          mosaic is as wide as its widest row.
+cv::Mat MosaicMatrices(const std::vector<cv::Mat>& mats, int columns);
+
 class Video
 {
 public:
-  /// Constructs a video from a given file.
+  /// Constructs a video from a given file. A FIFO, or "-" for stdin, is read
+  /// as a live stream, which ends when whatever writes to it stops.
   /// \param[in] file THe files to read from.
   Video(std::string);
 
@@ -83,18 +459,28 @@ public:
   /// until it reads a non-empty frame.
   void Read();
 
+  /// Moves the video to a frame, so that the next read returns it. Where the
+  /// decoder lands is checked, so a backend that only seeks to keyframes is
+  /// decoded forward to the frame instead of starting a few frames out.
+  /// \param[in] frame The frame to move to.
+  void Seek(int);
+
+  /// Returns the path the video was opened from.
+  std::string GetPath() const;
+
   /// Returns a pointer to the current frame. If the frame is null, then the 
   /// video should be done.
   /// \returns Pointer to the current frame read from the video.
   std::shared_ptr<cv::Mat> Get() const;
 
   /// Checks whether the video has ended or not.
-  /// \returns True if the video frames are equal to the total frames, false
-  /// otherwise.
+  /// \returns True if the video frames are equal to the total frames, or a
+  /// live stream has run out, false otherwise.
   bool Ended() const;
 
 public:
   std::string FileName;
+  bool bLive;
   int Frame;
   int TotalFrames;
   int Width;
@@ -104,6 +490,7 @@ public:
 
 private:
   std::string _filepath;
+  bool _bEnded;
   std::shared_ptr<cv::Mat> _frame;
   std::unique_ptr<cv::VideoCapture> _vid_cap;
   mutable std::mutex _mutex;
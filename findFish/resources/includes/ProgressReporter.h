@@ -0,0 +1,121 @@
+/// \date October 19, 2026
+///
+/// Publishes the live progress of a job to a small fixed-layout status file,
+/// which is memory mapped so updates never touch the disk synchronously. The
+/// record is guarded by a sequence lock: the writer bumps the sequence to an
+/// odd number, fills in the fields, then bumps it back to even, so readers in
+/// other processes (the GoFish server polls these files) can detect and retry
+/// a torn read without ever blocking the writer.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/// The stage a job is in, as seen from outside the process.
+enum ProgressStage : int32_t
+{
+    PROGRESS_STARTING,
+    PROGRESS_SYNCING,
+    PROGRESS_PROCESSING,
+    PROGRESS_FINALIZING,
+    PROGRESS_DONE,
+    PROGRESS_FAILED,
+    PROGRESS_STOPPED
+};
+
+/// The layout of the status file. Every field is little-endian and naturally
+/// aligned, and goServer/Progress.go decodes the same offsets, so bump
+/// PROGRESS_VERSION whenever this changes.
+struct ProgressRecord
+{
+    uint32_t Magic;
+    uint32_t Version;
+    std::atomic<uint64_t> Sequence;
+    int32_t  PID;
+    int32_t  Stage;
+    int32_t  Pair;
+    int32_t  TotalPairs;
+    int64_t  Frame;
+    int64_t  TotalFrames;
+    double   FPS;
+    double   ETA;
+    double   UpdatedAt;
+    char     Name[64];
+};
+
+static const uint32_t PROGRESS_MAGIC   = 0x52504646; // "FFPR"
+static const uint32_t PROGRESS_VERSION = 1;
+static_assert(sizeof(ProgressRecord) == 136, "The status file layout is shared with goServer/Progress.go");
+
+/// Writes the progress of a job to a memory mapped status file.
+class ProgressReporter
+{
+public:
+    /// Creates (or truncates) the status file and maps it. If the file cannot
+    /// be created, the reporter prints why and only the Listener is told.
+    /// \param[in] file The status file to write, or empty for none.
+    /// \param[in] interval The minimum number of seconds between frame updates.
+    ProgressReporter(std::string file, double interval = 0.25);
+
+    /// Unmaps the status file. The file is left behind with the final stage.
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    /// Returns the default status file for this process, which the server
+    /// finds by PID.
+    static std::string DefaultFile();
+
+    /// Starts reporting on a new pair of videos.
+    /// \param[in] pair The index of the pair being processed.
+    /// \param[in] total_pairs The number of pairs in this run.
+    /// \param[in] name The name of the pair.
+    void SetPair(int pair, int total_pairs, std::string name);
+
+    /// Moves the job to a new stage, and publishes it straight away.
+    /// \param[in] stage The stage the job is now in.
+    void SetStage(ProgressStage stage);
+
+    /// Records the current frame. This is cheap enough to call every frame;
+    /// it only publishes once per interval.
+    /// \param[in] frame The number of frames processed so far.
+    /// \param[in] total_frames The number of frames this pair will process.
+    void Update(int64_t frame, int64_t total_frames);
+
+    /// Returns true if the status file is mapped.
+    bool IsOpen() const;
+
+public:
+    /// Called with the stage, frames done, total frames and frame rate every
+    /// time they are published, for jobs running in the same process. It
+    /// isn't called once the reporter is being destroyed.
+    std::function<void(ProgressStage, int64_t, int64_t, double)> Listener;
+
+private:
+    /// Writes the current state into the mapped record.
+    void Publish();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::string _file;
+    int _fd;
+    ProgressRecord* _record;
+
+    double _interval;
+    ProgressStage _stage;
+    int _pair;
+    int _total_pairs;
+    std::string _name;
+    int64_t _frame;
+    int64_t _total_frames;
+    double _fps;
+
+    Clock::time_point _last_publish;
+    int64_t _last_frame;
+};
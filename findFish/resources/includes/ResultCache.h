@@ -0,0 +1,83 @@
+/// \date October 19, 2026
+///
+/// Keeps the results of finished jobs by what went into them, so a job that
+/// has already been done (e.g. the same dive uploaded twice) is answered by
+/// linking the results back into place instead of processing the videos
+/// again. A job's key hashes its videos, a few chunks of each, along with the
+/// other files and settings the results depend on. Each key gets a directory
+/// of hard links to the results, so keeping them costs no extra space until
+/// the originals are deleted.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// A local cache of finished results, addressed by their inputs.
+class ResultCache
+{
+public:
+    /// Nested wrapper class for settings pertaining to the cache.
+    struct Settings
+    {
+        // Where results are kept, one directory per key.
+        std::string Dir = "static/result-cache/";
+
+        // How many jobs' results are kept. The least recently used go first.
+        // 0 keeps them all.
+        int MaxEntries = 50;
+
+        // How much of each video is hashed: Chunks pieces of ChunkSize bytes,
+        // spread evenly through the file.
+        size_t ChunkSize = 1 << 20;
+        int Chunks = 16;
+    };
+
+public:
+    /// Constructs a cache.
+    /// \param[in] settings The settings for the cache.
+    ResultCache(Settings settings);
+
+    /// Works out the key of a job from what its results depend on.
+    /// \param[in] videos The job's videos, in camera order.
+    /// \param[in] files Other files the results depend on, hashed whole. A
+    ///                  file that doesn't exist is part of the key too.
+    /// \param[in] settings Everything else the results depend on.
+    /// \returns The key, or an empty string if a video couldn't be read.
+    std::string Key(const std::vector<std::string>& videos, const std::vector<std::string>& files, const std::string& settings) const;
+
+    /// Checks whether results are cached under a key.
+    /// \param[in] key A key from Key.
+    bool Has(const std::string& key) const;
+
+    /// Links the results cached under a key back into place for a job. They
+    /// are renamed from the name of the job that made them to the one asking,
+    /// and JSON files that name the other results are rewritten to match.
+    /// \param[in] key A key from Key.
+    /// \param[in] name The name of the job asking.
+    /// \returns The files put in place, or nothing if the key isn't cached or
+    ///          they couldn't all be put in place.
+    std::vector<std::string> Restore(const std::string& key, const std::string& name) const;
+
+    /// Caches a finished job's results under its key. Results already cached
+    /// under the key are kept as they are.
+    /// \param[in] key A key from Key.
+    /// \param[in] name The job's name, which its results are named after.
+    /// \param[in] files The results. Ones that don't exist are left out.
+    /// \returns True if the results are cached.
+    bool Store(const std::string& key, const std::string& name, const std::vector<std::string>& files) const;
+
+    /// Gives any file that is linked into a cache its own copy of its
+    /// contents, so writing to it in place can't change the cached results.
+    /// \param[in] files The files about to be written to.
+    static void Detach(const std::vector<std::string>& files);
+
+public:
+    /// Settings for the ResultCache.
+    Settings Config;
+
+private:
+    /// Removes the least recently used entries past MaxEntries.
+    /// \param[in] keep The key of an entry that stays, whatever its age.
+    void Evict(const std::string& keep) const;
+};
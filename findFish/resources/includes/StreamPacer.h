@@ -0,0 +1,82 @@
+/// \date October 19, 2026
+///
+/// Keeps a live stream's analysis within a latency budget. Frames arrive at
+/// the stream's frame rate whether or not the pipeline keeps up, so each
+/// frame's lag is how long after its arrival it is reached. Once the lag goes
+/// over the budget, frames are left unanalysed until it comes back under,
+/// either all of them or all but every few, and every frame left out is
+/// recorded.
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Decides which frames of a live stream get analysed.
+class StreamPacer
+{
+public:
+    /// What to do with frames once the budget is overrun.
+    enum class Policy
+    {
+        // Leave out every frame until the lag is back under the budget.
+        DROP,
+
+        // Analyse every few frames, more of them the further behind it is.
+        SUBSAMPLE
+    };
+
+    /// Nested wrapper class for settings pertaining to the pacing.
+    struct Settings
+    {
+        // How far behind a frame can be analysed, in milliseconds.
+        double BudgetMs = 200.0;
+
+        // What to do with frames once they are over the budget.
+        Policy DropPolicy = Policy::DROP;
+
+        // The most frames in a row SUBSAMPLE leaves out.
+        int MaxStride = 8;
+    };
+
+public:
+    /// Constructs a pacer for a stream.
+    /// \param[in] fps The stream's frame rate. 0 assumes 30.
+    /// \param[in] settings The settings for the pacer.
+    StreamPacer(double fps, Settings settings);
+
+    /// Decides whether a frame gets analysed, and records it if not.
+    /// \param[in] frame The frame number, counted from the first frame.
+    /// \param[in] elapsed Seconds since the first frame was read.
+    /// \returns True if the frame should be analysed.
+    bool ShouldAnalyse(int frame, double elapsed);
+
+    /// Returns the frames left out, as ranges of first and last frame.
+    const std::vector<std::pair<int, int>>& GetDropped() const;
+
+    /// Returns the number of frames left out.
+    int DroppedCount() const;
+
+    /// Returns the furthest behind any frame was, in seconds.
+    double MaxLag() const;
+
+    /// Reads a policy from its name, "drop" or "subsample". Throws on
+    /// anything else.
+    /// \param[in] name The name of the policy.
+    static Policy ParsePolicy(std::string name);
+
+    /// Returns the name of a policy.
+    static std::string PolicyName(Policy policy);
+
+public:
+    /// Settings for the StreamPacer.
+    Settings Config;
+
+private:
+    double _fps;
+    int _last_analysed;
+    int _dropped_count;
+    double _max_lag;
+    std::vector<std::pair<int, int>> _dropped;
+};
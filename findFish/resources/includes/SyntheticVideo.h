@@ -0,0 +1,91 @@
+/// \date October 19, 2026
+///
+/// Generates deterministic stereo video pairs for testing the processing
+/// pipeline without real footage. Each camera shows a geo URI QR sync card at
+/// its own frame, followed by a textured scene with fish-like blobs that swim
+/// through it over known frame ranges. The files follow the same
+/// <name>_A / <name>_B naming as uploaded videos, so they can be dropped
+/// straight into the videos directory.
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Renders synthetic stereo videos with known sync points and events.
+class SyntheticVideo
+{
+public:
+    /// A fish that crosses the scene. Frames are counted from the first frame
+    /// after the sync card (the first frame the Processor analyses), and
+    /// positions are fractions of the frame size.
+    struct Fish
+    {
+        int Start;
+        int End;
+        cv::Point2f From;
+        cv::Point2f To;
+        cv::Size2f Size;
+    };
+
+    /// Settings for the generated videos.
+    struct Settings
+    {
+        std::string Name = "synthetic";
+        std::string OutDir = "static/videos/";
+
+        cv::Size Resolution = cv::Size(640, 480);
+        int Frames = 300;
+        int FPS = 30;
+
+        // Standard deviation of the per-frame sensor noise.
+        double Noise = 2.0;
+        unsigned Seed = 1;
+
+        // Frame at which each camera shows the sync card.
+        int SyncFrame[2] = { 10, 25 };
+        std::string GeoURI = "geo:49.2827,-123.1207;site=synthetic";
+
+        // Horizontal shift of the fish in the right camera, in pixels.
+        int Disparity = 16;
+
+        // Leave empty to use a fish every 100 frames.
+        std::vector<Fish> Fishes;
+    };
+
+public:
+    /// Constructs a generator with the given settings.
+    /// \param[in] settings The settings for the generated videos.
+    SyntheticVideo(Settings settings);
+
+    /// Writes both videos of the pair.
+    /// \returns The paths of the left and right videos.
+    std::pair<std::string, std::string> Generate() const;
+
+    /// Returns the frame ranges in which a fish is visible, in the frame
+    /// numbering used by the Processor.
+    std::vector<std::pair<int, int>> GetEvents() const;
+
+    /// Writes an ideal, distortion free stereo calibration matching the
+    /// generated videos.
+    /// \param[in] file The calibration file to write.
+    void WriteCalibration(const std::string& file) const;
+
+    /// Settings for the generated videos.
+    Settings Config;
+
+private:
+    /// Renders a single frame for a camera.
+    /// \param[in] camera The camera index (0 is left, 1 is right).
+    /// \param[in] frame The frame number within that camera's video.
+    /// \param[in] background The static background for that camera.
+    /// \param[in] card The rendered sync card.
+    /// \param[in, out] rng The noise generator for that camera.
+    cv::Mat RenderFrame(int camera, int frame, const cv::Mat& background, const cv::Mat& card, cv::RNG& rng) const;
+
+    /// Renders the QR sync card holding the geo URI.
+    cv::Mat RenderSyncCard() const;
+};
@@ -0,0 +1,107 @@
+/// \date October 19, 2026
+///
+/// Shares the machine's cores out between every findFish job running on it,
+/// so that several jobs don't each run OpenCV on every core. Each job takes a
+/// slot by locking a file in a shared directory, which the kernel unlocks for
+/// it however it exits, and counts the other locked slots to find out how
+/// many jobs it is sharing with. Jobs that find every slot taken lock a job
+/// file instead, so they are still counted, and take a slot once one comes
+/// free. Its share sets OpenCV's thread count. With pinning and more than
+/// one slot, each slot gets its own fixed set of cores, taken from as few
+/// cache (or NUMA) domains as possible, and the job's threads are kept on
+/// them. Jobs without a slot aren't pinned, and the pinned jobs run fewer
+/// threads while they are there.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// A job's share of the machine's cores.
+class ThreadBudget
+{
+public:
+    /// Nested wrapper class for settings pertaining to the budget.
+    struct Settings
+    {
+        // How many jobs the cores are split between when pinning, and how
+        // many slots there are. 0 uses one per cache domain.
+        int MaxJobs = 0;
+
+        // Whether to keep each job on its own set of cores.
+        bool bPinThreads = false;
+
+        // Where the slot files are kept. Every job on the machine has to
+        // use the same directory.
+        std::string SlotDir = "static/slots/";
+    };
+
+public:
+    /// Takes a free slot, if there is one, and works out the job's share.
+    /// \param[in] settings The settings for the budget.
+    ThreadBudget(Settings settings);
+
+    /// Gives the slot back.
+    ~ThreadBudget();
+
+    ThreadBudget(const ThreadBudget&) = delete;
+    ThreadBudget& operator=(const ThreadBudget&) = delete;
+
+    /// Sets OpenCV's thread count to the job's share, and pins the process
+    /// to its cores if pinning is on.
+    void Apply();
+
+    /// Takes a slot if the job has none and one is free, then works the share
+    /// out again from the jobs running now, and applies it if it changed.
+    /// Pinned jobs keep their cores, but not always their thread count. Call
+    /// between frames, never while OpenCV is running anything in parallel.
+    /// \returns True if the share changed.
+    bool Rebalance();
+
+    /// Returns the slot taken, or -1 if every slot was taken.
+    int GetSlot() const;
+
+    /// Returns how many cores the job may use.
+    int GetCores() const;
+
+    /// Returns the cores the job is pinned to, or nothing if it isn't.
+    const std::vector<int>& GetCpus() const;
+
+    /// Counts the jobs running, with or without a slot, this one included.
+    int ActiveJobs() const;
+
+    /// Returns the online CPUs grouped by the last level cache they share,
+    /// or by NUMA node if the caches aren't listed. Every CPU is in exactly
+    /// one group.
+    static std::vector<std::vector<int>> CacheDomains();
+
+    /// Splits CPUs into equal parts, handing them out domain by domain, so a
+    /// part stays inside one domain whenever the split allows it.
+    /// \param[in] domains The CPUs, grouped by domain.
+    /// \param[in] parts How many parts to split them into.
+    /// \param[in] part The part to return.
+    /// \returns The CPUs of that part. Never empty.
+    static std::vector<int> Partition(const std::vector<std::vector<int>>& domains, int parts, int part);
+
+public:
+    /// Settings for the ThreadBudget.
+    Settings Config;
+
+private:
+    /// Locks the first free slot.
+    /// \returns False if every slot was taken.
+    bool TakeSlot();
+
+    /// Works out the job's share from the number of jobs running.
+    void Share();
+
+private:
+    std::vector<std::vector<int>> _domains;
+    int _total;
+    int _slot;
+    int _fd;
+    int _job;
+    int _job_fd;
+    int _cores;
+    std::vector<int> _cpus;
+};
@@ -0,0 +1,77 @@
+/// \date October 19, 2026
+///
+/// A small fixed-size pool of worker threads. Tasks are queued and picked up
+/// by the first free worker, and every submission hands back a future, so the
+/// caller can collect results in the order it submitted them regardless of
+/// the order in which they finish.
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Runs queued tasks on a fixed set of worker threads.
+class ThreadPool
+{
+public:
+    /// Starts the worker threads.
+    /// \param[in] n_threads The number of workers. 0 uses one per hardware thread.
+    explicit ThreadPool(size_t n_threads = 0);
+
+    /// Finishes every queued task, then joins the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Queues a task to be run on one of the workers.
+    /// \param[in] f The callable to run.
+    /// \param[in] args The arguments to call it with.
+    /// \returns A future holding the result (or exception) of the task.
+    template<class F, class... Args>
+    std::future<typename std::result_of<F(Args...)>::type> Enqueue(F&& f, Args&&... args);
+
+    /// Returns the number of worker threads in the pool.
+    size_t Size() const;
+
+    /// Returns the number of tasks waiting for a free worker.
+    size_t Pending() const;
+
+private:
+    /// Pulls tasks off the queue until the pool is stopped and drained.
+    void Worker();
+
+private:
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _tasks;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _bStopping;
+};
+
+template<class F, class... Args>
+std::future<typename std::result_of<F(Args...)>::type> ThreadPool::Enqueue(F&& f, Args&&... args)
+{
+    using Result = typename std::result_of<F(Args...)>::type;
+
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    std::future<Result> result = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_bStopping)
+            throw std::runtime_error("Cannot queue a task on a stopped thread pool!");
+        _tasks.emplace([task]() { (*task)(); });
+    }
+    _condition.notify_one();
+    return result;
+}
@@ -11,6 +11,9 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/objdetect.hpp>
 #include <map>
+#include <memory>
+
+class PipelineStats;
 
 /// Uses background subtraction and thresholding to detect motion in an image.
 class Tracker
@@ -26,6 +29,24 @@ public:
         // Threshold Settings
         int MaxThreshold = 255;
         int MinThreshold = 250;
+
+        // Morphology Settings, for full size frames. The foreground is
+        // blurred with a BlurSize kernel, then closed with a MorphSigma
+        // radius ellipse.
+        int BlurSize = 9;
+        int MorphSigma = 10;
+
+        // Classification Settings. Every cascade in the directory is loaded,
+        // and labels objects with its file name.
+        std::string CascadeDirectory = "config/cascades/";
+        int ClassifyMargin = 16;
+        int ClassifyInterval = 15;
+
+        // Warm start Settings. A background given to SeedBackground is fed
+        // to the model SeedFrames times before the first frame, as long as
+        // the two differ by at most SeedMaxDifference grey levels on average.
+        int SeedFrames = 5;
+        double SeedMaxDifference = 25.0;
     };
 
 public:
@@ -40,6 +61,14 @@ public:
     /// \param[in, out] img The image/frame to be masked.
     void CreateMask(cv::Mat& img);
 
+    /// Thresholds a foreground signal saved from CreateMask, and finds its
+    /// contours, without needing the frame it came from.
+    /// \param[in] foreground The background subtractor's output, possibly
+    ///                       scaled down.
+    /// \param[in] scale How much it was scaled down. Morphology is scaled to
+    ///                  match, and contours are scaled back up to the frame.
+    void ReplayMask(const cv::Mat& foreground, double scale);
+
     /// Finds the contours of all detected objects in a frame.
     /// \param[in, out] img The image/frame for which to detect contours.
     void GetObjectContours(cv::Mat&);
@@ -51,6 +80,62 @@ public:
     /// Gets all cascade classifiers.
     void GetCascades();
 
+    /// Returns whether any cascade classifiers were loaded.
+    bool HasCascades() const;
+
+    /// Labels objects by running the cascades only inside their boxes. Each
+    /// cascade runs on its own thread. Labels are cached by object ID, and
+    /// objects without a label are only tried again every ClassifyInterval
+    /// frames. Boxes without an ID aren't classified.
+    /// \param[in] img The image/frame the boxes were found in.
+    /// \param[in] boxes The boxes of the objects.
+    /// \param[in] ids Persistent IDs of the objects, or 0 where unknown.
+    /// \param[in] frame_num The frame number.
+    /// \returns A label per box, empty where no cascade found anything.
+    std::vector<std::string> Classify(const cv::Mat& img, const std::vector<cv::Rect>& boxes,
+                                      const std::vector<int>& ids, int frame_num);
+
+    /// Returns the bounding boxes of the objects found in the last frame.
+    std::vector<cv::Rect> GetBoundingBoxes() const;
+
+    /// Returns the contours of the objects found in the last frame.
+    const std::vector<std::vector<cv::Point>>& GetContours() const;
+
+    /// Returns whether an activity event is open.
+    bool IsActive() const;
+
+    /// Returns the foreground mask of the last frame.
+    const cv::Mat& GetMask() const;
+
+    /// Returns the background subtractor's output for the last frame, before
+    /// any morphology or thresholding.
+    const cv::Mat& GetForeground() const;
+
+    /// Feeds a frame to the background model without looking for activity,
+    /// to warm the model up.
+    /// \param[in] img The image/frame to learn from.
+    void LearnBackground(cv::Mat& img);
+
+    /// Returns the background the model has learnt, or nothing before the
+    /// first frame.
+    cv::Mat GetBackground() const;
+
+    /// Gives the model a background to start from, such as one saved at the
+    /// end of the last recording from the same camera, so it doesn't have to
+    /// learn the scene from the first frames. It's used on the next frame if
+    /// that looks like the same scene, and dropped otherwise.
+    /// \param[in] background The background, at any size.
+    void SeedBackground(const cv::Mat& background);
+
+    /// Writes the activity events found so far to a file.
+    /// \param[in, out] fs The file to write to.
+    /// \param[in] name The name of the node to write them under.
+    void Save(cv::FileStorage& fs, std::string name) const;
+
+    /// Replaces the activity events with ones written by Save.
+    /// \param[in] node The node they were written under.
+    void Load(const cv::FileNode& node);
+
 public:
     /// Settings for the Tracker.
     Settings Config;
@@ -58,10 +143,36 @@ public:
     /// Container for all activity events detected.
     std::vector<class ActivityEvent*> ActivityRange;
 
+    /// Optional stage timings for background subtraction, morphology, and
+    /// contouring. Left null, nothing is timed.
+    std::shared_ptr<PipelineStats> Stats;
+
 private:
+    /// Cleans up a foreground signal with morphology, and thresholds it into
+    /// the mask.
+    /// \param[in] foreground The background subtractor's output.
+    /// \param[in] scale The size of the foreground relative to a frame.
+    void Segment(const cv::Mat& foreground, double scale);
+
+    /// Feeds the seeded background to the model before its first frame, if
+    /// the frame is of the same scene. The seed is only ever tried once.
+    /// \param[in] frame The first frame.
+    void ApplySeed(const cv::Mat& frame);
+
+private:
+    cv::Mat _foreground;
     cv::Mat _mask;
+    cv::Mat _seed;
     cv::Ptr<cv::BackgroundSubtractor> bkgd_sub_ptr;
-    std::map<int, cv::Ptr<cv::CascadeClassifier>> cascades;
+    std::map<std::string, cv::Ptr<cv::CascadeClassifier>> cascades;
+
+    /// The last label found for each object ID, and when it was looked for.
+    struct CachedLabel
+    {
+        std::string Label;
+        int Frame = 0;
+    };
+    std::map<int, CachedLabel> labels;
     std::vector<std::vector<cv::Point>> contours;
     bool bIsActive;
 };
\ No newline at end of file
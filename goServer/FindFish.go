@@ -0,0 +1,205 @@
+//go:build findfish
+// +build findfish
+
+package main
+
+/*
+#cgo CFLAGS: -I${SRCDIR}/../findFish/api
+#cgo LDFLAGS: -L${SRCDIR}/../findFish/build -lfindfish -Wl,-rpath,${SRCDIR}/../findFish/build
+#include <stdlib.h>
+#include "FindFish.h"
+
+extern void goFindFishProgress(void*, int, int64_t, int64_t, double);
+extern void goFindFishEvent(void*, char*);
+*/
+import "C"
+
+import (
+	"errors"
+	"math"
+	"sync"
+	"time"
+	"unsafe"
+)
+
+///////////////////////////////////////////////////////////////////////////////
+// FindFish
+///////////////////////////////////////////////////////////////////////////////
+
+// Calls findFish in process through the C API in findFish/api/FindFish.h,
+// instead of starting FishFinder and polling the files it writes. Only built
+// with `go build -tags findfish`, once libfindfish has been built.
+
+// ErrFindFishCancelled : What a cancelled job ends with.
+var ErrFindFishCancelled = errors.New("findfish: job cancelled")
+
+// C can't hold on to Go pointers, so each job's callbacks get a key that is
+// looked up here instead.
+var (
+	findFishMutex sync.Mutex
+	findFishJobs  = map[unsafe.Pointer]*FindFishJob{}
+)
+
+// FindFishJob : A job running in the findFish library.
+type FindFishJob struct {
+	job        *C.ff_job
+	key        unsafe.Pointer
+	name       string
+	onProgress func(*Progress)
+	onEvent    func(string)
+}
+
+// SubmitFindFishJob : Starts processing one synced video per camera, the
+// stereo pair first. The callbacks are called from the job's thread, and
+// either may be nil. An empty name names the results after the videos.
+func SubmitFindFishJob(videos []string, name string, onProgress func(*Progress), onEvent func(string)) (*FindFishJob, error) {
+	if len(videos) == 0 {
+		return nil, errors.New("findfish: no videos to process")
+	}
+
+	job := &FindFishJob{key: C.malloc(1), name: name, onProgress: onProgress, onEvent: onEvent}
+	if job.name == "" {
+		job.name = videos[0]
+	}
+
+	// The options are copied by the library, so they can go once submitted.
+	list := C.malloc(C.size_t(len(videos)) * C.size_t(unsafe.Sizeof(uintptr(0))))
+	defer C.free(list)
+	cVideos := (*[1 << 20]*C.char)(list)[:len(videos):len(videos)]
+	for i, video := range videos {
+		cVideos[i] = C.CString(video)
+		defer C.free(unsafe.Pointer(cVideos[i]))
+	}
+
+	var options C.ff_job_options
+	options.videos = (**C.char)(list)
+	options.n_videos = C.size_t(len(videos))
+	if name != "" {
+		options.name = C.CString(name)
+		defer C.free(unsafe.Pointer(options.name))
+	}
+	options.on_progress = C.ff_progress_fn(C.goFindFishProgress)
+	options.on_event = C.ff_event_fn(C.goFindFishEvent)
+	options.user = job.key
+
+	// Callbacks can come before the job is returned.
+	findFishMutex.Lock()
+	findFishJobs[job.key] = job
+	findFishMutex.Unlock()
+
+	job.job = C.ff_job_submit(&options)
+	if job.job == nil {
+		job.release()
+		return nil, errors.New("findfish: out of memory")
+	}
+	return job, nil
+}
+
+// Wait : Waits for the job to finish, and returns why it failed if it did.
+func (job *FindFishJob) Wait() error {
+	status := C.ff_job_wait(job.job)
+	switch status {
+	case C.FF_OK:
+		return nil
+	case C.FF_CANCELLED:
+		return ErrFindFishCancelled
+	}
+	return errors.New("findfish: " + C.GoString(C.ff_job_error(job.job)))
+}
+
+// Cancel : Asks the job to stop after the frame it is on.
+func (job *FindFishJob) Cancel() {
+	C.ff_job_cancel(job.job)
+}
+
+// Close : Waits for the job to finish, then frees it.
+func (job *FindFishJob) Close() {
+	if job.job == nil {
+		return
+	}
+	C.ff_job_free(job.job)
+	job.job = nil
+	job.release()
+}
+
+// release : Stops looking up the job's callbacks.
+func (job *FindFishJob) release() {
+	findFishMutex.Lock()
+	delete(findFishJobs, job.key)
+	findFishMutex.Unlock()
+	C.free(job.key)
+}
+
+// lookupFindFishJob : Finds the job a callback was called for.
+func lookupFindFishJob(key unsafe.Pointer) *FindFishJob {
+	findFishMutex.Lock()
+	defer findFishMutex.Unlock()
+	return findFishJobs[key]
+}
+
+//export goFindFishProgress
+func goFindFishProgress(key unsafe.Pointer, stage C.int, frame, totalFrames C.int64_t, fps C.double) {
+	job := lookupFindFishJob(key)
+	if job == nil || job.onProgress == nil {
+		return
+	}
+
+	p := &Progress{
+		Pair:        0,
+		TotalPairs:  1,
+		Name:        job.name,
+		Frame:       int64(frame),
+		TotalFrames: int64(totalFrames),
+		FPS:         float64(fps),
+		ETA:         -1,
+		UpdatedAt:   time.Now(),
+	}
+	if stage >= 0 && int(stage) < len(ProgressStages) {
+		p.Stage = ProgressStages[stage]
+	}
+	if p.FPS > 0 {
+		p.ETA = math.Max(float64(p.TotalFrames-p.Frame), 0) / p.FPS
+	}
+	job.onProgress(p)
+}
+
+//export goFindFishEvent
+func goFindFishEvent(key unsafe.Pointer, event *C.char) {
+	job := lookupFindFishJob(key)
+	if job == nil || job.onEvent == nil {
+		return
+	}
+	job.onEvent(C.GoString(event))
+}
+
+// Triangulate : Triangulates points marked on the undistorted left and right
+// frames of a processed video into the left camera's coordinates, in mm. An
+// empty calibFile uses stereo_calibration.yaml in calib_config/.
+func Triangulate(calibFile string, left, right [][2]float32) ([][3]float32, error) {
+	if len(left) != len(right) {
+		return nil, errors.New("findfish: both sides need the same number of points")
+	}
+	if len(left) == 0 {
+		return [][3]float32{}, nil
+	}
+
+	var cCalib *C.char
+	if calibFile != "" {
+		cCalib = C.CString(calibFile)
+		defer C.free(unsafe.Pointer(cCalib))
+	}
+
+	xyz := make([][3]float32, len(left))
+	message := make([]byte, 256)
+	status := C.ff_triangulate(cCalib,
+		(*C.float)(unsafe.Pointer(&left[0][0])),
+		(*C.float)(unsafe.Pointer(&right[0][0])),
+		C.size_t(len(left)),
+		(*C.float)(unsafe.Pointer(&xyz[0][0])),
+		(*C.char)(unsafe.Pointer(&message[0])),
+		C.size_t(len(message)))
+	if status != C.FF_OK {
+		return nil, errors.New("findfish: " + C.GoString((*C.char)(unsafe.Pointer(&message[0]))))
+	}
+	return xyz, nil
+}
@@ -0,0 +1,40 @@
+//go:build findfish
+// +build findfish
+
+package main
+
+import (
+	"testing"
+)
+
+func TestFindFish_SubmitBadJob(t *testing.T) {
+	var stages []string
+	job, err := SubmitFindFishJob([]string{"missing_A.mp4"}, "missing", func(p *Progress) {
+		stages = append(stages, p.Stage)
+	}, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer job.Close()
+
+	if err := job.Wait(); err == nil || err == ErrFindFishCancelled {
+		t.Errorf("Expected the job to fail, got %v", err)
+	}
+	if len(stages) == 0 || stages[len(stages)-1] != "failed" {
+		t.Errorf("Expected the last stage to be failed, got %v", stages)
+	}
+}
+
+func TestFindFish_Triangulate(t *testing.T) {
+	if _, err := Triangulate("", [][2]float32{{1, 2}}, nil); err == nil {
+		t.Error("Expected an error for unpaired points")
+	}
+	if _, err := Triangulate("missing_calibration.yaml", [][2]float32{{1, 2}}, [][2]float32{{3, 4}}); err == nil {
+		t.Error("Expected an error without a calibration")
+	}
+
+	xyz, err := Triangulate("", nil, nil)
+	if err != nil || len(xyz) != 0 {
+		t.Errorf("Expected no points, got %v, %v", xyz, err)
+	}
+}
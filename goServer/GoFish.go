@@ -45,6 +45,7 @@ func main() {
 	os.Setenv("calibResultFolder", "81406022555")
 
 	os.Setenv("calib_config", "calib_config/")
+	os.Setenv("progressDir", "static/progress/")
 
 	goFish := &GoFish{NewServer(), NewBox("private_config/box_jwt.json"), ""}
 
@@ -169,6 +170,18 @@ func (goFish *GoFish) ProcessAndUploadVideos(args ...string) {
 										goFish.box.UploadFile("./static/proc_videos/"+file.Name(), file.Name(), os.Getenv("procVidFolder"))
 										os.Remove("./static/proc_videos/" + file.Name())
 										goFish.box.UploadFile("./static/video-info/DE_"+strings.TrimSuffix(file.Name(), ".mp4")+".json", "DE_"+strings.TrimSuffix(file.Name(), ".mp4")+".json", os.Getenv("vidInfoFolder"))
+
+										// Event thumbnails are optional, so only upload them if they were made.
+										thumbnails := "TH_" + strings.TrimSuffix(file.Name(), ".mp4") + ".jpg"
+										if _, err := os.Stat("./static/video-info/" + thumbnails); err == nil {
+											goFish.box.UploadFile("./static/video-info/"+thumbnails, thumbnails, os.Getenv("vidInfoFolder"))
+										}
+
+										// So is the binary event index, which older builds don't write.
+										index := "EI_" + strings.TrimSuffix(file.Name(), ".mp4") + ".idx"
+										if _, err := os.Stat("./static/video-info/" + index); err == nil {
+											goFish.box.UploadFile("./static/video-info/"+index, index, os.Getenv("vidInfoFolder"))
+										}
 									}
 								}
 							}
@@ -215,7 +228,7 @@ func (goFish *GoFish) RunProcess(instr string, args ...string) {
 
 	if cmd.Process != nil {
 		log.Printf("=== Started process %s with PID: %d ===\n", strings.TrimPrefix(instr, "./"), cmd.Process.Pid)
-		goFish.server.AddProcess(&Process{strings.TrimPrefix(instr, "./"), cmd.Process.Pid, "active", time.Now(), time.Time{}})
+		goFish.server.AddProcess(&Process{strings.TrimPrefix(instr, "./"), cmd.Process.Pid, "active", time.Now(), time.Time{}, nil})
 	}
 }
 
@@ -277,11 +290,14 @@ func (goFish *GoFish) HandleVideoHTML(r *http.Request) interface{} {
 				_, err = os.Open("static/video-info/" + "DE_" + strings.TrimSuffix(videoName, ".mp4") + ".json")
 				if err != nil {
 					items, err = goFish.box.GetFolderItems(os.Getenv("vidInfoFolder"), 1000, 0)
-					var infoID string
+					var infoID, thumbnailsID, indexID string
 					for _, v := range items.Entries {
 						if v.Name == "DE_"+strings.TrimSuffix(videoName, ".mp4")+".json" {
 							infoID = v.ID
-							break
+						} else if v.Name == "TH_"+strings.TrimSuffix(videoName, ".mp4")+".jpg" {
+							thumbnailsID = v.ID
+						} else if v.Name == "EI_"+strings.TrimSuffix(videoName, ".mp4")+".idx" {
+							indexID = v.ID
 						}
 					}
 
@@ -290,6 +306,18 @@ func (goFish *GoFish) HandleVideoHTML(r *http.Request) interface{} {
 						log.Println(err)
 						return struct{ VideosLoaded bool }{false}
 					}
+
+					// Older videos have no thumbnails, and the page does without.
+					if thumbnailsID != "" {
+						if err = goFish.box.DownloadFile(thumbnailsID, "static/video-info/"); err != nil {
+							log.Println(err)
+						}
+					}
+					if indexID != "" {
+						if err = goFish.box.DownloadFile(indexID, "static/video-info/"); err != nil {
+							log.Println(err)
+						}
+					}
 				}
 			}
 		}
@@ -0,0 +1,121 @@
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"math"
+	"os"
+	"strconv"
+	"time"
+)
+
+///////////////////////////////////////////////////////////////////////////////
+// Progress
+///////////////////////////////////////////////////////////////////////////////
+
+// The status file written by findFish's ProgressReporter. The offsets must
+// match ProgressRecord in findFish/resources/includes/ProgressReporter.h.
+const (
+	progressMagic   = 0x52504646 // "FFPR"
+	progressVersion = 1
+	progressSize    = 136
+	progressRetries = 10
+)
+
+// ProgressStages : Names for the stages a FishFinder job reports.
+var ProgressStages = []string{"starting", "syncing", "processing", "finalizing", "done", "failed", "stopped"}
+
+// Progress : The live progress of a FishFinder job.
+type Progress struct {
+	Stage       string
+	Pair        int
+	TotalPairs  int
+	Name        string
+	Frame       int64
+	TotalFrames int64
+	FPS         float64
+	ETA         float64
+	UpdatedAt   time.Time
+}
+
+// ProgressFile : Returns the status file a FishFinder process with the given
+// PID publishes its progress to.
+func ProgressFile(pid int) string {
+	dir := os.Getenv("progressDir")
+	if dir == "" {
+		dir = "static/progress/"
+	}
+	return dir + strconv.Itoa(pid) + ".status"
+}
+
+// ReadProgress : Reads a status file. The writer never blocks, so if a write
+// is in progress the read is retried until a consistent copy is seen.
+func ReadProgress(name string) (*Progress, error) {
+	file, err := os.Open(name)
+	if err != nil {
+		return nil, err
+	}
+	defer file.Close()
+
+	seq := make([]byte, 8)
+	record := make([]byte, progressSize)
+	for i := 0; i < progressRetries; i++ {
+		if _, err = file.ReadAt(seq, 8); err != nil {
+			return nil, err
+		}
+		before := binary.LittleEndian.Uint64(seq)
+
+		if _, err = file.ReadAt(record, 0); err != nil {
+			return nil, err
+		}
+
+		if _, err = file.ReadAt(seq, 8); err != nil {
+			return nil, err
+		}
+		after := binary.LittleEndian.Uint64(seq)
+
+		// An odd sequence means a write was in progress.
+		if before == after && before%2 == 0 {
+			return decodeProgress(record)
+		}
+		time.Sleep(time.Millisecond)
+	}
+	return nil, errors.New("progress: status file is being written too often to read")
+}
+
+// decodeProgress : Decodes a status record.
+func decodeProgress(record []byte) (*Progress, error) {
+	le := binary.LittleEndian
+	if le.Uint32(record[0:]) != progressMagic {
+		return nil, errors.New("progress: not a status file")
+	}
+	if le.Uint32(record[4:]) != progressVersion {
+		return nil, errors.New("progress: unsupported status file version")
+	}
+
+	p := &Progress{
+		Pair:        int(int32(le.Uint32(record[24:]))),
+		TotalPairs:  int(int32(le.Uint32(record[28:]))),
+		Frame:       int64(le.Uint64(record[32:])),
+		TotalFrames: int64(le.Uint64(record[40:])),
+		FPS:         math.Float64frombits(le.Uint64(record[48:])),
+		ETA:         math.Float64frombits(le.Uint64(record[56:])),
+	}
+
+	stage := int(int32(le.Uint32(record[20:])))
+	if stage >= 0 && stage < len(ProgressStages) {
+		p.Stage = ProgressStages[stage]
+	}
+
+	updated := math.Float64frombits(le.Uint64(record[64:]))
+	sec, frac := math.Modf(updated)
+	p.UpdatedAt = time.Unix(int64(sec), int64(frac*1e9))
+
+	name := record[72:progressSize]
+	if i := bytes.IndexByte(name, 0); i >= 0 {
+		name = name[:i]
+	}
+	p.Name = string(name)
+	return p, nil
+}
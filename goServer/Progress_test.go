@@ -0,0 +1,67 @@
+package main
+
+import (
+	"encoding/binary"
+	"io/ioutil"
+	"math"
+	"os"
+	"testing"
+)
+
+func writeProgress(t *testing.T, seq uint64) string {
+	record := make([]byte, progressSize)
+	le := binary.LittleEndian
+	le.PutUint32(record[0:], progressMagic)
+	le.PutUint32(record[4:], progressVersion)
+	le.PutUint64(record[8:], seq)
+	le.PutUint32(record[16:], 1234)
+	le.PutUint32(record[20:], 2)
+	le.PutUint32(record[24:], 1)
+	le.PutUint32(record[28:], 3)
+	le.PutUint64(record[32:], 150)
+	le.PutUint64(record[40:], 600)
+	le.PutUint64(record[48:], math.Float64bits(30))
+	le.PutUint64(record[56:], math.Float64bits(15))
+	le.PutUint64(record[64:], math.Float64bits(1571500000.5))
+	copy(record[72:], "2019-10-19-120000_A.mp4")
+
+	file, err := ioutil.TempFile("", "progress")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer file.Close()
+	file.Write(record)
+	return file.Name()
+}
+
+func TestProgress_ReadProgress(t *testing.T) {
+	name := writeProgress(t, 42)
+	defer os.Remove(name)
+
+	p, err := ReadProgress(name)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if p.Stage != "processing" || p.Pair != 1 || p.TotalPairs != 3 ||
+		p.Frame != 150 || p.TotalFrames != 600 || p.FPS != 30 || p.ETA != 15 ||
+		p.Name != "2019-10-19-120000_A.mp4" || p.UpdatedAt.Unix() != 1571500000 {
+		t.Fail()
+	}
+}
+
+func TestProgress_ReadProgressTorn(t *testing.T) {
+	// The writer never finishes, so the read should give up.
+	name := writeProgress(t, 43)
+	defer os.Remove(name)
+
+	if _, err := ReadProgress(name); err == nil {
+		t.Fail()
+	}
+}
+
+func TestProgress_ProgressFile(t *testing.T) {
+	os.Setenv("progressDir", "static/progress/")
+	if ProgressFile(99) != "static/progress/99.status" {
+		t.Fail()
+	}
+}
@@ -220,6 +220,7 @@ type Process struct {
 	Status      string
 	StartTime   time.Time
 	ElapsedTime time.Time
+	Progress    *Progress
 }
 
 // AddProcess : Adds a process to the server's list.
@@ -254,6 +255,9 @@ func (s *Server) GetProcesses() []*Process {
 			err = p.Signal(syscall.Signal(0))
 			if err != nil {
 				v.Status = "dead"
+				os.Remove(ProgressFile(v.ID))
+			} else if progress, err := ReadProgress(ProgressFile(v.ID)); err == nil {
+				v.Progress = progress
 			}
 		}
 	}
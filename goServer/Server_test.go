@@ -25,7 +25,7 @@ func TestServer_(t *testing.T) {
 }
 
 func TestServer_AddProcess(t *testing.T) {
-	server.AddProcess(&Process{"test", 0, "active", time.Now(), time.Now()})
+	server.AddProcess(&Process{"test", 0, "active", time.Now(), time.Now(), nil})
 
 }
 
@@ -134,8 +134,9 @@ function LoadAll()
         eventHandler.events = json.events;
     }
 
-    // Draw events on the scrubber bar.
+    // Draw events on the scrubber bar, and list them by their thumbnails.
     eventHandler.draw();
+    ShowThumbnails(eventHandler.events);
     HandleTools();
     
 }
@@ -239,6 +240,40 @@ function HandleTools()
     });
 }
 
+/** Shows the peak thumbnail of every event, cut out of the video's sprite
+ * sheet, so events can be browsed without seeking through the video.
+ * Clicking a thumbnail seeks to the start of its event.
+ * @param {Event[]} events The events to show.
+ */
+function ShowThumbnails(events)
+{
+    var strip = $("#event-thumbnails");
+    strip.empty();
+    events.forEach(function(event){
+        var t = event.thumbnails;
+        if(t == null)
+            return;
+
+        // Each row of the sheet holds an event's start, peak and end, in that order.
+        $("<div class='event-thumbnail'></div>")
+            .css({
+                "width": t.width + "px",
+                "height": t.height + "px",
+                "background-image": "url('/static/video-info/" + t.sheet + "')",
+                "background-position": (-t.width) + "px " + (-t.row * t.height) + "px"
+            })
+            .attr("title", "Frames " + t.start + " to " + t.end)
+            .on("click", function(){
+                if(videoHandler.video != null)
+                {
+                    videoHandler.video.currentTime = t.start / FRAMERATE;
+                    setTimeout(Redraw, 300);
+                }
+            })
+            .appendTo(strip);
+    });
+}
+
 /** Redraws the main video and scrubber bar canvases. */
 function Redraw()
 {
@@ -181,7 +181,7 @@ class JsonHandler
             function Activity(e){return e["Event_Activity_"+id];}
             var event = this.handle.DetectedEvents.find(Activity) != null ? this.handle.DetectedEvents.find(Activity)["Event_Activity_"+id] : null;
             if(event != null)
-                this.events.push(new Event(event.frame_start / this.video.maxFrame, event.frame_end / this.video.maxFrame));
+                this.events.push(new Event(event.frame_start / this.video.maxFrame, event.frame_end / this.video.maxFrame, event.thumbnails));
         }
     }
 }
@@ -282,11 +282,13 @@ class Event
     /** Constructs an event within a given start and end range.
      * @param {number} start The starting frame of the event.
      * @param {number} end The ending frame of the event.
+     * @param {JSON} thumbnails Where the event is in the thumbnail sprite sheet, if it has one.
      */
-    constructor(start, end)
+    constructor(start, end, thumbnails)
     {
         this.frame_start = start;
         this.frame_end = end;
+        this.thumbnails = thumbnails != null ? thumbnails : null;
         this.colour = "#8054c8";
     }
 
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "FindFish.h"
+
+class FindFishApiTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(FindFishApiTest);
+    CPPUNIT_TEST(TestVersion);
+    CPPUNIT_TEST(TestBadJob);
+    CPPUNIT_TEST(TestProcess);
+    CPPUNIT_TEST(TestCancel);
+    CPPUNIT_TEST(TestTriangulate);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestVersion();
+    void TestBadJob();
+    void TestProcess();
+    void TestCancel();
+    void TestTriangulate();
+
+};
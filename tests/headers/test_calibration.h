@@ -10,6 +10,10 @@ class CalibrationTest : public CppUnit::TestFixture
     CPPUNIT_TEST(TestConstructor);
     CPPUNIT_TEST(TestRunCalibration);
     CPPUNIT_TEST(TestReadCalibration);
+    CPPUNIT_TEST(TestUndistortPoints);
+    CPPUNIT_TEST(TestUndistortBoxes);
+    CPPUNIT_TEST(TestScaledDetection);
+    CPPUNIT_TEST(TestDetectionCache);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -17,8 +21,15 @@ public:
     void TestConstructor();
     void TestRunCalibration();
     void TestReadCalibration();
+    void TestUndistortPoints();
+    void TestUndistortBoxes();
+    void TestScaledDetection();
+    void TestDetectionCache();
     
 private:
     std::unique_ptr<Calibration> _calib;
 
+    // A pair with strong barrel distortion, read from calib_config.
+    std::unique_ptr<Calibration> _distorted;
+
 };
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "ContentHash.h"
+
+class ContentHashTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ContentHashTest);
+    CPPUNIT_TEST(TestHashString);
+    CPPUNIT_TEST(TestHashFile);
+    CPPUNIT_TEST(TestHashFileChunks);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void TestHashString();
+    void TestHashFile();
+    void TestHashFileChunks();
+
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "DepthEstimator.h"
+#include "Calibration.h"
+
+class DepthEstimatorTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(DepthEstimatorTest);
+    CPPUNIT_TEST(TestEstimate);
+    CPPUNIT_TEST(TestNoRectification);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestEstimate();
+    void TestNoRectification();
+
+private:
+    std::unique_ptr<Calibration> _calib;
+
+};
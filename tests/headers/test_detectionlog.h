@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "DetectionLog.h"
+
+class DetectionLogTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(DetectionLogTest);
+    CPPUNIT_TEST(TestRoundTrip);
+    CPPUNIT_TEST(TestAppend);
+    CPPUNIT_TEST(TestTruncate);
+    CPPUNIT_TEST(TestCompact);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void tearDown();
+    void TestRoundTrip();
+    void TestAppend();
+    void TestTruncate();
+    void TestCompact();
+
+};
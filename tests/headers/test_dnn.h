@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "DnnClassifier.h"
+
+class DnnClassifierTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(DnnClassifierTest);
+    CPPUNIT_TEST(TestMissingModel);
+    CPPUNIT_TEST(TestRunBatch);
+    CPPUNIT_TEST(TestClassifyRange);
+    CPPUNIT_TEST(TestSaveLoad);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void TestMissingModel();
+    void TestRunBatch();
+    void TestClassifyRange();
+    void TestSaveLoad();
+
+private:
+    DnnClassifier::Settings _settings;
+    cv::Mat _frame;
+    std::vector<cv::Rect> _boxes;
+
+};
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "EventIndex.h"
+
+class EventIndexTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(EventIndexTest);
+    CPPUNIT_TEST(TestQuery);
+    CPPUNIT_TEST(TestGetTracks);
+    CPPUNIT_TEST(TestNotAnIndex);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void TestQuery();
+    void TestGetTracks();
+    void TestNotAnIndex();
+
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "ForegroundCache.h"
+
+class ForegroundCacheTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ForegroundCacheTest);
+    CPPUNIT_TEST(TestRoundTrip);
+    CPPUNIT_TEST(TestTruncate);
+    CPPUNIT_TEST(TestRawFrames);
+    CPPUNIT_TEST(TestNotACache);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void tearDown();
+    void TestRoundTrip();
+    void TestTruncate();
+    void TestRawFrames();
+    void TestNotACache();
+
+};
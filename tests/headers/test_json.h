@@ -10,6 +10,8 @@ class JSONTest : public CppUnit::TestFixture
     CPPUNIT_TEST(TestConstructors);
     CPPUNIT_TEST(TestAddKeyValue);
     CPPUNIT_TEST(TestAddObject);
+    CPPUNIT_TEST(TestKeyValuesAndObjects);
+    CPPUNIT_TEST(TestKeyArray);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -17,6 +19,8 @@ public:
     void TestConstructors();
     void TestAddKeyValue();
     void TestAddObject();
+    void TestKeyValuesAndObjects();
+    void TestKeyArray();
 
 private:
     std::unique_ptr<JSON> _json;
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "LengthEstimator.h"
+#include "Calibration.h"
+
+class LengthEstimatorTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(LengthEstimatorTest);
+    CPPUNIT_TEST(TestMatch);
+    CPPUNIT_TEST(TestLengths);
+    CPPUNIT_TEST(TestNoFundamental);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestMatch();
+    void TestLengths();
+    void TestNoFundamental();
+
+private:
+    std::unique_ptr<Calibration> _calib;
+
+};
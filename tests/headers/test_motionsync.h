@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "MotionSync.h"
+
+class MotionSyncTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(MotionSyncTest);
+    CPPUNIT_TEST(TestCrossCorrelate);
+    CPPUNIT_TEST(TestNoMotion);
+    CPPUNIT_TEST(TestFrames);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void TestCrossCorrelate();
+    void TestNoMotion();
+    void TestFrames();
+
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "MultiTracker.h"
+
+class MultiTrackerTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(MultiTrackerTest);
+    CPPUNIT_TEST(TestPersistentIDs);
+    CPPUNIT_TEST(TestShortTracksIgnored);
+    CPPUNIT_TEST(TestCrowd);
+    CPPUNIT_TEST(TestAppend);
+    CPPUNIT_TEST(TestSaveLoad);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestPersistentIDs();
+    void TestShortTracksIgnored();
+    void TestCrowd();
+    void TestAppend();
+    void TestSaveLoad();
+
+private:
+    std::unique_ptr<MultiTracker> _tracker;
+
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "PipelineStats.h"
+
+class PipelineStatsTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(PipelineStatsTest);
+    CPPUNIT_TEST(TestPercentiles);
+    CPPUNIT_TEST(TestTimer);
+    CPPUNIT_TEST(TestCounters);
+    CPPUNIT_TEST(TestGetAsJSON);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestPercentiles();
+    void TestTimer();
+    void TestCounters();
+    void TestGetAsJSON();
+
+private:
+    std::unique_ptr<PipelineStats> _stats;
+
+};
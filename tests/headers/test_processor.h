@@ -9,14 +9,26 @@ class ProcessorTest : public CppUnit::TestFixture
     CPPUNIT_TEST_SUITE(ProcessorTest);
     CPPUNIT_TEST(TestConstructor);
     CPPUNIT_TEST(TestProcessVideo);
+    CPPUNIT_TEST(TestPointSpaceLog);
+    CPPUNIT_TEST(TestResume);
+    CPPUNIT_TEST(TestSeek);
     CPPUNIT_TEST(TestTriangulatePoints);
+    CPPUNIT_TEST(TestReadSettings);
+    CPPUNIT_TEST(TestReplay);
+    CPPUNIT_TEST(TestMosaic);
     CPPUNIT_TEST_SUITE_END();
 
 public:
     void setUp();
     void TestConstructor();
     void TestProcessVideo();
+    void TestPointSpaceLog();
+    void TestResume();
+    void TestSeek();
     void TestTriangulatePoints();
+    void TestReadSettings();
+    void TestReplay();
+    void TestMosaic();
     
 private:
     std::unique_ptr<Processor> _proc;
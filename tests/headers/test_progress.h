@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "ProgressReporter.h"
+
+class ProgressReporterTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ProgressReporterTest);
+    CPPUNIT_TEST(TestPublish);
+    CPPUNIT_TEST(TestBadFile);
+    CPPUNIT_TEST(TestListener);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void TestPublish();
+    void TestBadFile();
+    void TestListener();
+
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "ResultCache.h"
+
+class ResultCacheTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ResultCacheTest);
+    CPPUNIT_TEST(TestKey);
+    CPPUNIT_TEST(TestStoreRestore);
+    CPPUNIT_TEST(TestDetach);
+    CPPUNIT_TEST(TestEviction);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void TestKey();
+    void TestStoreRestore();
+    void TestDetach();
+    void TestEviction();
+
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "StreamPacer.h"
+
+class StreamPacerTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StreamPacerTest);
+    CPPUNIT_TEST(TestKeepingUp);
+    CPPUNIT_TEST(TestDrop);
+    CPPUNIT_TEST(TestSubsample);
+    CPPUNIT_TEST(TestParsePolicy);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void TestKeepingUp();
+    void TestDrop();
+    void TestSubsample();
+    void TestParsePolicy();
+
+};
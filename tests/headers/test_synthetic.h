@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "SyntheticVideo.h"
+
+class SyntheticVideoTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(SyntheticVideoTest);
+    CPPUNIT_TEST(TestGenerate);
+    CPPUNIT_TEST(TestGetEvents);
+    CPPUNIT_TEST(TestEndToEnd);
+    CPPUNIT_TEST(TestEndToEndChunked);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestGenerate();
+    void TestGetEvents();
+    void TestEndToEnd();
+    void TestEndToEndChunked();
+
+private:
+    /// Processes a generated pair and checks the events found.
+    void RunEndToEnd(int chunks);
+
+    std::unique_ptr<SyntheticVideo> _generator;
+
+};
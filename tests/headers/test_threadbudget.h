@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "ThreadBudget.h"
+
+class ThreadBudgetTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ThreadBudgetTest);
+    CPPUNIT_TEST(TestCacheDomains);
+    CPPUNIT_TEST(TestPartition);
+    CPPUNIT_TEST(TestSlots);
+    CPPUNIT_TEST(TestMoreJobsThanSlots);
+    CPPUNIT_TEST(TestPinning);
+    CPPUNIT_TEST(TestPinningOneDomain);
+    CPPUNIT_TEST(TestPinningMoreJobsThanSlots);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void tearDown();
+    void TestCacheDomains();
+    void TestPartition();
+    void TestSlots();
+    void TestMoreJobsThanSlots();
+    void TestPinning();
+    void TestPinningOneDomain();
+    void TestPinningMoreJobsThanSlots();
+
+};
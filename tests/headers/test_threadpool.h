@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "ThreadPool.h"
+
+class ThreadPoolTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ThreadPoolTest);
+    CPPUNIT_TEST(TestConstructor);
+    CPPUNIT_TEST(TestEnqueueOrder);
+    CPPUNIT_TEST(TestEnqueueException);
+    CPPUNIT_TEST(TestPending);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestConstructor();
+    void TestEnqueueOrder();
+    void TestEnqueueException();
+    void TestPending();
+
+private:
+    std::unique_ptr<ThreadPool> _pool;
+
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "EventThumbnails.h"
+
+class EventThumbnailsTest : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(EventThumbnailsTest);
+    CPPUNIT_TEST(TestAddRow);
+    CPPUNIT_TEST(TestWriteSheet);
+    CPPUNIT_TEST(TestSaveLoad);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void TestAddRow();
+    void TestWriteSheet();
+    void TestSaveLoad();
+
+private:
+    std::unique_ptr<EventThumbnails> _thumbnails;
+
+};
@@ -11,7 +11,12 @@ class TrackerTest : public CppUnit::TestFixture
     CPPUNIT_TEST(TestCreateMask);
     CPPUNIT_TEST(TestGetObjectContours);
     CPPUNIT_TEST(TestCheckForActivity);
+    CPPUNIT_TEST(TestReplayMask);
     CPPUNIT_TEST(TestGetCascades);
+    CPPUNIT_TEST(TestClassify);
+    CPPUNIT_TEST(TestClassifyCache);
+    CPPUNIT_TEST(TestSaveLoad);
+    CPPUNIT_TEST(TestSeedBackground);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -20,7 +25,12 @@ public:
     void TestCreateMask();
     void TestGetObjectContours();
     void TestCheckForActivity();
+    void TestReplayMask();
     void TestGetCascades();
+    void TestClassify();
+    void TestClassifyCache();
+    void TestSaveLoad();
+    void TestSeedBackground();
     
 private:
     std::unique_ptr<Tracker> _tracker;
@@ -0,0 +1,194 @@
+#include "test_api.h"
+#include "SyntheticVideo.h"
+
+#include <sys/stat.h>
+
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Everything a job's callbacks were called with.
+struct Calls
+{
+    std::mutex Mutex;
+    std::vector<int> Stages;
+    std::vector<std::string> Events;
+};
+
+void RecordProgress(void*, int, int64_t, int64_t, double);
+void RecordEvent(void*, const char*);
+
+void FindFishApiTest::setUp()
+{
+    // Jobs read and write relative to the working directory.
+    for(auto dir : { "static", "static/videos", "static/proc_videos", "static/video-info", "calib_config" })
+        mkdir(dir, 0755);
+}
+
+void FindFishApiTest::TestVersion()
+{
+    CPPUNIT_ASSERT_EQUAL(FINDFISH_API_VERSION, ff_version());
+}
+
+void FindFishApiTest::TestBadJob()
+{
+    // A job with one camera fails without starting, and says why.
+    Calls calls;
+    const char* videos[] = { "static/videos/missing_A.mp4" };
+    ff_job_options options = {};
+    options.videos      = videos;
+    options.n_videos    = 1;
+    options.on_progress = RecordProgress;
+    options.user        = &calls;
+
+    ff_job* job = ff_job_submit(&options);
+    CPPUNIT_ASSERT(job != nullptr);
+    CPPUNIT_ASSERT_EQUAL(int(FF_ERROR), ff_job_wait(job));
+    CPPUNIT_ASSERT(std::string(ff_job_error(job)) != "");
+    CPPUNIT_ASSERT(!calls.Stages.empty());
+    CPPUNIT_ASSERT_EQUAL(int(FF_STAGE_FAILED), calls.Stages.back());
+    ff_job_free(job);
+
+    job = ff_job_submit(nullptr);
+    CPPUNIT_ASSERT_EQUAL(int(FF_ERROR), ff_job_wait(job));
+    ff_job_free(job);
+}
+
+void FindFishApiTest::TestProcess()
+{
+    SyntheticVideo::Settings settings;
+    settings.Name = "api";
+    settings.Resolution = cv::Size(320, 240);
+    settings.Frames = 240;
+    SyntheticVideo generator(settings);
+    auto files = generator.Generate();
+    generator.WriteCalibration("calib_config/stereo_calibration.yaml");
+
+    // Answered from the cache, the job wouldn't process anything.
+    std::remove("static/video-info/DE_api.json");
+    {
+        cv::FileStorage fs("api_test.yaml", cv::FileStorage::WRITE);
+        fs << "chunks" << 1 << "result_cache" << 0;
+    }
+
+    Calls calls;
+    const char* videos[] = { files.first.c_str(), files.second.c_str() };
+    ff_job_options options = {};
+    options.videos      = videos;
+    options.n_videos    = 2;
+    options.name        = "api";
+    options.config_file = "api_test.yaml";
+    options.on_progress = RecordProgress;
+    options.on_event    = RecordEvent;
+    options.user        = &calls;
+
+    ff_job* job = ff_job_submit(&options);
+    CPPUNIT_ASSERT_EQUAL(int(FF_OK), ff_job_wait(job));
+    CPPUNIT_ASSERT_EQUAL(std::string(""), std::string(ff_job_error(job)));
+    ff_job_free(job);
+    std::remove("api_test.yaml");
+
+    CPPUNIT_ASSERT_EQUAL(int(FF_STAGE_STARTING), calls.Stages.front());
+    CPPUNIT_ASSERT_EQUAL(int(FF_STAGE_DONE), calls.Stages.back());
+
+    // Every event written to the file was handed over too.
+    int activities = 0;
+    for(const auto& event : calls.Events)
+    {
+        CPPUNIT_ASSERT(event.front() == '{' && event.back() == '}');
+        activities += event.find("Event_Activity_") != std::string::npos;
+    }
+    CPPUNIT_ASSERT(activities >= (int)generator.GetEvents().size());
+
+    struct stat info;
+    CPPUNIT_ASSERT(stat("static/video-info/DE_api.json", &info) == 0);
+}
+
+void FindFishApiTest::TestCancel()
+{
+    SyntheticVideo::Settings settings;
+    settings.Name = "api_cancel";
+    settings.Resolution = cv::Size(320, 240);
+    settings.Frames = 240;
+    auto files = SyntheticVideo(settings).Generate();
+
+    // Cancelled before it gets going, the job stops before syncing.
+    Calls calls;
+    const char* videos[] = { files.first.c_str(), files.second.c_str() };
+    ff_job_options options = {};
+    options.videos      = videos;
+    options.n_videos    = 2;
+    options.on_progress = RecordProgress;
+    options.user        = &calls;
+
+    // Another job in the same process carries on regardless.
+    ff_job_options other_options = {};
+    other_options.videos   = videos;
+    other_options.n_videos = 2;
+    other_options.name     = "api_other";
+    ff_job* other = ff_job_submit(&other_options);
+
+    ff_job* job = ff_job_submit(&options);
+    ff_job_cancel(job);
+    ff_job_cancel(job);
+    CPPUNIT_ASSERT_EQUAL(int(FF_CANCELLED), ff_job_wait(job));
+    CPPUNIT_ASSERT_EQUAL(int(FF_CANCELLED), ff_job_status(job));
+    CPPUNIT_ASSERT_EQUAL(int(FF_STAGE_STOPPED), calls.Stages.back());
+    ff_job_free(job);
+
+    struct stat info;
+    CPPUNIT_ASSERT(stat("static/video-info/DE_api_cancel.json", &info) != 0);
+
+    CPPUNIT_ASSERT_EQUAL(int(FF_OK), ff_job_wait(other));
+    ff_job_free(other);
+}
+
+void FindFishApiTest::TestTriangulate()
+{
+    SyntheticVideo::Settings settings;
+    settings.Resolution = cv::Size(320, 240);
+    SyntheticVideo(settings).WriteCalibration("calib_config/api_calibration.yaml");
+
+    // The synthetic rig is parallel, 100 mm apart, with f = 256.
+    float world[2][3] = { { 30.f, -20.f, 1000.f }, { -50.f, 10.f, 2500.f } };
+    float left[4], right[4], xyz[6];
+    for(int i = 0; i < 2; i++)
+    {
+        float x = world[i][0], y = world[i][1], z = world[i][2];
+        left[2 * i]      = 256.f * x / z + 160.f;
+        left[2 * i + 1]  = 256.f * y / z + 120.f;
+        right[2 * i]     = 256.f * (x - 100.f) / z + 160.f;
+        right[2 * i + 1] = left[2 * i + 1];
+    }
+
+    char error[256];
+    CPPUNIT_ASSERT_EQUAL(int(FF_OK), ff_triangulate("api_calibration.yaml", left, right, 2, xyz, error, sizeof(error)));
+    for(int i = 0; i < 2; i++)
+        for(int j = 0; j < 3; j++)
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(world[i][j], xyz[3 * i + j], 0.5);
+    std::remove("calib_config/api_calibration.yaml");
+
+    // Without a calibration there is nothing to triangulate with.
+    CPPUNIT_ASSERT_EQUAL(int(FF_ERROR), ff_triangulate("missing_calibration.yaml", left, right, 2, xyz, error, sizeof(error)));
+    CPPUNIT_ASSERT(std::string(error) != "");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper Functions
+///////////////////////////////////////////////////////////////////////////////
+
+void RecordProgress(void* user, int stage, int64_t, int64_t, double)
+{
+    Calls* calls = static_cast<Calls*>(user);
+    std::lock_guard<std::mutex> lock(calls->Mutex);
+    calls->Stages.push_back(stage);
+}
+
+void RecordEvent(void* user, const char* event_json)
+{
+    Calls* calls = static_cast<Calls*>(user);
+    std::lock_guard<std::mutex> lock(calls->Mutex);
+    calls->Events.push_back(event_json);
+}
@@ -1,10 +1,93 @@
 #include "test_calibration.h"
 
+#include <opencv2/imgcodecs.hpp>
+
+#include <cstdio>
+#include <thread>
+
+#include <sys/stat.h>
+
+/// Draws a 19x11 circle grid, 30 px apart, with its first centre at origin.
+static cv::Mat DrawGrid(cv::Point2f origin, std::vector<cv::Point2f>& centers)
+{
+    cv::Mat image(480, 640, CV_8UC1, cv::Scalar(255));
+    centers.clear();
+    for(int i = 0; i < 11; i++)
+        for(int j = 0; j < 19; j++)
+        {
+            cv::Point2f center = origin + cv::Point2f(30.f * j, 30.f * i);
+            centers.push_back(center);
+            // Drawn with 4 fractional bits, so the centres sit between pixels.
+            cv::circle(image, cv::Point(cvRound(center.x * 16), cvRound(center.y * 16)), 8 * 16,
+                       cv::Scalar(0), cv::FILLED, cv::LINE_AA, 4);
+        }
+    return image;
+}
+
+/// Counts the entries in the detection cache for an image.
+static int CountCached(const std::string& file)
+{
+    cv::FileStorage fs("calib_config/detection_cache.yaml", cv::FileStorage::READ);
+    int count = 0;
+    for(auto node : fs["detections"])
+    {
+        std::string cached;
+        node["file"] >> cached;
+        count += cached == file;
+    }
+    return count;
+}
+
+/// Moves every point in the detection cache, so hits can be told apart.
+static void ShiftCached(cv::Point2f offset)
+{
+    std::vector<std::string> keys, files;
+    std::vector<int> found;
+    std::vector<double> seconds;
+    std::vector<std::vector<cv::Point2f>> points;
+    {
+        cv::FileStorage fs("calib_config/detection_cache.yaml", cv::FileStorage::READ);
+        for(auto node : fs["detections"])
+        {
+            keys.emplace_back(); files.emplace_back(); found.emplace_back(); seconds.emplace_back(); points.emplace_back();
+            node["key"] >> keys.back();
+            node["file"] >> files.back();
+            node["found"] >> found.back();
+            node["seconds"] >> seconds.back();
+            node["points"] >> points.back();
+        }
+    }
+
+    cv::FileStorage fs("calib_config/detection_cache.yaml", cv::FileStorage::WRITE);
+    fs << "detections" << "[";
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        for(auto& point : points[i])
+            point += offset;
+        fs << "{" << "key" << keys[i] << "file" << files[i] << "found" << found[i]
+                  << "seconds" << seconds[i] << "points" << points[i] << "}";
+    }
+    fs << "]";
+}
+
 void CalibrationTest::setUp()
 {
     Calibration::Input input;
     input.image_size = cv::Size(1920, 1440);
     _calib = std::make_unique<Calibration>(input, CalibrationType::SINGLE, "stereo_calibration.yaml");
+
+    // A 320x240 pair with strong barrel distortion, for the undistortion tests.
+    mkdir("calib_config", 0755);
+    {
+        cv::Mat K = (cv::Mat_<double>(3, 3) << 256, 0, 160, 0, 256, 120, 0, 0, 1);
+        cv::Mat D = (cv::Mat_<double>(1, 5) << -0.3, 0, 0, 0, 0);
+        cv::FileStorage fs("calib_config/distorted_calibration.yaml", cv::FileStorage::WRITE);
+        fs << "K1" << K << "D1" << D << "K2" << K << "D2" << D;
+        fs << "image_size" << cv::Size(320, 240);
+    }
+    Calibration::Input distorted;
+    _distorted = std::make_unique<Calibration>(distorted, CalibrationType::STEREO, "distorted_calibration.yaml");
+    _distorted->ReadCalibration();
 }
 
 void CalibrationTest::TestConstructor()
@@ -26,4 +109,181 @@ void CalibrationTest::TestReadCalibration()
 {
     _calib->ReadCalibration();
     // Add CPPUNIT ASSERTs here.
-}
\ No newline at end of file
+}
+
+void CalibrationTest::TestUndistortPoints()
+{
+    // A dot near the corner moves when the image is undistorted, and the
+    // point has to land in the same place.
+    cv::Mat image = cv::Mat::zeros(240, 320, CV_8UC1);
+    image(cv::Rect(59, 49, 3, 3)).setTo(cv::Scalar(255));
+    _distorted->UndistortImage(image, 0);
+
+    double sum = 0.0, sum_x = 0.0, sum_y = 0.0;
+    for(int y = 0; y < image.rows; y++)
+        for(int x = 0; x < image.cols; x++)
+        {
+            double value = image.at<unsigned char>(y, x);
+            sum += value; sum_x += value * x; sum_y += value * y;
+        }
+    CPPUNIT_ASSERT(sum > 0);
+
+    std::vector<cv::Point2f> points = { cv::Point2f(60, 50), cv::Point2f(160, 120) };
+    _distorted->UndistortPoints(points, 0);
+    CPPUNIT_ASSERT(cv::norm(points[0] - cv::Point2f(60, 50)) > 2.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(sum_x / sum, points[0].x, 1.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(sum_y / sum, points[0].y, 1.0);
+
+    // Barrel distortion pulls points in, so undistorting pushes them out,
+    // and leaves the centre where it is.
+    CPPUNIT_ASSERT(cv::norm(points[0] - cv::Point2f(160, 120)) > cv::norm(cv::Point2f(60, 50) - cv::Point2f(160, 120)));
+    CPPUNIT_ASSERT(cv::norm(points[1] - cv::Point2f(160, 120)) < 0.01);
+
+    // The second camera has its own results, and there is no third.
+    std::vector<cv::Point2f> second = { cv::Point2f(60, 50) };
+    _distorted->UndistortPoints(second, 1);
+    CPPUNIT_ASSERT(cv::norm(second[0] - points[0]) < 1e-3);
+    CPPUNIT_ASSERT_THROW(_distorted->UndistortPoints(second, 2), std::runtime_error);
+
+    std::vector<cv::Point2f> none;
+    _distorted->UndistortPoints(none, 0);
+    CPPUNIT_ASSERT(none.empty());
+}
+
+void CalibrationTest::TestUndistortBoxes()
+{
+    std::vector<cv::Rect> raw = { cv::Rect(20, 20, 40, 30), cv::Rect(150, 110, 20, 20) };
+    auto boxes = raw;
+    _distorted->UndistortBoxes(boxes, 0);
+    CPPUNIT_ASSERT_EQUAL(raw.size(), boxes.size());
+
+    // Near the corner the box moves out, and still spans where its corners
+    // went.
+    std::vector<cv::Point2f> corners = { cv::Point2f(20, 20), cv::Point2f(59, 49) };
+    _distorted->UndistortPoints(corners, 0);
+    CPPUNIT_ASSERT(cv::norm(corners[0] - cv::Point2f(20, 20)) > 2.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(corners[0].x, boxes[0].x, 1.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(corners[0].y, boxes[0].y, 1.0);
+    CPPUNIT_ASSERT(boxes[0].br().x >= corners[1].x && boxes[0].br().y >= corners[1].y);
+
+    // It is stretched too, since its far corner moves out more than its
+    // near one.
+    CPPUNIT_ASSERT(boxes[0].width > raw[0].width && boxes[0].height > raw[0].height);
+
+    // At the centre there is next to no distortion.
+    CPPUNIT_ASSERT(std::abs(boxes[1].x - raw[1].x) <= 1 && std::abs(boxes[1].y - raw[1].y) <= 1);
+    CPPUNIT_ASSERT(std::abs(boxes[1].width - raw[1].width) <= 1 && std::abs(boxes[1].height - raw[1].height) <= 1);
+
+    // A box along the top edge bows, so its bounds take in the middle of
+    // the edge as well as the corners.
+    std::vector<cv::Rect> edge = { cv::Rect(20, 10, 280, 20) };
+    _distorted->UndistortBoxes(edge, 0);
+    std::vector<cv::Point2f> middle = { cv::Point2f(159.5f, 29) };
+    _distorted->UndistortPoints(middle, 0);
+    CPPUNIT_ASSERT(edge[0].br().y >= middle[0].y);
+
+    std::vector<cv::Rect> none;
+    _distorted->UndistortBoxes(none, 0);
+    CPPUNIT_ASSERT(none.empty());
+}
+
+void CalibrationTest::TestScaledDetection()
+{
+    mkdir("calib_test_grids", 0755);
+    std::vector<cv::Point2f> truth[2];
+    Calibration::Input input;
+    for(int i = 0; i < 2; i++)
+    {
+        std::string file = "calib_test_grids/grid_" + std::to_string(i) + ".png";
+        cv::imwrite(file, DrawGrid(cv::Point2f(53.3f + 10 * i, 91.6f + 5 * i), truth[i]));
+        input.images[0].push_back(file);
+        input.images[1].push_back(file);
+    }
+    input.detect_scale = 0.5f;
+    input.n_threads = 2;
+    input.use_detection_cache = false;
+
+    Calibration calib(input, CalibrationType::SINGLE, "stereo_calibration.yaml");
+    calib.RunCalibration();
+
+    // The size comes from the first image, and the centres found at half
+    // scale are refined back to within a fraction of a pixel.
+    CPPUNIT_ASSERT(calib._input.image_size == cv::Size(640, 480));
+    for(int j = 0; j < 2; j++)
+    {
+        CPPUNIT_ASSERT_EQUAL(size_t(2), calib._input.image_points[j].size());
+        for(int i = 0; i < 2; i++)
+        {
+            const auto& points = calib._input.image_points[j][i];
+            CPPUNIT_ASSERT_EQUAL(truth[i].size(), points.size());
+            for(size_t k = 0; k < points.size(); k++)
+                CPPUNIT_ASSERT(cv::norm(points[k] - truth[i][k]) < 0.25);
+        }
+    }
+}
+
+void CalibrationTest::TestDetectionCache()
+{
+    mkdir("calib_config", 0755);
+    mkdir("calib_test_cache", 0755);
+    std::remove("calib_config/detection_cache.yaml");
+
+    std::string files[2] = { "calib_test_cache/grid_0.png", "calib_test_cache/grid_1.png" };
+    std::vector<cv::Point2f> truth[2];
+    for(int i = 0; i < 2; i++)
+        cv::imwrite(files[i], DrawGrid(cv::Point2f(53.3f + 10 * i, 91.6f), truth[i]));
+
+    // Only one image a side isn't enough to calibrate, but the points are
+    // found (and cached) before that.
+    auto detect = [&](float scale, const std::string* images)
+    {
+        Calibration::Input input;
+        input.images[0].push_back(images[0]);
+        input.images[1].push_back(images[1]);
+        input.detect_scale = scale;
+        Calibration calib(input, CalibrationType::SINGLE, "stereo_calibration.yaml");
+        calib.RunCalibration();
+        CPPUNIT_ASSERT_EQUAL(size_t(1), calib._input.image_points[0].size());
+        return calib._input.image_points[0][0];
+    };
+
+    auto first = detect(1.f, files);
+    CPPUNIT_ASSERT_EQUAL(truth[0].size(), first.size());
+    CPPUNIT_ASSERT(cv::norm(first[0] - truth[0][0]) < 0.25);
+    CPPUNIT_ASSERT_EQUAL(1, CountCached(files[0]));
+    CPPUNIT_ASSERT_EQUAL(1, CountCached(files[1]));
+
+    // The same image and settings are taken from the cache.
+    ShiftCached(cv::Point2f(5, 5));
+    auto hit = detect(1.f, files);
+    CPPUNIT_ASSERT(cv::norm(hit[0] - (first[0] + cv::Point2f(5, 5))) < 1e-3);
+
+    // Detecting at another scale misses, and is cached alongside.
+    auto scaled = detect(0.5f, files);
+    CPPUNIT_ASSERT(cv::norm(scaled[0] - truth[0][0]) < 0.25);
+    CPPUNIT_ASSERT_EQUAL(2, CountCached(files[0]));
+
+    // So does a new image under the same name.
+    cv::imwrite(files[0], DrawGrid(cv::Point2f(58.3f, 101.6f), truth[0]));
+    auto moved = detect(1.f, files);
+    CPPUNIT_ASSERT(cv::norm(moved[0] - truth[0][0]) < 0.25);
+
+    // Entries for images that are gone are dropped.
+    std::remove(files[1].c_str());
+    detect(1.f, files);
+    CPPUNIT_ASSERT_EQUAL(0, CountCached(files[1]));
+    CPPUNIT_ASSERT(CountCached(files[0]) > 0);
+
+    // Calibrations saving the cache side by side keep each other's entries.
+    std::string others[2] = { "calib_test_cache/grid_2.png", "calib_test_cache/grid_3.png" };
+    std::vector<cv::Point2f> centers;
+    for(int i = 0; i < 2; i++)
+        cv::imwrite(others[i], DrawGrid(cv::Point2f(48.3f + 10 * i, 86.6f), centers));
+    int before = CountCached(files[0]);
+    std::thread side([&]() { detect(0.5f, others); });
+    detect(0.75f, files);
+    side.join();
+    CPPUNIT_ASSERT_EQUAL(1, CountCached(others[0]));
+    CPPUNIT_ASSERT_EQUAL(1, CountCached(others[1]));
+    CPPUNIT_ASSERT_EQUAL(before + 1, CountCached(files[0]));
+}
@@ -0,0 +1,67 @@
+#include "test_contenthash.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+void ContentHashTest::TestHashString()
+{
+    // Reference FNV-1a 64-bit values.
+    CPPUNIT_ASSERT_EQUAL(std::string("cbf29ce484222325"), HashToHex(HashString("")));
+    CPPUNIT_ASSERT_EQUAL(std::string("af63dc4c8601ec8c"), HashToHex(HashString("a")));
+
+    // Hashing in pieces gives the same result as hashing all at once.
+    CPPUNIT_ASSERT_EQUAL(HashString("foobar"), HashString("bar", HashString("foo")));
+}
+
+void ContentHashTest::TestHashFile()
+{
+    std::string file = "content_hash_test.txt";
+    {
+        std::ofstream out(file, std::ios::binary);
+        out << "foobar";
+    }
+
+    CPPUNIT_ASSERT_EQUAL(HashToHex(HashString("foobar")), HashFile(file));
+    CPPUNIT_ASSERT_EQUAL(std::string(""), HashFile("does_not_exist.txt"));
+
+    std::remove(file.c_str());
+}
+
+void ContentHashTest::TestHashFileChunks()
+{
+    std::string file = "content_hash_chunks_test.bin";
+    auto write = [&](const std::string& contents)
+    {
+        std::ofstream out(file, std::ios::binary);
+        out << contents;
+    };
+
+    // 4 chunks of 4 bytes over 64 bytes start at 0, 20, 40 and 60.
+    std::string contents(64, 'a');
+    write(contents);
+    std::string hash = HashFileChunks(file, 4, 4);
+    CPPUNIT_ASSERT_EQUAL(size_t(16), hash.size());
+    CPPUNIT_ASSERT_EQUAL(hash, HashFileChunks(file, 4, 4));
+
+    // Bytes between the chunks are skipped, bytes in them are not.
+    contents[10] = 'b';
+    write(contents);
+    CPPUNIT_ASSERT_EQUAL(hash, HashFileChunks(file, 4, 4));
+    contents[41] = 'b';
+    write(contents);
+    CPPUNIT_ASSERT(hash != HashFileChunks(file, 4, 4));
+
+    // The size counts, even when the chunks match.
+    write(std::string(64, 'a') + "a");
+    CPPUNIT_ASSERT(hash != HashFileChunks(file, 4, 4));
+
+    // Small files are hashed whole.
+    write("foobar");
+    std::string small = HashFileChunks(file, 4, 4);
+    write("fooBar");
+    CPPUNIT_ASSERT(small != HashFileChunks(file, 4, 4));
+
+    CPPUNIT_ASSERT_EQUAL(std::string(""), HashFileChunks("does_not_exist.bin"));
+    std::remove(file.c_str());
+}
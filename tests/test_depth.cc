@@ -0,0 +1,55 @@
+#include "test_depth.h"
+#include "SyntheticVideo.h"
+
+#include <sys/stat.h>
+
+void DepthEstimatorTest::setUp()
+{
+    mkdir("calib_config", 0755);
+
+    // An ideal 320x240 rig: f = 256 px, with a baseline of 100.
+    SyntheticVideo::Settings settings;
+    settings.Resolution = cv::Size(320, 240);
+    SyntheticVideo(settings).WriteCalibration("calib_config/depth_calibration.yaml");
+
+    Calibration::Input input;
+    input.image_size = settings.Resolution;
+    _calib = std::make_unique<Calibration>(input, CalibrationType::STEREO, "depth_calibration.yaml");
+    _calib->ReadCalibration();
+}
+
+void DepthEstimatorTest::TestEstimate()
+{
+    cv::RNG rng(1);
+    cv::Mat background(240, 320, CV_8UC3), texture(40, 40, CV_8UC3);
+    rng.fill(background, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+    rng.fill(texture, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+
+    // The object sits 16 px further left in the right camera.
+    cv::Mat left = background.clone(), right = background.clone();
+    cv::Rect box(160, 100, 40, 40);
+    texture.copyTo(left(box));
+    texture.copyTo(right(box - cv::Point(16, 0)));
+
+    cv::Mat mask = cv::Mat::zeros(left.size(), CV_8UC1);
+    mask(box).setTo(cv::Scalar(255));
+
+    DepthEstimator depth(*_calib, DepthEstimator::Settings());
+    auto objects = depth.Estimate(left, right, { box, cv::Rect(0, 0, 4, 4) }, mask);
+
+    // The tiny box is ignored, and the object is f * B / d = 1600 away.
+    CPPUNIT_ASSERT_EQUAL(size_t(1), objects.size());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(1600.0, objects[0].Range, 80.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(40 * 1600.0 / 256, objects[0].Width, 20.0);
+    CPPUNIT_ASSERT(objects[0].ValidPixels > 0);
+}
+
+void DepthEstimatorTest::TestNoRectification()
+{
+    Calibration::Input input;
+    input.image_size = cv::Size(320, 240);
+    Calibration calib(input, CalibrationType::STEREO, "does_not_exist.yaml");
+    calib.ReadCalibration();
+
+    CPPUNIT_ASSERT_THROW(DepthEstimator(calib, DepthEstimator::Settings()), std::runtime_error);
+}
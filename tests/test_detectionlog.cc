@@ -0,0 +1,112 @@
+#include "test_detectionlog.h"
+
+#include <cstdio>
+
+static const char* LOG_FILE = "detection_log_test.dlog";
+
+/// The contour of a square.
+std::vector<cv::Point> Square(int x, int y, int side)
+{
+    return { cv::Point(x, y), cv::Point(x + side, y), cv::Point(x + side, y + side), cv::Point(x, y + side) };
+}
+
+/// Reads every row of the log.
+std::vector<DetectionRow> ReadLog()
+{
+    std::vector<DetectionRow> rows;
+    DetectionLogReader reader(LOG_FILE);
+    for(DetectionRow row; reader.Next(row);)
+        rows.push_back(row);
+    return rows;
+}
+
+void DetectionLogTest::tearDown()
+{
+    std::remove(LOG_FILE);
+}
+
+void DetectionLogTest::TestRoundTrip()
+{
+    DetectionLog::Settings settings;
+    settings.BlockRows = 2;
+    {
+        // Frames without objects are left out, and frames can come out of
+        // order, as they do when chunks run side by side.
+        DetectionLog log(LOG_FILE, settings);
+        log.Add(10, 0, { Square(100, 200, 20), Square(5, 8, 40) });
+        log.Add(10, 1, {});
+        log.Add(11, 1, { Square(90, 210, 22) });
+        log.Add(3, 0, { Square(600, 10, 10) });
+    }
+
+    auto rows = ReadLog();
+    CPPUNIT_ASSERT_EQUAL(size_t(3), rows.size());
+    CPPUNIT_ASSERT_EQUAL(10, rows[0].Frame);
+    CPPUNIT_ASSERT_EQUAL(1, rows[1].Camera);
+    CPPUNIT_ASSERT_EQUAL(3, rows[2].Frame);
+
+    CPPUNIT_ASSERT_EQUAL(size_t(2), rows[0].Detections.size());
+    const Detection& detection = rows[0].Detections[1];
+    CPPUNIT_ASSERT(detection.Box == cv::boundingRect(Square(5, 8, 40)));
+    CPPUNIT_ASSERT_EQUAL(1600, detection.Area);
+    CPPUNIT_ASSERT(detection.Centroid == cv::Point(25, 28));
+    CPPUNIT_ASSERT(rows[2].Detections[0].Box == cv::boundingRect(Square(600, 10, 10)));
+}
+
+void DetectionLogTest::TestAppend()
+{
+    {
+        DetectionLog log(LOG_FILE, DetectionLog::Settings());
+        log.Add(1, 0, { Square(10, 10, 10) });
+    }
+    {
+        DetectionLog log(LOG_FILE, DetectionLog::Settings());
+        log.Add(2, 0, { Square(12, 10, 10) });
+    }
+
+    auto rows = ReadLog();
+    CPPUNIT_ASSERT_EQUAL(size_t(2), rows.size());
+    CPPUNIT_ASSERT_EQUAL(2, rows[1].Frame);
+
+    // Anything else is refused rather than appended to.
+    std::remove(LOG_FILE);
+    std::ofstream(LOG_FILE) << "frame,x,y\n";
+    CPPUNIT_ASSERT_THROW(DetectionLog log(LOG_FILE, DetectionLog::Settings()), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(DetectionLogReader reader(LOG_FILE), std::runtime_error);
+}
+
+void DetectionLogTest::TestTruncate()
+{
+    DetectionLog log(LOG_FILE, DetectionLog::Settings());
+    log.Add(1, 0, { Square(10, 10, 10) });
+    log.Flush();
+    uint64_t checkpoint = log.Size();
+
+    log.Add(2, 0, { Square(12, 10, 10) });
+    log.Flush();
+    log.Add(3, 0, { Square(14, 10, 10) });
+    log.Truncate(checkpoint);
+    log.Add(2, 1, { Square(12, 10, 10) });
+    log.Flush();
+
+    auto rows = ReadLog();
+    CPPUNIT_ASSERT_EQUAL(size_t(2), rows.size());
+    CPPUNIT_ASSERT_EQUAL(1, rows[1].Camera);
+
+    log.Truncate(0);
+    CPPUNIT_ASSERT(ReadLog().empty());
+}
+
+void DetectionLogTest::TestCompact()
+{
+    // A minute of one object drifting across both cameras.
+    {
+        DetectionLog log(LOG_FILE, DetectionLog::Settings());
+        for(int frame = 0; frame < 30 * 60; frame++)
+            for(int camera = 0; camera < 2; camera++)
+                log.Add(frame, camera, { Square(100 + frame / 4, 300 + camera * 20, 40 + frame % 3) });
+        log.Flush();
+        CPPUNIT_ASSERT(log.Size() < 64 * 1024);
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(2 * 30 * 60), ReadLog().size());
+}
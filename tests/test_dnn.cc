@@ -0,0 +1,140 @@
+#include "test_dnn.h"
+#include "PipelineStats.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+/// A model that averages each channel of its 8x8 input, so a crop of one
+/// colour scores its red, green and blue. Written byte for byte, as the
+/// tests have no ONNX tools to build it with.
+static const char MEAN_COLOUR_MODEL[] =
+    "\x08\x07\x3a\x89\x01\x0a\x22\x0a\x05\x69\x6e\x70\x75\x74\x12\x06\x70\x6f\x6f\x6c\x65\x64\x22\x11"
+    "\x47\x6c\x6f\x62\x61\x6c\x41\x76\x65\x72\x61\x67\x65\x50\x6f\x6f\x6c\x0a\x19\x0a\x06\x70\x6f\x6f"
+    "\x6c\x65\x64\x12\x06\x6f\x75\x74\x70\x75\x74\x22\x07\x46\x6c\x61\x74\x74\x65\x6e\x12\x0b\x6d\x65"
+    "\x61\x6e\x5f\x63\x6f\x6c\x6f\x75\x72\x5a\x20\x0a\x05\x69\x6e\x70\x75\x74\x12\x17\x0a\x15\x08\x01"
+    "\x12\x11\x0a\x03\x12\x01\x4e\x0a\x02\x08\x03\x0a\x02\x08\x08\x0a\x02\x08\x08\x62\x19\x0a\x06\x6f"
+    "\x75\x74\x70\x75\x74\x12\x0f\x0a\x0d\x08\x01\x12\x09\x0a\x03\x12\x01\x4e\x0a\x02\x08\x03\x42\x02"
+    "\x10\x0d";
+
+void DnnClassifierTest::setUp()
+{
+    std::ofstream("dnn_test_model.onnx", std::ios::binary).write(MEAN_COLOUR_MODEL, sizeof(MEAN_COLOUR_MODEL) - 1);
+    std::ofstream("dnn_test_labels.txt") << "red\ngreen\nblue\n";
+
+    _settings.Model = "dnn_test_model.onnx";
+    _settings.Labels = "dnn_test_labels.txt";
+    _settings.InputSize = cv::Size(8, 8);
+    _settings.BatchSize = 2;
+    _settings.Threads = 1;
+    _settings.SampleInterval = 1;
+    _settings.Margin = 0;
+
+    // The first box already scores probabilities, the second scores logits.
+    _frame = cv::Mat(40, 80, CV_8UC3, cv::Scalar::all(0));
+    _boxes = { cv::Rect(0, 0, 40, 40), cv::Rect(40, 0, 40, 40) };
+    _frame(_boxes[0]).setTo(cv::Scalar(50, 77, 128));
+    _frame(_boxes[1]).setTo(cv::Scalar(255, 128, 0));
+}
+
+void DnnClassifierTest::tearDown()
+{
+    std::remove("dnn_test_model.onnx");
+    std::remove("dnn_test_labels.txt");
+}
+
+void DnnClassifierTest::TestMissingModel()
+{
+    DnnClassifier::Settings settings;
+    settings.Model = "no_such_model.onnx";
+    CPPUNIT_ASSERT_THROW(DnnClassifier classifier(settings), std::exception);
+}
+
+void DnnClassifierTest::TestRunBatch()
+{
+    DnnClassifier classifier(_settings);
+    classifier.Stats = std::make_shared<PipelineStats>();
+    classifier.Add(0, _frame, _boxes);
+    classifier.Flush();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), classifier.Stats->GetStage(STAGE_DNN).Count());
+
+    // Scores that are already probabilities are kept as they are.
+    std::string label;
+    double confidence = 0.0;
+    CPPUNIT_ASSERT(classifier.Classify({ 0 }, { _boxes[0] }, label, confidence));
+    CPPUNIT_ASSERT_EQUAL(std::string("red"), label);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(128.0 / 255.0, confidence, 1e-4);
+
+    // Logits go through a softmax.
+    double logits[3] = { 0.0, 128.0 / 255.0, 1.0 }, sum = 0.0;
+    for(double logit : logits)
+        sum += std::exp(logit);
+    CPPUNIT_ASSERT(classifier.Classify({ 0 }, { _boxes[1] }, label, confidence));
+    CPPUNIT_ASSERT_EQUAL(std::string("blue"), label);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(std::exp(1.0) / sum, confidence, 1e-4);
+
+    // A box that was never cropped has nothing to go on.
+    CPPUNIT_ASSERT(!classifier.Classify({ 0 }, { cv::Rect(1, 1, 10, 10) }, label, confidence));
+}
+
+void DnnClassifierTest::TestClassifyRange()
+{
+    DnnClassifier classifier(_settings);
+    classifier.Add(0, _frame, { _boxes[0] });
+    classifier.Add(1, _frame, _boxes);
+    classifier.Add(5, _frame, { _boxes[1] });
+    classifier.Flush();
+
+    double logits[3] = { 0.0, 128.0 / 255.0, 1.0 }, sum = 0.0;
+    for(double logit : logits)
+        sum += std::exp(logit);
+    double red[2] = { 128.0 / 255.0, 1.0 / sum }, blue[2] = { 50.0 / 255.0, std::exp(1.0) / sum };
+
+    // Every crop in the range counts the same.
+    std::string label;
+    double confidence = 0.0;
+    CPPUNIT_ASSERT(classifier.Classify(0, 1, label, confidence));
+    CPPUNIT_ASSERT_EQUAL(std::string("red"), label);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL((2 * red[0] + red[1]) / 3, confidence, 1e-4);
+
+    CPPUNIT_ASSERT(classifier.Classify(1, 5, label, confidence));
+    CPPUNIT_ASSERT_EQUAL(std::string("blue"), label);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL((blue[0] + 2 * blue[1]) / 3, confidence, 1e-4);
+
+    CPPUNIT_ASSERT(!classifier.Classify(2, 4, label, confidence));
+
+    // An object's crops are picked out by their boxes, so the other box in
+    // frame 1 is left out.
+    CPPUNIT_ASSERT(classifier.Classify({ 0, 1 }, { _boxes[0], _boxes[0] }, label, confidence));
+    CPPUNIT_ASSERT_EQUAL(std::string("red"), label);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(red[0], confidence, 1e-4);
+}
+
+void DnnClassifierTest::TestSaveLoad()
+{
+    std::string file = "dnn_checkpoint.yaml";
+    {
+        DnnClassifier classifier(_settings);
+        classifier.Add(3, _frame, _boxes);
+        classifier.Flush();
+
+        cv::FileStorage fs(file, cv::FileStorage::WRITE);
+        classifier.Save(fs, "dnn");
+    }
+
+    DnnClassifier loaded(_settings);
+    {
+        cv::FileStorage fs(file, cv::FileStorage::READ);
+        loaded.Load(fs["dnn"]);
+    }
+    std::remove(file.c_str());
+
+    std::string label;
+    double confidence = 0.0;
+    CPPUNIT_ASSERT(loaded.Classify({ 3 }, { _boxes[0] }, label, confidence));
+    CPPUNIT_ASSERT_EQUAL(std::string("red"), label);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(128.0 / 255.0, confidence, 1e-4);
+    CPPUNIT_ASSERT(loaded.Classify({ 3 }, { _boxes[1] }, label, confidence));
+    CPPUNIT_ASSERT_EQUAL(std::string("blue"), label);
+    CPPUNIT_ASSERT(!loaded.Classify(0, 2, label, confidence));
+}
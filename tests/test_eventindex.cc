@@ -0,0 +1,71 @@
+#include "test_eventindex.h"
+
+#include <cstdio>
+#include <fstream>
+
+static const char* INDEX_FILE = "event_index_test.idx";
+
+void EventIndexTest::setUp()
+{
+    ObjectTrack track;
+    track.ID = 7;
+    track.Frames = { 40, 41 };
+    track.Boxes = { cv::Rect(1, 2, 30, 40), cv::Rect(5, 6, 31, 41) };
+
+    // Added out of order, with one long event that spans the next.
+    EventIndex index;
+    index.Add(3, 200, 220, 2, -1, {});
+    index.Add(1, 10, 100, 3, 0, {});
+    index.Add(2, 40, 50, 1, 1, { track });
+    CPPUNIT_ASSERT(index.Write(INDEX_FILE));
+}
+
+void EventIndexTest::tearDown()
+{
+    std::remove(INDEX_FILE);
+}
+
+void EventIndexTest::TestQuery()
+{
+    EventIndexReader reader(INDEX_FILE);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), reader.Size());
+    CPPUNIT_ASSERT_EQUAL(1, reader.Get(0).ID);
+    CPPUNIT_ASSERT_EQUAL(100, reader.Get(1).MaxEnd);
+
+    // The long event overlaps a window after the short one ends.
+    auto found = reader.Query(60, 70);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), found.size());
+    CPPUNIT_ASSERT_EQUAL(1, found[0]->ID);
+
+    found = reader.Query(45, 200);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), found.size());
+    CPPUNIT_ASSERT_EQUAL(2, found[1]->ID);
+    CPPUNIT_ASSERT_EQUAL(3, found[0]->Cameras);
+
+    CPPUNIT_ASSERT(reader.Query(101, 199).empty());
+    CPPUNIT_ASSERT(reader.Query(0, 9).empty());
+    CPPUNIT_ASSERT(reader.Query(221, 300).empty());
+}
+
+void EventIndexTest::TestGetTracks()
+{
+    EventIndexReader reader(INDEX_FILE);
+    auto found = reader.Query(45, 45);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), found.size());
+    CPPUNIT_ASSERT(reader.GetTracks(*found[0]).empty());
+
+    auto tracks = reader.GetTracks(*found[1]);
+    CPPUNIT_ASSERT_EQUAL(1, found[1]->Objects);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), tracks.size());
+    CPPUNIT_ASSERT_EQUAL(7, tracks[0].ID);
+    CPPUNIT_ASSERT_EQUAL(41, tracks[0].Frames[1]);
+    CPPUNIT_ASSERT(tracks[0].Boxes[1] == cv::Rect(5, 6, 31, 41));
+}
+
+void EventIndexTest::TestNotAnIndex()
+{
+    CPPUNIT_ASSERT_THROW(EventIndexReader("does_not_exist.idx"), std::runtime_error);
+
+    std::ofstream(INDEX_FILE) << "{ \"events\": [], \"note\": \"JSON, not an index\" }";
+    CPPUNIT_ASSERT_THROW(EventIndexReader reader(INDEX_FILE), std::runtime_error);
+}
@@ -0,0 +1,113 @@
+#include "test_foregroundcache.h"
+
+#include <cstdio>
+#include <fstream>
+
+static const char* CACHE_FILE = "foreground_cache_test.fgc";
+
+/// A foreground with a moving object and its shadow, as the background
+/// subtractor marks them.
+cv::Mat Foreground(int x)
+{
+    cv::Mat foreground = cv::Mat::zeros(320, 480, CV_8UC1);
+    cv::rectangle(foreground, cv::Rect(x, 100, 80, 40), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(foreground, cv::Rect(x, 140, 80, 20), cv::Scalar(127), cv::FILLED);
+    return foreground;
+}
+
+void ForegroundCacheTest::tearDown()
+{
+    std::remove(CACHE_FILE);
+}
+
+void ForegroundCacheTest::TestRoundTrip()
+{
+    {
+        // Out of order, as chunks write them, and with a frame cached twice.
+        ForegroundCache cache(CACHE_FILE, ForegroundCache::Settings());
+        cache.Add(5, 1, Foreground(200));
+        cache.Add(3, 1, Foreground(100));
+        cache.Add(3, 0, Foreground(0));
+        cache.Add(3, 0, Foreground(40));
+    }
+
+    ForegroundCacheReader reader(CACHE_FILE);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), reader.Size());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.25, reader.GetScale(), 1e-9);
+
+    int frame, camera;
+    cv::Mat foreground;
+    CPPUNIT_ASSERT(reader.Next(frame, camera, foreground));
+    CPPUNIT_ASSERT_EQUAL(3, frame);
+    CPPUNIT_ASSERT_EQUAL(0, camera);
+    CPPUNIT_ASSERT(foreground.size() == cv::Size(120, 80));
+
+    // The second copy of the frame wins, and the levels survive quantizing.
+    CPPUNIT_ASSERT_EQUAL(255, (int)foreground.at<unsigned char>(30, 15));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(127.0, foreground.at<unsigned char>(37, 15), 17.0);
+    CPPUNIT_ASSERT_EQUAL(0, (int)foreground.at<unsigned char>(30, 5));
+
+    CPPUNIT_ASSERT(reader.Next(frame, camera, foreground));
+    CPPUNIT_ASSERT_EQUAL(1, camera);
+    CPPUNIT_ASSERT(reader.Next(frame, camera, foreground));
+    CPPUNIT_ASSERT_EQUAL(5, frame);
+    CPPUNIT_ASSERT(!reader.Next(frame, camera, foreground));
+}
+
+void ForegroundCacheTest::TestTruncate()
+{
+    ForegroundCache cache(CACHE_FILE, ForegroundCache::Settings());
+    cache.Add(0, 0, Foreground(0));
+    cache.Flush();
+    uint64_t checkpoint = cache.Size();
+
+    cache.Add(1, 0, Foreground(10));
+    cache.Add(2, 0, Foreground(20));
+    cache.Truncate(checkpoint);
+    CPPUNIT_ASSERT_EQUAL(checkpoint, cache.Size());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), ForegroundCacheReader(CACHE_FILE).Size());
+
+    cache.Truncate(0);
+    CPPUNIT_ASSERT_EQUAL(size_t(0), ForegroundCacheReader(CACHE_FILE).Size());
+}
+
+void ForegroundCacheTest::TestRawFrames()
+{
+    ForegroundCache::Settings settings;
+    settings.bRawFrames = true;
+    settings.Scale = 0.5;
+    {
+        ForegroundCache cache(CACHE_FILE, settings);
+        cache.Add(0, 0, Foreground(0));
+    }
+    CPPUNIT_ASSERT(ForegroundCacheReader(CACHE_FILE).IsRaw());
+
+    // Carrying on with raw frames keeps the records and the scale.
+    {
+        ForegroundCache::Settings raw;
+        raw.bRawFrames = true;
+        ForegroundCache cache(CACHE_FILE, raw);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, cache.Config.Scale, 1e-9);
+        cache.Add(1, 0, Foreground(10));
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(2), ForegroundCacheReader(CACHE_FILE).Size());
+
+    // Undistorted frames can't go in with them, so the cache starts over.
+    {
+        ForegroundCache cache(CACHE_FILE, ForegroundCache::Settings());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.25, cache.Config.Scale, 1e-9);
+        cache.Add(2, 0, Foreground(20));
+    }
+    ForegroundCacheReader reader(CACHE_FILE);
+    CPPUNIT_ASSERT(!reader.IsRaw());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), reader.Size());
+}
+
+void ForegroundCacheTest::TestNotACache()
+{
+    CPPUNIT_ASSERT_THROW(ForegroundCacheReader reader("does_not_exist.fgc"), std::runtime_error);
+
+    std::ofstream(CACHE_FILE) << "This is a text file, not a foreground cache.";
+    CPPUNIT_ASSERT_THROW(ForegroundCacheReader reader(CACHE_FILE), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(ForegroundCache cache(CACHE_FILE, ForegroundCache::Settings()), std::runtime_error);
+}
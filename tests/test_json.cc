@@ -79,4 +79,39 @@ void JSONTest::TestAddObject()
     _json.reset(j2);
     _json->BuildJSONObjectArray();
     CPPUNIT_ASSERT_EQUAL(_json->GetJSON(), std::string("{\"json2\":[{\"sub1\":\"val1\"}]}"));
-}
\ No newline at end of file
+}
+
+void JSONTest::TestKeyValuesAndObjects()
+{
+    std::string name = "json";
+    _json.reset(new JSON(name));
+
+    std::map<std::string, std::string> val;
+    val.insert(std::make_pair("sub1", "val1"));
+    _json->AddKeyValue("key", "value");
+    _json->AddObject(JSON("json2", val));
+
+    // Key-value pairs and objects are separated by a comma.
+    _json->BuildJSONObject();
+    CPPUNIT_ASSERT_EQUAL(_json->GetJSON(), "{\"" + name + "\":{\"key\":\"value\",\"json2\":{\"sub1\":\"val1\"}}}");
+
+    _json->BuildJSONObjectArray();
+    CPPUNIT_ASSERT_EQUAL(_json->GetJSON(), "{\"" + name + "\":[{\"key\":\"value\"},{\"json2\":{\"sub1\":\"val1\"}}]}");
+}
+
+void JSONTest::TestKeyArray()
+{
+    _json.reset(new JSON("json"));
+    _json->AddKeyValue("key", "1");
+    _json->AddKeyArray("list", { "1", "2.5", "three" });
+    _json->AddObject(JSON("json2", std::map<std::string, std::string>{ { "sub1", "val1" } }));
+
+    // Numbers in arrays are unquoted, like any other value.
+    _json->BuildJSONObject();
+    CPPUNIT_ASSERT_EQUAL(std::string("{\"json\":{\"key\":1,\"list\":[1,2.5,\"three\"],\"json2\":{\"sub1\":\"val1\"}}}"), _json->GetJSON());
+
+    _json.reset(new JSON("json"));
+    _json->AddKeyArray("empty", {});
+    _json->BuildJSONObject();
+    CPPUNIT_ASSERT_EQUAL(std::string("{\"json\":{\"empty\":[]}}"), _json->GetJSON());
+}
@@ -0,0 +1,92 @@
+#include "test_length.h"
+#include "SyntheticVideo.h"
+
+#include <cmath>
+#include <sys/stat.h>
+
+/// An elliptical contour, the rough outline of a fish.
+std::vector<cv::Point> FishContour(cv::Point center, int length, int width, double angle)
+{
+    std::vector<cv::Point> contour;
+    for(int i = 0; i < 72; i++)
+    {
+        double t = i * CV_PI / 36;
+        double x = length / 2.0 * std::cos(t), y = width / 2.0 * std::sin(t);
+        contour.push_back(cv::Point(std::lround(center.x + x * std::cos(angle) - y * std::sin(angle)),
+                                    std::lround(center.y + x * std::sin(angle) + y * std::cos(angle))));
+    }
+    return contour;
+}
+
+void LengthEstimatorTest::setUp()
+{
+    mkdir("calib_config", 0755);
+
+    // An ideal 320x240 rig: f = 256 px, with a baseline of 100.
+    SyntheticVideo::Settings settings;
+    settings.Resolution = cv::Size(320, 240);
+    SyntheticVideo(settings).WriteCalibration("calib_config/length_calibration.yaml");
+
+    Calibration::Input input;
+    input.image_size = settings.Resolution;
+    _calib = std::make_unique<Calibration>(input, CalibrationType::STEREO, "length_calibration.yaml");
+    _calib->ReadCalibration();
+}
+
+void LengthEstimatorTest::TestMatch()
+{
+    LengthEstimator length(*_calib, LengthEstimator::Settings());
+
+    // The fish sits 16 px further left in the right camera, next to one that
+    // is on other rows, and so can't be the same fish.
+    auto left  = FishContour(cv::Point(160, 120), 80, 20, 0.3);
+    auto right = FishContour(cv::Point(144, 120), 80, 20, 0.3);
+    auto other = FishContour(cv::Point(150, 180), 80, 20, 0.3);
+
+    auto matches = length.Match({ left, FishContour(cv::Point(20, 20), 4, 2, 0.0) }, { other, right });
+    CPPUNIT_ASSERT_EQUAL(size_t(1), matches.size());
+    CPPUNIT_ASSERT(matches[0].Error < 1.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(16.0, matches[0].Head[0].x - matches[0].Head[1].x, 1.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(16.0, matches[0].Tail[0].x - matches[0].Tail[1].x, 1.0);
+
+    // Nothing matches when only the other fish is seen.
+    CPPUNIT_ASSERT(length.Match({ left }, { other }).empty());
+}
+
+void LengthEstimatorTest::TestLengths()
+{
+    LengthEstimator length(*_calib, LengthEstimator::Settings());
+
+    auto left  = FishContour(cv::Point(160, 120), 80, 20, 0.3);
+    auto right = FishContour(cv::Point(144, 120), 80, 20, 0.3);
+    auto matches = length.Match({ left }, { right });
+    length.Add(10, matches);
+    length.Add(11, matches);
+    length.Add(50, matches);
+
+    // 80 px at a range of f * B / d = 1600 is 500 long.
+    auto lengths = length.GetLengths(0, 20);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), lengths.size());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(80 * 1600.0 / 256, lengths[0], 25.0);
+
+    // The kept matches survive a checkpoint.
+    {
+        cv::FileStorage fs("length_checkpoint.yaml", cv::FileStorage::WRITE);
+        length.Save(fs, "lengths");
+    }
+    LengthEstimator restored(*_calib, LengthEstimator::Settings());
+    cv::FileStorage fs("length_checkpoint.yaml", cv::FileStorage::READ);
+    restored.Load(fs["lengths"]);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), restored.GetLengths(0, 100).size());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(lengths[0], restored.GetLengths(0, 20)[0], 0.01);
+}
+
+void LengthEstimatorTest::TestNoFundamental()
+{
+    Calibration::Input input;
+    input.image_size = cv::Size(320, 240);
+    Calibration calib(input, CalibrationType::STEREO, "does_not_exist.yaml");
+    calib.ReadCalibration();
+
+    CPPUNIT_ASSERT_THROW(LengthEstimator(calib, LengthEstimator::Settings()), std::runtime_error);
+}
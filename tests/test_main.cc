@@ -4,6 +4,24 @@
 #include "test_json.h"
 #include "test_events.h"
 #include "test_calibration.h"
+#include "test_threadpool.h"
+#include "test_contenthash.h"
+#include "test_synthetic.h"
+#include "test_pipelinestats.h"
+#include "test_progress.h"
+#include "test_depth.h"
+#include "test_length.h"
+#include "test_thumbnails.h"
+#include "test_multitracker.h"
+#include "test_dnn.h"
+#include "test_eventindex.h"
+#include "test_detectionlog.h"
+#include "test_foregroundcache.h"
+#include "test_streampacer.h"
+#include "test_motionsync.h"
+#include "test_threadbudget.h"
+#include "test_resultcache.h"
+#include "test_api.h"
 
 using namespace CppUnit;
 
@@ -15,6 +33,24 @@ int main()
    runner.addTest(EventTest::suite());
    runner.addTest(TrackerTest::suite());
    runner.addTest(ProcessorTest::suite());
+   runner.addTest(ThreadPoolTest::suite());
+   runner.addTest(ContentHashTest::suite());
+   runner.addTest(SyntheticVideoTest::suite());
+   runner.addTest(PipelineStatsTest::suite());
+   runner.addTest(ProgressReporterTest::suite());
+   runner.addTest(DepthEstimatorTest::suite());
+   runner.addTest(LengthEstimatorTest::suite());
+   runner.addTest(EventThumbnailsTest::suite());
+   runner.addTest(MultiTrackerTest::suite());
+   runner.addTest(DnnClassifierTest::suite());
+   runner.addTest(EventIndexTest::suite());
+   runner.addTest(DetectionLogTest::suite());
+   runner.addTest(ForegroundCacheTest::suite());
+   runner.addTest(StreamPacerTest::suite());
+   runner.addTest(MotionSyncTest::suite());
+   runner.addTest(ThreadBudgetTest::suite());
+   runner.addTest(ResultCacheTest::suite());
+   runner.addTest(FindFishApiTest::suite());
    runner.run();
    
    return 0;
@@ -0,0 +1,75 @@
+#include "test_motionsync.h"
+
+#include <algorithm>
+
+/// Bursts of motion of different lengths and strengths, at uneven times.
+std::vector<float> Bursts(int length)
+{
+    std::vector<float> signal(length, 1.0f);
+    unsigned int seed = 12345;
+    for(int burst = 0; burst < length / 30; burst++)
+    {
+        seed = seed * 1103515245 + 12345;
+        int start = (seed >> 8) % length;
+        int width = 3 + (seed >> 20) % 10;
+        for(int i = start; i < std::min(length, start + width); i++)
+            signal[i] += 5.0f + (seed >> 24) % 15;
+    }
+    return signal;
+}
+
+void MotionSyncTest::TestCrossCorrelate()
+{
+    // The second camera started recording 37 frames before the first.
+    std::vector<float> signal = Bursts(400);
+    std::vector<float> first(signal.begin() + 50, signal.begin() + 350);
+    std::vector<float> second(signal.begin() + 13, signal.begin() + 313);
+
+    MotionSync::Result result = MotionSync::CrossCorrelate(first, second, 100);
+    CPPUNIT_ASSERT_EQUAL(37, result.Offset);
+    CPPUNIT_ASSERT(result.Confidence > MotionSync::Settings().MinConfidence);
+
+    result = MotionSync::CrossCorrelate(second, first, 100);
+    CPPUNIT_ASSERT_EQUAL(-37, result.Offset);
+
+    // An offset outside the window can't be found.
+    result = MotionSync::CrossCorrelate(first, second, 20);
+    CPPUNIT_ASSERT(result.Offset != 37);
+}
+
+void MotionSyncTest::TestNoMotion()
+{
+    MotionSync::Result result = MotionSync::CrossCorrelate(std::vector<float>(100, 2.0f), Bursts(100), 50);
+    CPPUNIT_ASSERT_EQUAL(0.0, result.Confidence);
+
+    MotionSync::Settings settings;
+    MotionSync sync(settings);
+    CPPUNIT_ASSERT(!sync.IsConfident(sync.Estimate(1)));
+}
+
+void MotionSyncTest::TestFrames()
+{
+    // A square flashes on at uneven times, seen by both cameras, the second
+    // of which is 7 frames ahead.
+    const std::vector<int> flashes = { 10, 11, 30, 55, 56, 57, 80, 101, 102, 130 };
+    auto frame = [&](int number)
+    {
+        cv::Mat image = cv::Mat::zeros(96, 128, CV_8UC3);
+        if(std::find(flashes.begin(), flashes.end(), number) != flashes.end())
+            cv::rectangle(image, cv::Rect(32, 24, 48, 40), cv::Scalar(255, 255, 255), cv::FILLED);
+        return image;
+    };
+
+    MotionSync::Settings settings;
+    MotionSync sync(settings);
+    for(int i = 0; i < 150; i++)
+    {
+        sync.Add(0, frame(i));
+        sync.Add(1, frame(i - 7));
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(150), sync.GetSignal(1).size());
+
+    MotionSync::Result result = sync.Estimate(1);
+    CPPUNIT_ASSERT_EQUAL(7, result.Offset);
+    CPPUNIT_ASSERT(sync.IsConfident(result));
+}
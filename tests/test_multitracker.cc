@@ -0,0 +1,132 @@
+#include "test_multitracker.h"
+
+/// Two fish swimming towards each other on nearby rows.
+std::vector<cv::Rect> PassingFish(int frame)
+{
+    return { cv::Rect(20 + 6 * frame, 100, 40, 16), cv::Rect(400 - 6 * frame, 130, 40, 16) };
+}
+
+void MultiTrackerTest::setUp()
+{
+    _tracker = std::make_unique<MultiTracker>(MultiTracker::Settings());
+}
+
+void MultiTrackerTest::TestPersistentIDs()
+{
+    for(int frame = 0; frame < 60; frame++)
+    {
+        // The second fish goes unseen for a few frames.
+        auto boxes = PassingFish(frame);
+        if(frame >= 20 && frame < 25)
+            boxes.pop_back();
+        auto ids = _tracker->Update(frame, boxes);
+
+        // Boxes only get IDs once their track is confirmed.
+        CPPUNIT_ASSERT_EQUAL(boxes.size(), ids.size());
+        CPPUNIT_ASSERT_EQUAL(frame < 2 ? 0 : 1, ids[0]);
+    }
+
+    auto tracks = _tracker->GetTracks(0, 59);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), tracks.size());
+    CPPUNIT_ASSERT_EQUAL(1, tracks[0].ID);
+    CPPUNIT_ASSERT_EQUAL(2, tracks[1].ID);
+    CPPUNIT_ASSERT_EQUAL(size_t(60), tracks[0].Frames.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(55), tracks[1].Frames.size());
+
+    // Each track kept to its own fish, even where they passed each other.
+    for(size_t i = 0; i < tracks[0].Frames.size(); i++)
+        CPPUNIT_ASSERT_EQUAL(100, tracks[0].Boxes[i].y);
+    for(size_t i = 0; i < tracks[1].Frames.size(); i++)
+        CPPUNIT_ASSERT_EQUAL(130, tracks[1].Boxes[i].y);
+
+    // Ranges cut the tracks down to the frames inside them.
+    tracks = _tracker->GetTracks(10, 19);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), tracks.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(10), tracks[0].Frames.size());
+    CPPUNIT_ASSERT_EQUAL(10, tracks[0].Frames.front());
+}
+
+void MultiTrackerTest::TestShortTracksIgnored()
+{
+    // A flicker seen for two frames, and a box too small to be a fish.
+    _tracker->Update(0, { cv::Rect(50, 50, 20, 20), cv::Rect(200, 200, 4, 4) });
+    _tracker->Update(1, { cv::Rect(52, 50, 20, 20), cv::Rect(200, 200, 4, 4) });
+    for(int frame = 2; frame < 30; frame++)
+        _tracker->Update(frame, {});
+
+    CPPUNIT_ASSERT(_tracker->GetTracks(0, 30).empty());
+}
+
+void MultiTrackerTest::TestCrowd()
+{
+    // A school of 400 fish drifting right, in a 20x20 grid.
+    for(int frame = 0; frame < 10; frame++)
+    {
+        std::vector<cv::Rect> boxes;
+        for(int y = 0; y < 20; y++)
+            for(int x = 0; x < 20; x++)
+                boxes.push_back(cv::Rect(x * 50 + 2 * frame, y * 40, 24, 12));
+        _tracker->Update(frame, boxes);
+    }
+
+    auto tracks = _tracker->GetTracks(0, 9);
+    CPPUNIT_ASSERT_EQUAL(size_t(400), tracks.size());
+    for(const auto& track : tracks)
+    {
+        CPPUNIT_ASSERT_EQUAL(size_t(10), track.Frames.size());
+        CPPUNIT_ASSERT_EQUAL(track.Boxes.front().y, track.Boxes.back().y);
+        CPPUNIT_ASSERT_EQUAL(track.Boxes.front().x + 18, track.Boxes.back().x);
+    }
+}
+
+void MultiTrackerTest::TestAppend()
+{
+    // The same fish, split across two chunks at frame 30.
+    MultiTracker next{MultiTracker::Settings()};
+    for(int frame = 0; frame < 60; frame++)
+    {
+        std::vector<cv::Rect> boxes = { cv::Rect(20 + 6 * frame, 100, 40, 16) };
+        if(frame >= 40)
+            boxes.push_back(cv::Rect(300, 300, 30, 30));
+        if(frame < 30) _tracker->Update(frame, boxes);
+        else           next.Update(frame, boxes);
+    }
+    _tracker->Append(next, 30);
+
+    auto tracks = _tracker->GetTracks(0, 59);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), tracks.size());
+    CPPUNIT_ASSERT_EQUAL(1, tracks[0].ID);
+    CPPUNIT_ASSERT_EQUAL(size_t(60), tracks[0].Frames.size());
+    CPPUNIT_ASSERT_EQUAL(2, tracks[1].ID);
+    CPPUNIT_ASSERT_EQUAL(40, tracks[1].Frames.front());
+}
+
+void MultiTrackerTest::TestSaveLoad()
+{
+    for(int frame = 0; frame < 30; frame++)
+        _tracker->Update(frame, PassingFish(frame));
+    _tracker->SetLabel(2, "salmon");
+
+    {
+        cv::FileStorage fs("multitracker_test.yaml", cv::FileStorage::WRITE);
+        _tracker->Save(fs, "objects");
+    }
+
+    // The restored tracker carries on with the same tracks.
+    MultiTracker restored{MultiTracker::Settings()};
+    {
+        cv::FileStorage fs("multitracker_test.yaml", cv::FileStorage::READ);
+        restored.Load(fs["objects"]);
+    }
+    std::remove("multitracker_test.yaml");
+
+    for(int frame = 30; frame < 40; frame++)
+        restored.Update(frame, PassingFish(frame));
+
+    auto tracks = restored.GetTracks(0, 39);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), tracks.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(40), tracks[0].Frames.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(40), tracks[1].Frames.size());
+    CPPUNIT_ASSERT(tracks[0].Label.empty());
+    CPPUNIT_ASSERT_EQUAL(std::string("salmon"), tracks[1].Label);
+}
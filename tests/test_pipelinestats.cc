@@ -0,0 +1,69 @@
+#include "test_pipelinestats.h"
+#include "JsonBuilder.h"
+
+void PipelineStatsTest::setUp()
+{
+    _stats = std::make_unique<PipelineStats>();
+}
+
+void PipelineStatsTest::TestPercentiles()
+{
+    // 1 to 100 ms, evenly spread.
+    for(int i = 1; i <= 100; i++)
+        _stats->Record(STAGE_DECODE, i / 1000.0);
+
+    const LatencyHistogram& decode = _stats->GetStage(STAGE_DECODE);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(100), decode.Count());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(5.05, decode.Total(), 1e-6);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.1, decode.Max(), 1e-6);
+
+    // The buckets are a quarter octave wide, so allow ~20% either way.
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.050, decode.Percentile(50), 0.010);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.095, decode.Percentile(95), 0.019);
+    CPPUNIT_ASSERT(decode.Percentile(99) <= decode.Max());
+
+    CPPUNIT_ASSERT_EQUAL(0.0, _stats->GetStage(STAGE_ENCODE).Percentile(50));
+}
+
+void PipelineStatsTest::TestTimer()
+{
+    {
+        PipelineStats::Timer timer(_stats.get(), STAGE_ENCODE);
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), _stats->GetStage(STAGE_ENCODE).Count());
+
+    // A null stats pointer times nothing.
+    PipelineStats::Timer timer(nullptr, STAGE_ENCODE);
+}
+
+void PipelineStatsTest::TestCounters()
+{
+    _stats->CountFrame();
+    _stats->CountFrame();
+    _stats->CountDroppedFrame();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(2), _stats->FramesProcessed());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), _stats->FramesDropped());
+}
+
+void PipelineStatsTest::TestGetAsJSON()
+{
+    _stats->Record(STAGE_UNDISTORT, 0.002);
+    _stats->RecordQueueDepth("frames", 3);
+    _stats->RecordQueueDepth("frames", 7);
+    _stats->RecordQueueDepth("frames", 2);
+
+    std::string json = _stats->GetAsJSON().GetJSON();
+    CPPUNIT_ASSERT(json.find("\"PerformanceReport\":{") != std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"undistort\":{") != std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"decode\"") == std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"frames\":7") != std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"effective_cores\"") != std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"utilisation\"") == std::string::npos);
+
+    // Utilisation is only reported against a budget.
+    _stats->SetThreadBudget(4);
+    json = _stats->GetAsJSON().GetJSON();
+    CPPUNIT_ASSERT(json.find("\"thread_budget\":4") != std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"utilisation\"") != std::string::npos);
+    CPPUNIT_ASSERT(_stats->CpuSeconds() >= 0.0);
+}
@@ -1,4 +1,13 @@
 #include "test_processor.h"
+#include "SyntheticVideo.h"
+#include "ForegroundCache.h"
+#include "DetectionLog.h"
+#include "ProgressReporter.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <map>
 
 void ProcessorTest::setUp()
 {
@@ -13,10 +22,287 @@ void ProcessorTest::TestConstructor()
 
 void ProcessorTest::TestProcessVideo()
 {
+    for(auto dir : { "static", "static/videos", "static/proc_videos", "static/video-info", "calib_config" })
+        mkdir(dir, 0755);
+
+    // Process a short synthetic pair, since there is no footage to test with.
+    SyntheticVideo::Settings settings;
+    settings.Name = "processor";
+    settings.Resolution = cv::Size(320, 240);
+    settings.Frames = 60;
+    SyntheticVideo generator(settings);
+    auto files = generator.Generate();
+    generator.WriteCalibration("calib_config/stereo_calibration.yaml");
+
+    _proc.reset(new Processor(files.first, files.second));
+    _proc->Config.Results.bEnabled = false;
     _proc->ProcessVideos();
+    CPPUNIT_ASSERT(_proc->Success);
+}
+
+void ProcessorTest::TestPointSpaceLog()
+{
+    for(auto dir : { "static", "static/videos", "static/proc_videos", "static/video-info", "calib_config" })
+        mkdir(dir, 0755);
+
+    // A fish near the corner, where the distortion moves it the most.
+    SyntheticVideo::Settings settings;
+    settings.Name = "pointspace";
+    settings.Resolution = cv::Size(320, 240);
+    settings.Frames = 60;
+    settings.Fishes.push_back({ 10, 40, cv::Point2f(0.15f, 0.2f), cv::Point2f(0.35f, 0.25f), cv::Size2f(0.12f, 0.05f) });
+    SyntheticVideo generator(settings);
+    auto files = generator.Generate();
+
+    // Give both cameras strong barrel distortion.
+    std::string file = "calib_config/stereo_calibration.yaml";
+    generator.WriteCalibration(file);
+    {
+        cv::FileStorage in(file, cv::FileStorage::READ);
+        std::vector<std::pair<std::string, cv::Mat>> nodes;
+        for(auto name : { "K1", "K2", "E", "F", "R", "T", "P1", "R1", "P2", "R2", "Q" })
+        {
+            cv::Mat value;
+            in[name] >> value;
+            nodes.push_back({ name, value });
+        }
+        cv::Size size;
+        in["image_size"] >> size;
+        in.release();
+
+        cv::FileStorage out(file, cv::FileStorage::WRITE);
+        cv::Mat D = (cv::Mat_<double>(1, 5) << -0.2, 0, 0, 0, 0);
+        for(const auto& node : nodes)
+            out << node.first << node.second;
+        out << "D1" << D << "D2" << D << "image_size" << size;
+    }
+
+    // Undistorting whole frames and undistorting points should log the
+    // fish in the same place.
+    std::map<std::pair<int, int>, cv::Point> centroids[2];
+    for(int mode = 0; mode < 2; mode++)
+    {
+        _proc.reset(new Processor(files.first, files.second));
+        _proc->Config.Results.bEnabled     = false;
+        _proc->Config.Record.bDetectionLog = true;
+        _proc->Config.Rig.bUndistortPoints = mode == 1;
+        _proc->ProcessVideos();
+        CPPUNIT_ASSERT(_proc->Success);
+        _proc.reset();
+
+        DetectionLogReader log("static/video-info/DL_" + settings.Name + ".dlog");
+        DetectionRow row;
+        while(log.Next(row))
+            if(row.Detections.size() == 1)
+                centroids[mode][{ row.Frame, row.Camera }] = row.Detections[0].Centroid;
+    }
+
+    int compared = 0;
+    for(const auto& whole : centroids[0])
+    {
+        auto points = centroids[1].find(whole.first);
+        if(points == centroids[1].end())
+            continue;
+        CPPUNIT_ASSERT(cv::norm(whole.second - points->second) < 4.0);
+        compared++;
+    }
+    CPPUNIT_ASSERT(compared > 20);
+
+    // Leave an undistorted calibration for the other tests.
+    generator.WriteCalibration(file);
+}
+
+void ProcessorTest::TestResume()
+{
+    for(auto dir : { "static", "static/videos", "static/proc_videos", "static/video-info", "calib_config" })
+        mkdir(dir, 0755);
+
+    // Two fish, the first gone before the job is stopped and the second
+    // after it resumes.
+    SyntheticVideo::Settings settings;
+    settings.Name = "resume";
+    settings.Resolution = cv::Size(320, 240);
+    settings.Frames = 200;
+    SyntheticVideo generator(settings);
+    auto files = generator.Generate();
+    generator.WriteCalibration("calib_config/stereo_calibration.yaml");
+    CPPUNIT_ASSERT_EQUAL(size_t(2), generator.GetEvents().size());
+
+    for(int run = 0; run < 2; run++)
+    {
+        _proc.reset(new Processor(files.first, files.second));
+        _proc->Config.Results.bEnabled = false;
+        _proc->Config.Events.bThumbnails  = true;
+        _proc->Config.Job.Chunks       = 1;
+
+        // The first run is stopped between the fish, as a user would.
+        Processor* proc = _proc.get();
+        _proc->Progress = std::make_shared<ProgressReporter>("", 0.0);
+        if(run == 0)
+            _proc->Progress->Listener = [proc](ProgressStage, int64_t frame, int64_t, double)
+            {
+                if(frame >= 120)
+                    proc->Cancel();
+            };
+        _proc->ProcessVideos();
+        CPPUNIT_ASSERT_EQUAL(run == 1, _proc->Success);
+    }
+
+    // Both events get a row of the sheet, though the first was only seen
+    // before the job was stopped. The mosaic is 640x240, so each thumbnail
+    // is 240x90.
+    cv::Mat sheet = cv::imread("static/video-info/TH_" + settings.Name + ".jpg");
+    CPPUNIT_ASSERT(sheet.size() == cv::Size(3 * 240, 2 * 90));
+}
+
+void ProcessorTest::TestSeek()
+{
+    for(auto dir : { "static", "static/videos" })
+        mkdir(dir, 0755);
+
+    SyntheticVideo::Settings settings;
+    settings.Name = "seek";
+    settings.Resolution = cv::Size(160, 120);
+    settings.Frames = 80;
+    std::string file = SyntheticVideo(settings).Generate().first;
+
+    // Chunks start part way through, and have to get exactly the frame a
+    // straight read would.
+    std::vector<cv::Mat> frames;
+    Video straight(file);
+    for(int frame = 0; frame < 60; frame++)
+    {
+        straight.Read();
+        frames.push_back(straight.Get()->clone());
+    }
+
+    Video sought(file);
+    for(int frame : { 37, 12, 59 })
+    {
+        sought.Seek(frame);
+        CPPUNIT_ASSERT_EQUAL(frame, sought.Frame);
+        sought.Read();
+        CPPUNIT_ASSERT_EQUAL(0.0, cv::norm(*sought.Get(), frames[frame], cv::NORM_INF));
+    }
 }
 
 void ProcessorTest::TestTriangulatePoints()
 {
     _proc->TriangulatePoints("../calib_config/measure_points.yaml", "../calib_config/stereo_calibration.yaml");
 }
+
+
+void ProcessorTest::TestReadSettings()
+{
+    // Without a file, everything keeps its default.
+    Processor::Settings defaults = Processor::ReadSettings("does_not_exist.yaml");
+    CPPUNIT_ASSERT_EQUAL(Processor::Settings().Job.Chunks, defaults.Job.Chunks);
+
+    std::string file = "processor_settings.yaml";
+    {
+        cv::FileStorage fs(file, cv::FileStorage::WRITE);
+        fs << "chunks" << 4;
+        fs << "undistort_points" << 1;
+        fs << "dnn_model" << "fish.onnx";
+        fs << "dnn_threads" << 3;
+        fs << "cameras" << 1;
+        fs << "mosaic_columns" << 2;
+    }
+    Processor::Settings settings = Processor::ReadSettings(file);
+    std::remove(file.c_str());
+
+    CPPUNIT_ASSERT_EQUAL(4, settings.Job.Chunks);
+    CPPUNIT_ASSERT_EQUAL(defaults.Job.WarmupFrames, settings.Job.WarmupFrames);
+    CPPUNIT_ASSERT(!defaults.Rig.bUndistortPoints);
+    CPPUNIT_ASSERT(settings.Rig.bUndistortPoints);
+    CPPUNIT_ASSERT(!settings.Dnn.bEnabled);
+    CPPUNIT_ASSERT_EQUAL(std::string("fish.onnx"), settings.Dnn.Model);
+    CPPUNIT_ASSERT_EQUAL(3, settings.Dnn.Threads);
+    CPPUNIT_ASSERT_EQUAL(2, settings.Rig.Cameras);
+    CPPUNIT_ASSERT_EQUAL(2, settings.Rig.MosaicColumns);
+}
+
+void ProcessorTest::TestReplay()
+{
+    // Each camera sees the object for a while, and the two overlap.
+    std::string file = "processor_replay.fgc";
+    {
+        ForegroundCache cache(file, ForegroundCache::Settings());
+        for(int frame = 0; frame < 40; frame++)
+            for(int camera = 0; camera < 2; camera++)
+            {
+                cv::Mat foreground = cv::Mat::zeros(320, 480, CV_8UC1);
+                if((camera == 0 && frame >= 10 && frame < 20) || (camera == 1 && frame >= 12 && frame < 25))
+                    cv::circle(foreground, cv::Point(100 + frame * 4, 160), 40, cv::Scalar(255), cv::FILLED);
+                cache.Add(frame, camera, foreground);
+            }
+    }
+
+    auto events = Processor::Replay(file, 200);
+    std::remove(file.c_str());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), events.size());
+    CPPUNIT_ASSERT_EQUAL(10, events[0].first);
+    CPPUNIT_ASSERT_EQUAL(25, events[0].second);
+
+    CPPUNIT_ASSERT_THROW(Processor::Replay("does_not_exist.fgc", 200), std::runtime_error);
+
+    // Masks of the raw frames are undistorted before they are replayed,
+    // which without any distortion finds the same events.
+    mkdir("calib_config", 0755);
+    std::string calib_file = "calib_config/stereo_calibration.yaml";
+    SyntheticVideo::Settings video;
+    video.Resolution = cv::Size(480, 320);
+    SyntheticVideo(video).WriteCalibration(calib_file);
+    {
+        ForegroundCache::Settings settings;
+        settings.bRawFrames = true;
+        ForegroundCache cache(file, settings);
+        for(int frame = 0; frame < 40; frame++)
+        {
+            cv::Mat foreground = cv::Mat::zeros(320, 480, CV_8UC1);
+            if(frame >= 10 && frame < 20)
+                cv::circle(foreground, cv::Point(100 + frame * 4, 160), 40, cv::Scalar(255), cv::FILLED);
+            cache.Add(frame, 0, foreground);
+        }
+    }
+    events = Processor::Replay(file, 200);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), events.size());
+    CPPUNIT_ASSERT_EQUAL(10, events[0].first);
+    CPPUNIT_ASSERT_EQUAL(20, events[0].second);
+
+    // They can't be replayed without the calibration.
+    std::remove(calib_file.c_str());
+    CPPUNIT_ASSERT_THROW(Processor::Replay(file, 200), std::runtime_error);
+    std::remove(file.c_str());
+    SyntheticVideo(video).WriteCalibration(calib_file);
+}
+
+void ProcessorTest::TestMosaic()
+{
+    std::vector<cv::Mat> mats = {
+        cv::Mat(40, 60, CV_8UC3, cv::Scalar(10, 10, 10)),
+        cv::Mat(50, 30, CV_8UC3, cv::Scalar(20, 20, 20)),
+        cv::Mat(20, 20, CV_8UC3, cv::Scalar(30, 30, 30))
+    };
+
+    // Without columns every frame goes in one row, like the stereo pair.
+    cv::Mat row = MosaicMatrices(mats, 0);
+    CPPUNIT_ASSERT_EQUAL(110, row.cols);
+    CPPUNIT_ASSERT_EQUAL(50, row.rows);
+    CPPUNIT_ASSERT_EQUAL(30, (int)row.at<cv::Vec3b>(0, 100)[0]);
+    CPPUNIT_ASSERT_EQUAL(0, (int)row.at<cv::Vec3b>(45, 10)[0]);
+
+    // Two frames come out the same as they always have.
+    cv::Mat difference;
+    cv::absdiff(MosaicMatrices({ mats[0], mats[1] }, 0), ConcatenateMatrices(mats[0], mats[1]), difference);
+    CPPUNIT_ASSERT_EQUAL(0.0, cv::sum(difference)[0]);
+
+    // With two columns the third frame starts a row under the tallest of the first.
+    cv::Mat grid = MosaicMatrices(mats, 2);
+    CPPUNIT_ASSERT_EQUAL(90, grid.cols);
+    CPPUNIT_ASSERT_EQUAL(70, grid.rows);
+    CPPUNIT_ASSERT_EQUAL(10, (int)grid.at<cv::Vec3b>(0, 0)[0]);
+    CPPUNIT_ASSERT_EQUAL(20, (int)grid.at<cv::Vec3b>(49, 89)[0]);
+    CPPUNIT_ASSERT_EQUAL(30, (int)grid.at<cv::Vec3b>(50, 0)[0]);
+    CPPUNIT_ASSERT_EQUAL(0, (int)grid.at<cv::Vec3b>(50, 30)[0]);
+}
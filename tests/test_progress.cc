@@ -0,0 +1,82 @@
+#include "test_progress.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+void ProgressReporterTest::TestPublish()
+{
+    std::string file = "progress_test.status";
+    {
+        ProgressReporter progress(file, 0.0);
+        CPPUNIT_ASSERT(progress.IsOpen());
+
+        progress.SetPair(1, 3, "pair_A.mp4");
+        progress.SetStage(PROGRESS_PROCESSING);
+        progress.Update(150, 600);
+    }
+
+    // Read the record back the way another process would.
+    char bytes[sizeof(ProgressRecord)];
+    std::ifstream in(file, std::ios::binary);
+    in.read(bytes, sizeof(bytes));
+    CPPUNIT_ASSERT_EQUAL(std::streamsize(sizeof(bytes)), in.gcount());
+
+    uint32_t magic;
+    uint64_t sequence;
+    int32_t stage, pair, total_pairs;
+    int64_t frame, total_frames;
+    std::memcpy(&magic, bytes, 4);
+    std::memcpy(&sequence, bytes + 8, 8);
+    std::memcpy(&stage, bytes + 20, 4);
+    std::memcpy(&pair, bytes + 24, 4);
+    std::memcpy(&total_pairs, bytes + 28, 4);
+    std::memcpy(&frame, bytes + 32, 8);
+    std::memcpy(&total_frames, bytes + 40, 8);
+
+    CPPUNIT_ASSERT_EQUAL(PROGRESS_MAGIC, magic);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), sequence % 2);
+    CPPUNIT_ASSERT_EQUAL(int32_t(PROGRESS_PROCESSING), stage);
+    CPPUNIT_ASSERT_EQUAL(int32_t(1), pair);
+    CPPUNIT_ASSERT_EQUAL(int32_t(3), total_pairs);
+    CPPUNIT_ASSERT_EQUAL(int64_t(150), frame);
+    CPPUNIT_ASSERT_EQUAL(int64_t(600), total_frames);
+    CPPUNIT_ASSERT_EQUAL(std::string("pair_A.mp4"), std::string(bytes + 72));
+
+    std::remove(file.c_str());
+}
+
+void ProgressReporterTest::TestBadFile()
+{
+    // A reporter that could not open its file does nothing.
+    ProgressReporter progress("does/not/exist/progress.status");
+    CPPUNIT_ASSERT(!progress.IsOpen());
+    progress.SetStage(PROGRESS_DONE);
+    progress.Update(1, 1);
+}
+
+void ProgressReporterTest::TestListener()
+{
+    // Without a file, the listener is still told everything.
+    std::vector<std::pair<ProgressStage, int64_t>> published;
+    {
+        ProgressReporter progress("", 0.0);
+        CPPUNIT_ASSERT(!progress.IsOpen());
+        progress.Listener = [&](ProgressStage stage, int64_t frame, int64_t total_frames, double)
+        {
+            published.push_back(std::make_pair(stage, frame));
+            CPPUNIT_ASSERT(total_frames == 0 || total_frames == 600);
+        };
+
+        progress.SetPair(0, 1, "pair_A.mp4");
+        progress.SetStage(PROGRESS_PROCESSING);
+        progress.Update(150, 600);
+        progress.SetStage(PROGRESS_DONE);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(size_t(4), published.size());
+    CPPUNIT_ASSERT_EQUAL(PROGRESS_STARTING, published[0].first);
+    CPPUNIT_ASSERT_EQUAL(int64_t(150), published[2].second);
+    CPPUNIT_ASSERT_EQUAL(PROGRESS_DONE, published[3].first);
+}
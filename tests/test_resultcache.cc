@@ -0,0 +1,168 @@
+#include "test_resultcache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* OUT_DIR = "result_cache_test_out/";
+static const char* CACHE_DIR = "result_cache_test_cache/";
+
+/// Writes a file in the test's output directory, returning its path.
+static std::string WriteFile(const std::string& name, const std::string& contents)
+{
+    std::string path = OUT_DIR + name;
+    std::ofstream out(path, std::ios::binary);
+    out << contents;
+    return path;
+}
+
+static std::string ReadFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+/// Removes a directory, and the directories and files in it.
+static void RemoveAll(const std::string& dir)
+{
+    if(DIR* dp = opendir(dir.c_str()))
+    {
+        while(struct dirent* d = readdir(dp))
+        {
+            std::string name = d->d_name;
+            if(name == "." || name == "..")
+                continue;
+            struct stat info;
+            std::string path = dir + name;
+            if(stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+                RemoveAll(path + "/");
+            else
+                std::remove(path.c_str());
+        }
+        closedir(dp);
+    }
+    rmdir(dir.c_str());
+}
+
+static ResultCache MakeCache(int max_entries)
+{
+    ResultCache::Settings settings;
+    settings.Dir = CACHE_DIR;
+    settings.MaxEntries = max_entries;
+    settings.ChunkSize = 4;
+    settings.Chunks = 4;
+    return ResultCache(settings);
+}
+
+void ResultCacheTest::setUp()
+{
+    RemoveAll(OUT_DIR);
+    RemoveAll(CACHE_DIR);
+    mkdir(OUT_DIR, 0775);
+}
+
+void ResultCacheTest::tearDown()
+{
+    RemoveAll(OUT_DIR);
+    RemoveAll(CACHE_DIR);
+}
+
+void ResultCacheTest::TestKey()
+{
+    ResultCache cache = MakeCache(0);
+    std::string left  = WriteFile("left_1.mp4", std::string(64, 'l'));
+    std::string right = WriteFile("right_1.mp4", std::string(64, 'r'));
+    std::string calib = WriteFile("calib.yaml", "K1: 1");
+
+    std::string key = cache.Key({ left, right }, { calib }, "min_threshold=200");
+    CPPUNIT_ASSERT_EQUAL(size_t(16), key.size());
+
+    // The same videos under other names are the same job.
+    std::string copy = WriteFile("copy_1.mp4", std::string(64, 'l'));
+    CPPUNIT_ASSERT_EQUAL(key, cache.Key({ copy, right }, { calib }, "min_threshold=200"));
+
+    // Anything the results depend on changes the key.
+    CPPUNIT_ASSERT(key != cache.Key({ right, left }, { calib }, "min_threshold=200"));
+    CPPUNIT_ASSERT(key != cache.Key({ left, right }, { calib }, "min_threshold=250"));
+    WriteFile("calib.yaml", "K1: 2");
+    CPPUNIT_ASSERT(key != cache.Key({ left, right }, { calib }, "min_threshold=200"));
+
+    // A missing calibration is still a key, a missing video isn't.
+    CPPUNIT_ASSERT(!cache.Key({ left, right }, { std::string(OUT_DIR) + "none.yaml" }, "").empty());
+    CPPUNIT_ASSERT_EQUAL(std::string(""), cache.Key({ left, std::string(OUT_DIR) + "none.mp4" }, { calib }, ""));
+}
+
+void ResultCacheTest::TestStoreRestore()
+{
+    ResultCache cache = MakeCache(0);
+    std::string video  = WriteFile("dive.mp4", "video");
+    std::string events = WriteFile("DE_dive.json", "{ \"sheet\": \"TH_dive.jpg\", \"name\": \"dive\" }");
+    std::string sheet  = WriteFile("TH_dive.jpg", "sheet");
+    std::string other  = WriteFile("unrelated.txt", "other");
+
+    std::string key = "0123456789abcdef";
+    CPPUNIT_ASSERT(!cache.Has(key));
+    CPPUNIT_ASSERT(cache.Restore(key, "dive").empty());
+    CPPUNIT_ASSERT(cache.Store(key, "dive", { video, events, sheet, other, std::string(OUT_DIR) + "DL_dive.dlog" }));
+    CPPUNIT_ASSERT(cache.Has(key));
+
+    // The cache keeps its own links, so the results outlive the originals.
+    std::remove(video.c_str());
+    std::remove(events.c_str());
+    std::remove(sheet.c_str());
+
+    auto restored = cache.Restore(key, "again");
+    CPPUNIT_ASSERT_EQUAL(size_t(3), restored.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("video"), ReadFile(std::string(OUT_DIR) + "again.mp4"));
+    CPPUNIT_ASSERT_EQUAL(std::string("sheet"), ReadFile(std::string(OUT_DIR) + "TH_again.jpg"));
+
+    // Only file names in the JSON are renamed.
+    CPPUNIT_ASSERT_EQUAL(std::string("{ \"sheet\": \"TH_again.jpg\", \"name\": \"dive\" }"),
+                         ReadFile(std::string(OUT_DIR) + "DE_again.json"));
+
+    // Restoring under the original name links the files as they are.
+    CPPUNIT_ASSERT_EQUAL(size_t(3), cache.Restore(key, "dive").size());
+    CPPUNIT_ASSERT_EQUAL(std::string("{ \"sheet\": \"TH_dive.jpg\", \"name\": \"dive\" }"), ReadFile(events));
+    struct stat info;
+    CPPUNIT_ASSERT(stat(video.c_str(), &info) == 0);
+    CPPUNIT_ASSERT(info.st_nlink >= 2);
+}
+
+void ResultCacheTest::TestDetach()
+{
+    ResultCache cache = MakeCache(0);
+    std::string video = WriteFile("dive.mp4", "video");
+    std::string key = "0123456789abcdef";
+    CPPUNIT_ASSERT(cache.Store(key, "dive", { video }));
+
+    // Writing over a detached result leaves the cached one alone.
+    ResultCache::Detach({ video });
+    struct stat info;
+    CPPUNIT_ASSERT(stat(video.c_str(), &info) == 0);
+    CPPUNIT_ASSERT_EQUAL(1, int(info.st_nlink));
+    CPPUNIT_ASSERT_EQUAL(std::string("video"), ReadFile(video));
+
+    WriteFile("dive.mp4", "changed");
+    cache.Restore(key, "copy");
+    CPPUNIT_ASSERT_EQUAL(std::string("video"), ReadFile(std::string(OUT_DIR) + "copy.mp4"));
+}
+
+void ResultCacheTest::TestEviction()
+{
+    ResultCache cache = MakeCache(2);
+    std::string video = WriteFile("dive.mp4", "video");
+
+    CPPUNIT_ASSERT(cache.Store("0000000000000001", "dive", { video }));
+    CPPUNIT_ASSERT(cache.Store("0000000000000002", "dive", { video }));
+    CPPUNIT_ASSERT(cache.Store("0000000000000003", "dive", { video }));
+
+    // Only two are kept, and never the one just stored.
+    int kept = cache.Has("0000000000000001") + cache.Has("0000000000000002") + cache.Has("0000000000000003");
+    CPPUNIT_ASSERT_EQUAL(2, kept);
+    CPPUNIT_ASSERT(cache.Has("0000000000000003"));
+}
@@ -0,0 +1,65 @@
+#include "test_streampacer.h"
+
+#include <stdexcept>
+
+void StreamPacerTest::TestKeepingUp()
+{
+    // Reaching every frame as it arrives analyses all of them.
+    StreamPacer pacer(10.0, StreamPacer::Settings());
+    for(int frame = 0; frame < 50; frame++)
+        CPPUNIT_ASSERT(pacer.ShouldAnalyse(frame, frame / 10.0 + 0.05));
+
+    CPPUNIT_ASSERT_EQUAL(0, pacer.DroppedCount());
+    CPPUNIT_ASSERT(pacer.GetDropped().empty());
+}
+
+void StreamPacerTest::TestDrop()
+{
+    StreamPacer::Settings settings;
+    settings.BudgetMs = 100;
+    StreamPacer pacer(10.0, settings);
+
+    // Frames 10 to 14 are reached half a second late, the rest on time.
+    for(int frame = 0; frame < 20; frame++)
+    {
+        double lag = (frame >= 10 && frame < 15) ? 0.5 : 0.0;
+        CPPUNIT_ASSERT_EQUAL(lag == 0.0, pacer.ShouldAnalyse(frame, frame / 10.0 + lag));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(5, pacer.DroppedCount());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), pacer.GetDropped().size());
+    CPPUNIT_ASSERT_EQUAL(10, pacer.GetDropped()[0].first);
+    CPPUNIT_ASSERT_EQUAL(14, pacer.GetDropped()[0].second);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, pacer.MaxLag(), 1e-9);
+}
+
+void StreamPacerTest::TestSubsample()
+{
+    StreamPacer::Settings settings;
+    settings.BudgetMs = 100;
+    settings.DropPolicy = StreamPacer::Policy::SUBSAMPLE;
+    settings.MaxStride = 2;
+    StreamPacer pacer(10.0, settings);
+
+    // Two budgets behind analyses every third frame.
+    CPPUNIT_ASSERT(pacer.ShouldAnalyse(0, 0.0));
+    int analysed = 0;
+    for(int frame = 1; frame <= 9; frame++)
+        analysed += pacer.ShouldAnalyse(frame, frame / 10.0 + 0.25) ? 1 : 0;
+    CPPUNIT_ASSERT_EQUAL(3, analysed);
+    CPPUNIT_ASSERT_EQUAL(6, pacer.DroppedCount());
+
+    // However far behind, no more than MaxStride frames in a row are left out.
+    for(int frame = 10; frame < 40; frame++)
+        pacer.ShouldAnalyse(frame, frame / 10.0 + 10.0);
+    for(const auto& range : pacer.GetDropped())
+        CPPUNIT_ASSERT(range.second - range.first + 1 <= 2);
+}
+
+void StreamPacerTest::TestParsePolicy()
+{
+    CPPUNIT_ASSERT(StreamPacer::ParsePolicy("drop") == StreamPacer::Policy::DROP);
+    CPPUNIT_ASSERT(StreamPacer::ParsePolicy("subsample") == StreamPacer::Policy::SUBSAMPLE);
+    CPPUNIT_ASSERT_EQUAL(std::string("subsample"), StreamPacer::PolicyName(StreamPacer::Policy::SUBSAMPLE));
+    CPPUNIT_ASSERT_THROW(StreamPacer::ParsePolicy("skip"), std::runtime_error);
+}
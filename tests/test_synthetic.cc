@@ -0,0 +1,98 @@
+#include "test_synthetic.h"
+#include "Processor.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+void SyntheticVideoTest::setUp()
+{
+    // The Processor reads and writes relative to the working directory.
+    for(auto dir : { "static", "static/videos", "static/proc_videos", "static/video-info", "calib_config" })
+        mkdir(dir, 0755);
+
+    SyntheticVideo::Settings settings;
+    settings.Name = "synthetic";
+    settings.Resolution = cv::Size(320, 240);
+    settings.Frames = 240;
+    _generator = std::make_unique<SyntheticVideo>(settings);
+}
+
+void SyntheticVideoTest::TestGenerate()
+{
+    auto files = _generator->Generate();
+    CPPUNIT_ASSERT_EQUAL(std::string("static/videos/synthetic_A.mp4"), files.first);
+    CPPUNIT_ASSERT_EQUAL(std::string("static/videos/synthetic_B.mp4"), files.second);
+
+    // Each video holds its lead-in, the sync card, and then the scene.
+    for(int i = 0; i < 2; i++)
+    {
+        cv::VideoCapture cap(i == 0 ? files.first : files.second);
+        CPPUNIT_ASSERT(cap.isOpened());
+        CPPUNIT_ASSERT_EQUAL(_generator->Config.SyncFrame[i] + 1 + _generator->Config.Frames, int(cap.get(cv::CAP_PROP_FRAME_COUNT)));
+        CPPUNIT_ASSERT_EQUAL(320, int(cap.get(cv::CAP_PROP_FRAME_WIDTH)));
+    }
+}
+
+void SyntheticVideoTest::TestGetEvents()
+{
+    auto events = _generator->GetEvents();
+    CPPUNIT_ASSERT_EQUAL(size_t(2), events.size());
+    CPPUNIT_ASSERT_EQUAL(50, events[0].first);
+    CPPUNIT_ASSERT_EQUAL(86, events[0].second);
+}
+
+void SyntheticVideoTest::TestEndToEnd()
+{
+    RunEndToEnd(1);
+}
+
+void SyntheticVideoTest::TestEndToEndChunked()
+{
+    // Both events run over a chunk boundary, so they have to be merged.
+    RunEndToEnd(3);
+}
+
+void SyntheticVideoTest::RunEndToEnd(int chunks)
+{
+    auto files = _generator->Generate();
+    _generator->WriteCalibration("calib_config/stereo_calibration.yaml");
+
+    Processor p(files.first, files.second);
+    p.Config.Job.Chunks = chunks;
+    p.Config.Results.bEnabled = false;
+    auto start = cv::getTickCount();
+    p.ProcessVideos();
+    double seconds = double(cv::getTickCount() - start) / cv::getTickFrequency();
+    CPPUNIT_ASSERT(p.Success);
+
+    double fps = _generator->Config.Frames / seconds;
+    std::cout << "\n  > End-to-end throughput at 320x240 in " << chunks << " chunk(s): " << fps << " fps\n";
+    CPPUNIT_ASSERT(fps > 5.0);
+
+    // Read back the detected events.
+    std::vector<std::pair<int, int>> detected;
+    cv::FileStorage fs("static/video-info/DE_synthetic.json", cv::FileStorage::READ);
+    CPPUNIT_ASSERT(fs.isOpened());
+    for(auto entry : fs["DetectedEvents"])
+        for(auto event : entry)
+            if(event.name().find("Event_Activity_") == 0)
+                detected.push_back(std::make_pair((int)event["frame_start"], (int)event["frame_end"]));
+
+    // The background models are still learning the scene for the first few
+    // frames, so ignore anything they report there.
+    const int warmup = 10, tolerance = 4;
+    detected.erase(std::remove_if(detected.begin(), detected.end(),
+                                  [&](const std::pair<int, int>& e) { return e.first < warmup; }),
+                   detected.end());
+
+    auto truth = _generator->GetEvents();
+    CPPUNIT_ASSERT_EQUAL(truth.size(), detected.size());
+    for(size_t i = 0; i < truth.size(); i++)
+    {
+        CPPUNIT_ASSERT(std::abs(truth[i].first - detected[i].first) <= tolerance);
+        CPPUNIT_ASSERT(std::abs(truth[i].second - detected[i].second) <= tolerance);
+    }
+}
@@ -0,0 +1,199 @@
+#include "test_threadbudget.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <string>
+
+static const char* SLOT_DIR = "thread_budget_test_slots/";
+
+void ThreadBudgetTest::tearDown()
+{
+    for(int slot = 0; slot < 4; slot++)
+    {
+        std::remove((std::string(SLOT_DIR) + "slot_" + std::to_string(slot) + ".lock").c_str());
+        std::remove((std::string(SLOT_DIR) + "job_" + std::to_string(slot) + ".lock").c_str());
+    }
+    std::remove(SLOT_DIR);
+}
+
+void ThreadBudgetTest::TestCacheDomains()
+{
+    // Every CPU shows up once, whatever the machine looks like.
+    std::set<int> seen;
+    size_t total = 0;
+    for(const auto& domain : ThreadBudget::CacheDomains())
+    {
+        CPPUNIT_ASSERT(!domain.empty());
+        seen.insert(domain.begin(), domain.end());
+        total += domain.size();
+    }
+    CPPUNIT_ASSERT(total > 0);
+    CPPUNIT_ASSERT_EQUAL(total, seen.size());
+}
+
+void ThreadBudgetTest::TestPartition()
+{
+    const std::vector<std::vector<int>> domains = { { 0, 1, 2, 3 }, { 8, 9, 10, 11 } };
+
+    // A part per domain keeps each part in its own domain.
+    CPPUNIT_ASSERT(ThreadBudget::Partition(domains, 2, 1) == std::vector<int>({ 8, 9, 10, 11 }));
+    CPPUNIT_ASSERT(ThreadBudget::Partition(domains, 4, 3) == std::vector<int>({ 10, 11 }));
+
+    // Uneven splits still cover every CPU once.
+    std::vector<int> all;
+    for(int part = 0; part < 3; part++)
+    {
+        auto cpus = ThreadBudget::Partition(domains, 3, part);
+        CPPUNIT_ASSERT(cpus.size() >= 2);
+        all.insert(all.end(), cpus.begin(), cpus.end());
+    }
+    CPPUNIT_ASSERT(all == std::vector<int>({ 0, 1, 2, 3, 8, 9, 10, 11 }));
+
+    // More parts than CPUs gives each part a single CPU.
+    CPPUNIT_ASSERT_EQUAL(size_t(1), ThreadBudget::Partition(domains, 16, 9).size());
+    CPPUNIT_ASSERT(!ThreadBudget::Partition({}, 2, 0).empty());
+}
+
+void ThreadBudgetTest::TestSlots()
+{
+    ThreadBudget::Settings settings;
+    settings.MaxJobs = 2;
+    settings.SlotDir = SLOT_DIR;
+
+    auto first = std::make_unique<ThreadBudget>(settings);
+    CPPUNIT_ASSERT_EQUAL(0, first->GetSlot());
+    CPPUNIT_ASSERT_EQUAL(1, first->ActiveJobs());
+    int cores = first->GetCores();
+
+    {
+        ThreadBudget second(settings);
+        CPPUNIT_ASSERT_EQUAL(1, second.GetSlot());
+        CPPUNIT_ASSERT_EQUAL(2, first->ActiveJobs());
+        CPPUNIT_ASSERT_EQUAL(std::max(1, cores / 2), second.GetCores());
+
+        // With every slot taken, a job shares without one.
+        ThreadBudget third(settings);
+        CPPUNIT_ASSERT_EQUAL(-1, third.GetSlot());
+        CPPUNIT_ASSERT_EQUAL(3, third.ActiveJobs());
+    }
+
+    // Slots come back when their jobs end.
+    CPPUNIT_ASSERT_EQUAL(1, first->ActiveJobs());
+    first.reset();
+    ThreadBudget again(settings);
+    CPPUNIT_ASSERT_EQUAL(0, again.GetSlot());
+}
+
+void ThreadBudgetTest::TestMoreJobsThanSlots()
+{
+    ThreadBudget::Settings settings;
+    settings.MaxJobs = 1;
+    settings.SlotDir = SLOT_DIR;
+
+    // Jobs without a slot are still seen by every other job, the one with
+    // the slot included.
+    ThreadBudget first(settings);
+    int cores = first.GetCores();
+    {
+        ThreadBudget second(settings), third(settings);
+        CPPUNIT_ASSERT_EQUAL(0, first.GetSlot());
+        CPPUNIT_ASSERT_EQUAL(-1, second.GetSlot());
+        CPPUNIT_ASSERT_EQUAL(-1, third.GetSlot());
+        CPPUNIT_ASSERT_EQUAL(3, first.ActiveJobs());
+        CPPUNIT_ASSERT_EQUAL(3, second.ActiveJobs());
+        CPPUNIT_ASSERT_EQUAL(3, third.ActiveJobs());
+
+        first.Rebalance();
+        CPPUNIT_ASSERT_EQUAL(std::max(1, cores / 3), first.GetCores());
+        CPPUNIT_ASSERT_EQUAL(std::max(1, cores / 3), third.GetCores());
+    }
+
+    // Their job files are let go when they end.
+    CPPUNIT_ASSERT_EQUAL(1, first.ActiveJobs());
+    ThreadBudget again(settings);
+    CPPUNIT_ASSERT_EQUAL(2, first.ActiveJobs());
+}
+
+void ThreadBudgetTest::TestPinning()
+{
+    ThreadBudget::Settings settings;
+    settings.MaxJobs = 2;
+    settings.SlotDir = SLOT_DIR;
+    settings.bPinThreads = true;
+
+    ThreadBudget first(settings), second(settings);
+    CPPUNIT_ASSERT(!first.GetCpus().empty());
+    CPPUNIT_ASSERT_EQUAL((int)first.GetCpus().size(), first.GetCores());
+
+    // Pinned jobs never share a core, unless there is only one.
+    size_t total = 0;
+    for(const auto& domain : ThreadBudget::CacheDomains())
+        total += domain.size();
+    if(total > 1)
+        for(int cpu : first.GetCpus())
+            CPPUNIT_ASSERT(std::find(second.GetCpus().begin(), second.GetCpus().end(), cpu) == second.GetCpus().end());
+}
+
+void ThreadBudgetTest::TestPinningOneDomain()
+{
+    // One domain gives one slot, which pinning can't split.
+    ThreadBudget::Settings settings;
+    settings.MaxJobs = 1;
+    settings.SlotDir = SLOT_DIR;
+    settings.bPinThreads = true;
+
+    ThreadBudget first(settings), second(settings), third(settings);
+    CPPUNIT_ASSERT_EQUAL(0, first.GetSlot());
+    CPPUNIT_ASSERT(first.GetCpus().empty());
+
+    // So every job shares all of the cores, and between them they use no
+    // more than there are.
+    first.Rebalance();
+    second.Rebalance();
+    size_t total = 0;
+    for(const auto& domain : ThreadBudget::CacheDomains())
+        total += domain.size();
+    int expected = std::max<int>(1, total / 3);
+    for(ThreadBudget* budget : { &first, &second, &third })
+    {
+        CPPUNIT_ASSERT(budget->GetCpus().empty());
+        CPPUNIT_ASSERT_EQUAL(expected, budget->GetCores());
+    }
+    if(total >= 3)
+        CPPUNIT_ASSERT(first.GetCores() + second.GetCores() + third.GetCores() <= (int)total);
+}
+
+void ThreadBudgetTest::TestPinningMoreJobsThanSlots()
+{
+    ThreadBudget::Settings settings;
+    settings.MaxJobs = 2;
+    settings.SlotDir = SLOT_DIR;
+    settings.bPinThreads = true;
+
+    size_t total = 0;
+    for(const auto& domain : ThreadBudget::CacheDomains())
+        total += domain.size();
+
+    auto first = std::make_unique<ThreadBudget>(settings);
+    ThreadBudget second(settings), third(settings);
+    CPPUNIT_ASSERT_EQUAL(-1, third.GetSlot());
+    CPPUNIT_ASSERT(third.GetCpus().empty());
+
+    // The job without a slot runs on every core, so the pinned jobs make
+    // room for it.
+    first->Rebalance();
+    second.Rebalance();
+    if(total >= 3)
+        CPPUNIT_ASSERT(first->GetCores() + second.GetCores() + third.GetCores() <= (int)total);
+    CPPUNIT_ASSERT(first->GetCores() <= (int)first->GetCpus().size());
+
+    // Once a slot is free, the job takes it and is pinned like the others.
+    first.reset();
+    CPPUNIT_ASSERT(third.Rebalance());
+    CPPUNIT_ASSERT_EQUAL(0, third.GetSlot());
+    CPPUNIT_ASSERT(!third.GetCpus().empty());
+    CPPUNIT_ASSERT_EQUAL((int)third.GetCpus().size(), third.GetCores());
+    CPPUNIT_ASSERT_EQUAL(2, second.ActiveJobs());
+}
@@ -0,0 +1,58 @@
+#include "test_threadpool.h"
+
+#include <chrono>
+
+void ThreadPoolTest::setUp()
+{
+    _pool = std::make_unique<ThreadPool>(4);
+}
+
+void ThreadPoolTest::TestConstructor()
+{
+    CPPUNIT_ASSERT_EQUAL(size_t(4), _pool->Size());
+
+    _pool.reset(new ThreadPool());
+    CPPUNIT_ASSERT(_pool->Size() >= 1);
+}
+
+void ThreadPoolTest::TestEnqueueOrder()
+{
+    // Earlier tasks sleep longer, so they finish last, but the futures still
+    // hand the results back in submission order.
+    std::vector<std::future<int>> results;
+    for(int i = 0; i < 8; i++)
+        results.push_back(_pool->Enqueue([](int n) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2 * (8 - n)));
+            return n * n;
+        }, i));
+
+    for(int i = 0; i < 8; i++)
+        CPPUNIT_ASSERT_EQUAL(i * i, results[i].get());
+}
+
+void ThreadPoolTest::TestEnqueueException()
+{
+    auto result = _pool->Enqueue([]() -> int { throw std::runtime_error("failed"); });
+    CPPUNIT_ASSERT_THROW(result.get(), std::runtime_error);
+}
+
+void ThreadPoolTest::TestPending()
+{
+    // One worker held up by the first task leaves the rest waiting.
+    _pool.reset(new ThreadPool(1));
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::promise<void> started;
+
+    std::vector<std::future<void>> results;
+    results.push_back(_pool->Enqueue([&started, gate]() { started.set_value(); gate.wait(); }));
+    started.get_future().wait();
+    for(int i = 0; i < 3; i++)
+        results.push_back(_pool->Enqueue([]() {}));
+    CPPUNIT_ASSERT_EQUAL(size_t(3), _pool->Pending());
+
+    release.set_value();
+    for(auto& result : results)
+        result.get();
+    CPPUNIT_ASSERT_EQUAL(size_t(0), _pool->Pending());
+}
@@ -0,0 +1,88 @@
+#include "test_thumbnails.h"
+
+/// A frame whose brightness tells which frame it was.
+cv::Mat NumberedFrame(int frame)
+{
+    return cv::Mat(160, 480, CV_8UC3, cv::Scalar::all(frame * 5));
+}
+
+void EventThumbnailsTest::setUp()
+{
+    _thumbnails = std::make_unique<EventThumbnails>(EventThumbnails::Settings());
+
+    // Two stretches of activity, 10-14 peaking at 11, and 20-21 peaking at 20.
+    double activity[] = { 1, 5, 2, 3, 1 };
+    for(int i = 0; i < 5; i++)
+        _thumbnails->Observe(10 + i, NumberedFrame(10 + i), activity[i]);
+    _thumbnails->Observe(21, NumberedFrame(21), 1);
+    _thumbnails->Observe(20, NumberedFrame(20), 4);
+    _thumbnails->Observe(30, NumberedFrame(30), 0);
+}
+
+void EventThumbnailsTest::TestAddRow()
+{
+    Thumbnail picks[EventThumbnails::N_COLUMNS];
+    CPPUNIT_ASSERT_EQUAL(0, _thumbnails->AddRow(5, 15, picks));
+    CPPUNIT_ASSERT_EQUAL(10, picks[EventThumbnails::COLUMN_START].Frame);
+    CPPUNIT_ASSERT_EQUAL(11, picks[EventThumbnails::COLUMN_PEAK].Frame);
+    CPPUNIT_ASSERT_EQUAL(14, picks[EventThumbnails::COLUMN_END].Frame);
+    CPPUNIT_ASSERT(picks[EventThumbnails::COLUMN_PEAK].Image.size() == cv::Size(240, 80));
+
+    // Frames that arrive out of order start their own stretch, and an event
+    // covering several stretches takes from all of them.
+    CPPUNIT_ASSERT_EQUAL(1, _thumbnails->AddRow(12, 25, picks));
+    CPPUNIT_ASSERT_EQUAL(10, picks[EventThumbnails::COLUMN_START].Frame);
+    CPPUNIT_ASSERT_EQUAL(11, picks[EventThumbnails::COLUMN_PEAK].Frame);
+    CPPUNIT_ASSERT_EQUAL(21, picks[EventThumbnails::COLUMN_END].Frame);
+
+    // Frames without activity are never kept.
+    CPPUNIT_ASSERT_EQUAL(-1, _thumbnails->AddRow(25, 40, picks));
+}
+
+void EventThumbnailsTest::TestWriteSheet()
+{
+    CPPUNIT_ASSERT(!_thumbnails->WriteSheet("thumbnails_test.jpg"));
+
+    Thumbnail picks[EventThumbnails::N_COLUMNS];
+    _thumbnails->AddRow(5, 15, picks);
+    _thumbnails->AddRow(18, 22, picks);
+    CPPUNIT_ASSERT(_thumbnails->WriteSheet("thumbnails_test.jpg"));
+
+    cv::Mat sheet = cv::imread("thumbnails_test.jpg");
+    std::remove("thumbnails_test.jpg");
+    CPPUNIT_ASSERT(sheet.size() == cv::Size(3 * 240, 2 * 80));
+
+    // The second row is the second event: 20, 20 and 21.
+    cv::Size size = _thumbnails->GetThumbnailSize();
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(55.0, sheet.at<cv::Vec3b>(size.height / 2, size.width + size.width / 2)[0], 4.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(100.0, sheet.at<cv::Vec3b>(size.height + size.height / 2, size.width / 2)[0], 4.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(105.0, sheet.at<cv::Vec3b>(size.height + size.height / 2, 2 * size.width + size.width / 2)[0], 4.0);
+}
+
+void EventThumbnailsTest::TestSaveLoad()
+{
+    {
+        cv::FileStorage fs("thumbnails_test.yaml", cv::FileStorage::WRITE);
+        _thumbnails->Save(fs, "thumbnails");
+    }
+
+    // A resumed job carries on the stretch that ran up to the checkpoint.
+    EventThumbnails resumed{EventThumbnails::Settings()};
+    {
+        cv::FileStorage fs("thumbnails_test.yaml", cv::FileStorage::READ);
+        resumed.Load(fs["thumbnails"]);
+    }
+    std::remove("thumbnails_test.yaml");
+    CPPUNIT_ASSERT(resumed.GetThumbnailSize() == cv::Size(240, 80));
+    resumed.Observe(22, NumberedFrame(22), 9);
+
+    Thumbnail picks[EventThumbnails::N_COLUMNS];
+    CPPUNIT_ASSERT_EQUAL(0, resumed.AddRow(5, 15, picks));
+    CPPUNIT_ASSERT_EQUAL(11, picks[EventThumbnails::COLUMN_PEAK].Frame);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(55.0, picks[EventThumbnails::COLUMN_PEAK].Image.at<cv::Vec3b>(40, 120)[0], 4.0);
+
+    CPPUNIT_ASSERT_EQUAL(1, resumed.AddRow(18, 25, picks));
+    CPPUNIT_ASSERT_EQUAL(20, picks[EventThumbnails::COLUMN_START].Frame);
+    CPPUNIT_ASSERT_EQUAL(22, picks[EventThumbnails::COLUMN_PEAK].Frame);
+    CPPUNIT_ASSERT_EQUAL(22, picks[EventThumbnails::COLUMN_END].Frame);
+}
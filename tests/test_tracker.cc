@@ -1,4 +1,11 @@
 #include "test_tracker.h"
+#include "EventDetector.h"
+#include "PipelineStats.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 void TrackerTest::setUp()
@@ -40,8 +47,185 @@ void TrackerTest::TestCheckForActivity()
     _tracker->CheckForActivity(i);
 }
 
+void TrackerTest::TestReplayMask()
+{
+    // A blob in a quarter size foreground is found where it'd be on the frame.
+    cv::Mat foreground = cv::Mat::zeros(80, 120, CV_8UC1);
+    cv::circle(foreground, cv::Point(50, 30), 10, cv::Scalar(255), cv::FILLED);
+    _tracker->ReplayMask(foreground, 0.25);
+
+    auto boxes = _tracker->GetBoundingBoxes();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), boxes.size());
+    cv::Point centre = (boxes[0].tl() + boxes[0].br()) / 2;
+    CPPUNIT_ASSERT(std::abs(centre.x - 200) <= 16 && std::abs(centre.y - 120) <= 16);
+    CPPUNIT_ASSERT(_tracker->GetMask().size() == foreground.size());
+
+    // Nothing moving, nothing found.
+    _tracker->ReplayMask(cv::Mat::zeros(80, 120, CV_8UC1), 0.25);
+    CPPUNIT_ASSERT(_tracker->GetContours().empty());
+}
+
 void TrackerTest::TestGetCascades()
 {
-    _tracker->GetCascades();
+    // Files that aren't cascades, or can't be loaded, are skipped.
+    mkdir("test_cascades", 0755);
+    std::ofstream("test_cascades/notes.txt") << "not a cascade";
+    std::ofstream("test_cascades/broken.xml") << "<opencv_storage></opencv_storage>";
+
+    Tracker::Settings config;
+    config.CascadeDirectory = "test_cascades/";
+    Tracker tracker(config);
+    CPPUNIT_ASSERT(!tracker.HasCascades());
+
+    // Any cascade OpenCV was installed with will do for a real one.
+    const char* installed[] = { "/usr/share/opencv4/haarcascades/haarcascade_frontalface_default.xml",
+                                "/usr/local/share/opencv4/haarcascades/haarcascade_frontalface_default.xml" };
+    for(auto file : installed)
+        if(std::ifstream(file).good())
+        {
+            std::ofstream("test_cascades/face.xml") << std::ifstream(file).rdbuf();
+            Tracker with_cascade(config);
+            CPPUNIT_ASSERT(with_cascade.HasCascades());
+            break;
+        }
+
+    std::remove("test_cascades/notes.txt");
+    std::remove("test_cascades/broken.xml");
+    std::remove("test_cascades/face.xml");
+    rmdir("test_cascades");
+}
+
+void TrackerTest::TestClassify()
+{
+    // Without cascades every object is left unlabelled.
+    Tracker::Settings config;
+    config.CascadeDirectory = "does_not_exist/";
+    Tracker tracker(config);
+
+    cv::Mat frame(240, 320, CV_8UC3, cv::Scalar::all(128));
+    auto labels = tracker.Classify(frame, { cv::Rect(10, 10, 40, 40), cv::Rect(100, 100, 30, 30) }, { 1, 0 }, 0);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), labels.size());
+    CPPUNIT_ASSERT(labels[0].empty() && labels[1].empty());
+}
+
+void TrackerTest::TestClassifyCache()
+{
+    // A single stage cascade that takes every 24x24 window.
+    mkdir("test_classify_cascades", 0755);
+    std::ofstream("test_classify_cascades/always.xml") <<
+        "<?xml version=\"1.0\"?>\n<opencv_storage>\n<cascade>\n"
+        "  <stageType>BOOST</stageType>\n  <featureType>HAAR</featureType>\n"
+        "  <height>24</height>\n  <width>24</width>\n"
+        "  <stageParams><maxWeakCount>1</maxWeakCount></stageParams>\n"
+        "  <featureParams><maxCatCount>0</maxCatCount></featureParams>\n"
+        "  <stageNum>1</stageNum>\n"
+        "  <stages><_>\n    <maxWeakCount>1</maxWeakCount>\n    <stageThreshold>-1.</stageThreshold>\n"
+        "    <weakClassifiers><_>\n      <internalNodes>0 -1 0 0.</internalNodes>\n"
+        "      <leafValues>1. 1.</leafValues></_></weakClassifiers></_></stages>\n"
+        "  <features><_><rects>\n    <_>0 0 24 24 -1.</_>\n    <_>0 0 12 24 2.</_></rects></_></features>\n"
+        "</cascade>\n</opencv_storage>\n";
+
+    Tracker::Settings config;
+    config.CascadeDirectory = "test_classify_cascades/";
+    config.ClassifyMargin = 0;
+    config.ClassifyInterval = 15;
+    Tracker tracker(config);
+    tracker.Stats = std::make_shared<PipelineStats>();
+    std::remove("test_classify_cascades/always.xml");
+    rmdir("test_classify_cascades");
+    CPPUNIT_ASSERT(tracker.HasCascades());
+
+    // The first object is big enough to be found, the second is smaller than
+    // the cascade's window, and the third isn't an object yet.
+    cv::Mat frame(240, 320, CV_8UC3, cv::Scalar::all(128));
+    std::vector<cv::Rect> boxes = { cv::Rect(10, 10, 60, 60), cv::Rect(100, 100, 10, 10), cv::Rect(200, 100, 60, 60) };
+    std::vector<int> ids = { 1, 2, 0 };
+    auto runs = [&]() { return tracker.Stats->GetStage(STAGE_CLASSIFY).Count(); };
+
+    auto labels = tracker.Classify(frame, boxes, ids, 0);
+    CPPUNIT_ASSERT_EQUAL(std::string("always"), labels[0]);
+    CPPUNIT_ASSERT(labels[1].empty() && labels[2].empty());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), runs());
+
+    // Boxes without an ID never run the cascades.
+    tracker.Classify(frame, { boxes[2] }, { 0 }, 1);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), runs());
+
+    // The label is kept, and the object that wasn't recognised waits for
+    // ClassifyInterval frames before it is tried again.
+    labels = tracker.Classify(frame, boxes, ids, 14);
+    CPPUNIT_ASSERT_EQUAL(std::string("always"), labels[0]);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), runs());
+
+    labels = tracker.Classify(frame, boxes, ids, 15);
+    CPPUNIT_ASSERT_EQUAL(std::string("always"), labels[0]);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(2), runs());
+}
+
+
+
+void TrackerTest::TestSaveLoad()
+{
+    _tracker->ActivityRange.push_back(new ActivityEvent(1, 10, 20));
+    _tracker->ActivityRange.push_back(new ActivityEvent(2, 30, -1));
+
+    std::string file = "tracker_checkpoint.yaml";
+    {
+        cv::FileStorage fs(file, cv::FileStorage::WRITE);
+        _tracker->Save(fs, "tracker");
+    }
+
+    Tracker::Settings config;
+    Tracker loaded(config);
+    {
+        cv::FileStorage fs(file, cv::FileStorage::READ);
+        loaded.Load(fs["tracker"]);
+    }
+    std::remove(file.c_str());
+
+    // The open event is still open, so it carries on in a resumed run.
+    CPPUNIT_ASSERT_EQUAL(size_t(2), loaded.ActivityRange.size());
+    CPPUNIT_ASSERT(loaded.ActivityRange[0]->GetRange() == std::make_pair(10, 20));
+    CPPUNIT_ASSERT(loaded.ActivityRange[1]->GetRange().first == 30);
+    CPPUNIT_ASSERT(loaded.ActivityRange[1]->IsActive());
 }
 
+void TrackerTest::TestSeedBackground()
+{
+    // A smooth scene with nothing moving in it.
+    cv::Mat scene(120, 160, CV_8UC3);
+    for(int y = 0; y < scene.rows; y++)
+        for(int x = 0; x < scene.cols; x++)
+            scene.at<cv::Vec3b>(y, x) = cv::Vec3b((unsigned char)(x * 3 / 2), (unsigned char)(y * 2), 128);
+
+    // A cold model sees the whole first frame as foreground.
+    CPPUNIT_ASSERT(_tracker->GetBackground().empty());
+    cv::Mat frame = scene.clone();
+    _tracker->CreateMask(frame);
+    CPPUNIT_ASSERT(cv::mean(_tracker->GetForeground())[0] > 200.0);
+
+    // Its background, saved at half size, warms up the next model.
+    for(int i = 0; i < 9; i++)
+    {
+        frame = scene.clone();
+        _tracker->CreateMask(frame);
+    }
+    cv::Mat background = _tracker->GetBackground();
+    CPPUNIT_ASSERT(background.size() == scene.size());
+    cv::resize(background, background, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+
+    Tracker warm(_tracker->Config);
+    warm.SeedBackground(background);
+    frame = scene.clone();
+    warm.CreateMask(frame);
+    CPPUNIT_ASSERT(cv::mean(warm.GetForeground())[0] < 10.0);
+
+    // A background of some other scene is left out.
+    Tracker moved(_tracker->Config);
+    cv::Mat other;
+    cv::bitwise_not(scene, other);
+    moved.SeedBackground(other);
+    frame = scene.clone();
+    moved.CreateMask(frame);
+    CPPUNIT_ASSERT(cv::mean(moved.GetForeground())[0] > 200.0);
+}